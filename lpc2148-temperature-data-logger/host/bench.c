@@ -0,0 +1,553 @@
+#include <stdio.h>           // Report and JSON files
+#include <stdlib.h>          // atoi, atof, malloc
+#include <string.h>          // strcmp, strstr
+#include <time.h>            // Host clock
+#include "types.h"           // Custom data types (u8, u32, f64)
+#include "sim.h"             // Register model
+#include "lcd.h"             // IntLCD, FltLCD, LCD_Flush
+#include "uart.h"            // UART transmit functions
+#include "uart_defines.h"    // UART_TX_BUF_SIZE
+#include "delay.h"           // Delay_Init
+#include "edit.h"            // Number entry, GetMaxDays
+#include "fmt.h"             // Formatting routines
+#include "lm35.h"            // lm35Code, Read_LM35
+#include "tscomp.h"          // TSC_Encode
+#include "adc.h"             // Scan engine, adcSampleCnt
+
+/* ================= DRIVER MICRO-BENCHMARKS ================= */
+/*
+ * lpc_bench runs each driver and formatting routine against the
+ * register model and reports per operation:
+ *
+ *   ns      host time of the call (model overhead included, so
+ *           only comparable with runs on the same machine)
+ *   bytes   bytes the UART sent plus bytes the LCD latched
+ *   regs    register accesses, including the UART interrupts
+ *           that send the queued bytes
+ *   cycles  virtual PCLK cycles of the call
+ *
+ * An op may have a prep step, run before each call and not
+ * measured, to set up its input on the register model.
+ *
+ *   lpc_bench [-i iters] [-j out.json] [-b baseline.json] [-n factor]
+ *
+ * -b compares with a stored run: more bytes, register accesses
+ * or cycles per op than the baseline fail (these are exact for a
+ * given iteration count); ns/op only fails beyond -n times the
+ * baseline, since it depends on the host.
+ */
+
+#define BENCH_ITERS  1000
+
+extern volatile s32 temp[];
+
+static volatile u32 benchSink;       // Keeps pure results alive
+
+/* ================= INPUTS ================= */
+/*
+ * Function: Mix
+ * Purpose : Repeatable pseudo-random input for iteration i
+ */
+static u32 Mix(u32 i)
+{
+    i = (i + 0x9E3779B9) * 0x85EBCA6B;
+    i ^= i >> 13;
+    i *= 0xC2B2AE35;
+    return i ^ (i >> 16);
+}
+
+// Values of every digit count, small ones as often as large ones
+static u32 MixU32(u32 i)
+{
+    return Mix(i) >> (i % 32);
+}
+
+static f32 MixF32(u32 i)
+{
+    return (f32)((s32)(Mix(i) % 2000001) - 1000000) / 100;
+}
+
+/* ================= OPERATIONS ================= */
+
+static void Op_UARTTxU32(u32 i)
+{
+    UARTTxU32(MixU32(i));
+}
+
+static void Op_UARTTxF32(u32 i)
+{
+    UARTTxF32(MixF32(i));
+}
+
+static void Op_UARTTX_Data(u32 i)
+{
+    static const u16 flags[4] =
+    {
+        0, LOGREC_F_WARN, LOGREC_F_ALERT | LOGREC_F_OVERTEMP,
+        LOGREC_F_ALERT | LOGREC_F_RATE
+    };
+
+    temp[1] = (s32)(Mix(i) % 12000) - 2000;
+    UARTTX_Data(1, flags[i % 4], i % 24, i % 60, (i * 7) % 60,
+                1 + i % 28, 1 + i % 12, 2000 + i % 100);
+}
+
+static void Op_IntLCD(u32 i)
+{
+    CmdLCD(0x80);
+    IntLCD((s32)MixU32(i));
+    LCD_Flush();
+}
+
+static void Op_FltLCD(u32 i)
+{
+    CmdLCD(0xC0);
+    FltLCD(MixF32(i));
+    LCD_Flush();
+}
+
+static void Op_Read_LM35(u32 i)
+{
+    lm35Code[1] = Mix(i) % (LM35_CODE_MAX + 1);
+    benchSink += (u32)(s32)Read_LM35(1, (i & 1) ? 'F' : 'C');
+}
+
+/*
+ * Function: Op_NumberKey
+ * Purpose : Enters a 4-digit value and ENTER, as the edit menus
+ *           do for every numeric field
+ */
+static void Op_NumberKey(u32 i)
+{
+    u32 v = Mix(i) % 10000;
+
+    CmdLCD(0xC0);
+    StartNumber(FLD_YEAR, 4, 9999);
+    NumberKey(v / 1000);
+    NumberKey((v / 100) % 10);
+    NumberKey((v / 10) % 10);
+    NumberKey(v % 10);
+    if(!NumberKey(15) || edVal != v)
+        Sim_Fail("NumberKey: %u read as %u", v, edVal);
+    LCD_Flush();
+}
+
+static void Op_GetMaxDays(u32 i)
+{
+    benchSink += GetMaxDays(1 + i % 12, 1900 + Mix(i) % 400);
+}
+
+static void Op_Fmt_U32(u32 i)
+{
+    u8 buf[FMT_U32_MAX];
+
+    benchSink += Fmt_U32(buf, MixU32(i)) - buf;
+}
+
+static void Op_Fmt_Centi(u32 i)
+{
+    u8 buf[1 + FMT_U32_MAX + 1 + 2];
+
+    benchSink += Fmt_Centi(buf, (s32)Mix(i)) - buf;
+}
+
+static void Op_Fmt_F32(u32 i)
+{
+    u8 buf[1 + FMT_U32_MAX + 1 + 6];
+
+    benchSink += Fmt_F32(buf, MixF32(i), 6) - buf;
+}
+
+/*
+ * Function: Op_TSC_Encode
+ * Purpose : Compresses one record of a 4-channel per-minute
+ *           series (slow drift, an alarm now and then), with a
+ *           key frame every 32 records as packed frames get
+ */
+static void Op_TSC_Encode(u32 i)
+{
+    static TSCState ts;
+    static s32 centi[TSC_NUM_CH];
+    u8  buf[TSC_REC_MAX];
+    u32 ch = i % TSC_NUM_CH, epoch = 1767394800 + (i / TSC_NUM_CH) * 60;
+    u32 r = Mix(i);
+
+    if(i % 32 == 0)
+        TSC_Start(&ts, epoch);
+    centi[ch] += (s32)(r % 21) - 10;
+    if(r % 97 == 0)
+        centi[ch] += 400;                 // Step change
+    benchSink += TSC_Encode(&ts, buf, epoch + ((r >> 8) % 50 == 0), 2500 + centi[ch],
+                            ch, (r % 61 == 0) ? LOGREC_F_ALERT : 0);
+}
+
+/*
+ * Function: Prep_Sample
+ * Purpose : Runs the scan engine on CH1 until one sample is in
+ *           the ring, then stops it, so each LM35_Update call
+ *           handles exactly one sample (every LM35_OSR-th call
+ *           also decimates and filters)
+ */
+static void Prep_Sample(u32 i)
+{
+    u32 n = adcSampleCnt;
+
+    if(i == 0)
+        Init_ADC(1);
+    Sim_Temp(1, 2500 + (s32)(Mix(i) % 50));
+    ADC_StartScan(1 << 1, 10000);
+    while(adcSampleCnt == n)
+        Sim_Idle(SIM_US(10));
+    ADC_StopSampling();
+}
+
+/*
+ * Function: Op_Temp_Float / Op_Temp_Fixed
+ * Purpose : One reading from ADC code to 2-decimal text, through
+ *           the float formula Read_LM35 used before the tables and
+ *           through the centi-degree pipeline. The host has an
+ *           FPU, so the gap is smaller here than on the ARM7TDMI,
+ *           where every float operation is a library call.
+ */
+static void Op_Temp_Float(u32 i)
+{
+    u8  buf[1 + FMT_U32_MAX + 1 + 2];
+    u32 code = Mix(i) % LM35_LUT_SIZE;
+    f32 eAR = code * (3.3 / 1023);
+    f32 temp = eAR * 100;
+
+    if(i & 1)
+        temp = ((temp * (9/5.0)) + 32);
+    benchSink += Fmt_F32(buf, temp, 2) - buf;
+}
+
+static void Op_Temp_Fixed(u32 i)
+{
+    u8 buf[1 + FMT_U32_MAX + 1 + 2];
+
+    lm35Code[1] = (Mix(i) % LM35_LUT_SIZE) << LM35_EXTRA_BITS;
+    benchSink += Fmt_Centi(buf, Read_LM35_Centi(1, (i & 1) ? 'F' : 'C')) - buf;
+}
+
+// Cost per sample of the oversample / decimate / filter stage
+static void Op_LM35_Update(u32 i)
+{
+    LM35_Update();
+    benchSink += lm35Code[1];
+}
+
+static void DrainUart(void);
+
+/*
+ * Function: Prep_TxRoom / Op_UARTTxEnq
+ * Purpose : Queues one byte behind others still being sent, the
+ *           usual case while a log line goes out; the ring is
+ *           drained, unmeasured, before it can fill
+ */
+static void Prep_TxRoom(u32 i)
+{
+    if(UARTTxFree() < 64)
+        DrainUart();
+}
+
+static void Op_UARTTxEnq(u32 i)
+{
+    benchSink += UARTTxEnq('0' + i % 10);
+}
+
+typedef struct
+{
+    const char *name;
+    void (*fn)(u32 i);
+    u8 uart;                          // Drain the UART after each op
+    void (*prep)(u32 i);              // Unmeasured set-up (0 = none)
+} BenchOp;
+
+static const BenchOp benchOps[] =
+{
+    { "UARTTxU32",    Op_UARTTxU32,   1 },
+    { "UARTTxF32",    Op_UARTTxF32,   1 },
+    { "UARTTX_Data",  Op_UARTTX_Data, 1 },
+    { "IntLCD",       Op_IntLCD,      0 },
+    { "FltLCD",       Op_FltLCD,      0 },
+    { "Read_LM35",    Op_Read_LM35,   0 },
+    { "NumberKey",    Op_NumberKey,   0 },
+    { "GetMaxDays",   Op_GetMaxDays,  0 },
+    { "Fmt_U32",      Op_Fmt_U32,     0 },
+    { "Fmt_Centi",    Op_Fmt_Centi,   0 },
+    { "Fmt_F32",      Op_Fmt_F32,     0 },
+    { "TSC_Encode",   Op_TSC_Encode,  0 },
+    { "LM35_Update",  Op_LM35_Update, 0, Prep_Sample },
+    { "Temp_Float",   Op_Temp_Float,  0 },
+    { "Temp_Fixed",   Op_Temp_Fixed,  0 },
+    { "UARTTxEnq",    Op_UARTTxEnq,   0, Prep_TxRoom },
+};
+
+#define BENCH_NUM_OPS  (sizeof(benchOps) / sizeof(benchOps[0]))
+
+typedef struct
+{
+    f64 ns, bytes, regs, cycles;
+} BenchRes;
+
+/* ================= MEASUREMENT ================= */
+
+static f64 HostNs(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+/*
+ * Function: TimerCost
+ * Purpose : Smallest time measured around nothing
+ */
+static f64 TimerCost(void)
+{
+    f64 t, best = 1e9;
+    u32 i;
+
+    for(i = 0; i < 1000; i++)
+    {
+        t = HostNs();
+        t = HostNs() - t;
+        if(t < best)
+            best = t;
+    }
+    return best;
+}
+
+static u64 BytesOut(void)
+{
+    return simStats.uartBytes + simStats.lcdWrites;
+}
+
+/*
+ * Function: DrainUart
+ * Purpose : Lets the UART interrupt send everything queued
+ */
+static void DrainUart(void)
+{
+    while(UARTTxFree() != UART_TX_BUF_SIZE || Sim_UartBusy())
+        Sim_Idle(SIM_US(1000));
+}
+
+static void Bench_Run(const BenchOp *op, u32 iters, f64 tcost, BenchRes *r)
+{
+    u64 acc, out, cyc;
+    f64 t;
+    u32 i;
+
+    memset(r, 0, sizeof(*r));
+    for(i = 0; i < iters; i++)
+    {
+        if(op->prep)
+            op->prep(i);
+        acc = simStats.accesses;
+        out = BytesOut();
+        cyc = Sim_Now();
+
+        t = HostNs();
+        op->fn(i);
+        t = HostNs() - t - tcost;
+
+        r->cycles += Sim_Now() - cyc;
+        r->ns     += (t > 0) ? t : 0;
+        if(op->uart)
+            DrainUart();
+        r->regs   += simStats.accesses - acc;
+        r->bytes  += BytesOut() - out;
+    }
+    r->ns     /= iters;
+    r->bytes  /= iters;
+    r->regs   /= iters;
+    r->cycles /= iters;
+}
+
+/* ================= JSON ================= */
+
+static void Json_Write(FILE *f, u32 iters, const BenchRes *res)
+{
+    u32 i;
+
+    fprintf(f, "{\n  \"iters\": %u,\n  \"ops\": [\n", iters);
+    for(i = 0; i < BENCH_NUM_OPS; i++)
+        fprintf(f, "    { \"name\": \"%s\", \"ns_per_op\": %.1f, "
+                   "\"bytes_per_op\": %.3f, \"regs_per_op\": %.3f, "
+                   "\"cycles_per_op\": %.3f }%s\n",
+                benchOps[i].name, res[i].ns, res[i].bytes, res[i].regs,
+                res[i].cycles, (i + 1 < BENCH_NUM_OPS) ? "," : "");
+    fprintf(f, "  ]\n}\n");
+}
+
+/*
+ * Function: Json_Get
+ * Purpose : Reads one number of one op from a file written by
+ *           Json_Write (op = 0 for the top level)
+ */
+static u8 Json_Get(const char *js, const char *op, const char *key, f64 *v)
+{
+    char pat[64];
+    const char *p = js, *end = 0;
+
+    if(op)
+    {
+        snprintf(pat, sizeof(pat), "\"name\": \"%s\"", op);
+        if(!(p = strstr(js, pat)))
+            return 0;
+        end = strchr(p, '}');
+    }
+    snprintf(pat, sizeof(pat), "\"%s\":", key);
+    p = strstr(p, pat);
+    if(!p || (end && p > end))
+        return 0;
+    *v = atof(p + strlen(pat));
+    return 1;
+}
+
+static char *ReadFile(const char *path)
+{
+    FILE *f = fopen(path, "rb");
+    char *buf;
+    long n;
+
+    if(!f)
+        return 0;
+    fseek(f, 0, SEEK_END);
+    n = ftell(f);
+    rewind(f);
+    buf = malloc(n + 1);
+    if(buf && fread(buf, 1, n, f) != (size_t)n)
+    {
+        free(buf);
+        buf = 0;
+    }
+    if(buf)
+        buf[n] = '\0';
+    fclose(f);
+    return buf;
+}
+
+/*
+ * Function: Bench_Compare
+ * Purpose : Checks the results against a baseline run
+ * Returns : Number of regressions
+ */
+static u32 Bench_Compare(const char *js, u32 iters, const BenchRes *res,
+                         f64 nsFactor)
+{
+    static const char *keys[3] = { "bytes_per_op", "regs_per_op", "cycles_per_op" };
+    f64 base, cur;
+    u32 i, k, bad = 0;
+
+    if(!Json_Get(js, 0, "iters", &base) || (u32)base != iters)
+    {
+        printf("baseline was taken with %.0f iterations, not %u\n", base, iters);
+        return 1;
+    }
+
+    for(i = 0; i < BENCH_NUM_OPS; i++)
+    {
+        for(k = 0; k < 3; k++)
+        {
+            cur = (k == 0) ? res[i].bytes : (k == 1) ? res[i].regs : res[i].cycles;
+            if(!Json_Get(js, benchOps[i].name, keys[k], &base))
+            {
+                printf("%-12s %s missing from baseline\n", benchOps[i].name, keys[k]);
+                bad++;
+            }
+            else if(cur > base + 0.001)
+            {
+                printf("%-12s %s %.3f, baseline %.3f\n",
+                       benchOps[i].name, keys[k], cur, base);
+                bad++;
+            }
+        }
+        if(nsFactor > 0 && Json_Get(js, benchOps[i].name, "ns_per_op", &base) &&
+           res[i].ns > base * nsFactor)
+        {
+            printf("%-12s ns_per_op %.1f, baseline %.1f\n",
+                   benchOps[i].name, res[i].ns, base);
+            bad++;
+        }
+    }
+    return bad;
+}
+
+/* ================= MAIN ================= */
+
+int main(int argc, char **argv)
+{
+    BenchRes res[BENCH_NUM_OPS];
+    const char *jsonPath = 0, *basePath = 0;
+    u32 iters = BENCH_ITERS, i, bad = 0;
+    f64 tcost, nsFactor = 0;
+    char *js;
+    FILE *f;
+
+    for(i = 1; i + 1 < (u32)argc; i += 2)
+    {
+        if(!strcmp(argv[i], "-i"))
+            iters = atoi(argv[i + 1]);
+        else if(!strcmp(argv[i], "-j"))
+            jsonPath = argv[i + 1];
+        else if(!strcmp(argv[i], "-b"))
+            basePath = argv[i + 1];
+        else if(!strcmp(argv[i], "-n"))
+            nsFactor = atof(argv[i + 1]);
+        else
+            break;
+    }
+    if(i != (u32)argc || !iters)
+    {
+        fprintf(stderr, "usage: lpc_bench [-i iters] [-j out.json] "
+                        "[-b baseline.json] [-n factor]\n");
+        return 2;
+    }
+
+    /* --------- DRIVERS UP, AS main() LEAVES THEM --------- */
+    Sim_Init();
+    Delay_Init();
+    InitLCD();
+    InitUART();
+    LM35_InitCal();
+    LCD_SetSync(0);
+    DrainUart();
+
+    tcost = TimerCost();
+    printf("%-12s %9s %9s %9s %10s\n", "op", "ns/op", "bytes/op", "regs/op", "cycles/op");
+    for(i = 0; i < BENCH_NUM_OPS; i++)
+    {
+        Bench_Run(&benchOps[i], iters, tcost, &res[i]);
+        printf("%-12s %9.1f %9.3f %9.3f %10.3f\n", benchOps[i].name,
+               res[i].ns, res[i].bytes, res[i].regs, res[i].cycles);
+    }
+
+    if(jsonPath)
+    {
+        f = strcmp(jsonPath, "-") ? fopen(jsonPath, "w") : stdout;
+        if(!f)
+        {
+            fprintf(stderr, "lpc_bench: cannot write %s\n", jsonPath);
+            return 2;
+        }
+        Json_Write(f, iters, res);
+        if(f != stdout)
+            fclose(f);
+    }
+
+    if(basePath)
+    {
+        if(!(js = ReadFile(basePath)))
+        {
+            fprintf(stderr, "lpc_bench: cannot read %s\n", basePath);
+            return 2;
+        }
+        bad = Bench_Compare(js, iters, res, nsFactor);
+        free(js);
+        printf("%s against %s\n", bad ? "REGRESSION" : "no regression", basePath);
+    }
+    return bad ? 1 : 0;
+}
@@ -0,0 +1,56 @@
+# ================= DECODER CHECK =================
+# Run by ctest: the same scenario is simulated in text mode and
+# in log format FMT, the capture is decoded with lpc_decode and
+# must give the same log lines, byte for byte.
+#
+#   cmake -DSIM=lpc_sim -DDECODE=lpc_decode -DSCN=file.scn
+#         -DFMT=binary|packed [-DAGG=1] -DSECS=n -P decode_test.cmake
+
+set(base ${CMAKE_CURRENT_BINARY_DIR}/decode_${FMT})
+set(sim_args -t ${SECS} -s ${SCN})
+if(AGG)
+    set(base ${base}_agg)
+    list(APPEND sim_args -a)
+endif()
+
+execute_process(COMMAND ${SIM} ${sim_args} -u ${base}_text.txt
+                OUTPUT_QUIET RESULT_VARIABLE rc)
+if(NOT rc EQUAL 0)
+    message(FATAL_ERROR "text run failed: ${rc}")
+endif()
+execute_process(COMMAND ${SIM} ${sim_args} -l ${FMT} -u ${base}.bin
+                OUTPUT_QUIET RESULT_VARIABLE rc)
+if(NOT rc EQUAL 0)
+    message(FATAL_ERROR "${FMT} run failed: ${rc}")
+endif()
+execute_process(COMMAND ${DECODE} -v ${base}.bin
+                OUTPUT_FILE ${base}_decoded.txt RESULT_VARIABLE rc)
+if(NOT rc EQUAL 0)
+    message(FATAL_ERROR "lpc_decode reported bad or lost frames")
+endif()
+
+file(STRINGS ${base}_text.txt text)
+file(STRINGS ${base}_decoded.txt decoded)
+list(LENGTH text n_text)
+list(LENGTH decoded n_decoded)
+message(STATUS "${n_text} text lines, ${n_decoded} decoded")
+if(n_text EQUAL 0)
+    message(FATAL_ERROR "no log lines in text mode")
+endif()
+
+# Report the first difference, not just that there is one
+math(EXPR last "${n_text} - 1")
+foreach(i RANGE ${last})
+    list(GET text ${i} a)
+    if(i LESS n_decoded)
+        list(GET decoded ${i} b)
+    else()
+        set(b "<missing>")
+    endif()
+    if(NOT a STREQUAL b)
+        message(FATAL_ERROR "line ${i} differs:\n  text:    ${a}\n  decoded: ${b}")
+    endif()
+endforeach()
+if(NOT n_text EQUAL n_decoded)
+    message(FATAL_ERROR "decoded ${n_decoded} lines, text mode ${n_text}")
+endif()
@@ -0,0 +1,2 @@
+/* Keil resolves includes case-insensitively, the host does not */
+#include "keyPd.h"
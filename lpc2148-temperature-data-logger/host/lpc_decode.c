@@ -0,0 +1,256 @@
+#include <stdio.h>           // Capture in, text out
+#include <string.h>          // strcmp
+#include "types.h"           // Custom data types (u8, u16, u32, s16)
+#include "logrec.h"          // Frame format, CRC16, COBS_Decode
+#include "tscomp.h"          // Packed record decoder
+#include "stats.h"           // Summary record
+#include "rtc.h"             // RTC_FromEpoch
+#include "fmt.h"             // Same number formatting as the firmware
+
+/* ================= HOST LOG DECODER ================= */
+/*
+ * lpc_decode turns a UART capture of the binary or packed log
+ * format (logrec.h) back into the lines text mode sends:
+ *
+ *   lpc_decode [-v] [capture.bin]       (default stdin)
+ *
+ * Record frames give "[INFO]/[WARN]/[ALERT] CHn Temp: ..." lines,
+ * summary frames "[STAT] ..." lines, in the order received. Bad
+ * CRCs and packed frames after a lost one (up to the next key
+ * frame) are skipped; -v reports them on stderr. Exits 1 if any
+ * frame was skipped.
+ */
+
+#define DEC_FRAME_MAX  512           // Larger encoded frames are noise
+
+static u32 badFrames;                // CRC, COBS or length errors
+static u32 lostFrames;               // Packed frames out of sequence
+
+static TSCState pkState;             // Packed decoder, runs on
+static u8  pkSync;                   // pkState follows the stream
+
+/* ================= FIELD ACCESS ================= */
+
+static u32 GetU16(const u8 *p)
+{
+    return p[0] | (p[1] << 8);
+}
+
+static u32 GetU32(const u8 *p)
+{
+    return GetU16(p) | (GetU16(p + 2) << 16);
+}
+
+/* ================= TEXT LINES ================= */
+/*
+ * Function: FmtStamp
+ * Purpose : Writes "HH:MM:SS DD/MM/YYYY" for an epoch
+ */
+static u8 *FmtStamp(u8 *p, u32 epoch)
+{
+    RTCTime t;
+
+    RTC_FromEpoch(epoch, &t);
+    p = Fmt_Time(p, t.hour, t.min, t.sec);
+    *p++ = ' ';
+    return Fmt_Date(p, t.dom, t.month, t.year);
+}
+
+/*
+ * Function: PutRecord
+ * Purpose : Prints one record as UARTTX_Data formats it
+ */
+static void PutRecord(u32 epoch, s32 centiC, u16 code)
+{
+    u8 line[FMT_LINE_MAX];
+    u8 *p = line;
+
+    if(code & LOGREC_F_ALERT)
+        p = Fmt_Str(p, "[ALERT] ");
+    else if(code & LOGREC_F_WARN)
+        p = Fmt_Str(p, "[WARN] ");
+    else
+        p = Fmt_Str(p, "[INFO] ");
+
+    p = Fmt_Str(p, "CH");
+    *p++ = ((code >> LOGREC_CH_BITS) & 3) + '0';
+    p = Fmt_Str(p, " Temp: ");
+    p = Fmt_Centi(p, centiC);
+    p = Fmt_Str(p, " C | ");
+    p = FmtStamp(p, epoch);
+
+    if(code & LOGREC_F_OVERTEMP)
+        p = Fmt_Str(p, " **OVER TEMP**");
+    if(code & LOGREC_F_RATE)
+        p = Fmt_Str(p, " **RATE**");
+    p = Fmt_Str(p, "\r\n");
+
+    fwrite(line, 1, p - line, stdout);
+}
+
+/*
+ * Function: PutStats
+ * Purpose : Prints one summary frame as UARTTX_Stats formats it
+ */
+static void PutStats(const u8 *f)
+{
+    u8 line[FMT_LINE_MAX];
+    u8 *p = line;
+
+    p = Fmt_Str(p, "[STAT] CH");
+    *p++ = (f[4] & 3) + '0';
+    p = Fmt_Str(p, " n: ");
+    p = Fmt_U32(p, GetU32(&f[5]));
+    p = Fmt_Str(p, " Mean: ");
+    p = Fmt_Centi(p, (s16)GetU16(&f[9]));
+    p = Fmt_Str(p, " SD: ");
+    p = Fmt_Centi(p, GetU16(&f[11]));
+    p = Fmt_Str(p, " Min: ");
+    p = Fmt_Centi(p, (s16)GetU16(&f[13]));
+    p = Fmt_Str(p, " @+");
+    p = Fmt_U32(p, GetU16(&f[15]));
+    p = Fmt_Str(p, "s Max: ");
+    p = Fmt_Centi(p, (s16)GetU16(&f[17]));
+    p = Fmt_Str(p, " @+");
+    p = Fmt_U32(p, GetU16(&f[19]));
+    p = Fmt_Str(p, "s | ");
+    p = FmtStamp(p, GetU32(&f[0]));
+    p = Fmt_Str(p, "\r\n");
+
+    fwrite(line, 1, p - line, stdout);
+}
+
+/* ================= FRAME DECODING ================= */
+/*
+ * Function: DecodePacked
+ * Purpose : Decodes a packed frame; the encoder state carries
+ *           over from the previous frame unless this is a key
+ * Returns : 0 if the frame cannot be decoded
+ */
+static u8 DecodePacked(const u8 *f, u32 len)
+{
+    u32 n = f[4] & LOGREC_PK_COUNT, pos = 5, used;
+    FlashRec r;
+
+    if(f[4] & LOGREC_KEY)
+    {
+        TSC_Start(&pkState, GetU32(f));
+        pkSync = 1;
+    }
+    else if(!pkSync || (pkState.epoch != GetU32(f)))
+    {
+        lostFrames++;                    // Wait for the next key
+        pkSync = 0;
+        return 1;
+    }
+
+    while(n--)
+    {
+        used = TSC_Decode(&pkState, &f[pos], len - pos, &r);
+        if(!used)
+        {
+            pkSync = 0;
+            return 0;
+        }
+        pos += used;
+        PutRecord(r.epoch, r.temp, r.code);
+    }
+    return pos == len;
+}
+
+/*
+ * Function: DecodeFrame
+ * Purpose : Checks one COBS frame and prints what it holds
+ */
+static void DecodeFrame(const u8 *enc, u32 encLen)
+{
+    u8  f[DEC_FRAME_MAX];
+    u32 len, i, n;
+    const u8 *r;
+
+    len = COBS_Decode(enc, encLen, f);
+    if((len < 3) || (CRC16(f, len - 2, 0xFFFF) != GetU16(&f[len - 2])))
+    {
+        badFrames++;
+        return;
+    }
+    len -= 2;
+    if(len < 5)
+    {
+        badFrames++;
+        return;
+    }
+
+    if(f[4] & LOGREC_STATS)
+    {
+        if(len == 21)
+            PutStats(f);
+        else
+            badFrames++;
+        return;
+    }
+
+    if(f[4] & LOGREC_PACKED)
+    {
+        if(!DecodePacked(f, len))
+            badFrames++;
+        return;
+    }
+
+    n = f[4];
+    if(len != 5 + n * LOGREC_REC_SIZE)
+    {
+        badFrames++;
+        return;
+    }
+    for(i = 0, r = &f[5]; i < n; i++, r += LOGREC_REC_SIZE)
+        PutRecord(GetU32(f) + r[0], (s16)GetU16(&r[1]), GetU16(&r[3]));
+}
+
+/* ================= MAIN ================= */
+
+int main(int argc, char **argv)
+{
+    static u8 enc[DEC_FRAME_MAX];
+    FILE *in = stdin;
+    u32 encLen = 0, over = 0;
+    u8  verbose = 0;
+    int c, i;
+
+    for(i = 1; i < argc; i++)
+    {
+        if(!strcmp(argv[i], "-v"))
+            verbose = 1;
+        else if(!(in = fopen(argv[i], "rb")))
+        {
+            fprintf(stderr, "lpc_decode: cannot read %s\n", argv[i]);
+            return 2;
+        }
+    }
+
+    // Any 0x00 ends a frame; empty frames between two are ignored
+    while((c = fgetc(in)) != EOF)
+    {
+        if(c != 0)
+        {
+            if(encLen < sizeof(enc))
+                enc[encLen++] = c;
+            else
+                over = 1;
+            continue;
+        }
+        if(over)
+            badFrames++;
+        else if(encLen)
+            DecodeFrame(enc, encLen);
+        encLen = 0;
+        over   = 0;
+    }
+    if(encLen)
+        badFrames++;                     // Capture cut mid-frame
+
+    if(verbose || badFrames || lostFrames)
+        fprintf(stderr, "lpc_decode: %u bad frames, %u packed frames lost\n",
+                badFrames, lostFrames);
+    return (badFrames || lostFrames) ? 1 : 0;
+}
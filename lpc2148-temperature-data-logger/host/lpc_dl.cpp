@@ -0,0 +1,680 @@
+#include <cstdio>            // Report, CSV output
+#include <cstdlib>           // atoi, exit, mkdtemp
+#include <cstring>           // strcmp, memcpy
+#include <map>               // Records by history index
+#include <string>            // Paths
+#include <vector>            // Frames, command lines
+#include <fcntl.h>           // open
+#include <poll.h>            // Receive timeout
+#include <signal.h>          // Stop the simulator
+#include <sys/stat.h>        // Wait for the link to appear
+#include <sys/wait.h>        // waitpid
+#include <termios.h>         // Raw serial line
+#include <time.h>            // Host clock
+#include <unistd.h>          // read, write, fork, exec
+
+extern "C" {
+#include "types.h"           // Custom data types (u8, u16, u32)
+#include "logrec.h"          // Record code field layout
+#include "download.h"        // Protocol definitions
+#include "tscomp.h"          // Compressed block decoder
+}
+
+/* ================= HOST DOWNLOADER ================= */
+/*
+ * lpc_dl reads the RAM history from the logger with the windowed
+ * protocol in download.h:
+ *
+ *   lpc_dl [-z] [-r offset] [-o out.csv] device
+ *   lpc_dl -T lpc_sim
+ *
+ * device is the serial port (the MAX232 side of UART0, 9600 8N1)
+ * or the link made by lpc_sim -p. -z asks for compressed blocks,
+ * -r resumes at a history offset, -o writes "offset,epoch,temp,
+ * code" lines (default stdout).
+ *
+ * -T is the loopback test run by ctest: it starts lpc_sim on a
+ * pseudo-terminal and downloads the same history several times,
+ * with a stalled acknowledgement (ACK timeout), lost ACKs, an
+ * abort and resume, and compressed blocks. Every pass must give
+ * the same records as a clean one, with no gap.
+ */
+
+/* ================= FRAMING ================= */
+/*
+ * Same CRC-16/CCITT (poly 0x1021, MSB first) and COBS as
+ * logrec.c; frames on the wire are 0x00 <COBS> 0x00.
+ */
+static u16 Crc16(const u8 *buf, u32 len)
+{
+    u16 crc = 0xFFFF;
+    u32 i;
+
+    while(len--)
+    {
+        crc ^= (u16)(*buf++) << 8;
+        for(i = 0; i < 8; i++)
+            crc = (crc & 0x8000) ? (u16)((crc << 1) ^ 0x1021) : (u16)(crc << 1);
+    }
+    return crc;
+}
+
+static std::vector<u8> CobsEncode(const std::vector<u8> &src)
+{
+    std::vector<u8> dst(1);
+    u32 codePos = 0;
+    u8  code = 1;
+
+    for(u8 b : src)
+    {
+        if(b == 0)
+        {
+            dst[codePos] = code;
+            codePos = dst.size();
+            dst.push_back(0);
+            code = 1;
+            continue;
+        }
+        dst.push_back(b);
+        if(++code == 0xFF)
+        {
+            dst[codePos] = code;
+            codePos = dst.size();
+            dst.push_back(0);
+            code = 1;
+        }
+    }
+    dst[codePos] = code;
+    return dst;
+}
+
+// Returns false on a malformed block
+static bool CobsDecode(const std::vector<u8> &src, std::vector<u8> &dst)
+{
+    u32 in = 0, i;
+    u8  code;
+
+    dst.clear();
+    while(in < src.size())
+    {
+        code = src[in++];
+        if(code == 0)
+            return false;
+        for(i = 1; i < code; i++)
+        {
+            if(in >= src.size())
+                return false;
+            dst.push_back(src[in++]);
+        }
+        if((code < 0xFF) && (in < src.size()))
+            dst.push_back(0);
+    }
+    return true;
+}
+
+static u32 GetU32(const u8 *p)
+{
+    return p[0] | (p[1] << 8) | ((u32)p[2] << 16) | ((u32)p[3] << 24);
+}
+
+static bool IsText(const std::vector<u8> &buf)
+{
+    for(u8 c : buf)
+        if((c < ' ' || c > '~') && c != '\r' && c != '\n')
+            return false;
+    return true;
+}
+
+static f64 Now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* ================= SERIAL LINK ================= */
+
+class Link
+{
+public:
+    bool Open(const char *path);
+    void Close(void);
+    void Send(u8 type, const u8 *arg, u32 len);
+    void SendU32(u8 type, u32 v);
+    bool Recv(std::vector<u8> &frame, f64 timeout);
+    void Drain(f64 quiet);
+
+    u32 badFrames = 0;             // CRC or COBS errors seen
+
+private:
+    int fd = -1;
+    std::vector<u8> rx;            // Bytes since the last 0x00
+};
+
+/*
+ * Function: Link::Open
+ * Purpose : Opens the port raw at the logger's 9600 8N1
+ */
+bool Link::Open(const char *path)
+{
+    struct termios tio;
+
+    fd = open(path, O_RDWR | O_NOCTTY);
+    if(fd < 0)
+        return false;
+    if(tcgetattr(fd, &tio) == 0)
+    {
+        cfmakeraw(&tio);
+        cfsetspeed(&tio, B9600);
+        tcsetattr(fd, TCSANOW, &tio);
+    }
+    tcflush(fd, TCIOFLUSH);
+    rx.clear();
+    return true;
+}
+
+void Link::Close(void)
+{
+    if(fd >= 0)
+        close(fd);
+    fd = -1;
+}
+
+/*
+ * Function: Link::Send
+ * Purpose : Sends one command frame, led by a delimiter that
+ *           ends anything the logger had half received
+ */
+void Link::Send(u8 type, const u8 *arg, u32 len)
+{
+    std::vector<u8> body(1, type), wire(1, 0);
+    u16 crc;
+
+    body.insert(body.end(), arg, arg + len);
+    crc = Crc16(body.data(), body.size());
+    body.push_back(crc & 0xFF);
+    body.push_back(crc >> 8);
+
+    std::vector<u8> enc = CobsEncode(body);
+    wire.insert(wire.end(), enc.begin(), enc.end());
+    wire.push_back(0);
+    if(write(fd, wire.data(), wire.size()) != (ssize_t)wire.size())
+        perror("lpc_dl: write");
+}
+
+void Link::SendU32(u8 type, u32 v)
+{
+    u8 arg[4] = { (u8)v, (u8)(v >> 8), (u8)(v >> 16), (u8)(v >> 24) };
+
+    Send(type, arg, 4);
+}
+
+/*
+ * Function: Link::Recv
+ * Purpose : Waits up to timeout seconds for a frame with a good
+ *           CRC; text log lines and damaged frames are skipped
+ * Returns : false on timeout; frame holds type + payload
+ */
+bool Link::Recv(std::vector<u8> &frame, f64 timeout)
+{
+    f64 end = Now() + timeout;
+    struct pollfd p = { fd, POLLIN, 0 };
+    u8  buf[256];
+    ssize_t n;
+
+    for(;;)
+    {
+        // Complete frames already buffered come first
+        for(u32 i = 0; i < rx.size(); i++)
+        {
+            if(rx[i] != 0)
+                continue;
+            std::vector<u8> enc(rx.begin(), rx.begin() + i);
+            rx.erase(rx.begin(), rx.begin() + i + 1);
+            i = (u32)-1;
+            if(enc.empty())
+                continue;
+            if(CobsDecode(enc, frame) && frame.size() >= 3 &&
+               Crc16(frame.data(), frame.size() - 2) ==
+               (frame[frame.size() - 2] | (frame[frame.size() - 1] << 8)))
+            {
+                frame.resize(frame.size() - 2);
+                return true;
+            }
+            // Text log lines end at the next frame's leading
+            // delimiter; only count what is not text
+            if(!IsText(enc))
+                badFrames++;
+        }
+
+        f64 left = end - Now();
+        if(left <= 0)
+            return false;
+        p.revents = 0;
+        if(poll(&p, 1, (int)(left * 1000) + 1) <= 0)
+            continue;
+        n = read(fd, buf, sizeof(buf));
+        if(n > 0)
+            rx.insert(rx.end(), buf, buf + n);
+    }
+}
+
+/*
+ * Function: Link::Drain
+ * Purpose : Discards input until the line is quiet for quiet s
+ */
+void Link::Drain(f64 quiet)
+{
+    std::vector<u8> frame;
+
+    while(Recv(frame, quiet))
+        ;
+    rx.clear();
+}
+
+/* ================= DOWNLOAD ================= */
+
+typedef std::map<u32, FlashRec> RecMap;
+
+// Faults injected by the loopback test, counted in blocks received
+struct Faults
+{
+    std::vector<u32> dropAck;      // Block numbers whose ACK is not sent
+    u32 stallAt = ~0u;             // Block number to hold the ACK of
+    f64 stallFor = 0;              // for this many host seconds
+    u32 abortAt = ~0u;             // Send 'X' after this block
+};
+
+struct DlResult
+{
+    bool done = false;             // 'e' received
+    u32  next = 0;                 // First offset not received
+    u32  end = 0;                  // Offset in 'e'
+    u32  blocks = 0;               // Blocks received (with repeats)
+    u32  repeats = 0;              // Blocks received twice (resends)
+    u32  gaps = 0;                 // Blocks past a missing one
+    u32  restarts = 0;             // 'G' sent again after silence
+};
+
+static f64 rxTimeout = 5;          // Host seconds before asking again
+
+/*
+ * Function: DecodeBlock
+ * Purpose : Unpacks a 'b' or 'z' frame into records
+ * Returns : false if the frame is malformed
+ */
+static bool DecodeBlock(const std::vector<u8> &f, u32 &off,
+                        std::vector<FlashRec> &recs)
+{
+    u32 n, i, pos, used;
+    TSCState ts;
+    FlashRec r;
+
+    recs.clear();
+    if(f.size() < 6)
+        return false;
+    off = GetU32(&f[1]);
+    n = f[5];
+
+    if(f[0] == DL_RSP_BLOCK)
+    {
+        if(f.size() != 6 + n * 8)
+            return false;
+        for(i = 0; i < n; i++)
+        {
+            const u8 *p = &f[6 + i * 8];
+            r.epoch = GetU32(p);
+            r.temp  = (s16)(p[4] | (p[5] << 8));
+            r.code  = p[6] | (p[7] << 8);
+            recs.push_back(r);
+        }
+        return true;
+    }
+
+    if(n == 0)
+        return f.size() == 6;
+    if(f.size() < 10)
+        return false;
+    TSC_Start(&ts, GetU32(&f[6]));
+    for(i = 0, pos = 10; i < n; i++, pos += used)
+    {
+        used = TSC_Decode(&ts, &f[pos], f.size() - pos, &r);
+        if(!used)
+            return false;
+        recs.push_back(r);
+    }
+    return pos == f.size();
+}
+
+/*
+ * Function: Download
+ * Purpose : Runs one download from offset into recs, sending a
+ *           cumulative ACK for each block (unless a fault says
+ *           otherwise) and 'G' again after a gap or silence
+ */
+static DlResult Download(Link &link, u32 from, bool packed, RecMap &recs,
+                         const Faults &fault = Faults())
+{
+    DlResult res;
+    std::vector<u8> f;
+    std::vector<FlashRec> blk;
+    u8  get = packed ? DL_CMD_GETZ : DL_CMD_GET;
+    u32 off, i;
+
+    res.next = from;
+    link.SendU32(get, from);
+
+    while(res.restarts < 5)
+    {
+        if(!link.Recv(f, rxTimeout))
+        {
+            res.restarts++;
+            link.SendU32(get, res.next);
+            continue;
+        }
+        if(f[0] == DL_RSP_END && f.size() == 5)
+        {
+            res.end  = GetU32(&f[1]);
+            res.done = (res.next >= res.end);
+            if(res.done)
+                break;
+            link.SendU32(get, res.next);        // Ended early
+            continue;
+        }
+        if(f[0] != (packed ? DL_RSP_ZBLOCK : DL_RSP_BLOCK))
+            continue;
+        if(!DecodeBlock(f, off, blk))
+        {
+            link.badFrames++;
+            continue;
+        }
+
+        res.blocks++;
+        if(off > res.next)
+        {
+            // A block was lost: ask for the missing records
+            res.gaps++;
+            link.SendU32(get, res.next);
+            continue;
+        }
+        if(off + blk.size() <= res.next)
+            res.repeats++;
+        for(i = 0; i < blk.size(); i++)
+            recs[off + i] = blk[i];
+        if(off + blk.size() > res.next)
+            res.next = off + blk.size();
+
+        if(res.blocks == fault.stallAt)
+        {
+            f64 until = Now() + fault.stallFor;
+
+            while(Now() < until)
+                usleep(10000);
+        }
+        bool drop = false;
+        for(u32 d : fault.dropAck)
+            drop |= (d == res.blocks);
+        // The end of this block, not res.next: after a resend the
+        // logger only accepts offsets it has sent again
+        if(!drop)
+            link.SendU32(DL_CMD_ACK, off + blk.size());
+
+        if(res.blocks == fault.abortAt)
+        {
+            link.Send(DL_CMD_ABORT, 0, 0);
+            break;
+        }
+    }
+    return res;
+}
+
+/*
+ * Function: Info
+ * Purpose : Asks for the history range, retrying on silence
+ */
+static bool Info(Link &link, u32 &first, u32 &next)
+{
+    std::vector<u8> f;
+    u32 tries;
+
+    for(tries = 0; tries < 5; tries++)
+    {
+        link.Send(DL_CMD_INFO, 0, 0);
+        while(link.Recv(f, rxTimeout))
+        {
+            if(f[0] == DL_RSP_INFO && f.size() == 9)
+            {
+                first = GetU32(&f[1]);
+                next  = GetU32(&f[5]);
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+/* ================= LOOPBACK TEST ================= */
+
+static u32 testFails;
+
+#define CHECK(c) do { if(!(c)) { testFails++; \
+    printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #c); } } while(0)
+
+/*
+ * Function: Compare
+ * Purpose : Every record of got must match the reference, and
+ *           got must hold first..end-1 with no gap
+ */
+static void Compare(const char *pass, const RecMap &ref, const RecMap &got,
+                    u32 first, u32 end, bool packed)
+{
+    u32 i, bad = 0;
+    u16 mask = packed ? (u16)~LOGREC_CODE_MASK : 0xFFFF;
+
+    for(i = first; i < end; i++)
+    {
+        auto g = got.find(i), r = ref.find(i);
+
+        if(g == got.end())
+            bad++;
+        else if(r != ref.end() &&
+                (g->second.epoch != r->second.epoch ||
+                 g->second.temp != r->second.temp ||
+                 (g->second.code & mask) != (r->second.code & mask)))
+            bad++;
+    }
+    printf("%-8s %u records from %u, %u missing or different\n",
+           pass, end - first, first, bad);
+    CHECK(bad == 0);
+}
+
+static void Report(const char *pass, const DlResult &r)
+{
+    printf("%-8s blocks %u, repeats %u, gaps %u, restarts %u%s\n", pass,
+           r.blocks, r.repeats, r.gaps, r.restarts, r.done ? ", done" : "");
+}
+
+/*
+ * Function: LoopbackTest
+ * Purpose : Runs lpc_sim on a pty and the download passes
+ *           against it
+ */
+static int LoopbackTest(const char *simPath)
+{
+    char dir[] = "/tmp/lpc_dl.XXXXXX";
+    std::string tty;
+    struct stat st;
+    pid_t sim;
+    Link link;
+    RecMap ref, got;
+    DlResult r;
+    Faults fault;
+    u32 first = 0, next = 0, i, blocks;
+    f64 until;
+
+    if(!mkdtemp(dir))
+    {
+        perror("lpc_dl: mkdtemp");
+        return 2;
+    }
+    tty = std::string(dir) + "/tty";
+
+    // 100 virtual minutes before the link opens gives 100 history
+    // records (7 blocks, more than the window); x10 real time then
+    // makes the 1 s ACK timeout 0.1 s of host time
+    sim = fork();
+    if(sim == 0)
+    {
+        execl(simPath, simPath, "-t", "100000", "-w", "6000", "-x", "10",
+              "-p", tty.c_str(), (char *)0);
+        _exit(127);
+    }
+
+    for(until = Now() + 60; stat(tty.c_str(), &st) && Now() < until; )
+        usleep(20000);
+    rxTimeout = 2;
+    CHECK(link.Open(tty.c_str()));
+    CHECK(Info(link, first, next));
+    printf("history  %u..%u\n", first, next);
+    CHECK(next - first >= (DL_WINDOW + 2) * DL_BLOCK_RECS);
+
+    /* --------- CLEAN PASS (REFERENCE) --------- */
+    r = Download(link, first, false, ref);
+    Report("clean", r);
+    CHECK(r.done && r.repeats == 0 && r.gaps == 0 && r.restarts == 0);
+    for(i = first + 1; i < r.next; i++)
+        CHECK(ref[i].epoch == ref[i - 1].epoch + 60);
+    next = r.next;
+    Compare("clean", ref, ref, first, next, false);
+    blocks = r.blocks;
+
+    /* --------- ACK TIMEOUT --------- */
+    // Holding the second ACK for 0.5 s (5 virtual s) lets the
+    // logger time out and send the window again from block 2
+    fault = Faults();
+    fault.stallAt  = 2;
+    fault.stallFor = 0.5;
+    got.clear();
+    r = Download(link, first, false, got, fault);
+    Report("timeout", r);
+    CHECK(r.done && r.repeats > 0);
+    Compare("timeout", ref, got, first, next, false);
+
+    /* --------- LOST ACKS --------- */
+    // A lost ACK mid-stream is covered by the next (cumulative)
+    // one; losing the last one makes the logger resend
+    fault = Faults();
+    fault.dropAck = { 2, blocks };
+    got.clear();
+    r = Download(link, first, false, got, fault);
+    Report("lost", r);
+    CHECK(r.done && r.repeats > 0);
+    Compare("lost", ref, got, first, next, false);
+
+    /* --------- ABORT AND RESUME --------- */
+    fault = Faults();
+    fault.abortAt = 3;
+    got.clear();
+    r = Download(link, first, false, got, fault);
+    Report("abort", r);
+    CHECK(!r.done && r.next == first + 3 * DL_BLOCK_RECS);
+    link.Drain(0.5);
+    r = Download(link, r.next, false, got);
+    Report("resume", r);
+    CHECK(r.done && r.blocks <= blocks - 3 + 1);
+    Compare("resume", ref, got, first, next, false);
+
+    /* --------- COMPRESSED --------- */
+    got.clear();
+    r = Download(link, first, true, got);
+    Report("packed", r);
+    CHECK(r.done);
+    Compare("packed", ref, got, first, next, true);
+
+    printf("bad frames %u\n", link.badFrames);
+    CHECK(link.badFrames == 0);
+
+    link.Close();
+    kill(sim, SIGTERM);
+    waitpid(sim, 0, 0);
+    unlink(tty.c_str());
+    rmdir(dir);
+
+    printf("%s\n", testFails ? "FAILED" : "passed");
+    return testFails ? 1 : 0;
+}
+
+/* ================= MAIN ================= */
+
+static void Usage(void)
+{
+    fprintf(stderr, "usage: lpc_dl [-z] [-r offset] [-o out.csv] device\n"
+                    "       lpc_dl -T lpc_sim\n");
+    exit(2);
+}
+
+int main(int argc, char **argv)
+{
+    const char *dev = 0, *outPath = 0;
+    bool packed = false;
+    u32 from = 0, first, next;
+    int i;
+    FILE *out = stdout;
+    Link link;
+    RecMap recs;
+    DlResult r;
+
+    for(i = 1; i < argc; i++)
+    {
+        if(!strcmp(argv[i], "-z"))
+            packed = true;
+        else if(argv[i][0] != '-')
+            dev = argv[i];
+        else if(i + 1 >= argc)
+            Usage();
+        else if(!strcmp(argv[i], "-T"))
+            return LoopbackTest(argv[i + 1]);
+        else if(!strcmp(argv[i], "-r"))
+            from = strtoul(argv[++i], 0, 0);
+        else if(!strcmp(argv[i], "-o"))
+            outPath = argv[++i];
+        else
+            Usage();
+    }
+    if(!dev)
+        Usage();
+
+    if(!link.Open(dev))
+    {
+        fprintf(stderr, "lpc_dl: cannot open %s\n", dev);
+        return 2;
+    }
+    if(!Info(link, first, next))
+    {
+        fprintf(stderr, "lpc_dl: no reply from the logger\n");
+        return 1;
+    }
+    if(from < first)
+        from = first;
+    fprintf(stderr, "lpc_dl: history %u..%u, from %u\n", first, next, from);
+
+    r = Download(link, from, packed, recs);
+    if(outPath && !(out = fopen(outPath, "w")))
+    {
+        fprintf(stderr, "lpc_dl: cannot write %s\n", outPath);
+        return 2;
+    }
+    for(auto &e : recs)
+        fprintf(out, "%u,%u,%d,%u\n", e.first, e.second.epoch,
+                e.second.temp, e.second.code);
+    if(out != stdout)
+        fclose(out);
+
+    fprintf(stderr, "lpc_dl: %zu records, %u resent, %u gaps%s\n",
+            recs.size(), r.repeats, r.gaps,
+            r.done ? "" : " (incomplete, resume with -r)");
+    if(!r.done)
+        fprintf(stderr, "lpc_dl: next offset %u\n", r.next);
+    return r.done ? 0 : 1;
+}
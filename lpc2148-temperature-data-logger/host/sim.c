@@ -0,0 +1,1672 @@
+#include <stdio.h>           // Scenario, flash image and UART files
+#include <stdlib.h>          // qsort, realloc, exit
+#include <string.h>          // memset, memcpy
+#include <stdarg.h>          // Sim_Fail message
+#include <setjmp.h>          // End of a run abandons the firmware
+#include <math.h>            // Default temperature trace
+#include <LPC214X.H>         // Host register model (host/inc)
+#include "types.h"           // Custom data types (u8, u32, u64)
+#include "sim.h"             // Simulator interface
+
+/* ================= REGISTER MODEL ================= */
+/*
+ * Sim_Reg hands out one word per access and the firmware reads
+ * and/or writes it after the call returns. What it did is only
+ * known at the next access, so each access is committed then:
+ *
+ *  RK_PLAIN  storage, no side effect (returned directly)
+ *  RK_HOOK   storage; a changed value is passed to Sim_Hook
+ *            (also every register that moves the next event)
+ *  RK_CALC   the read value is computed into calc[]; a changed
+ *            cell means the firmware wrote it
+ *
+ * Writes of the value just read are invisible; that is harmless
+ * everywhere except the write-1-to-clear flags (T0IR, T1IR, ILR),
+ * which read back with bit 31 set so any write differs.
+ */
+#define RK_PLAIN      0
+#define RK_HOOK       1
+#define RK_CALC       2
+
+#define REG_NONE      SIM_NUM_REGS
+#define READ_CANARY   0x80000000
+
+#define NEVER         0xFFFFFFFFFFFFFFFFull
+
+SimStats simStats;
+
+static u32 reg[SIM_NUM_REGS];         // Register storage
+static u32 calc[SIM_NUM_REGS];        // Computed read values
+static u8  kind[SIM_NUM_REGS];        // RK_* per register
+
+static u32 pendId = REG_NONE;         // Access awaiting commit
+static u32 pendOld;                   // Value handed out for it
+
+/* ================= VIRTUAL TIME ================= */
+
+static u64 now;                       // Wall time (cycles)
+static u64 pdTotal;                   // Time PCLK was stopped
+#define PNOW          (now - pdTotal) // PCLK time
+
+static u8  inIsr;                     // An ISR is running
+static u8  inPd;                      // PCLK stopped (power-down)
+static u8  running;                   // Inside Sim_Run
+static u64 endTime = NEVER;           // End of the run (wall)
+static jmp_buf runEnd;
+
+/* --------- EVENT SOURCES --------- */
+enum { EV_TMR, EV_UART = 8, EV_URX, EV_ADC, EV_RTC, EV_STIM, EV_HOST, EV_END };
+
+static u64 evTime;                    // Next event (wall)
+static u32 evSrc;                     // Its source
+static u8  evDirty = 1;               // evTime must be recomputed
+
+/* ================= TIMER MODEL ================= */
+/*
+ * The counter is not stepped: TC = tcBase + (pclk - base) / (PR+1)
+ * while running. After a match reset TC holds the match value for
+ * one tick and restarts from 0, as on the chip.
+ */
+typedef struct
+{
+    u8  run;                          // TCR enable, not in reset
+    u64 base;                         // PCLK time TC was tcBase
+    u32 tcBase;                       // TC at base (or when stopped)
+    u32 hold;                         // TC before base (match reset)
+} SimTmr;
+
+static SimTmr tmr[2];
+
+#define TREG(n, r)    ((r) + (n) * (SIM_T1IR - SIM_T0IR))
+
+/* ================= UART MODEL ================= */
+
+static u8  txFifo[16];                // Transmit FIFO
+static u32 txHead, txCnt;
+static u8  txShift;                   // A byte is being sent
+static u8  txByte;
+static u64 txEnd;                     // PCLK time it is sent
+static u8  threPend;                  // THRE interrupt pending
+static FILE *uartOut;
+static void (*uartTap)(u8);
+
+/*
+ * Receive side: bytes queued by the host wait on the line and
+ * arrive one character time apart into the 16-byte RX FIFO. The
+ * firmware sets the trigger level to one character, so RDA is
+ * raised whenever the FIFO holds data (no CTI timing needed).
+ */
+#define RX_LINE_SIZE  65536
+
+static u8  rxLine[RX_LINE_SIZE];      // Bytes still on the wire
+static u32 rxLineHead, rxLineCnt;
+static u64 rxEnd = NEVER;             // PCLK time the next one lands
+static u8  rxFifo[16];
+static u32 rxHead, rxCnt;
+
+/* ================= ADC MODEL ================= */
+
+static u8  adcBusy;                   // Conversion in progress
+static u32 adcCh;
+static u64 adcEnd;                    // PCLK time it completes
+static u32 adcLcg = 1;                // Dither generator
+
+/* ================= RTC MODEL ================= */
+
+static u64 rtcNext = NEVER;           // Next second (RTC clock)
+
+/* ================= HOST CALLBACK ================= */
+
+static void (*hostFn)(void);          // Sim_Periodic callback
+static u64 hostPeriod;
+static u64 hostNext = NEVER;          // Next call (wall)
+
+/* ================= PINS, LCD AND KEYPAD ================= */
+
+static u32 latch0, latch1;            // GPIO output latches
+static u32 keysDown;                  // Keypad keys held (bit n)
+static u8  swDown;                    // EDIT switch held
+
+#define LCD_RS        (1<<5)          // P0.5
+#define LCD_RW        (1<<6)          // P0.6
+#define LCD_EN        (1<<7)          // P0.7
+#define EDIT_SW_PIN   (1<<4)          // P0.4, active low
+#define KP_ROW0       16              // P1.16-19 rows
+#define KP_COL0       20              // P1.20-23 columns
+
+static u8  lcdRam[128];               // DDRAM
+static u8  lcdCgRam[64];              // CGRAM (8 characters x 8 rows)
+static u8  lcdAc;                     // Address counter
+static u8  lcdCg;                     // Writes go to CGRAM
+static u64 lcdBusyEnd;                // Busy flag clears (wall)
+static u8  lcdHang;                   // Busy flag stuck at 1
+
+/* ================= STIMULUS ================= */
+
+typedef struct
+{
+    u64 t;                            // Wall time (cycles)
+    s32 v;                            // Temperature (centi-degC)
+} SimPt;
+
+typedef struct
+{
+    u64 t;
+    u8  type;                         // STIM_KEY / STIM_SW
+    u8  arg;                          // Key number
+    u8  down;
+} SimEv;
+
+#define STIM_KEY      0
+#define STIM_SW       1
+#define STIM_CH       4
+
+static SimPt *tempPts[STIM_CH];       // Scenario temperature trace
+static u32 tempCnt[STIM_CH];
+static u32 tempCur[STIM_CH];          // Segment last used
+static u8  tempFixed[STIM_CH];        // Sim_Temp override
+static s32 tempFix[STIM_CH];
+
+static SimEv *stimEv;                 // Scenario key / switch events
+static u32 stimCnt, stimIdx;
+
+/* ================= FLASH ================= */
+
+unsigned char simFlash[SIM_FLASH_SIZE] __attribute__((aligned(4096)));
+static u8 flashInit;
+static u32 iapPrepared;               // Sectors prepared (bit n)
+static u32 cutCmds;                   // Erase/copy commands to the cut
+static u32 cutKeep;                   // Bytes done by the cut one
+
+static void Sim_Dispatch(void);
+static void Sim_Commit(void);
+static void Sim_PowerCut(void);
+
+/* ================= FAILURE ================= */
+/*
+ * Function: Sim_Fail
+ * Purpose : Reports misuse of the model and stops
+ */
+void Sim_Fail(const char *fmt, ...)
+{
+    va_list ap;
+
+    fprintf(stderr, "sim: %.6f s: ", (f64)now / SIM_PCLK);
+    va_start(ap, fmt);
+    vfprintf(stderr, fmt, ap);
+    va_end(ap);
+    fputc('\n', stderr);
+    exit(2);
+}
+
+/* ================= TIMERS ================= */
+/*
+ * Function: Tmr_TC
+ * Purpose : Current counter value with prescale div
+ */
+static u32 Tmr_TC(u32 n, u32 div)
+{
+    SimTmr *t = &tmr[n];
+
+    if(!t->run)
+        return t->tcBase;
+    if(PNOW < t->base)
+        return t->hold;
+    return t->tcBase + (u32)((PNOW - t->base) / div);
+}
+
+static u32 Tmr_Div(u32 n)
+{
+    return reg[TREG(n, SIM_T0PR)] + 1;
+}
+
+/*
+ * Function: Tmr_PC
+ * Purpose : Current prescale counter
+ */
+static u32 Tmr_PC(u32 n)
+{
+    SimTmr *t = &tmr[n];
+
+    if(!t->run || PNOW < t->base)
+        return 0;
+    return (u32)((PNOW - t->base) % Tmr_Div(n));
+}
+
+/*
+ * Function: Tmr_Next
+ * Purpose : PCLK time of the next match with an action, and
+ *           which match register it is
+ */
+static u64 Tmr_Next(u32 n, u32 *which)
+{
+    SimTmr *t = &tmr[n];
+    u64 ref, ticks, at, best = NEVER;
+    u32 div, cur, d, x, mcr, emr;
+
+    if(!t->run)
+        return NEVER;
+
+    div   = Tmr_Div(n);
+    ref   = (PNOW > t->base) ? PNOW : t->base;
+    ticks = (ref - t->base) / div;
+    cur   = t->tcBase + (u32)ticks;
+    mcr   = reg[TREG(n, SIM_T0MCR)];
+    emr   = reg[TREG(n, SIM_T0EMR)];
+
+    for(x = 0; x < 4; x++)
+    {
+        if(!((mcr >> (3 * x)) & 7) && !((emr >> (4 + 2 * x)) & 3))
+            continue;
+        d  = reg[TREG(n, SIM_T0MR0) + x] - cur;
+        at = t->base + (ticks + (d ? (u64)d : 0x100000000ull)) * div;
+        if(at < best)
+        {
+            best   = at;
+            *which = x;
+        }
+    }
+    return best;
+}
+
+/*
+ * Function: Adc_Trigger
+ * Purpose : MAT0.1 edge (START = 4, edge select)
+ */
+static void Adc_Start(u32 ch);
+static u32  Adc_NextCh(u32 sel, u32 after);
+
+static void Adc_Trigger(u8 level)
+{
+    u32 cr = reg[SIM_AD0CR];
+    u8  rising = !((cr >> 27) & 1);
+
+    if(((cr >> 24) & 7) != 4 || level != rising || adcBusy)
+        return;
+    if(cr & 0xFF)
+        Adc_Start(Adc_NextCh(cr & 0xFF, 7));
+}
+
+/*
+ * Function: Tmr_Fire
+ * Purpose : Match x of timer n reached at PCLK time at
+ */
+static void Tmr_Fire(u32 n, u32 x, u64 at)
+{
+    SimTmr *t = &tmr[n];
+    u32 act = (reg[TREG(n, SIM_T0MCR)] >> (3 * x)) & 7;
+    u32 em  = (reg[TREG(n, SIM_T0EMR)] >> (4 + 2 * x)) & 3;
+    u32 mr  = reg[TREG(n, SIM_T0MR0) + x];
+    u32 *emr = &reg[TREG(n, SIM_T0EMR)];
+    u32 div = Tmr_Div(n);
+    u8  old, lvl;
+
+    // Counter state right at the match
+    t->tcBase += (u32)((at - t->base) / div);
+    t->base    = at;
+
+    if(act & 1)
+        reg[TREG(n, SIM_T0IR)] |= (1 << x);
+    if(act & 2)
+    {
+        t->hold   = mr;
+        t->tcBase = 0;
+        t->base   = at + div;
+    }
+    if(act & 4)
+    {
+        t->run = 0;
+        t->tcBase = mr;
+        reg[TREG(n, SIM_T0TCR)] &= ~1;
+    }
+    if(em)
+    {
+        old = (*emr >> x) & 1;
+        lvl = (em == 1) ? 0 : (em == 2) ? 1 : !old;
+        *emr = (*emr & ~(1 << x)) | (lvl << x);
+        if(n == 0 && x == 1 && lvl != old)
+            Adc_Trigger(lvl);
+    }
+}
+
+/*
+ * Function: Tmr_Control
+ * Purpose : TCR write (enable / reset)
+ */
+static void Tmr_Control(u32 n, u32 v)
+{
+    SimTmr *t = &tmr[n];
+
+    if(v & 2)
+    {
+        t->run    = 0;
+        t->tcBase = 0;
+    }
+    else if((v & 1) && !t->run)
+    {
+        t->run  = 1;
+        t->base = PNOW;
+    }
+    else if(!(v & 1) && t->run)
+    {
+        t->tcBase = Tmr_TC(n, Tmr_Div(n));
+        t->run    = 0;
+    }
+}
+
+/*
+ * Function: Tmr_Prescale
+ * Purpose : PR write; the count so far used the old divider
+ */
+static void Tmr_Prescale(u32 n, u32 oldPr)
+{
+    SimTmr *t = &tmr[n];
+
+    if(!t->run || PNOW < t->base)
+        return;
+    t->tcBase = Tmr_TC(n, oldPr + 1);
+    t->base   = PNOW;
+}
+
+/* ================= UART0 ================= */
+/*
+ * Function: Uart_CharCycles
+ * Purpose : PCLK cycles per 10-bit character at the set baud
+ */
+static u64 Uart_CharCycles(void)
+{
+    u32 dl  = (reg[SIM_U0DLM] << 8) | reg[SIM_U0DLL];
+    u32 mul = (reg[SIM_U0FDR] >> 4) & 15;
+    u32 div = reg[SIM_U0FDR] & 15;
+
+    if(!dl)
+        dl = 1;
+    if(!mul)
+        mul = 1;
+    return (u64)10 * 16 * dl * (mul + div) / mul;
+}
+
+/*
+ * Function: Uart_Load
+ * Purpose : Moves the next FIFO byte to the shift register
+ */
+static void Uart_Load(void)
+{
+    txShift = 0;
+    if(!txCnt)
+        return;
+    txByte  = txFifo[txHead];
+    txHead  = (txHead + 1) & 15;
+    txCnt--;
+    txShift = 1;
+    txEnd   = PNOW + Uart_CharCycles();
+    if(!txCnt)
+        threPend = 1;                 // FIFO just ran empty
+    evDirty = 1;
+}
+
+static void Uart_Thr(u32 v)
+{
+    threPend = 0;
+    if(txCnt == 16)
+    {
+        simStats.uartLost++;
+        return;
+    }
+    txFifo[(txHead + txCnt) & 15] = (u8)v;
+    txCnt++;
+    if(!txShift)
+        Uart_Load();
+}
+
+static void Uart_Sent(void)
+{
+    simStats.uartBytes++;
+    if(uartOut)
+        fputc(txByte, uartOut);
+    if(uartTap)
+        uartTap(txByte);
+    Uart_Load();
+}
+
+/*
+ * Function: Uart_RxNext
+ * Purpose : Starts the next byte waiting on the receive line
+ */
+static void Uart_RxNext(void)
+{
+    rxEnd   = rxLineCnt ? PNOW + Uart_CharCycles() : NEVER;
+    evDirty = 1;
+}
+
+/*
+ * Function: Uart_Received
+ * Purpose : One byte has arrived; lost if the FIFO is full
+ */
+static void Uart_Received(void)
+{
+    u8 b = rxLine[rxLineHead];
+
+    rxLineHead = (rxLineHead + 1) % RX_LINE_SIZE;
+    rxLineCnt--;
+    simStats.uartRxBytes++;
+    if(rxCnt == 16)
+        simStats.uartRxLost++;
+    else
+    {
+        rxFifo[(rxHead + rxCnt) & 15] = b;
+        rxCnt++;
+    }
+    Uart_RxNext();
+}
+
+static u32 Uart_Rbr(void)
+{
+    u8 b;
+
+    if(reg[SIM_U0LCR] & 0x80)
+        return reg[SIM_U0DLL];
+    if(!rxCnt)
+        return 0;
+    b = rxFifo[rxHead];
+    rxHead = (rxHead + 1) & 15;
+    rxCnt--;
+    return b;
+}
+
+static u32 Uart_Iir(void)
+{
+    if(rxCnt && (reg[SIM_U0IER] & 1))
+        return 0xC4;                  // RDA, above THRE
+    if(threPend && (reg[SIM_U0IER] & 2))
+    {
+        threPend = 0;                 // Reading IIR clears THRE
+        return 0xC2;
+    }
+    return 0xC1;
+}
+
+static u32 Uart_Lsr(void)
+{
+    return (txCnt ? 0 : 0x20) | ((txCnt || txShift) ? 0 : 0x40) |
+           (rxCnt ? 0x01 : 0);
+}
+
+/* ================= ADC ================= */
+/*
+ * Function: Stim_Temp
+ * Purpose : Temperature of a channel now (centi-degC)
+ *           Scenario trace, linear between points, or a slow
+ *           daily swing around 25 C without one
+ */
+static s32 Stim_Temp(u32 ch)
+{
+    SimPt *p = tempPts[ch];
+    u32 i;
+
+    if(tempFixed[ch])
+        return tempFix[ch];
+    if(!tempCnt[ch])
+        return (s32)(2500 + 500 * sin(2 * M_PI * ((f64)now / SIM_PCLK) / 86400));
+
+    if(now <= p[0].t)
+        return p[0].v;
+    i = tempCur[ch];
+    if(i >= tempCnt[ch] || p[i].t > now)
+        i = 0;
+    while(i + 1 < tempCnt[ch] && p[i + 1].t <= now)
+        i++;
+    tempCur[ch] = i;
+    if(i + 1 == tempCnt[ch])
+        return p[i].v;
+    return p[i].v + (s32)((f64)(p[i + 1].v - p[i].v) *
+                          (f64)(now - p[i].t) / (f64)(p[i + 1].t - p[i].t));
+}
+
+/*
+ * Function: Adc_Code
+ * Purpose : 10-bit code of an LM35 (10 mV/C) on a 3.3 V
+ *           reference, with up to half an LSB of dither
+ */
+static u32 Adc_Code(u32 ch)
+{
+    f64 code;
+
+    adcLcg = adcLcg * 1664525 + 1013904223;
+    code = (f64)Stim_Temp(ch) * 1023 / 33000 +
+           (f64)(adcLcg >> 8) / (1 << 24) - 0.5;
+    if(code < 0)
+        return 0;
+    if(code > 1023)
+        return 1023;
+    return (u32)(code + 0.5);
+}
+
+static u32 Adc_NextCh(u32 sel, u32 after)
+{
+    u32 i, ch;
+
+    for(i = 1; i <= 8; i++)
+    {
+        ch = (after + i) & 7;
+        if(sel & (1 << ch))
+            return ch;
+    }
+    return 0;
+}
+
+static void Adc_Start(u32 ch)
+{
+    u32 cr = reg[SIM_AD0CR];
+
+    if(!(cr & (1 << 21)))             // Powered down
+        return;
+    adcBusy = 1;
+    adcCh   = ch;
+    adcEnd  = PNOW + 11 * (((cr >> 8) & 0xFF) + 1);
+    evDirty = 1;
+}
+
+/*
+ * Function: Adc_Done
+ * Purpose : Stores a result; in burst mode the next selected
+ *           channel is started while BURST is still set
+ */
+static void Adc_Done(void)
+{
+    u32 code = Adc_Code(adcCh);
+    u32 *dr  = &reg[SIM_AD0DR0 + adcCh];
+    u32 *gdr = &reg[SIM_AD0GDR];
+    u32 cr   = reg[SIM_AD0CR];
+
+    *dr  = ((*dr  >> 31) << 30) | (1u << 31) | (code << 6);
+    *gdr = ((*gdr >> 31) << 30) | (1u << 31) | (code << 6) | (adcCh << 24);
+    adcBusy = 0;
+    simStats.adcConv++;
+
+    if((cr & (1 << 16)) && (cr & 0xFF))
+        Adc_Start(Adc_NextCh(cr & 0xFF, adcCh));
+}
+
+/*
+ * Function: Adc_Control
+ * Purpose : AD0CR write: burst start, software start
+ */
+static void Adc_Control(u32 old, u32 v)
+{
+    reg[SIM_AD0GDR] &= ~(1u << 31);
+
+    if(!(v & (1 << 21)))
+    {
+        adcBusy = 0;
+        evDirty = 1;
+        return;
+    }
+    if(adcBusy || !(v & 0xFF))
+        return;
+    if((v & (1 << 16)) && !(old & (1 << 16)))
+        Adc_Start(Adc_NextCh(v & 0xFF, 7));
+    else if(!(v & (1 << 16)) && ((v >> 24) & 7) == 1 && ((old >> 24) & 7) != 1)
+        Adc_Start(Adc_NextCh(v & 0xFF, 7));
+}
+
+static u32 Adc_Stat(void)
+{
+    u32 i, done = 0, ovr = 0;
+
+    for(i = 0; i < 8; i++)
+    {
+        done |= (reg[SIM_AD0DR0 + i] >> 31) << i;
+        ovr  |= ((reg[SIM_AD0DR0 + i] >> 30) & 1) << i;
+    }
+    return done | (ovr << 8);
+}
+
+static u8 Adc_Irq(void)
+{
+    u32 en = reg[SIM_AD0INTEN];
+
+    return (Adc_Stat() & en & 0xFF) ||
+           ((en & (1 << 8)) && (reg[SIM_AD0GDR] >> 31));
+}
+
+/* ================= RTC ================= */
+
+static u64 Rtc_Clock(void)
+{
+    return (reg[SIM_CCR] & 0x10) ? now : PNOW;
+}
+
+static void Rtc_Control(u32 old, u32 v)
+{
+    u8 wasOn = (old & 1) && !(old & 2);
+
+    if((v & 1) && !(v & 2))
+    {
+        if(!wasOn)
+            rtcNext = Rtc_Clock() + SIM_PCLK;
+    }
+    else
+        rtcNext = NEVER;
+}
+
+static u32 Rtc_Days(void)
+{
+    u32 m = reg[SIM_MONTH];
+
+    if(m == 2)
+        return (reg[SIM_YEAR] & 3) ? 28 : 29;
+    if(m == 4 || m == 6 || m == 9 || m == 11)
+        return 30;
+    return 31;
+}
+
+/*
+ * Function: Rtc_Tick
+ * Purpose : One second of the calendar counters, increment
+ *           and alarm interrupts
+ */
+static void Rtc_Tick(void)
+{
+    u32 *r = reg;
+    u32 inc = 1, amr;
+
+    rtcNext += SIM_PCLK;
+
+    if(++r[SIM_SEC] >= 60)
+    {
+        r[SIM_SEC] = 0;
+        inc |= 2;
+        if(++r[SIM_MIN] >= 60)
+        {
+            r[SIM_MIN] = 0;
+            inc |= 4;
+            if(++r[SIM_HOUR] >= 24)
+            {
+                r[SIM_HOUR] = 0;
+                inc |= 8 | 16 | 32;
+                r[SIM_DOW] = (r[SIM_DOW] + 1) % 7;
+                r[SIM_DOY]++;
+                if(++r[SIM_DOM] > Rtc_Days())
+                {
+                    r[SIM_DOM] = 1;
+                    inc |= 64;
+                    if(++r[SIM_MONTH] > 12)
+                    {
+                        r[SIM_MONTH] = 1;
+                        r[SIM_DOY] = 1;
+                        r[SIM_YEAR]++;
+                        inc |= 128;
+                    }
+                }
+            }
+        }
+    }
+
+    if(r[SIM_CIIR] & inc)
+        r[SIM_ILR] |= 1;
+
+    amr = r[SIM_AMR];
+    if((amr & 0xFF) != 0xFF &&
+       ((amr & 1)   || r[SIM_ALSEC]  == r[SIM_SEC])   &&
+       ((amr & 2)   || r[SIM_ALMIN]  == r[SIM_MIN])   &&
+       ((amr & 4)   || r[SIM_ALHOUR] == r[SIM_HOUR])  &&
+       ((amr & 8)   || r[SIM_ALDOM]  == r[SIM_DOM])   &&
+       ((amr & 16)  || r[SIM_ALDOW]  == r[SIM_DOW])   &&
+       ((amr & 32)  || r[SIM_ALDOY]  == r[SIM_DOY])   &&
+       ((amr & 64)  || r[SIM_ALMON]  == r[SIM_MONTH]) &&
+       ((amr & 128) || r[SIM_ALYEAR] == r[SIM_YEAR]))
+        r[SIM_ILR] |= 2;
+}
+
+/* ================= HD44780 ================= */
+
+static void Lcd_Step(s32 d)
+{
+    if(d > 0)
+        lcdAc = (lcdAc == 0x27) ? 0x40 : (lcdAc == 0x67) ? 0 : lcdAc + 1;
+    else
+        lcdAc = (lcdAc == 0x40) ? 0x27 : (lcdAc == 0) ? 0x67 : lcdAc - 1;
+}
+
+/*
+ * Function: Lcd_Write
+ * Purpose : Byte latched on the EN falling edge
+ */
+static void Lcd_Write(u8 rs, u8 v)
+{
+    u64 cost = SIM_US(37);
+
+    simStats.lcdWrites++;
+    if(now < lcdBusyEnd)
+        simStats.lcdBusy++;
+
+    if(rs)
+    {
+        if(lcdCg)
+        {
+            // The address counter is shared: CGRAM writes move it
+            lcdCgRam[lcdAc & 0x3F] = v;
+            lcdAc = (lcdAc + 1) & 0x3F;
+        }
+        else
+        {
+            lcdRam[lcdAc & 0x7F] = v;
+            Lcd_Step(1);
+        }
+    }
+    else if(v & 0x80)
+    {
+        lcdAc = v & 0x7F;
+        lcdCg = 0;
+    }
+    else if(v & 0x40)
+    {
+        lcdAc = v & 0x3F;
+        lcdCg = 1;
+    }
+    else if(v & 0x20)
+        ;                             // Function set
+    else if(v & 0x10)
+    {
+        if(!(v & 0x08))
+            Lcd_Step((v & 0x04) ? 1 : -1);
+    }
+    else if(v & 0x0C)
+        ;                             // Display control, entry mode
+    else if(v & 0x02)
+    {
+        lcdAc = 0;
+        cost  = SIM_US(1520);
+    }
+    else if(v & 0x01)
+    {
+        memset(lcdRam, ' ', sizeof(lcdRam));
+        lcdAc = 0;
+        cost  = SIM_US(1520);
+    }
+    lcdBusyEnd = now + cost;
+}
+
+/* ================= GPIO ================= */
+
+static void Port0_Set(u32 v)
+{
+    u32 old = latch0;
+
+    latch0 = v;
+    if((old & LCD_EN) && !(v & LCD_EN) && !(v & LCD_RW))
+        Lcd_Write((v & LCD_RS) != 0, (u8)(v >> 8));
+}
+
+/*
+ * Function: Pins0
+ * Purpose : P0 pin levels: outputs from the latch, the EDIT
+ *           switch, and the LCD data bus while it is read
+ */
+static u32 Pins0(void)
+{
+    u32 dir = reg[SIM_IODIR0];
+    u32 in  = 0xFFFFFFFF;
+    u32 bus;
+
+    if(swDown)
+        in &= ~EDIT_SW_PIN;
+    if((latch0 & LCD_RW) && (latch0 & LCD_EN))
+    {
+        bus = (latch0 & LCD_RS) ? 0 :
+              ((lcdHang || now < lcdBusyEnd) ? 0x80 : 0) | (lcdAc & 0x7F);
+        in  = (in & ~0xFF00) | (bus << 8);
+    }
+    return (latch0 & dir) | (in & ~dir);
+}
+
+/*
+ * Function: Pins1
+ * Purpose : P1 pin levels: a held key connects its column to
+ *           its row while the row is driven low
+ */
+static u32 Pins1(void)
+{
+    u32 dir = reg[SIM_IODIR1];
+    u32 in  = 0xFFFFFFFF;
+    u32 k, row;
+
+    for(k = 0; k < 16; k++)
+    {
+        if(!(keysDown & (1 << k)))
+            continue;
+        row = KP_ROW0 + k / 4;
+        if(((dir >> row) & 1) && !((latch1 >> row) & 1))
+            in &= ~(1 << (KP_COL0 + k % 4));
+    }
+    return (latch1 & dir) | (in & ~dir);
+}
+
+/* ================= INTERRUPT SOURCES ================= */
+/*
+ * Function: Sim_Raw
+ * Purpose : VIC raw interrupt lines
+ */
+static u32 Sim_Raw(void)
+{
+    u32 raw = 0;
+
+    if(reg[SIM_T0IR] & 0xFF)
+        raw |= (1 << 4);
+    if(reg[SIM_T1IR] & 0xFF)
+        raw |= (1 << 5);
+    if((threPend && (reg[SIM_U0IER] & 2)) || (rxCnt && (reg[SIM_U0IER] & 1)))
+        raw |= (1 << 6);
+    if(reg[SIM_ILR] & 3)
+        raw |= (1 << 13);
+    if(Adc_Irq())
+        raw |= (1 << 18);
+    return raw;
+}
+
+/* ================= EVENTS ================= */
+/*
+ * Function: Sim_NextEvent
+ * Purpose : Finds the earliest pending event (wall time)
+ *           While PCLK is stopped only the crystal RTC, the
+ *           stimulus and the end of the run can happen
+ */
+static void Sim_NextEvent(void)
+{
+    u64 t;
+    u32 n, x = 0;
+
+    evTime = NEVER;
+    evSrc  = EV_END;
+
+#define EV_TRY(when, src)  do { t = (when); \
+        if(t < evTime) { evTime = t; evSrc = (src); } } while(0)
+
+    if(!inPd)
+    {
+        for(n = 0; n < 2; n++)
+        {
+            t = Tmr_Next(n, &x);
+            if(t != NEVER)
+                EV_TRY(t + pdTotal, EV_TMR + n * 4 + x);
+        }
+        if(txShift)
+            EV_TRY(txEnd + pdTotal, EV_UART);
+        if(rxEnd != NEVER)
+            EV_TRY(rxEnd + pdTotal, EV_URX);
+        if(adcBusy)
+            EV_TRY(adcEnd + pdTotal, EV_ADC);
+    }
+    if(rtcNext != NEVER)
+    {
+        if(reg[SIM_CCR] & 0x10)
+            EV_TRY(rtcNext, EV_RTC);
+        else if(!inPd)
+            EV_TRY(rtcNext + pdTotal, EV_RTC);
+    }
+    if(stimIdx < stimCnt)
+        EV_TRY(stimEv[stimIdx].t, EV_STIM);
+    EV_TRY(hostNext, EV_HOST);
+    EV_TRY(endTime, EV_END);
+
+#undef EV_TRY
+    evDirty = 0;
+}
+
+static void Sim_Fire(void)
+{
+    SimEv *e;
+
+    evDirty = 1;
+    switch(evSrc)
+    {
+        case EV_UART: Uart_Sent(); break;
+        case EV_URX:  Uart_Received(); break;
+        case EV_ADC:  Adc_Done();  break;
+        case EV_RTC:  Rtc_Tick();  break;
+        case EV_STIM:
+            e = &stimEv[stimIdx++];
+            if(e->type == STIM_KEY)
+                Sim_Key(e->arg, e->down);
+            else
+                Sim_Switch(e->down);
+            break;
+        case EV_HOST:
+            hostNext += hostPeriod;
+            hostFn();
+            break;
+        case EV_END:
+            if(running)
+                longjmp(runEnd, 1);
+            endTime = NEVER;
+            break;
+        default:
+            Tmr_Fire((evSrc - EV_TMR) / 4, (evSrc - EV_TMR) % 4, PNOW);
+            break;
+    }
+}
+
+/*
+ * Function: Sim_Advance
+ * Purpose : Moves virtual time to target, firing events on
+ *           the way (the CPU is busy, no ISR is entered)
+ */
+static void Sim_Advance(u64 target)
+{
+    for(;;)
+    {
+        if(evDirty)
+            Sim_NextEvent();
+        if(evTime > target)
+            break;
+        now = evTime;
+        Sim_Fire();
+    }
+    now = target;
+}
+
+/*
+ * Function: Sim_WaitIrq
+ * Purpose : Idle mode: time runs until an enabled interrupt
+ *           is pending
+ */
+static void Sim_WaitIrq(void)
+{
+    u64 start = now;
+
+    while(!(Sim_Raw() & reg[SIM_VICIntEnable]))
+    {
+        if(evDirty)
+            Sim_NextEvent();
+        now = evTime;
+        Sim_Fire();
+    }
+    simStats.idleCycles += now - start;
+}
+
+/*
+ * Function: Sim_PowerDown
+ * Purpose : PCLK stops until an RTC interrupt enabled in
+ *           INTWAKE; the RTC only keeps counting on the crystal
+ */
+static void Sim_PowerDown(void)
+{
+    u64 start = now;
+
+    inPd    = 1;
+    evDirty = 1;
+    while(!((reg[SIM_ILR] & 3) && (reg[SIM_INTWAKE] & (1 << 15))))
+    {
+        if(evDirty)
+            Sim_NextEvent();
+        pdTotal += evTime - now;
+        now = evTime;
+        Sim_Fire();
+    }
+    inPd    = 0;
+    evDirty = 1;
+    simStats.pdCycles += now - start;
+}
+
+/* ================= ACCESS COMMIT ================= */
+/*
+ * Function: Sim_Hook
+ * Purpose : Side effect of a register the firmware changed
+ */
+static void Sim_Hook(u32 id, u32 old, u32 v)
+{
+    switch(id)
+    {
+        case SIM_IOPIN0: Port0_Set(v);                 break;
+        case SIM_IOSET0: Port0_Set(latch0 | v);        break;
+        case SIM_IOCLR0: Port0_Set(latch0 & ~v);       break;
+        case SIM_IOPIN1: latch1 = v;                   break;
+        case SIM_IOSET1: latch1 |= v;                  break;
+        case SIM_IOCLR1: latch1 &= ~v;                 break;
+
+        case SIM_U0THR:
+            if(reg[SIM_U0LCR] & 0x80)
+                reg[SIM_U0DLL] = v & 0xFF;
+            else
+                Uart_Thr(v);
+            break;
+        case SIM_U0RBR:
+            if(reg[SIM_U0LCR] & 0x80)
+                reg[SIM_U0DLL] = v & 0xFF;
+            break;
+        case SIM_U0FCR:
+            if(v & 2)
+                rxCnt = 0;
+            if(v & 4)
+                txCnt = 0;
+            break;
+
+        case SIM_T0IR:  reg[SIM_T0IR] &= ~v;           break;
+        case SIM_T1IR:  reg[SIM_T1IR] &= ~v;           break;
+        case SIM_T0TCR: Tmr_Control(0, v);             break;
+        case SIM_T1TCR: Tmr_Control(1, v);             break;
+        case SIM_T0PR:  Tmr_Prescale(0, old);          break;
+        case SIM_T1PR:  Tmr_Prescale(1, old);          break;
+
+        case SIM_VICIntEnable: reg[SIM_VICIntEnable] |= v;  break;
+        case SIM_VICIntEnClr:  reg[SIM_VICIntEnable] &= ~v; break;
+
+        case SIM_AD0CR: Adc_Control(old, v);           break;
+
+        case SIM_ILR:   reg[SIM_ILR] &= ~v;            break;
+        case SIM_CCR:   Rtc_Control(old, v);           break;
+
+        case SIM_PCON:
+            if(v & 2)
+                Sim_PowerDown();
+            else if(v & 1)
+                Sim_WaitIrq();
+            reg[SIM_PCON] = 0;        // Bits clear on wake-up
+            break;
+
+        default:
+            break;
+    }
+    evDirty = 1;
+}
+
+/*
+ * Function: Sim_Commit
+ * Purpose : Applies the access handed out last
+ */
+static void Sim_Commit(void)
+{
+    u32 id = pendId;
+    u32 v;
+
+    pendId = REG_NONE;
+    v = (kind[id] == RK_CALC) ? calc[id] : reg[id];
+    if(v != pendOld)
+        Sim_Hook(id, pendOld, v & ~((id == SIM_T0IR || id == SIM_T1IR ||
+                                     id == SIM_ILR) ? READ_CANARY : 0));
+}
+
+/*
+ * Function: Sim_Read
+ * Purpose : Value of a computed register; read side effects
+ *           (ADC DONE, UART THRE interrupt, RX FIFO) happen here
+ */
+static u32 Sim_Read(u32 id)
+{
+    u32 v;
+
+    switch(id)
+    {
+        case SIM_IOPIN0: return Pins0();
+        case SIM_IOSET0: return latch0;
+        case SIM_IOPIN1: return Pins1();
+        case SIM_IOSET1: return latch1;
+
+        case SIM_U0RBR:  return Uart_Rbr();
+        case SIM_U0THR:
+            return 0xFFFFFFFF;
+        case SIM_U0IIR:  return Uart_Iir();
+        case SIM_U0LSR:  return Uart_Lsr();
+
+        case SIM_AD0GDR:
+        case SIM_AD0DR0: case SIM_AD0DR1: case SIM_AD0DR2: case SIM_AD0DR3:
+        case SIM_AD0DR4: case SIM_AD0DR5: case SIM_AD0DR6: case SIM_AD0DR7:
+            v = reg[id];
+            reg[id] &= ~(3u << 30);
+            return v;
+        case SIM_AD0STAT:
+            return Adc_Stat() | (Adc_Irq() << 16);
+
+        case SIM_T0IR:   return reg[SIM_T0IR] | READ_CANARY;
+        case SIM_T1IR:   return reg[SIM_T1IR] | READ_CANARY;
+        case SIM_T0TC:   return Tmr_TC(0, Tmr_Div(0));
+        case SIM_T1TC:   return Tmr_TC(1, Tmr_Div(1));
+        case SIM_T0PC:   return Tmr_PC(0);
+        case SIM_T1PC:   return Tmr_PC(1);
+
+        case SIM_VICRawIntr:   return Sim_Raw();
+        case SIM_VICIRQStatus: return Sim_Raw() & reg[SIM_VICIntEnable];
+        case SIM_VICIntEnable: return reg[SIM_VICIntEnable];
+
+        case SIM_ILR:    return reg[SIM_ILR] | READ_CANARY;
+        case SIM_CTIME0:
+            return (reg[SIM_SEC] & 63) | ((reg[SIM_MIN] & 63) << 8) |
+                   ((reg[SIM_HOUR] & 31) << 16) | ((reg[SIM_DOW] & 7) << 24);
+        case SIM_CTIME1:
+            return (reg[SIM_DOM] & 31) | ((reg[SIM_MONTH] & 15) << 8) |
+                   ((reg[SIM_YEAR] & 0xFFF) << 16);
+        case SIM_CTIME2: return reg[SIM_DOY] & 0xFFF;
+
+        case SIM_PLL0STAT:                  // Always locked
+            return (1 << 10) | ((reg[SIM_PLL0CON] & 3) << 8) |
+                   (reg[SIM_PLL0CFG] & 0x7F);
+
+        default:
+            return 0;                       // Write-only registers
+    }
+}
+
+/*
+ * Function: Sim_Dispatch
+ * Purpose : Enters pending interrupts, highest priority
+ *           (lowest VIC slot) first
+ */
+static void Sim_Dispatch(void)
+{
+    u32 pend, slot, cntl, guard = 0;
+
+    while((pend = Sim_Raw() & reg[SIM_VICIntEnable] & ~reg[SIM_VICIntSelect]))
+    {
+        for(slot = 0; slot < 16; slot++)
+        {
+            cntl = reg[SIM_VICVectCntl0 + slot];
+            if((cntl & (1 << 5)) && (pend & (1 << (cntl & 31))))
+                break;
+        }
+        if(slot == 16)
+            Sim_Fail("unvectored interrupt 0x%08x", pend);
+        if(++guard > 1000)
+            Sim_Fail("interrupt storm in slot %u", slot);
+
+        simStats.irq[slot]++;
+        Sim_Advance(now + SIM_IRQ_CYCLES);
+        inIsr = 1;
+        ((void (*)(void))(unsigned long)reg[SIM_VICVectAddr0 + slot])();
+        if(pendId != REG_NONE)
+            Sim_Commit();
+        inIsr = 0;
+    }
+}
+
+/* ================= REGISTER ACCESS ================= */
+/*
+ * Function: Sim_Reg
+ * Purpose : One firmware register access (LPC214X.H)
+ */
+volatile unsigned int *Sim_Reg(unsigned int id)
+{
+    if(id >= SIM_NUM_REGS)
+        Sim_Fail("register id %u", id);
+
+    if(pendId != REG_NONE)
+        Sim_Commit();
+
+    simStats.accesses++;
+    Sim_Advance(now + SIM_ACCESS_CYCLES);
+    if(!inIsr)
+        Sim_Dispatch();
+
+    if(kind[id] == RK_PLAIN)
+        return &reg[id];
+
+    pendId = id;
+    if(kind[id] == RK_CALC)
+    {
+        calc[id] = Sim_Read(id);
+        pendOld  = calc[id];
+        return &calc[id];
+    }
+    pendOld = reg[id];
+    return &reg[id];
+}
+
+/* ================= FLASH / IAP ================= */
+/*
+ * Function: Sim_IAP
+ * Purpose : IAP commands on the modelled log sectors, with the
+ *           chip's checks and typical erase / program times
+ *           (the CPU is stalled meanwhile)
+ */
+void Sim_IAP(unsigned int *cmd, unsigned int *res)
+{
+    u32 first, last, off, mask, i, n;
+    u64 cost = 0;
+    u8  cut;
+
+    if(pendId != REG_NONE)
+        Sim_Commit();
+    simStats.iapCmds++;
+    res[0] = 0;
+
+    switch(cmd[0])
+    {
+        case 50:                            // Prepare sectors
+        case 52:                            // Erase sectors
+            first = cmd[1];
+            last  = cmd[2];
+            if(first > last || first < SIM_FLASH_FIRST ||
+               last >= SIM_FLASH_FIRST + SIM_FLASH_SECS)
+            {
+                res[0] = 7;                 // INVALID_SECTOR
+                break;
+            }
+            mask = 0;
+            for(i = first; i <= last; i++)
+                mask |= 1 << (i - SIM_FLASH_FIRST);
+            if(cmd[0] == 50)
+            {
+                iapPrepared |= mask;
+                break;
+            }
+            if((iapPrepared & mask) != mask)
+            {
+                res[0] = 9;                 // SECTOR_NOT_PREPARED
+                break;
+            }
+            n   = (last - first + 1) * 0x1000;
+            cut = cutCmds && !--cutCmds;
+            memset(&simFlash[(first - SIM_FLASH_FIRST) * 0x1000], 0xFF,
+                   (cut && cutKeep < n) ? cutKeep : n);
+            for(i = first; i <= last; i++)
+                simStats.flashErases[i - SIM_FLASH_FIRST]++;
+            if(cut)
+                Sim_PowerCut();
+            cost = SIM_US(400000) * (last - first + 1);
+            iapPrepared = 0;
+            break;
+
+        case 51:                            // Copy RAM to flash
+            off = cmd[1] - (u32)(unsigned long)simFlash;
+            if(off >= SIM_FLASH_SIZE || (off & 0xFF))
+                res[0] = 3;                 // DST_ADDR_ERROR
+            else if(cmd[2] & 3)
+                res[0] = 2;                 // SRC_ADDR_ERROR
+            else if((cmd[3] != 256 && cmd[3] != 512 && cmd[3] != 1024 &&
+                     cmd[3] != 4096) || off + cmd[3] > SIM_FLASH_SIZE)
+                res[0] = 6;                 // COUNT_ERROR
+            else if(!(iapPrepared & (1 << (off / 0x1000))))
+                res[0] = 9;                 // SECTOR_NOT_PREPARED
+            else
+            {
+                n   = cmd[3];
+                cut = cutCmds && !--cutCmds;
+                if(cut && cutKeep < n)
+                    n = cutKeep;
+                for(i = 0; i < n; i++)          // Programming only clears bits
+                    simFlash[off + i] &= ((u8 *)(unsigned long)cmd[2])[i];
+                if(cut)
+                    Sim_PowerCut();
+                cost = SIM_US(1000) * (cmd[3] / 256);
+                iapPrepared = 0;
+            }
+            break;
+
+        default:
+            res[0] = 1;                     // INVALID_COMMAND
+            break;
+    }
+
+    if(res[0])
+        simStats.iapErrors++;
+    Sim_Advance(now + cost);
+}
+
+/*
+ * Function: Sim_PowerCut
+ * Purpose : Ends the run where the supply failed; the firmware
+ *           does not get to run another instruction
+ */
+static void Sim_PowerCut(void)
+{
+    cutCmds = 0;
+    if(!running)
+        Sim_Fail("power cut outside Sim_Run");
+    longjmp(runEnd, 1);
+}
+
+void Sim_FlashCut(u32 cmds, u32 keep)
+{
+    cutCmds = cmds;
+    cutKeep = keep;
+}
+
+/*
+ * Function: Sim_FlashLoad / Sim_FlashSave
+ * Purpose : Flash log area image on disk
+ */
+u8 Sim_FlashLoad(const char *path)
+{
+    FILE *f = fopen(path, "rb");
+    u8 ok;
+
+    if(!f)
+        return 0;
+    ok = fread(simFlash, 1, SIM_FLASH_SIZE, f) == SIM_FLASH_SIZE;
+    fclose(f);
+    return ok;
+}
+
+u8 Sim_FlashSave(const char *path)
+{
+    FILE *f = fopen(path, "wb");
+    u8 ok;
+
+    if(!f)
+        return 0;
+    ok = fwrite(simFlash, 1, SIM_FLASH_SIZE, f) == SIM_FLASH_SIZE;
+    return (fclose(f) == 0) && ok;
+}
+
+/* ================= STIMULUS ================= */
+
+void Sim_Key(u32 key, u8 down)
+{
+    if(key >= 16)
+        return;
+    if(down)
+        keysDown |= (1 << key);
+    else
+        keysDown &= ~(1 << key);
+}
+
+void Sim_Switch(u8 down)
+{
+    swDown = down;
+}
+
+void Sim_Temp(u32 ch, s32 centiC)
+{
+    if(ch >= STIM_CH)
+        return;
+    tempFixed[ch] = 1;
+    tempFix[ch]   = centiC;
+}
+
+static int Pt_Cmp(const void *a, const void *b)
+{
+    u64 x = ((const SimPt *)a)->t, y = ((const SimPt *)b)->t;
+
+    return (x > y) - (x < y);
+}
+
+static int Ev_Cmp(const void *a, const void *b)
+{
+    u64 x = ((const SimEv *)a)->t, y = ((const SimEv *)b)->t;
+
+    return (x > y) - (x < y);
+}
+
+static void Stim_AddEv(u64 t, u8 type, u8 arg, u8 down)
+{
+    stimEv = realloc(stimEv, (stimCnt + 1) * sizeof(SimEv));
+    if(!stimEv)
+        Sim_Fail("out of memory");
+    stimEv[stimCnt].t    = t;
+    stimEv[stimCnt].type = type;
+    stimEv[stimCnt].arg  = arg;
+    stimEv[stimCnt].down = down;
+    stimCnt++;
+}
+
+/*
+ * Function: Sim_LoadScenario
+ * Purpose : Reads temperature points and key / switch events
+ *           (format in sim.h); times are from the start
+ */
+u8 Sim_LoadScenario(const char *path)
+{
+    FILE *f = fopen(path, "r");
+    char line[128], word[16];
+    f64 sec, a, b;
+    u32 ch, n;
+    u64 t;
+
+    if(!f)
+        return 0;
+
+    while(fgets(line, sizeof(line), f))
+    {
+        if(sscanf(line, "%lf %15s", &sec, word) != 2 || line[0] == '#')
+            continue;
+        t = (u64)(sec * SIM_PCLK);
+
+        if(!strcmp(word, "temp") &&
+           sscanf(line, "%*f %*s %u %lf", &ch, &a) == 2 && ch < STIM_CH)
+        {
+            n = tempCnt[ch];
+            tempPts[ch] = realloc(tempPts[ch], (n + 1) * sizeof(SimPt));
+            if(!tempPts[ch])
+                Sim_Fail("out of memory");
+            tempPts[ch][n].t = t;
+            tempPts[ch][n].v = (s32)(a * 100 + ((a < 0) ? -0.5 : 0.5));
+            tempCnt[ch]++;
+        }
+        else if(!strcmp(word, "key") &&
+                sscanf(line, "%*f %*s %u %lf", &ch, &b) == 2 && ch < 16)
+        {
+            Stim_AddEv(t, STIM_KEY, (u8)ch, 1);
+            Stim_AddEv(t + (u64)(b * SIM_PCLK / 1000), STIM_KEY, (u8)ch, 0);
+        }
+        else if(!strcmp(word, "sw") && sscanf(line, "%*f %*s %lf", &b) == 1)
+        {
+            Stim_AddEv(t, STIM_SW, 0, 1);
+            Stim_AddEv(t + (u64)(b * SIM_PCLK / 1000), STIM_SW, 0, 0);
+        }
+        else
+        {
+            fprintf(stderr, "sim: %s: bad line: %s", path, line);
+            fclose(f);
+            return 0;
+        }
+    }
+    fclose(f);
+
+    for(ch = 0; ch < STIM_CH; ch++)
+        if(tempCnt[ch])
+            qsort(tempPts[ch], tempCnt[ch], sizeof(SimPt), Pt_Cmp);
+    if(stimCnt)
+        qsort(stimEv, stimCnt, sizeof(SimEv), Ev_Cmp);
+    evDirty = 1;
+    return 1;
+}
+
+/* ================= OUTPUT ================= */
+
+void Sim_UartOutput(FILE *f)
+{
+    uartOut = f;
+}
+
+void Sim_UartTap(void (*fn)(u8 byte))
+{
+    uartTap = fn;
+}
+
+void Sim_UartInput(const u8 *buf, u32 len)
+{
+    u8 idle = (rxLineCnt == 0);
+
+    while(len--)
+    {
+        if(rxLineCnt == RX_LINE_SIZE)
+            Sim_Fail("UART receive line overflow");
+        rxLine[(rxLineHead + rxLineCnt) % RX_LINE_SIZE] = *buf++;
+        rxLineCnt++;
+    }
+    if(idle && rxLineCnt)
+        Uart_RxNext();
+}
+
+void Sim_Periodic(void (*fn)(void), u64 period)
+{
+    hostFn     = fn;
+    hostPeriod = period;
+    hostNext   = (fn && period) ? now + period : NEVER;
+    evDirty    = 1;
+}
+
+u8 Sim_UartBusy(void)
+{
+    return txCnt || txShift;
+}
+
+void Sim_LcdRow(u32 row, char *buf)
+{
+    if(pendId != REG_NONE)
+        Sim_Commit();               // The last write may latch a byte
+    memcpy(buf, &lcdRam[row ? 0x40 : 0], 16);
+    buf[16] = '\0';
+}
+
+void Sim_LcdCgram(u8 *buf)
+{
+    if(pendId != REG_NONE)
+        Sim_Commit();
+    memcpy(buf, lcdCgRam, sizeof(lcdCgRam));
+}
+
+void Sim_LcdHang(u8 on)
+{
+    lcdHang = on;
+}
+
+/* ================= CONTROL ================= */
+/*
+ * Function: Sim_Init
+ * Purpose : Reset state of every modelled peripheral
+ */
+void Sim_Init(void)
+{
+    u32 i;
+
+    if(!flashInit)
+    {
+        memset(simFlash, 0xFF, SIM_FLASH_SIZE);
+        flashInit = 1;
+    }
+
+    memset(reg, 0, sizeof(reg));
+    memset(calc, 0, sizeof(calc));
+    memset(&simStats, 0, sizeof(simStats));
+    cutCmds = 0;
+    memset(tmr, 0, sizeof(tmr));
+
+    for(i = 0; i < SIM_NUM_REGS; i++)
+        kind[i] = RK_PLAIN;
+    {
+        static const u32 calcIds[] =
+        {
+            SIM_IOPIN0, SIM_IOSET0, SIM_IOCLR0,
+            SIM_IOPIN1, SIM_IOSET1, SIM_IOCLR1,
+            SIM_U0RBR, SIM_U0THR, SIM_U0IIR, SIM_U0FCR, SIM_U0LSR,
+            SIM_AD0GDR, SIM_AD0STAT,
+            SIM_AD0DR0, SIM_AD0DR1, SIM_AD0DR2, SIM_AD0DR3,
+            SIM_AD0DR4, SIM_AD0DR5, SIM_AD0DR6, SIM_AD0DR7,
+            SIM_T0IR, SIM_T0TC, SIM_T0PC, SIM_T1IR, SIM_T1TC, SIM_T1PC,
+            SIM_VICIRQStatus, SIM_VICRawIntr, SIM_VICIntEnable, SIM_VICIntEnClr,
+            SIM_ILR, SIM_CTIME0, SIM_CTIME1, SIM_CTIME2, SIM_PLL0STAT
+        };
+        static const u32 hookIds[] =
+        {
+            SIM_T0TCR, SIM_T0PR, SIM_T0MCR, SIM_T0EMR,
+            SIM_T0MR0, SIM_T0MR1, SIM_T0MR2, SIM_T0MR3,
+            SIM_T1TCR, SIM_T1PR, SIM_T1MCR, SIM_T1EMR,
+            SIM_T1MR0, SIM_T1MR1, SIM_T1MR2, SIM_T1MR3,
+            SIM_AD0CR, SIM_CCR, SIM_PCON
+        };
+
+        for(i = 0; i < sizeof(calcIds) / sizeof(calcIds[0]); i++)
+            kind[calcIds[i]] = RK_CALC;
+        for(i = 0; i < sizeof(hookIds) / sizeof(hookIds[0]); i++)
+            kind[hookIds[i]] = RK_HOOK;
+    }
+
+    // Reset values the firmware may read before writing
+    reg[SIM_U0DLL]   = 1;
+    reg[SIM_U0FDR]   = 0x10;
+    reg[SIM_PCONP]   = 0x03BE;
+    reg[SIM_AD0CR]   = 0x01;
+    reg[SIM_AMR]     = 0xFF;
+    reg[SIM_DOM]     = 1;
+    reg[SIM_MONTH]   = 1;
+    reg[SIM_DOY]     = 1;
+
+    pendId  = REG_NONE;
+    now     = 0;
+    pdTotal = 0;
+    inIsr   = 0;
+    inPd    = 0;
+    endTime = NEVER;
+    evDirty = 1;
+
+    txHead = txCnt = 0;
+    txShift = threPend = 0;
+    rxLineHead = rxLineCnt = 0;
+    rxHead = rxCnt = 0;
+    rxEnd = NEVER;
+    hostFn = 0;
+    hostNext = NEVER;
+    adcBusy = 0;
+    adcLcg  = 1;
+    rtcNext = NEVER;
+    latch0  = latch1 = 0;
+    keysDown = 0;
+    swDown  = 0;
+    memset(lcdRam, ' ', sizeof(lcdRam));
+    memset(lcdCgRam, 0, sizeof(lcdCgRam));
+    lcdAc = lcdCg = 0;
+    lcdBusyEnd = 0;
+    lcdHang = 0;
+    iapPrepared = 0;
+
+    for(i = 0; i < STIM_CH; i++)
+    {
+        free(tempPts[i]);
+        tempPts[i]   = 0;
+        tempCnt[i]   = 0;
+        tempCur[i]   = 0;
+        tempFixed[i] = 0;
+    }
+    free(stimEv);
+    stimEv  = 0;
+    stimCnt = stimIdx = 0;
+}
+
+/*
+ * Function: Sim_Run
+ * Purpose : Runs entry for seconds of virtual time
+ */
+void Sim_Run(void (*entry)(void), f64 seconds)
+{
+    endTime = now + (u64)(seconds * SIM_PCLK);
+    evDirty = 1;
+    running = 1;
+    if(!setjmp(runEnd))
+        entry();
+    running = 0;
+    endTime = NEVER;
+    evDirty = 1;
+    pendId  = REG_NONE;               // The firmware was cut off
+    inIsr   = 0;
+    inPd    = 0;
+}
+
+/*
+ * Function: Sim_Idle
+ * Purpose : Lets cycles pass with only ISRs running (tests)
+ */
+void Sim_Idle(u64 cycles)
+{
+    u64 target = now + cycles;
+
+    if(pendId != REG_NONE)
+        Sim_Commit();
+    for(;;)
+    {
+        Sim_Dispatch();
+        if(evDirty)
+            Sim_NextEvent();
+        if(evTime > target)
+            break;
+        now = evTime;
+        Sim_Fire();
+    }
+    now = target;
+    Sim_Dispatch();
+}
+
+u64 Sim_Now(void)
+{
+    return now;
+}
@@ -0,0 +1,162 @@
+#ifndef __SIM_H__
+#define __SIM_H__            // Header guard to prevent multiple inclusion
+
+#include <stdio.h>           // FILE
+#include "types.h"           // Custom data types (u8, u32, u64)
+
+/* ================= VIRTUAL TIME ================= */
+/*
+ * Virtual time counts PCLK cycles (15 MHz, 67 ns). The firmware
+ * code between two register accesses takes no virtual time; each
+ * access costs SIM_ACCESS_CYCLES and each interrupt entry
+ * SIM_IRQ_CYCLES, a rough stand-in for the ARM7 at 60 MHz.
+ */
+#define SIM_PCLK          15000000
+#define SIM_ACCESS_CYCLES 2
+#define SIM_IRQ_CYCLES    8
+
+#define SIM_US(us)        ((u64)(us) * (SIM_PCLK / 1000000))
+#define SIM_SEC(s)        ((u64)(s) * SIM_PCLK)
+
+/* ================= FLASH LOG AREA ================= */
+
+#define SIM_FLASH_FIRST   22            // First modelled sector
+#define SIM_FLASH_SECS    4             // Sectors 22-25, 4 KB each
+#define SIM_FLASH_SIZE    (SIM_FLASH_SECS * 0x1000)
+
+/* ================= STATISTICS ================= */
+
+typedef struct
+{
+    u64 accesses;             // Register accesses
+    u64 idleCycles;           // Time in idle mode (PCON IDL)
+    u64 pdCycles;             // Time in power-down (PCON PD)
+    u64 irq[16];              // ISR entries per VIC slot
+    u64 uartBytes;            // Bytes shifted out of UART0
+    u64 uartLost;             // THR writes to a full TX FIFO
+    u64 uartRxBytes;          // Bytes received by UART0
+    u64 uartRxLost;           // Bytes lost to a full RX FIFO
+    u64 adcConv;              // ADC conversions completed
+    u64 lcdWrites;            // Bytes latched by the HD44780
+    u64 lcdBusy;              // LCD writes while it was busy
+    u64 iapCmds;              // IAP commands executed
+    u64 iapErrors;            // IAP commands that failed
+    u64 flashErases[SIM_FLASH_SECS];  // Erase cycles per sector
+} SimStats;
+
+extern SimStats simStats;
+
+/* ================= CONTROL ================= */
+
+/*
+ * Resets the peripheral model, virtual time and statistics
+ * (flash contents are kept)
+ */
+void Sim_Init(void);
+
+/*
+ * Runs entry (normally the firmware main) until seconds of
+ * virtual time have passed; entry is abandoned at that point
+ */
+void Sim_Run(void (*entry)(void), f64 seconds);
+
+/*
+ * Lets virtual time pass as an idle CPU would: interrupts are
+ * taken, the calling code does not run (for tests)
+ */
+void Sim_Idle(u64 cycles);
+
+/*
+ * Current virtual time (cycles)
+ */
+u64 Sim_Now(void);
+
+/*
+ * Stops with a message (model or firmware misuse)
+ */
+void Sim_Fail(const char *fmt, ...);
+
+/*
+ * Calls fn every period cycles of virtual time, from the event
+ * loop (0 = stop); for host I/O and pacing alongside a run
+ */
+void Sim_Periodic(void (*fn)(void), u64 period);
+
+/* ================= STIMULUS ================= */
+
+/*
+ * Reads a scenario file, one event per line:
+ *   <sec> temp <ch> <degC>   temperature set point (linear between)
+ *   <sec> key <n> <ms>       press keypad key n for ms
+ *   <sec> sw <ms>            hold the EDIT switch for ms
+ * Returns 0 if the file cannot be read or has a bad line
+ */
+u8 Sim_LoadScenario(const char *path);
+
+/*
+ * Sets a key or the EDIT switch at once (for tests)
+ */
+void Sim_Key(u32 key, u8 down);
+void Sim_Switch(u8 down);
+
+/*
+ * Fixes the temperature of a channel (centi-degC), overriding
+ * the scenario (for tests)
+ */
+void Sim_Temp(u32 ch, s32 centiC);
+
+/* ================= OUTPUT ================= */
+
+/*
+ * UART0 output goes to f (0 = discarded, still counted)
+ */
+void Sim_UartOutput(FILE *f);
+
+/*
+ * Calls fn with each byte as it leaves UART0 (0 = none)
+ */
+void Sim_UartTap(void (*fn)(u8 byte));
+
+/*
+ * Returns 1 while the UART0 FIFO or shift register holds data
+ */
+u8 Sim_UartBusy(void);
+
+/*
+ * Queues bytes on the UART0 receive line; they arrive one
+ * character time apart, as from a host at the same baud rate
+ */
+void Sim_UartInput(const u8 *buf, u32 len);
+
+/*
+ * Copies one LCD row (16 characters and a terminator) to buf
+ */
+void Sim_LcdRow(u32 row, char *buf);
+
+/*
+ * Copies the 64 bytes of LCD CGRAM to buf
+ */
+void Sim_LcdCgram(u8 *buf);
+
+/*
+ * The LCD stops answering while on is 1: its busy flag reads 1
+ * (for tests)
+ */
+void Sim_LcdHang(u8 on);
+
+/*
+ * Cuts the power during the cmds-th IAP erase or copy command
+ * from now (0 = never): a copy programs only its first keep
+ * bytes, an erase sets only the first keep bytes of the sector
+ * to 0xFF, and the run ends there as at the end of Sim_Run
+ */
+void Sim_FlashCut(u32 cmds, u32 keep);
+
+/*
+ * Loads / saves the flash log area, so a run can resume the
+ * log of an earlier one
+ */
+u8 Sim_FlashLoad(const char *path);
+u8 Sim_FlashSave(const char *path);
+
+#endif   // End of __SIM_H__
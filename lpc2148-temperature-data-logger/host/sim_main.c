@@ -0,0 +1,307 @@
+#define _GNU_SOURCE                 // posix_openpt, cfmakeraw
+#include <stdio.h>           // Report
+#include <stdlib.h>          // atof, exit, pseudo-terminal
+#include <string.h>          // strcmp
+#include <time.h>            // Host wall clock, pacing
+#include <fcntl.h>           // Non-blocking serial link
+#include <unistd.h>          // read, write, symlink
+#include <termios.h>         // Raw serial link
+#include "types.h"           // Custom data types (u8, u32, u64)
+#include "sim.h"             // Simulator interface
+#include "sched.h"           // Per-task run statistics
+#include "uart.h"            // Transmit ring statistics
+#include "adc.h"             // Sample ring statistics
+#include "flashlog.h"        // Flash log statistics
+#include "power.h"           // Power-down statistics
+#include "lcd.h"             // LCD bus statistics
+#include "logrec.h"          // Log format
+#include "stats.h"           // Aggregation mode
+
+/* ================= HOST RUNNER ================= */
+/*
+ * lpc_sim runs the unmodified firmware main() against the
+ * register model at accelerated time and reports what it did:
+ *
+ *   lpc_sim [-t seconds] [-s scenario] [-u uart.txt] [-f flash.bin] [-c]
+ *           [-p link] [-x factor] [-w seconds] [-l text|binary|packed] [-a]
+ *
+ * -u - sends the UART output to stdout, ahead of the report.
+ * -l starts in another log format and -a in aggregation mode,
+ * as if set from the edit menu (lpc_decode reads such captures).
+ * -f loads the flash log area before the run (if the file exists)
+ * and saves it after, so consecutive runs model power cycles.
+ * -c exits non-zero on drops, missed deadlines, IAP errors, LCD
+ * timing violations or no UART output (used by ctest).
+ *
+ * -p connects UART0 to a pseudo-terminal and makes link a symlink
+ * to it, so a host tool (lpc_dl) can talk to the firmware as to
+ * the board. Time is then paced at factor x real time (-x, default
+ * 1) so host timeouts and the firmware's agree; -w lets the first
+ * seconds run unpaced, and link only appears after them.
+ */
+
+extern int fw_main(void);    // main.c, renamed by the build
+
+static void Firmware(void)
+{
+    fw_main();
+}
+
+static f64 HostSeconds(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void Usage(void)
+{
+    fprintf(stderr, "usage: lpc_sim [-t seconds] [-s scenario] "
+                    "[-u uart.txt] [-f flash.bin] [-c]\n"
+                    "               [-p link] [-x factor] [-w seconds]\n"
+                    "               [-l text|binary|packed] [-a]\n");
+    exit(2);
+}
+
+/* ================= SERIAL LINK ================= */
+
+#define LINK_POLL     SIM_US(1000)    // Host I/O every 1 ms virtual
+
+static const char *linkPath;          // Symlink to the pty (-p)
+static int  ptyFd = -1;               // Master side
+static u8   ptyOut[65536];            // Logger -> host, not yet written
+static u32  ptyOutCnt;
+static u64  linkLost;                 // Bytes dropped, ptyOut full
+static f64  paceX = 1;                // Virtual per real second (-x)
+static u64  warmUp;                   // Unpaced cycles first (-w)
+static f64  paceWall;                 // Host time at the end of warmUp
+
+static void Link_Tx(u8 b)
+{
+    if(ptyOutCnt < sizeof(ptyOut))
+        ptyOut[ptyOutCnt++] = b;
+    else
+        linkLost++;
+}
+
+/*
+ * Function: Link_Open
+ * Purpose : Creates the pseudo-terminal, raw and non-blocking,
+ *           and points linkPath at its slave side
+ */
+static void Link_Open(void)
+{
+    struct termios tio;
+    const char *slave;
+
+    ptyFd = posix_openpt(O_RDWR | O_NOCTTY);
+    if(ptyFd < 0 || grantpt(ptyFd) || unlockpt(ptyFd) ||
+       !(slave = ptsname(ptyFd)))
+    {
+        fprintf(stderr, "lpc_sim: cannot create a pseudo-terminal\n");
+        exit(2);
+    }
+    // Held open so the master never sees a hang-up between
+    // host tool runs
+    if(open(slave, O_RDWR | O_NOCTTY) < 0 || tcgetattr(ptyFd, &tio))
+    {
+        fprintf(stderr, "lpc_sim: cannot open %s\n", slave);
+        exit(2);
+    }
+    cfmakeraw(&tio);
+    tcsetattr(ptyFd, TCSANOW, &tio);
+    fcntl(ptyFd, F_SETFL, fcntl(ptyFd, F_GETFL) | O_NONBLOCK);
+
+    unlink(linkPath);
+    if(symlink(slave, linkPath))
+    {
+        fprintf(stderr, "lpc_sim: cannot create %s\n", linkPath);
+        exit(2);
+    }
+    Sim_UartTap(Link_Tx);
+    paceWall = HostSeconds();
+}
+
+/*
+ * Function: Link_Poll
+ * Purpose : Moves bytes between the pty and UART0 and holds
+ *           virtual time to paceX x real time (Sim_Periodic)
+ */
+static void Link_Poll(void)
+{
+    u8  buf[256];
+    s32 n;
+    f64 ahead;
+    struct timespec ts;
+
+    if(ptyFd < 0)
+    {
+        if(Sim_Now() >= warmUp)
+            Link_Open();
+        return;
+    }
+
+    if(ptyOutCnt && (n = write(ptyFd, ptyOut, ptyOutCnt)) > 0)
+    {
+        memmove(ptyOut, ptyOut + n, ptyOutCnt - n);
+        ptyOutCnt -= n;
+    }
+    while((n = read(ptyFd, buf, sizeof(buf))) > 0)
+        Sim_UartInput(buf, n);
+
+    ahead = (f64)(Sim_Now() - warmUp) / SIM_PCLK / paceX -
+            (HostSeconds() - paceWall);
+    if(ahead > 0)
+    {
+        ts.tv_sec  = (time_t)ahead;
+        ts.tv_nsec = (long)((ahead - ts.tv_sec) * 1e9);
+        nanosleep(&ts, 0);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    f64 secs = 60, wall, virt;
+    const char *scen = 0, *uartPath = 0, *flashPath = 0;
+    FILE *uf = 0;
+    u8 check = 0;
+    char row[17];
+    u32 i, misses = 0, bad = 0;
+    u64 irqs = 0;
+
+    for(i = 1; i < (u32)argc; i++)
+    {
+        if(!strcmp(argv[i], "-c"))
+            check = 1;
+        else if(!strcmp(argv[i], "-a"))
+            log_stats = STATS_ON;
+        else if(i + 1 >= (u32)argc)
+            Usage();
+        else if(!strcmp(argv[i], "-t"))
+            secs = atof(argv[++i]);
+        else if(!strcmp(argv[i], "-s"))
+            scen = argv[++i];
+        else if(!strcmp(argv[i], "-u"))
+            uartPath = argv[++i];
+        else if(!strcmp(argv[i], "-f"))
+            flashPath = argv[++i];
+        else if(!strcmp(argv[i], "-p"))
+            linkPath = argv[++i];
+        else if(!strcmp(argv[i], "-x"))
+            paceX = atof(argv[++i]);
+        else if(!strcmp(argv[i], "-w"))
+            warmUp = SIM_SEC(atof(argv[++i]));
+        else if(!strcmp(argv[i], "-l"))
+        {
+            i++;
+            if(!strcmp(argv[i], "text"))
+                log_format = LOG_FMT_TEXT;
+            else if(!strcmp(argv[i], "binary"))
+                log_format = LOG_FMT_BINARY;
+            else if(!strcmp(argv[i], "packed"))
+                log_format = LOG_FMT_PACKED;
+            else
+                Usage();
+        }
+        else
+            Usage();
+    }
+    if(paceX <= 0)
+        Usage();
+
+    Sim_Init();
+    if(flashPath)
+        Sim_FlashLoad(flashPath);         // Missing file = erased flash
+    if(scen && !Sim_LoadScenario(scen))
+    {
+        fprintf(stderr, "lpc_sim: cannot read scenario %s\n", scen);
+        return 2;
+    }
+    if(uartPath && !strcmp(uartPath, "-"))
+        uf = stdout;
+    else if(uartPath && !(uf = fopen(uartPath, "wb")))
+    {
+        fprintf(stderr, "lpc_sim: cannot write %s\n", uartPath);
+        return 2;
+    }
+    Sim_UartOutput(uf);
+    if(linkPath)
+        Sim_Periodic(Link_Poll, LINK_POLL);
+
+    wall = HostSeconds();
+    Sim_Run(Firmware, secs);
+    wall = HostSeconds() - wall;
+    virt = (f64)Sim_Now() / SIM_PCLK;
+
+    if(uf && uf != stdout)
+        fclose(uf);
+    if(linkPath)
+        unlink(linkPath);
+    if(flashPath && !Sim_FlashSave(flashPath))
+        fprintf(stderr, "lpc_sim: cannot write %s\n", flashPath);
+
+    /* --------- REPORT --------- */
+    for(i = 0; i < 16; i++)
+        irqs += simStats.irq[i];
+
+    printf("virtual  %.3f s in %.3f s host (x%.0f)\n",
+           virt, wall, wall > 0 ? virt / wall : 0);
+    printf("accesses %llu (%.0f per virtual s), irqs %llu\n",
+           (unsigned long long)simStats.accesses,
+           simStats.accesses / virt, (unsigned long long)irqs);
+    printf("idle     %.1f %%, power-down %.1f %%\n",
+           100.0 * simStats.idleCycles / Sim_Now(),
+           100.0 * simStats.pdCycles / Sim_Now());
+
+    printf("task period(us) runs misses skips max(us)\n");
+    for(i = 0; i < schedTaskCnt; i++)
+    {
+        printf("%4u %10u %5u %6u %5u %7u\n", i, schedTask[i].period,
+               schedTask[i].runs, schedTask[i].misses,
+               schedTask[i].skips, schedTask[i].maxUs);
+        misses += schedTask[i].misses + schedTask[i].skips;
+    }
+
+    printf("uart     %llu bytes, ring drops %u, FIFO overruns %llu\n",
+           (unsigned long long)simStats.uartBytes, uartTxDropCnt,
+           (unsigned long long)simStats.uartLost);
+    printf("uart rx  %llu bytes, FIFO overruns %llu, ring drops %u\n",
+           (unsigned long long)simStats.uartRxBytes,
+           (unsigned long long)simStats.uartRxLost, uartRxDropCnt);
+    if(linkPath)
+        printf("link     %llu bytes lost\n", (unsigned long long)linkLost);
+    printf("adc      %llu conversions, %u samples, drops %u, overruns %u\n",
+           (unsigned long long)simStats.adcConv, adcSampleCnt,
+           adcDropCnt, adcOverrunCnt);
+    printf("flash    %u records, %u pages, %u erases, errors %u/%llu\n",
+           flogStats.records, flogStats.pages, flogStats.erases,
+           flogStats.errors, (unsigned long long)simStats.iapErrors);
+    printf("power    %u wakes, %u refused\n", pwrStats.wakes, pwrStats.refused);
+    printf("lcd      %llu writes, %llu while busy, %u timeouts\n",
+           (unsigned long long)simStats.lcdWrites,
+           (unsigned long long)simStats.lcdBusy, lcdBusyTimeouts);
+    for(i = 0; i < 2; i++)
+    {
+        Sim_LcdRow(i, row);
+        printf("lcd%u     [%s]\n", i, row);
+    }
+
+    if(!check)
+        return 0;
+
+    if(!simStats.uartBytes)
+        bad |= 1;
+    if(uartTxDropCnt || simStats.uartLost || adcDropCnt ||
+       uartRxDropCnt || simStats.uartRxLost || linkLost)
+        bad |= 2;
+    if(misses)
+        bad |= 4;
+    if(flogStats.errors || simStats.iapErrors)
+        bad |= 8;
+    if(simStats.lcdBusy || lcdBusyTimeouts)
+        bad |= 16;
+    if(bad)
+        printf("check failed (0x%02x)\n", bad);
+    return bad ? 1 : 0;
+}
@@ -10,9 +10,40 @@
 void Init_ADC(u32 chNo);
 
 /*
- * Reads ADC value from the selected channel
- * chNo     ? ADC channel number
- * eAR      ? Pointer to store equivalent analog voltage
- * adcDVal  ? Pointer to store digital ADC value
+ * Starts Timer0-paced burst scans of several channels
+ * chMask  ? bit n set to convert AINn
+ * rateHz  ? scan passes per second
  */
-void Read_ADC(u32 chNo, f32 *eAR, u32 *adcDVal);
+void ADC_StartScan(u32 chMask, u32 rateHz);
+
+/*
+ * Stops the sampling engine
+ */
+void ADC_StopSampling(void);
+
+/*
+ * Stops sampling and powers the ADC down (PDN) for sleep
+ */
+void ADC_Suspend(void);
+
+/*
+ * Powers the ADC up and restarts the last burst scan
+ */
+void ADC_Resume(void);
+
+/*
+ * Takes the oldest sample from the ring buffer
+ * Returns 1 if a sample was available, 0 if empty
+ */
+u8 ADC_GetSample(u32 *chNo, u32 *adcDVal);
+
+/* ================= SAMPLING ENGINE STATISTICS ================= */
+
+// Samples dropped because the ring was full
+extern volatile u32 adcDropCnt;
+
+// Scan passes skipped, the previous one still running
+extern volatile u32 adcOverrunCnt;
+
+// Conversions completed
+extern volatile u32 adcSampleCnt;
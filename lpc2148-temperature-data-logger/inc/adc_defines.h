@@ -25,9 +25,15 @@
 // Power-down bit position in ADCR
 #define PDN_BIT            21
 
+// Burst (continuous scan) bit position in ADCR
+#define BURST_BIT          16
+
 // Start conversion bit position in ADCR
 #define ADC_CONV_START_BIT 24
 
+// Edge select bit for timer-triggered start (0 = rising)
+#define ADC_EDGE_BIT       27
+
 /* ================= ADDR REGISTER BIT DEFINITIONS ================= */
 
 // Digital conversion result bits (bits 615)
@@ -36,6 +42,45 @@
 // Conversion complete (DONE) bit position
 #define DONE_BIT           31
 
+/* ================= PER-CHANNEL REGISTER DEFINITIONS ================= */
+
+// ADC interrupt enable register (AD0INTEN)
+#ifndef ADINTEN
+#define ADINTEN (*((volatile unsigned long *) 0xE003400C))
+#endif
+
+// Per-channel result registers AD0DR0..AD0DR7
+#ifndef ADDR_CH
+#define ADDR_CH(ch) (*((volatile unsigned long *) (0xE0034010 + ((ch) << 2))))
+#endif
+
+/* ================= TIMER0 TRIGGER DEFINITIONS ================= */
+
+// T0MCR: interrupt and reset TC on MR0 match
+#define MR0I_BIT           0
+#define MR0R_BIT           1
+
+/* ================= SAMPLING ENGINE CONFIGURATION ================= */
+
+// Sample ring size in entries (must be a power of 2)
+#define ADC_RING_SIZE      512
+
+// Default and limit sample rates in Hz
+#define ADC_SAMPLE_RATE    160
+#define ADC_RATE_MIN       1
+#define ADC_RATE_MAX       10000
+
+// Ring entry layout: bits 0-9 code, bits 12-14 channel
+#define ADC_RING_CH_BITS   12
+
+/* ================= VIC DEFINITIONS ================= */
+
+// ADC0 interrupt source number in the VIC
+#define VIC_AD0_CHNL       18
+
+// Timer0 interrupt source number in the VIC
+#define VIC_TIMER0_CHNL    4
+
 /* ================= ADC PIN FUNCTION DEFINITIONS ================= */
 
 // ADC channel 0 pin select (P0.27)
@@ -58,4 +103,7 @@
 #define CH2 2
 #define CH3 3
 
+// Number of AIN channels available for sensors
+#define ADC_NUM_CH 4
+
 // Add more defines as and when required
@@ -0,0 +1,103 @@
+#ifndef __ALARM_H__
+#define __ALARM_H__        // Header guard to prevent multiple inclusion
+
+#include "types.h"         // Custom data types (u8, s16, u16, s32)
+
+/* ================= ALARM LEVELS ================= */
+
+#define ALM_NONE   0
+#define ALM_WARN   1       // Within warnBand of the limit
+#define ALM_CRIT   2       // At or above sensorCfg[].limit
+
+/* ================= ALARM EVENTS ================= */
+
+#define ALM_EV_LEVEL   (1<<0)   // Level changed (raise or clear)
+#define ALM_EV_RATE    (1<<1)   // Rate alarm raised or cleared
+#define ALM_EV_REMIND  (1<<2)   // Alarm still active, repeat message
+
+/* ================= DEFAULT CONFIGURATION ================= */
+
+// Number of channels handled by the engine
+#define ALM_NUM_CH         4
+
+// Alarm_Eval calls per second (alert task period 100 ms)
+#define ALM_EVAL_HZ        10
+
+// Warning starts this far below the limit (centi-degC)
+#define ALM_WARN_BAND      200
+
+// Temperature must fall this far below a threshold to clear it
+#define ALM_HYST           50
+
+// Evaluations a new level must persist before it is accepted
+#define ALM_MIN_TICKS      5
+
+// Rate alarm when |dT/dt| exceeds this (centi-degC per minute)
+#define ALM_RATE_MAX       300
+
+// Rate alarm clears below this fraction of the limit (1/4 steps)
+#define ALM_RATE_CLR_Q4    3
+
+// Rate is measured once per second and smoothed (1/2^n weight)
+#define ALM_RATE_SHIFT     3
+
+// Shortest interval between messages for one active alarm (s)
+#define ALM_REPEAT_S       60
+
+/* ================= PER-CHANNEL CONFIGURATION ================= */
+
+typedef struct
+{
+    s16 warnBand;             // Warning band below limit (centi)
+    u16 hyst;                 // Hysteresis (centi)
+    u16 rateMax;              // Rate limit (centi/min), 0 = off
+    u8  minTicks;             // Debounce in evaluations
+} AlarmCfg;
+
+extern AlarmCfg alarmCfg[ALM_NUM_CH];
+
+/* ================= PER-CHANNEL STATE (14 bytes) ================= */
+
+typedef struct
+{
+    u8  level;                // ALM_xxx accepted level
+    u8  pending;              // Level waiting for debounce
+    u8  cnt;                  // Evaluations pending has held
+    u8  rateCnt;              // Evaluations rate condition held
+    u8  rate;                 // Rate alarm active
+    u8  events;               // ALM_EV_xxx not yet taken
+    u8  sub;                  // Evaluations since last rate sample
+    u8  urgent;               // Events include an escalation
+    s16 ref;                  // Temperature at last rate sample
+    s16 slope;                // Smoothed dT/dt (centi/min)
+    u16 hold;                 // Evaluations until next reminder
+} AlarmState;
+
+extern AlarmState alarmSt[ALM_NUM_CH];
+
+/* ================= FUNCTION PROTOTYPES ================= */
+
+/*
+ * Resets every channel to ALM_NONE
+ */
+void Alarm_Init(void);
+
+/*
+ * Evaluates one channel; call ALM_EVAL_HZ times per second
+ * limit ? critical threshold in centi-degC
+ */
+void Alarm_Eval(u32 chNo, s32 centiC, s32 limit);
+
+/*
+ * Returns and clears the pending ALM_EV_xxx events of a channel
+ * Escalations are returned at once, other events at most once
+ * per ALM_REPEAT_S
+ */
+u8 Alarm_TakeEvents(u32 chNo);
+
+/*
+ * Returns LOGREC_F_xxx record flags for the current state
+ */
+u16 Alarm_Flags(u32 chNo);
+
+#endif   // End of __ALARM_H__
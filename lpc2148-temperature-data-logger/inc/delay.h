@@ -1,5 +1,59 @@
+#ifndef __DELAY_H__
+#define __DELAY_H__        // Header guard to prevent multiple inclusion
+
+#include "types.h"         // Custom data types (u8, u32)
+
+/* ================= MONOTONIC TICK ================= */
+/*
+ * Timer1 counts microseconds from Delay_Init and wraps every
+ * 2^32 us (about 71 minutes). Deadlines are compared with
+ * signed differences, so they stay valid across the wrap as
+ * long as they are less than 35 minutes away.
+ */
+
+// Periodic callback, runs in interrupt context
+typedef void (*TickFn)(void);
+
+/*
+ * Starts the Timer1 microsecond tick
+ * Called once at start-up; the delay functions call it if needed
+ */
+void Delay_Init(void);
+
+/*
+ * Returns the current tick in microseconds
+ */
+u32 Tick_Now(void);
+
+/*
+ * Returns the current time in PCLK cycles (15 per tick),
+ * wrapping every 2^32 cycles (about 286 seconds)
+ */
+u32 Tick_Cycles(void);
+
+/*
+ * Returns a deadline us microseconds from now
+ */
+u32 Tick_Deadline(u32 us);
+
+/*
+ * Returns 1 once the deadline has been reached
+ */
+u8 Tick_Expired(u32 deadline);
+
+/*
+ * Calls fn from the Timer1 ISR every us microseconds
+ */
+void Tick_StartPeriodic(TickFn fn, u32 us);
+
 /* ================= DELAY FUNCTION PROTOTYPES ================= */
 
+/*
+ * Waits until the tick reaches deadline, idling the CPU
+ * for all but the last few microseconds
+ */
+void delay_until(u32 deadline);
+
 /*
  * Generates a delay in microseconds
  */
@@ -14,3 +68,5 @@ void delay_ms(unsigned int);
  * Generates a delay in seconds
  */
 void delay_s(unsigned int);
+
+#endif   // End of __DELAY_H__
@@ -0,0 +1,43 @@
+#ifndef DELAY_DEFINES_H
+#define DELAY_DEFINES_H        // Header guard to prevent multiple inclusion
+
+/* ================= TIMER1 CLOCK DEFINITIONS ================= */
+
+// Peripheral clock feeding Timer1 (CCLK 60 MHz / 4)
+#define TICK_PCLK         15000000
+
+// Timer1 tick rate, one count per microsecond
+#define TICK_HZ           1000000
+
+// Timer1 prescaler value for TICK_HZ
+#define TICK_PR_VAL       ((TICK_PCLK / TICK_HZ) - 1)
+
+/* ================= T1TCR / T1MCR / T1IR BIT DEFINITIONS ================= */
+
+// T1TCR: counter enable and counter reset
+#define TCR_EN_BIT        0
+#define TCR_RST_BIT       1
+
+// T1MCR: interrupt on MR0 / MR1 match
+#define T1_MR0I_BIT       0
+#define T1_MR1I_BIT       3
+
+// T1IR: MR0 / MR1 interrupt flags
+#define T1_MR0_INT        0
+#define T1_MR1_INT        1
+
+/* ================= IDLE WAIT CONFIGURATION ================= */
+
+// PCON: idle mode bit (CPU stops, peripherals keep running)
+#define PCON_IDL_BIT      0
+
+// Waits at or below this many microseconds are spun, not idled;
+// it also covers the wake-up latency from idle mode
+#define DELAY_SPIN_US     10
+
+/* ================= VIC DEFINITIONS ================= */
+
+// Timer1 interrupt source number in the VIC
+#define VIC_TIMER1_CHNL   5
+
+#endif   // End of DELAY_DEFINES_H
@@ -0,0 +1,75 @@
+#ifndef __DOWNLOAD_H__
+#define __DOWNLOAD_H__        // Header guard to prevent multiple inclusion
+
+#include "types.h"            // Custom data types (u8, u32)
+
+/* ================= DOWNLOAD PROTOCOL ================= */
+/*
+ * Every frame, in both directions, is:
+ *   u8 type, payload, u16 CRC-16/CCITT over type + payload
+ * COBS encoded and delimited by 0x00 (see logrec.h).
+ * Multi-byte fields are little-endian.
+ *
+ * Host ? logger:
+ *   'I'                     ? request history range
+ *   'G' u32 offset          ? start (or resume) download at offset
+ *   'Z' u32 offset          ? as 'G', blocks sent compressed
+ *   'A' u32 offset          ? all records before offset received
+ *   'X'                     ? abort download
+ *   'P' [u8 clear]          ? send the profiling and interrupt
+ *                             tables as text (PROF_ENABLE only)
+ *
+ * Logger ? host:
+ *   'i' u32 first, u32 next ? history range held in RAM
+ *   'b' u32 offset, u8 n, n x record (u32 epoch, s16 temp, u16 code)
+ *                           ? block of records starting at offset
+ *   'z' u32 offset, u8 n, u32 base, n x TSC_Encode record
+ *                           ? compressed block, each one a key
+ *                             frame (series format in tscomp.h)
+ *   'e' u32 offset          ? download complete up to offset
+ *
+ * Up to DL_WINDOW blocks are sent ahead of the last 'A'.
+ * If no 'A' arrives for DL_ACK_TIMEOUT polls, sending restarts
+ * from the last acknowledged offset. A host that sees a bad CRC
+ * or a gap simply sends 'G' with the offset it needs next.
+ * UART log output is paused while a download is running.
+ */
+
+#define DL_CMD_INFO     'I'
+#define DL_CMD_GET      'G'
+#define DL_CMD_GETZ     'Z'
+#define DL_CMD_ACK      'A'
+#define DL_CMD_ABORT    'X'
+#define DL_CMD_PROF     'P'
+
+#define DL_RSP_INFO     'i'
+#define DL_RSP_BLOCK    'b'
+#define DL_RSP_ZBLOCK   'z'
+#define DL_RSP_END      'e'
+
+// Records per block
+#define DL_BLOCK_RECS   16
+
+// Blocks sent ahead of the host's acknowledgement
+#define DL_WINDOW       4
+
+// Polls without an acknowledgement before going back
+#define DL_ACK_TIMEOUT  5
+
+// Largest command frame accepted (encoded)
+#define DL_RX_MAX       16
+
+/* ================= FUNCTION PROTOTYPES ================= */
+
+/*
+ * Handles received commands and sends pending blocks
+ * Call regularly from the main loop
+ */
+void Download_Poll(void);
+
+/*
+ * Returns 1 while a download is in progress
+ */
+u8 Download_Active(void);
+
+#endif   // End of __DOWNLOAD_H__
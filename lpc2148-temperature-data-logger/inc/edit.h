@@ -3,12 +3,18 @@
 
 #include "types.h"          // Custom data types (u8, u32)
 
-/* ================= EDIT MODE MAIN FUNCTION ================= */
+/* ================= EDIT MODE FUNCTIONS ================= */
 /*
- * Enters and controls the overall edit mode
- * Called from main program
+ * Enters edit mode and shows the main menu
+ * Called from main program when the EDIT switch is pressed
  */
-void EditMode(void);
+void EditStart(void);
+
+/*
+ * Advances the edit menus from queued key events
+ * Never blocks; called periodically from main program
+ */
+void EditPoll(void);
 
 /* ================= INTERNAL EDIT FUNCTIONS ================= */
 /*
@@ -17,15 +23,38 @@ void EditMode(void);
 void DisplayMainEditMenu(void);
 
 /*
- * Displays and handles RTC edit sub-menu
- * Allows editing time, date, and day
+ * Displays the RTC edit sub-menu on LCD
  */
-void EditRTCMenu(void);
+void DisplayRTCEditMenu(void);
+
+/* ================= NUMBER ENTRY ================= */
+
+// Values entered through number entry (field of StartNumber)
+#define FLD_HOUR     0
+#define FLD_MIN      1
+#define FLD_SEC      2
+#define FLD_DATE     3
+#define FLD_MONTH    4
+#define FLD_YEAR     5
+#define FLD_DAY      6
+#define FLD_SP_CH    7   // Set-point channel
+#define FLD_SP_LIM   8   // Set-point limit
+#define FLD_BAUD     9
+#define FLD_STATS    10  // Summary window (s), 0 = off
+
+// Number entered so far
+extern u32 edVal;
 
 /*
- * Allows editing of temperature set-point
+ * Starts entry of a number of up to digits digits for field
  */
-void EditSetPoint(void);
+void StartNumber(u8 field, u8 digits, u32 max);
+
+/*
+ * Handles one key of number entry (digits, 14 backspace)
+ * Returns 1 on ENTER (key 15) with the number in edVal
+ */
+u8 NumberKey(u8 key);
 
 /*
  * Checks whether a given year is a leap year
@@ -40,15 +69,4 @@ u8 IsLeapYear(u32);
  */
 u8 GetMaxDays(u32, u32);
 
-/* ================= KEYPAD NUMBER INPUT ================= */
-/*
- * Reads numeric input from keypad
- * Parameters:
- *   digits ? Maximum number of digits allowed
- *   max    ? Maximum value allowed
- * Returns:
- *   Entered number
- */
-u32 GetKeyNumber(u8 digits, u32 max);
-
 #endif   // End of __EDIT_H__
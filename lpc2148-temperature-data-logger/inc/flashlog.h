@@ -0,0 +1,123 @@
+#ifndef __FLASHLOG_H__
+#define __FLASHLOG_H__        // Header guard to prevent multiple inclusion
+
+#include <LPC214X.H>          // LPC214x register definitions
+#include "types.h"            // Custom data types (u8, u16, u32, s16)
+#include "logrec.h"           // LOGREC_F_xxx record flags
+
+/* ================= FLASH AREA LAYOUT ================= */
+/*
+ * Sectors 22-25 (4 KB each, 0x00078000 - 0x0007BFFF) are unused
+ * by the application and below the boot loader.
+ * They are written as one circular log of 256-byte pages,
+ * the smallest unit the IAP "copy RAM to flash" command accepts.
+ * A sector is erased only when the write pointer enters it, so
+ * every sector sees the same number of erase cycles.
+ */
+#define FLOG_FIRST_SECTOR  22
+#define FLOG_NUM_SECTORS   4
+#ifndef FLOG_BASE_ADDR                // Host build maps it to RAM
+#define FLOG_BASE_ADDR     0x00078000
+#endif
+#define FLOG_SECTOR_SIZE   0x1000
+#define FLOG_PAGE_SIZE     256
+
+#define FLOG_PAGES_PER_SEC (FLOG_SECTOR_SIZE / FLOG_PAGE_SIZE)
+#define FLOG_NUM_PAGES     (FLOG_NUM_SECTORS * FLOG_PAGES_PER_SEC)
+
+// Page header marker ("FLG1")
+#define FLOG_MAGIC         0x31474C46
+
+/* ================= IAP DEFINITIONS ================= */
+
+#ifndef IAP_LOCATION                  // Host build: flash model
+#define IAP_LOCATION       0x7FFFFFF1
+#endif
+#define IAP_PREPARE        50
+#define IAP_COPY_RAM       51
+#define IAP_ERASE          52
+#define IAP_CMD_SUCCESS    0
+
+/* ================= RECORD AND PAGE FORMAT ================= */
+/*
+ * One logged sample (8 bytes).
+ * code uses the same layout as the binary UART record:
+ * bits 0-9 raw ADC code, 10-11 channel, 12-15 LOGREC_F_xxx flags
+ */
+typedef struct
+{
+    u32 epoch;                // Seconds since 01/01/1970
+    s16 temp;                 // Centi-degrees Celsius
+    u16 code;                 // Raw code, channel and flags
+} FlashRec;
+
+#define FLOG_HDR_SIZE      12
+#define FLOG_RECS_PER_PAGE ((FLOG_PAGE_SIZE - FLOG_HDR_SIZE) / sizeof(FlashRec))
+
+/*
+ * Records reach flash one page (30 records) at a time, so a reset
+ * loses the records still in the RAM page buffer: up to 29, i.e.
+ * almost half an hour of one-per-minute logging of one channel.
+ * A record carrying any of these flags programs the partly filled
+ * page at once, so alarm events are never in that window. Each
+ * such sync uses a whole page (counted in flogStats.padRecs).
+ */
+#define FLOG_SYNC_FLAGS    (LOGREC_F_ALERT | LOGREC_F_OVERTEMP)
+
+/*
+ * Page image. A page is valid only if magic matches and crc
+ * (CRC-16/CCITT over seq, count and all records) is correct,
+ * so a page torn by a power cut during programming is ignored.
+ */
+typedef struct
+{
+    u32 magic;                // FLOG_MAGIC
+    u32 seq;                  // Page sequence number, never reused
+    u16 count;                // Records in this page
+    u16 crc;                  // Integrity check
+    FlashRec rec[FLOG_RECS_PER_PAGE];
+} FlashPage;
+
+/* ================= STATISTICS ================= */
+
+typedef struct
+{
+    u32 records;              // Records appended since start-up
+    u32 pages;                // Pages programmed
+    u32 erases;               // Sectors erased
+    u32 padRecs;              // Unused record slots in synced pages
+    u32 errors;               // IAP commands that failed
+} FlashLogStats;
+
+extern FlashLogStats flogStats;
+
+/* ================= FUNCTION PROTOTYPES ================= */
+
+/*
+ * Scans the flash area and resumes after the newest valid page
+ */
+void FlashLog_Init(void);
+
+/*
+ * Appends a record to the RAM page buffer, programming the
+ * page when it is full or the record has FLOG_SYNC_FLAGS
+ */
+void FlashLog_Append(u32 epoch, s32 centiC, u32 chNo, u32 code, u16 flags);
+
+/*
+ * Programs the partly filled page buffer now
+ */
+void FlashLog_Sync(void);
+
+/*
+ * Returns the valid page with sequence number seq, or 0
+ */
+const FlashPage *FlashLog_FindPage(u32 seq);
+
+/*
+ * Oldest and next-to-be-written page sequence numbers
+ */
+extern u32 flogFirstSeq;
+extern u32 flogNextSeq;
+
+#endif   // End of __FLASHLOG_H__
@@ -0,0 +1,67 @@
+#ifndef __FMT_H__
+#define __FMT_H__          // Header guard to prevent multiple inclusion
+
+#include "types.h"         // Custom data types (u8, u32, s32, u64, f32)
+
+/* ================= DIVISION BY CONSTANTS ================= */
+/*
+ * ARM7TDMI has no divide instruction, so n / 10 and n / 100 are
+ * library calls of 30-100 cycles. A multiply by the scaled
+ * reciprocal (one UMULL) gives the exact quotient for every u32.
+ */
+#define FMT_DIV10(n)   ((u32)(((u64)(u32)(n) * 0xCCCCCCCDu) >> 35))
+#define FMT_DIV100(n)  ((u32)(((u64)(u32)(n) * 0x51EB851Fu) >> 37))
+
+/* ================= BUFFER SIZES ================= */
+
+// Longest Fmt_U32 output ("4294967295")
+#define FMT_U32_MAX    10
+
+// Line buffer for one UART log record
+#define FMT_LINE_MAX   128
+
+/* ================= FUNCTION PROTOTYPES ================= */
+/*
+ * Every function writes at p and returns the position after
+ * the last character written. Output is not NUL terminated;
+ * the caller adds the terminator once the line is complete.
+ */
+
+/*
+ * Unsigned and signed decimal, no padding
+ */
+u8 *Fmt_U32(u8 *p, u32 n);
+u8 *Fmt_S32(u8 *p, s32 n);
+
+/*
+ * Unsigned decimal, zero padded to at least width digits
+ */
+u8 *Fmt_UPad(u8 *p, u32 n, u32 width);
+
+/*
+ * Two digits, zero padded (n mod 100)
+ */
+u8 *Fmt_U2(u8 *p, u32 n);
+
+/*
+ * Centi-unit value with 2 decimals (3250 -> "32.50")
+ */
+u8 *Fmt_Centi(u8 *p, s32 v);
+
+/*
+ * Float with nDec truncated decimals
+ */
+u8 *Fmt_F32(u8 *p, f32 f, u32 nDec);
+
+/*
+ * "HH:MM:SS" and "DD/MM/YYYY"
+ */
+u8 *Fmt_Time(u8 *p, u32 hour, u32 min, u32 sec);
+u8 *Fmt_Date(u8 *p, u32 date, u32 month, u32 year);
+
+/*
+ * Copies a NUL-terminated string (without the NUL)
+ */
+u8 *Fmt_Str(u8 *p, const char *s);
+
+#endif   // End of __FMT_H__
@@ -0,0 +1,40 @@
+#ifndef __HISTORY_H__
+#define __HISTORY_H__         // Header guard to prevent multiple inclusion
+
+#include "types.h"            // Custom data types (u8, u16, u32, s32)
+#include "flashlog.h"         // FlashRec record layout
+
+/* ================= HISTORY CONFIGURATION ================= */
+
+// Records kept in RAM (must be a power of 2)
+#define HIST_SIZE  256
+
+/* ================= FUNCTION PROTOTYPES ================= */
+/*
+ * Records are addressed by an absolute index that keeps
+ * counting up from start-up; only the newest HIST_SIZE
+ * indices are still held.
+ */
+
+/*
+ * Adds one sample to the history ring
+ */
+void Hist_Add(u32 epoch, s32 centiC, u32 chNo, u32 code, u16 flags);
+
+/*
+ * Index of the oldest record still held
+ */
+u32 Hist_First(void);
+
+/*
+ * Index the next record will get (one past the newest)
+ */
+u32 Hist_Next(void);
+
+/*
+ * Copies record idx into *rec
+ * Returns 1 if held, 0 if overwritten or not yet written
+ */
+u8 Hist_Get(u32 idx, FlashRec *rec);
+
+#endif   // End of __HISTORY_H__
@@ -2,6 +2,7 @@
 #define __KEYPD_H__        // Header guard to prevent multiple inclusion
 
 #include <LPC214X.H>       // LPC214x microcontroller register definitions
+#include "types.h"         // Custom data types (u32)
 
 /* ================= ROW PIN DEFINITIONS ================= */
 /*
@@ -23,6 +24,56 @@
 #define C2 22
 #define C3 23
 
+/* ================= SCANNER CONFIGURATION ================= */
+
+// Timer1 tick between row samples (us), 4 ticks per full scan
+#define KEY_SCAN_US       2000
+
+// Equal samples needed to accept a press or release (8 ms each)
+#define KEY_DEBOUNCE      3
+
+// Samples held down before a long-press event (about 1 s)
+#define KEY_LONG_SAMPLES  125
+
+// Event queue size (must be a power of 2)
+#define KEY_QUEUE_SIZE    16
+
+/* ================= KEY EVENTS ================= */
+/*
+ * Event byte: bits 0-3 key value (LUT), bits 4-5 event type
+ */
+#define KEY_VAL_MASK      0x0F
+#define KEY_EV_MASK       0x30
+#define KEY_EV_PRESS      0x10   // Debounced press
+#define KEY_EV_RELEASE    0x20   // Debounced release
+#define KEY_EV_LONG       0x30   // Held for KEY_LONG_SAMPLES
+
+// Events lost because the queue was full
+extern volatile u32 keyDropCnt;
+
+/* ================= DEBOUNCE STATE MACHINE ================= */
+/*
+ * One state per key (keySt), advanced by KeyPd_Debounce with each
+ * sample of the key; the scanner feeds it, tests drive it directly
+ */
+#define KEY_ST_UP       0
+#define KEY_ST_DN_WAIT  1   // Down, not yet KEY_DEBOUNCE samples
+#define KEY_ST_DOWN     2
+#define KEY_ST_UP_WAIT  3   // Up, not yet KEY_DEBOUNCE samples
+
+extern unsigned char keySt[16];
+
+/*
+ * Sets every key up and empties the event queue
+ */
+void KeyPd_Reset(void);
+
+/*
+ * Takes one sample of a key (down != 0 when pressed) and queues
+ * the events it completes
+ */
+void KeyPd_Debounce(unsigned char key, unsigned char down);
+
 /* ================= KEYPAD FUNCTION PROTOTYPES ================= */
 /*
  * Initializes keypad row pins as outputs
@@ -42,6 +93,28 @@ unsigned char ColStat(void);
  */
 unsigned char KeyVal(void);
 
+/*
+ * Starts interrupt-driven scanning on the Timer1 tick
+ * ColStat/KeyVal must not be used once it is running
+ */
+void KeyPd_StartScan(void);
+
+/*
+ * Takes the oldest key event
+ * Returns 1 with the event in *ev, 0 if none is queued
+ */
+unsigned char KeyPd_GetEvent(unsigned char *ev);
+
+/*
+ * Discards all queued key events
+ */
+void KeyPd_Flush(void);
+
+/*
+ * Waits for the next key press and returns its value
+ */
+unsigned char KeyPd_WaitKey(void);
+
 /* ================= KEY LOOKUP TABLE ================= */
 /*
  * 44 keypad lookup table
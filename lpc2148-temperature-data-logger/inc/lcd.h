@@ -1,3 +1,11 @@
+#include "types.h"       // Custom data types (u32, s32)
+
+/* ================= LCD GEOMETRY ================= */
+
+// Visible characters per line and number of lines
+#define LCD_COLS 16
+#define LCD_ROWS 2
+
 /* ================= LCD FUNCTION PROTOTYPES ================= */
 
 /*
@@ -28,7 +36,7 @@ void StrLCD(unsigned char *);
 /*
  * Displays a signed integer value on the LCD
  */
-void IntLCD(signed long int);
+void IntLCD(s32);
 
 /*
  * Displays a floating-point value on the LCD
@@ -39,3 +47,21 @@ void FltLCD(float);
  * Stores a custom character font in LCD CGRAM
  */
 void StoreCustCharFont(void);
+
+/*
+ * Sends framebuffer cells that changed since the last flush
+ */
+void LCD_Flush(void);
+
+/*
+ * Selects write-through (1) or deferred (0) LCD updates
+ */
+void LCD_SetSync(unsigned char);
+
+/* ================= LCD BUS STATISTICS ================= */
+
+// Bytes written to the LCD bus
+extern u32 lcdBusWrites;
+
+// Busy flag waits that timed out
+extern u32 lcdBusyTimeouts;
@@ -3,15 +3,95 @@
 
 #include "types.h"        // Custom data types (u8, f32)
 
-/* ================= LM35 FUNCTION PROTOTYPE ================= */
+/* ================= OVERSAMPLING CONFIGURATION ================= */
+/*
+ * 4^n raw 10-bit samples are summed and shifted right by n,
+ * giving n extra bits of resolution (16x ? 12 bit, 64x ? 13 bit)
+ */
+#define LM35_OSR_LOG2   4                           // 16x oversampling
+#define LM35_OSR        (1 << LM35_OSR_LOG2)
+#define LM35_EXTRA_BITS (LM35_OSR_LOG2 / 2)
+#define LM35_CODE_MAX   (1023 << LM35_EXTRA_BITS)   // Full-scale code
+
+/* ================= POST FILTER CONFIGURATION ================= */
+
+#define LM35_FILT_NONE   0   // Decimated code used directly
+#define LM35_FILT_AVG    1   // Moving average of LM35_FILT_LEN codes
+#define LM35_FILT_MEDIAN 2   // Median of LM35_FILT_LEN codes
+
+#define LM35_FILTER     LM35_FILT_MEDIAN
+#define LM35_FILT_LEN   5    // Window length (max 8)
+
+/* ================= FIXED-POINT FORMAT ================= */
+/*
+ * Temperatures are held as s32 centi-degrees (3250 = 32.50 degC)
+ * and calibration gains as Q16 (65536 = 1.0)
+ */
+#define LM35_GAIN_ONE   65536
 
+/* ================= CONVERSION TABLES ================= */
+
+// One entry per raw 10-bit ADC code
+#define LM35_LUT_SIZE   1024
+
+// Uncalibrated code ? centi-degC / centi-degF tables (flash)
+extern const s16 lm35LutC[];
+extern const s16 lm35LutF[];
+
+/* ================= SENSOR TABLE ENTRY ================= */
 /*
- * Reads temperature from LM35 sensor
+ * Calibration and alarm limit for one LM35 channel
+ */
+typedef struct
+{
+    u8  enabled;          // 1 ? sensor fitted and scanned
+    s32 gain;             // Multiplier applied to raw degC (Q16)
+    s32 offset;           // Added after gain (centi-degC)
+    u32 limit;            // Over-temperature limit (degC)
+} SensorCfg;
+
+// Per-channel sensor table (AIN0..AIN3, ADC_NUM_CH entries)
+extern SensorCfg sensorCfg[];
+
+// Filtered, oversampled code (0..LM35_CODE_MAX), per channel
+extern u32 lm35Code[];
+
+// Raw 10-bit ADC code of the most recent sample, per channel
+extern u32 lm35Raw[];
+
+/* ================= LM35 FUNCTION PROTOTYPES ================= */
+
+/*
+ * Returns bit mask of enabled sensor channels
+ */
+u32 LM35_ChMask(void);
+
+/*
+ * Marks channels whose gain/offset must be applied to readings
+ * Call at start-up and after changing sensorCfg calibration
+ */
+void LM35_InitCal(void);
+
+/*
+ * Collects new samples from the ADC sampling engine
+ */
+void LM35_Update(void);
+
+/*
+ * Reads temperature from LM35 sensor in fixed point
  * Parameter:
+ *   chNo  ? ADC channel number
  *   tType ? 'C' for Celsius, 'F' for Fahrenheit
  * Returns:
+ *   Temperature in centi-degrees
+ */
+s32 Read_LM35_Centi(u32 chNo, u8 tType);
+
+/*
+ * Float compatibility wrapper for Read_LM35_Centi
+ * Returns:
  *   Temperature value as float
  */
-f32 Read_LM35(u8 tType);
+f32 Read_LM35(u32 chNo, u8 tType);
 
 #endif   // End of _LM35_H_
@@ -0,0 +1,158 @@
+#ifndef __LOGREC_H__
+#define __LOGREC_H__        // Header guard to prevent multiple inclusion
+
+#include "types.h"          // Custom data types (u8, u16, u32, s32)
+#include "stats.h"          // Window summary record
+
+/* ================= BINARY LOG FRAME FORMAT ================= */
+/*
+ * All multi-byte fields are little-endian.
+ *
+ * Frame (before COBS encoding):
+ *   u32  base    ? epoch seconds (since 01/01/1970) of first record
+ *   u8   count   ? number of records that follow (1..LOGREC_BATCH)
+ *   count x record:
+ *     u8   dt    ? seconds after base
+ *     s16  temp  ? temperature in centi-degrees Celsius
+ *     u16  code  ? bits 0-9  : raw ADC code
+ *                  bits 10-11: sensor channel (AIN0..AIN3)
+ *                  bits 12-15: LOGREC_F_xxx flags
+ *   u16  crc     ? CRC-16/CCITT (poly 0x1021, init 0xFFFF)
+ *                  over all preceding frame bytes
+ *
+ * Summary frame (aggregation mode, stats.h), marked by bit 7
+ * of the count byte:
+ *   u32  start    epoch seconds of window start
+ *   u8   0x80|ch  summary marker and sensor channel
+ *   u32  n        samples in window
+ *   s16  mean     centi-degC
+ *   u16  sd       sample standard deviation, centi-degC
+ *   s16  min      centi-degC
+ *   u16  minOff   seconds from window start to min
+ *   s16  max      centi-degC
+ *   u16  maxOff   seconds from window start to max
+ *   u16  crc      as above
+ *
+ * Packed frame (LOG_FMT_PACKED, series format in tscomp.h),
+ * marked by bit 6 of the count byte:
+ *   u32  epoch    key frame: base epoch of the block
+ *                  otherwise: epoch of the previous record
+ *   u8   flags    bit 6 LOGREC_PACKED, bit 5 LOGREC_KEY,
+ *                  bits 0-4 number of records
+ *   records       TSC_Encode output
+ *   u16  crc      as above
+ *
+ * The encoder state runs on across packed frames and restarts
+ * in every LOGREC_KEY_EVERY-th frame (key frame). A receiver
+ * whose decoded epoch does not match the epoch field of a
+ * non-key frame has lost a frame and skips to the next key.
+ *
+ * The frame is COBS encoded, preceded and terminated by a 0x00
+ * byte, so a receiver can resynchronise on any zero in the
+ * stream; empty frames between two zeros are ignored. A frame
+ * is queued whole or dropped whole, never cut short.
+ */
+
+/* ================= LOG FORMAT SELECTION ================= */
+
+#define LOG_FMT_TEXT    0   // "[INFO] Temp: ..." ASCII lines
+#define LOG_FMT_BINARY  1   // COBS framed binary records
+#define LOG_FMT_PACKED  2   // COBS framed compressed records
+
+// Build-time default, can be changed from the edit menu
+#ifndef LOG_FMT_DEFAULT
+#define LOG_FMT_DEFAULT LOG_FMT_TEXT
+#endif
+
+/* ================= FRAME PARAMETERS ================= */
+
+// Records packed into one frame
+#define LOGREC_BATCH    8
+
+// A pending frame is sent once its first record is this old (seconds)
+#define LOGREC_MAX_AGE  5
+
+// Size of one packed record in bytes
+#define LOGREC_REC_SIZE 5
+
+// Largest frame body accepted by LogRec_SendFrame (without CRC)
+#define LOGREC_FRAME_MAX 160
+
+// Mask for raw ADC code field
+#define LOGREC_CODE_MASK 0x03FF
+
+// Position of sensor channel field
+#define LOGREC_CH_BITS   10
+
+// Count byte bit marking a summary frame
+#define LOGREC_STATS     0x80
+
+// Count byte bits of a packed frame
+#define LOGREC_PACKED    0x40
+#define LOGREC_KEY       0x20
+#define LOGREC_PK_COUNT  0x1F
+
+// Packed frames between key frames
+#define LOGREC_KEY_EVERY 16
+
+// Body bytes of one packed frame (without CRC)
+#define LOGREC_PK_SIZE   64
+
+/* ================= RECORD FLAGS (code bits 12-15) ================= */
+
+#define LOGREC_F_ALERT    (1<<12)  // Line would be tagged [ALERT]
+#define LOGREC_F_OVERTEMP (1<<13)  // Line would end **OVER TEMP**
+#define LOGREC_F_WARN     (1<<14)  // Line would be tagged [WARN]
+#define LOGREC_F_RATE     (1<<15)  // Line would end **RATE**
+
+// Current log output format (LOG_FMT_xxx)
+extern u8 log_format;
+
+/* ================= FUNCTION PROTOTYPES ================= */
+
+/*
+ * Adds one sample to the pending frame, sending the frame
+ * when it is full, on an alert, or when dt would overflow
+ */
+void LogRec_Add(u32 epoch, s32 centiC, u32 chNo, u32 code, u16 flags);
+
+/*
+ * Sends the pending frame if it is older than LOGREC_MAX_AGE
+ */
+void LogRec_Poll(u32 epoch);
+
+/*
+ * Sends the pending frame immediately (if any)
+ */
+void LogRec_Flush(void);
+
+/*
+ * Appends CRC-16, COBS encodes and queues any frame body
+ * buf must have 2 spare bytes after len for the CRC
+ */
+void LogRec_SendFrame(u8 *buf, u32 len);
+
+/*
+ * Sends one aggregation window summary as a binary frame
+ */
+void LogRec_SendStats(u32 chNo, const StatsSummary *s);
+
+/*
+ * Computes CRC-16/CCITT over a buffer
+ */
+u16 CRC16(const u8 *buf, u32 len, u16 crc);
+
+/*
+ * COBS encodes len bytes from src into dst
+ * dst must hold len + len/254 + 1 bytes
+ * Returns encoded length (without the 0x00 delimiter)
+ */
+u32 COBS_Encode(const u8 *src, u32 len, u8 *dst);
+
+/*
+ * Decodes one COBS frame (without the 0x00 delimiter)
+ * Returns decoded length, 0 if malformed
+ */
+u32 COBS_Decode(const u8 *src, u32 len, u8 *dst);
+
+#endif   // End of __LOGREC_H__
@@ -0,0 +1,49 @@
+#ifndef __POWER_H__
+#define __POWER_H__        // Header guard to prevent multiple inclusion
+
+#include "types.h"         // Custom data types (u8, u32)
+
+/* ================= POWER MODE SELECTION ================= */
+
+#define POWER_MODE_OFF    0   // Always running (mains supply)
+#define POWER_MODE_SLEEP  1   // Power-down between samples
+
+// Build-time default; needs the RTC on its 32.768 kHz crystal
+#ifndef POWER_MODE_DEFAULT
+#define POWER_MODE_DEFAULT POWER_MODE_OFF
+#endif
+
+// Current power mode (POWER_MODE_OFF or POWER_MODE_SLEEP)
+extern u8 power_mode;
+
+/* ================= WAKE STATISTICS ================= */
+
+typedef struct
+{
+    u32 wakes;                // Wake-ups from power-down
+    u32 refused;              // Sleeps skipped (RTC not on crystal)
+    u32 lastAwakeUs;          // Time awake before the last sleep
+    u32 maxAwakeUs;           // Longest awake period
+    u32 overBudget;           // Awake periods over the budget
+    u32 sleepS;               // Total time in power-down (s)
+    u32 chargeRunUC;          // Estimated charge while running (uC)
+    u32 chargePdUC;           // Estimated charge in power-down (uC)
+} PowerStats;
+
+extern PowerStats pwrStats;
+
+/* ================= FUNCTION PROTOTYPES ================= */
+
+/*
+ * Returns the epoch second at which to wake for the sample
+ * after now: the next multiple of period, less lead seconds
+ */
+u32 Power_NextWake(u32 now, u32 period, u32 lead);
+
+/*
+ * Called periodically; powers down until the next scheduled
+ * sample once the current one has been logged
+ */
+void Power_Poll(void);
+
+#endif   // End of __POWER_H__
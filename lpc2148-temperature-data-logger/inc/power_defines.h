@@ -0,0 +1,57 @@
+#ifndef POWER_DEFINES_H
+#define POWER_DEFINES_H        // Header guard to prevent multiple inclusion
+
+/* ================= PCON / PCONP / INTWAKE BIT DEFINITIONS ================= */
+
+// PCON: power-down mode (all clocks stop)
+#define PCON_PD_BIT       1
+
+// PCONP: peripheral power control
+#define PCONP_UART0_BIT   3
+#define PCONP_AD0_BIT     12
+
+// INTWAKE: RTC interrupt wakes the CPU from power-down
+#define INTWAKE_RTC_BIT   15
+
+/* ================= PLL DEFINITIONS ================= */
+/*
+ * Power-down stops the PLL, so it is re-locked on wake-up
+ * CCLK = FOSC * (MSEL + 1) = 12 MHz * 5 = 60 MHz,
+ * CCO  = CCLK * 2 * P = 240 MHz with P = 2
+ */
+#define PLL_CFG_VAL       0x24   // MSEL = 4, PSEL = 1
+#define PLLCON_PLLE       (1<<0)
+#define PLLCON_PLLC       (1<<1)
+#define PLLSTAT_PLOCK     (1<<10)
+
+/* ================= RTC ALARM MASK ================= */
+
+// AMR: compare sec, min, hour, day of month, month and year
+// (day of week and day of year are not maintained)
+#define AMR_WAKE          0x30
+
+/* ================= SCHEDULE CONFIGURATION ================= */
+
+// Logging interval in power mode (seconds)
+#define POWER_PERIOD_S    60
+
+// Wake this many seconds before each scheduled sample so the
+// oversampling filter is full again when the minute rolls over
+#define POWER_LEAD_S      2
+
+// Stay awake this long after the scheduled sample (seconds)
+#define POWER_HOLD_S      1
+
+// Do not sleep unless the wake-up is at least this far away
+#define POWER_MIN_SLEEP_S 3
+
+// Awake time expected per wake-up (us), longer wakes are counted
+#define POWER_WAKE_BUDGET_US 4000000
+
+/* ================= CHARGE ESTIMATE ================= */
+
+// Supply current while running (mA) and in power-down (uA)
+#define POWER_I_RUN_MA    40
+#define POWER_I_PD_UA     60
+
+#endif   // End of POWER_DEFINES_H
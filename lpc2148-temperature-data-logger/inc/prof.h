@@ -0,0 +1,88 @@
+#ifndef __PROF_H__
+#define __PROF_H__         // Header guard to prevent multiple inclusion
+
+#include "types.h"         // Custom data types (u32, u64)
+
+/* ================= PROFILING SWITCH ================= */
+/*
+ * Build with PROF_ENABLE 1 to time the regions below. With the
+ * default 0 every PROF_xxx macro compiles to nothing and no
+ * table is linked.
+ * The clock (profTbl) counts Timer1 PCLK cycles (15 MHz,
+ * T1TC * 15 + T1PC), or nanoseconds when built for the host with
+ * PROF_HOST; the dumped table is in microseconds either way.
+ */
+#ifndef PROF_ENABLE
+#define PROF_ENABLE    0
+#endif
+
+/* ================= REGION IDENTIFIERS ================= */
+
+#define PROF_LM35       0   // LM35_Update and Read_LM35_Centi
+#define PROF_ALARM      1   // Alarm_Eval, all channels
+#define PROF_DISP_TIME  2   // DisplayRTCTime
+#define PROF_DISP_DATE  3   // DisplayRTCDate
+#define PROF_DISP_DAY   4   // DisplayRTCDay
+#define PROF_DISP_TEMP  5   // DisplayTemp
+#define PROF_UART_DATA  6   // UARTTX_Data, one record
+#define PROF_FLASH      7   // FlashLog_Append, one record
+#define PROF_LCD_FLUSH  8   // LCD_Flush
+#define PROF_NUM        9
+
+// Free TX ring space needed before a table line is queued
+#define PROF_LINE_MAX   96
+
+/* ================= REGION STATISTICS ================= */
+
+typedef struct
+{
+    u32 count;                // Completed entries
+    u32 min, max;             // Shortest and longest entry
+    u64 total;                // Sum of all entries
+    u32 start;                // Clock at the open entry
+} ProfRegion;
+
+#if PROF_ENABLE
+
+extern ProfRegion profTbl[PROF_NUM];
+
+/* ================= FUNCTION PROTOTYPES ================= */
+
+/*
+ * Returns the profiling clock (wraps, use differences only)
+ */
+u32 Prof_Clock(void);
+
+/*
+ * Closes an entry of region id and updates its statistics
+ */
+void Prof_End(u32 id);
+
+/*
+ * Requests the table to be sent over UART by Prof_Poll
+ * clear != 0 resets the statistics once they are sent
+ */
+void Prof_Dump(u8 clear);
+
+/*
+ * Sends pending table lines while the TX ring has room
+ */
+void Prof_Poll(void);
+
+/* ================= INSTRUMENTATION MACROS ================= */
+
+#define PROF_BEGIN(id)      (profTbl[id].start = Prof_Clock())
+#define PROF_END(id)        Prof_End(id)
+#define PROF_DUMP(clear)    Prof_Dump(clear)
+#define PROF_POLL()         Prof_Poll()
+
+#else
+
+#define PROF_BEGIN(id)      ((void)0)
+#define PROF_END(id)        ((void)0)
+#define PROF_DUMP(clear)    ((void)0)
+#define PROF_POLL()         ((void)0)
+
+#endif   // PROF_ENABLE
+
+#endif   // End of __PROF_H__
@@ -1,6 +1,29 @@
 #ifndef RTC_H
 #define RTC_H        // Header guard to prevent multiple inclusion
 
+#include "types.h"   // Custom data types (u32, s32)
+
+/* ================= CONSISTENT TIME SNAPSHOT ================= */
+/*
+ * One RTC reading taken from CTIME0/CTIME1, so all fields
+ * belong to the same second
+ */
+typedef struct
+{
+    unsigned char  sec, min, hour, dow;
+    unsigned char  dom, month;
+    unsigned short year;
+} RTCTime;
+
+/* ================= TICK EVENTS ================= */
+/*
+ * Incremented by the RTC ISR on every second / every minute
+ * rollover. A consumer keeps its own copy of the last value
+ * seen, so any number of consumers can watch the same counter.
+ */
+extern volatile u32 rtcSecCnt;
+extern volatile u32 rtcMinCnt;
+
 /* ================= RTC FUNCTION PROTOTYPES ================= */
 
 /*
@@ -8,6 +31,22 @@
  */
 void RTC_Init(void);
 
+/*
+ * Reads time and date atomically (two register reads, repeated
+ * only if a second boundary fell between them)
+ */
+void RTC_ReadTime(RTCTime *);
+
+/*
+ * Converts a time snapshot to seconds since 01/01/1970
+ */
+u32 RTC_Epoch(const RTCTime *);
+
+/*
+ * Converts seconds since 01/01/1970 to a time snapshot
+ */
+void RTC_FromEpoch(u32, RTCTime *);
+
 /*
  * Reads current time from RTC
  * Parameters:
@@ -15,14 +54,12 @@ void RTC_Init(void);
  *   minute ? pointer to store minute value
  *   second ? pointer to store second value
  */
-void GetRTCTimeInfo(long int *, long int *, long int *);
+void GetRTCTimeInfo(s32 *, s32 *, s32 *);
 
 /*
  * Displays time on LCD in HH:MM:SS format
  */
-void DisplayRTCTime(unsigned long int,
-                    unsigned long int,
-                    unsigned long int);
+void DisplayRTCTime(u32, u32, u32);
 
 /*
  * Reads current date from RTC
@@ -31,47 +68,46 @@ void DisplayRTCTime(unsigned long int,
  *   month ? pointer to store month
  *   year  ? pointer to store year
  */
-void GetRTCDateInfo(long int *, long int *, long int *);
+void GetRTCDateInfo(s32 *, s32 *, s32 *);
 
 /*
  * Displays date on LCD in DD/MM/YYYY format
  */
-void DisplayRTCDate(unsigned long int,
-                    unsigned long int,
-                    unsigned long int);
+void DisplayRTCDate(u32, u32, u32);
 
 /*
  * Sets RTC time (hour, minute, second)
  */
-void SetRTCTimeInfo(unsigned long int,
-                    unsigned long int,
-                    unsigned long int);
+void SetRTCTimeInfo(u32, u32, u32);
 
 /*
  * Sets RTC date (date, month, year)
  */
-void SetRTCDateInfo(unsigned long int,
-                    unsigned long int,
-                    unsigned long int);
+void SetRTCDateInfo(u32, u32, u32);
 
 /*
  * Reads day of week from RTC
  */
-void GetRTCDay(long int *);
+void GetRTCDay(s32 *);
 
 /*
  * Displays day of week on LCD
  */
-void DisplayRTCDay(unsigned long int);
+void DisplayRTCDay(u32);
 
 /*
  * Sets day of week in RTC
  */
-void SetRTCDay(unsigned long int);
+void SetRTCDay(u32);
+
+/*
+ * Converts date and time to seconds since 01/01/1970
+ */
+u32 RTCToEpoch(u32, u32, u32, u32, u32, u32);
 
 /*
- * Displays temperature on LCD
+ * Displays temperature of a sensor channel on LCD
  */
-void DisplayTemp(void);
+void DisplayTemp(u32);
 
 #endif   // End of RTC_H
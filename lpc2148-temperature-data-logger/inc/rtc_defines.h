@@ -31,6 +31,37 @@
 // RTC Clock Source select bit
 #define RTC_CLKSRC  (1 << 4)
 
+// Define when a 32.768 kHz crystal is fitted on RTCX1/RTCX2.
+// The RTC then keeps running in power-down (needed by power.c)
+//#define RTC_USE_XTAL
+
+/* ================= ILR / CIIR REGISTER BIT DEFINITIONS ================= */
+
+// ILR: counter increment and alarm interrupt flags (write 1 to clear)
+#define ILR_RTCCIF  (1 << 0)
+#define ILR_RTCALF  (1 << 1)
+
+// CIIR: interrupt on every increment of the seconds counter
+#define CIIR_IMSEC  (1 << 0)
+
+/* ================= CONSOLIDATED TIME REGISTERS ================= */
+/*
+ * CTIME0: sec 0-5, min 8-13, hour 16-20, day of week 24-26
+ * CTIME1: day of month 0-4, month 8-11, year 16-27
+ */
+#define CT_SEC(c0)    ((c0) & 0x3F)
+#define CT_MIN(c0)    (((c0) >> 8) & 0x3F)
+#define CT_HOUR(c0)   (((c0) >> 16) & 0x1F)
+#define CT_DOW(c0)    (((c0) >> 24) & 0x07)
+#define CT_DOM(c1)    ((c1) & 0x1F)
+#define CT_MONTH(c1)  (((c1) >> 8) & 0x0F)
+#define CT_YEAR(c1)   (((c1) >> 16) & 0xFFF)
+
+/* ================= VIC DEFINITIONS ================= */
+
+// RTC interrupt source number in the VIC
+#define VIC_RTC_CHNL 13
+
 //#define _LPC2148    // Reserved for LPC2148 specific configuration
 
 #endif   // End of RTC_DEFINES_H
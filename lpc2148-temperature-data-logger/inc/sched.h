@@ -0,0 +1,69 @@
+#ifndef __SCHED_H__
+#define __SCHED_H__        // Header guard to prevent multiple inclusion
+
+#include "types.h"         // Custom data types (u8, u32)
+
+/* ================= SCHEDULER CONFIGURATION ================= */
+
+// Largest number of tasks in the table
+#define SCHED_MAX_TASKS    8
+
+/* ================= TASK CONTROL BLOCK ================= */
+/*
+ * Tasks run to completion. A task is released every period
+ * microseconds and must finish within deadline microseconds of
+ * its release. When several tasks are ready, the one added
+ * first runs first.
+ */
+typedef void (*TaskFn)(void);
+
+typedef struct
+{
+    TaskFn fn;                // Task body
+    u32 period;               // Release interval (us)
+    u32 deadline;             // Allowed release-to-finish time (us)
+    u32 release;              // Tick of the next release
+    u32 runs;                 // Times the task has run
+    u32 misses;               // Runs that finished after the deadline
+    u32 skips;                // Releases dropped after an overrun
+    u32 lastUs;               // Execution time of the last run (us)
+    u32 maxUs;                // Longest execution time seen (us)
+} SchedTask;
+
+// Task table, in priority order
+extern SchedTask schedTask[SCHED_MAX_TASKS];
+
+// Number of entries used in schedTask[]
+extern u32 schedTaskCnt;
+
+/* ================= FUNCTION PROTOTYPES ================= */
+
+/*
+ * Adds a task, first released offset microseconds from now
+ * deadline 0 means the deadline equals the period
+ * Returns the task index, or SCHED_MAX_TASKS if the table is full
+ */
+u32 Sched_Add(TaskFn fn, u32 period, u32 deadline, u32 offset);
+
+/*
+ * Runs the highest priority released task, if any
+ * Returns 1 if a task was run
+ */
+u8 Sched_RunOnce(void);
+
+/*
+ * Returns the tick of the earliest pending release
+ */
+u32 Sched_NextRelease(void);
+
+/*
+ * Runs the scheduler forever, idling between releases
+ */
+void Sched_Run(void);
+
+/*
+ * Clears the run-time statistics of every task
+ */
+void Sched_ClearStats(void);
+
+#endif   // End of __SCHED_H__
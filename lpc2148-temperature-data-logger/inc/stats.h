@@ -0,0 +1,102 @@
+#ifndef __STATS_H__
+#define __STATS_H__        // Header guard to prevent multiple inclusion
+
+#include "types.h"         // Custom data types (u16, s32, u32, u64)
+
+/* ================= AGGREGATION MODE ================= */
+
+#define STATS_OFF       0   // One instantaneous record per minute
+#define STATS_ON        1   // One summary record per window
+
+/*
+ * Build-time default of log_stats (build with -DSTATS_DEFAULT=1
+ * to start in aggregation mode). Edit menu 6 sets the window at
+ * run time, 0 switching aggregation off.
+ */
+#ifndef STATS_DEFAULT
+#define STATS_DEFAULT   STATS_OFF
+#endif
+
+// Default summary window and range accepted by the menu (seconds);
+// offsets within a window are u16, so the window is kept short
+#define STATS_WINDOW_S   60
+#define STATS_WINDOW_MIN 10
+#define STATS_WINDOW_MAX 3600
+
+// Number of channels aggregated
+#define STATS_NUM_CH    4
+
+/* ================= FIXED-POINT FORMAT ================= */
+/*
+ * The running mean is kept in centi-degrees Q8 (x 256) together
+ * with the remainder of the division, so n * mean + rem is always
+ * exactly the sum of the samples and the mean cannot drift however
+ * long the window. M2 (sum of squared deviations) is centi^2 Q16
+ */
+#define STATS_Q         8
+
+/* ================= RUNNING ACCUMULATOR ================= */
+
+typedef struct
+{
+    u32 n;                    // Samples in window
+    s32 mean;                 // Running mean (centi Q8)
+    s32 rem;                  // Remainder of sum / n (centi Q8)
+    u64 m2;                   // Sum of squared deviations (centi^2 Q16)
+    s16 min, max;             // Extremes (centi-degC)
+    u16 minOff, maxOff;       // Seconds from window start
+} StatsAcc;
+
+/* ================= SUMMARY RECORD ================= */
+
+typedef struct
+{
+    u32 start;                // Window start (epoch seconds)
+    u32 n;                    // Samples in window
+    s16 mean;                 // Mean (centi-degC)
+    u16 sd;                   // Sample standard deviation (centi)
+    s16 min, max;             // Extremes (centi-degC)
+    u16 minOff, maxOff;       // Seconds from window start
+} StatsSummary;
+
+// Aggregation on/off and window length (seconds)
+extern u8  log_stats;
+extern u32 stats_window;
+
+/* ================= FUNCTION PROTOTYPES ================= */
+
+/*
+ * Adds one filtered sample of a channel (called at the full
+ * filter output rate by LM35_Update)
+ */
+void Stats_Add(u32 chNo, s32 centiC);
+
+/*
+ * Returns 1 when epoch lies in a later window than the one
+ * being accumulated (the first call only starts a window)
+ */
+u8 Stats_WindowDone(u32 epoch);
+
+/*
+ * Produces the summary of a channel for the current window
+ * Returns 0 if the channel had no samples
+ */
+u8 Stats_Take(u32 chNo, StatsSummary *s);
+
+/*
+ * Starts a new window at epoch for every channel
+ */
+void Stats_Begin(u32 epoch);
+
+/*
+ * Discards the current window; the next Stats_WindowDone call
+ * starts a fresh one (after the mode or window length changes)
+ */
+void Stats_Reset(void);
+
+/*
+ * Integer square root of a 64-bit value
+ */
+u32 ISqrt64(u64 v);
+
+#endif   // End of __STATS_H__
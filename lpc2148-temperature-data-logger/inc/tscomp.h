@@ -0,0 +1,75 @@
+#ifndef __TSCOMP_H__
+#define __TSCOMP_H__        // Header guard to prevent multiple inclusion
+
+#include "types.h"          // Custom data types (u8, u16, u32, s16, s32)
+#include "flashlog.h"       // FlashRec record layout
+
+/* ================= COMPRESSED SERIES FORMAT ================= */
+/*
+ * A compressed block restarts the encoder at a known base epoch
+ * (the keyframe) and is followed by records of 1 to 9 bytes:
+ *
+ *   u8  tag       bits 0-1: sensor channel
+ *                  bit  2  : TSC_T_SAME, same time as previous
+ *                            record, no time field follows
+ *                  bit  3  : TSC_T_ZERO, same temperature as the
+ *                            previous record of this channel,
+ *                            no temperature field follows
+ *                  bits 4-7: LOGREC_F_xxx flags (code bits 12-15)
+ *   var dod       zig-zag varint, delta-of-delta of the epoch
+ *   var dtemp     zig-zag varint, centi-degC change since the
+ *                  previous record of the same channel
+ *
+ * Varints are little-endian groups of 7 bits, bit 7 set on all
+ * but the last byte. Zig-zag maps 0,-1,1,-2.. to 0,1,2,3.. so
+ * small changes of either sign fit in one byte.
+ *
+ * After a keyframe the previous epoch is the base, the previous
+ * interval is 0 and every channel's previous temperature is 0,
+ * so each block decodes on its own. A lost block never corrupts
+ * the records after the next keyframe.
+ *
+ * The raw ADC code is not carried; decoded records have code
+ * bits 0-9 cleared.
+ */
+
+#define TSC_T_SAME      (1<<2)
+#define TSC_T_ZERO      (1<<3)
+#define TSC_FLAG_SHIFT  8       // Code bits 12-15 to tag bits 4-7
+
+// Channels tracked by one stream
+#define TSC_NUM_CH      4
+
+// Largest encoded record (tag + 5-byte dod + 3-byte dtemp)
+#define TSC_REC_MAX     9
+
+/* ================= ENCODER / DECODER STATE ================= */
+
+typedef struct
+{
+    u32 epoch;                // Epoch of previous record
+    s32 delta;                // Previous epoch interval
+    s16 temp[TSC_NUM_CH];     // Previous temperature per channel
+} TSCState;
+
+/* ================= FUNCTION PROTOTYPES ================= */
+
+/*
+ * Starts a block (keyframe) at base epoch
+ */
+void TSC_Start(TSCState *s, u32 base);
+
+/*
+ * Encodes one record into dst (TSC_REC_MAX bytes free)
+ * Returns the number of bytes written
+ */
+u32 TSC_Encode(TSCState *s, u8 *dst, u32 epoch, s32 centiC,
+               u32 chNo, u16 flags);
+
+/*
+ * Decodes one record from src (len bytes available)
+ * Returns bytes consumed, 0 if truncated or malformed
+ */
+u32 TSC_Decode(TSCState *s, const u8 *src, u32 len, FlashRec *rec);
+
+#endif   // End of __TSCOMP_H__
@@ -6,9 +6,21 @@ typedef unsigned short int u16;
 
 typedef signed short int s16;
 
+#ifdef __LP64__
+// Host simulator build (host/): long is 64 bits there, and the
+// firmware relies on 32-bit wrap of tick and epoch arithmetic
+typedef unsigned int u32;
+
+typedef signed int s32;
+#else
 typedef unsigned long int u32;
 
 typedef signed long int s32;
+#endif
+
+typedef signed long long s64;
+
+typedef unsigned long long u64;
 
 typedef float f32;
 
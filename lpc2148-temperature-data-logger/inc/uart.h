@@ -1,4 +1,5 @@
 #include "types.h"     // Custom data types (u32, f32, s8)
+#include "stats.h"     // Window summary record
 
 /* ================= UART FUNCTION PROTOTYPES ================= */
 
@@ -7,16 +8,72 @@
  */
 void InitUART(void);
 
+/*
+ * Computes divisor latch and fractional divider for a baud rate
+ * Returns rate error in units of 0.01%
+ */
+u32 UARTCalcBaud(u32 baud, u32 *dl, u32 *fdr);
+
+/*
+ * Switches UART0 to a new baud rate
+ * Returns 1 if set, 0 if the rate error is too large
+ */
+u8 UARTSetBaud(u32 baud);
+
 /*
  * Transmits a single character via UART
+ * (queued to the interrupt-driven transmit ring)
  */
 void UARTTxChar(s8);
 
+/*
+ * Queues a character without blocking
+ * Returns 1 if queued, 0 if dropped (ring full)
+ */
+u8 UARTTxEnq(u8);
+
+/*
+ * Queues len bytes as one unit without blocking
+ * Returns 1 if queued, 0 if dropped whole (ring full)
+ */
+u8 UARTTxBuf(const u8 *buf, u32 len);
+
+/*
+ * Returns free space in the transmit ring (bytes)
+ */
+u32 UARTTxFree(void);
+
+/*
+ * Returns 1 when the ring and the UART shifter are empty
+ */
+u8 UARTTxIdle(void);
+
+/*
+ * Waits until all queued characters have been sent
+ */
+void UARTTxFlush(void);
+
+/*
+ * Takes one received byte without blocking
+ * Returns 1 if a byte was available, 0 if not
+ */
+u8 UARTRxGet(u8 *ch);
+
 /*
  * Transmits a null-terminated string via UART
  */
 void UARTTxStr(s8 *);
 
+/*
+ * Returns 1 while the link carries text (not COBS frames)
+ */
+u8 UARTTextMode(void);
+
+/*
+ * Transmits an operator message, dropped unless UARTTextMode()
+ */
+void UARTTxMsg(s8 *);
+
 /*
  * Transmits an unsigned 32-bit integer via UART
  */
@@ -28,6 +85,36 @@ void UARTTxU32(u32);
 void UARTTxF32(f32);
 
 /*
- * Transmits complete system data (temperature, time, date)
+ * Transmits a centi-unit fixed-point value with 2 decimals
+ */
+void UARTTxCenti(s32);
+
+/*
+ * Transmits complete system data (channel, temperature, time, date)
+ * flags ? LOGREC_F_xxx alarm state of the channel
  */
-void UARTTX_Data(u32, u32, u32, u32, u32, u32);
+void UARTTX_Data(u32, u16, u32, u32, u32, u32, u32, u32);
+
+/*
+ * Transmits the summary of one aggregation window (stats.h)
+ */
+void UARTTX_Stats(u32 chNo, const StatsSummary *s);
+
+/* ================= BAUD RATE TABLE ================= */
+
+// Baud rates selectable from the edit menu
+extern const u32 uartBaudTbl[];
+
+// Baud rate currently in use
+extern u32 uartBaud;
+
+/* ================= TRANSMIT RING STATISTICS ================= */
+
+// Bytes discarded because the transmit ring was full
+extern volatile u32 uartTxDropCnt;
+
+// Highest transmit ring occupancy seen
+extern u32 uartTxHighWater;
+
+// Received bytes lost because the receive ring was full
+extern volatile u32 uartRxDropCnt;
@@ -0,0 +1,92 @@
+#ifndef UART_DEFINES_H
+#define UART_DEFINES_H        // Header guard to prevent multiple inclusion
+
+/* ================= U0LCR REGISTER BIT DEFINITIONS ================= */
+
+// 8-bit data, 1 stop bit, no parity
+#define UART_8N1          0x03
+
+// Divisor Latch Access Bit
+#define DLAB_BIT          7
+
+/* ================= U0LSR REGISTER BIT DEFINITIONS ================= */
+
+// Receiver Data Ready
+#define RDR_BIT           0
+
+// Transmit Holding Register Empty
+#define THRE_BIT          5
+
+// Transmitter Empty (THR and shift register empty)
+#define TEMT_BIT          6
+
+/* ================= U0IER REGISTER BIT DEFINITIONS ================= */
+
+// Receive data available interrupt enable
+#define RBR_IE_BIT        0
+
+// THRE interrupt enable
+#define THRE_IE_BIT       1
+
+/* ================= U0IIR REGISTER DEFINITIONS ================= */
+
+// Interrupt identification field (bits 1-3)
+#define IIR_ID_MASK       0x0E
+
+// Set when no interrupt is pending
+#define IIR_NONE          0x01
+
+// Interrupt identification values
+#define IIR_THRE          0x02   // Transmit holding register empty
+#define IIR_RDA           0x04   // Receive data available
+#define IIR_RLS           0x06   // Receive line status
+#define IIR_CTI           0x0C   // Character time-out
+
+/* ================= U0FDR REGISTER DEFINITIONS ================= */
+
+// Fractional divider fields: baud = PCLK / (16 * DL * (1 + DIVADD/MUL))
+#define DIVADDVAL_BITS    0   //@0-3
+#define MULVAL_BITS       4   //@4-7
+
+/* ================= BAUD RATE CONFIGURATION ================= */
+
+// Baud rate selected by InitUART
+#define UART_BAUD_DEFAULT 9600
+
+// Largest accepted baud rate error (units of 0.01%)
+#define UART_BAUD_MAX_ERR 100
+
+// Number of entries in uartBaudTbl[]
+#define UART_BAUD_COUNT   6
+
+/* ================= U0FCR REGISTER DEFINITIONS ================= */
+
+// Enable FIFOs and reset RX/TX FIFOs
+#define FIFO_EN_RESET     0x07
+
+/* ================= TRANSMIT RING CONFIGURATION ================= */
+
+// Transmit ring size in bytes (must be a power of 2)
+#define UART_TX_BUF_SIZE  512
+
+// Bytes loaded into the 16-byte TX FIFO per THRE interrupt
+#define UART_TX_CHUNK     14
+
+// Full-ring policies
+#define UART_TX_DROP_NEW    0   // Discard the byte being queued
+#define UART_TX_OVERWRITE   1   // Discard the oldest queued byte
+
+// Policy used when the transmit ring is full
+#define UART_TX_POLICY    UART_TX_DROP_NEW
+
+/* ================= RECEIVE RING CONFIGURATION ================= */
+
+// Receive ring size in bytes (must be a power of 2)
+#define UART_RX_BUF_SIZE  128
+
+/* ================= VIC DEFINITIONS ================= */
+
+// UART0 interrupt source number in the VIC
+#define VIC_UART0_CHNL    6
+
+#endif   // End of UART_DEFINES_H
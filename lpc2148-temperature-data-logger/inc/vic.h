@@ -0,0 +1,98 @@
+#ifndef __VIC_H__
+#define __VIC_H__          // Header guard to prevent multiple inclusion
+
+#include "types.h"         // Custom data types (u8, u32, u64)
+#include "vic_defines.h"   // Slot and source definitions
+#include "prof.h"          // PROF_ENABLE build flag
+
+/* ================= INTERRUPT PRIORITIES ================= */
+/*
+ * The priority of a source is its vectored slot, 0 highest.
+ * One table, so two drivers can never claim the same slot.
+ */
+#define VIC_PRIO_ADC      0   // Conversion results, overrun first
+#define VIC_PRIO_UART0    1   // 16-byte FIFOs
+#define VIC_PRIO_TIMER0   2   // ADC scan trigger
+#define VIC_PRIO_TIMER1   3   // Delay wake-up and keypad scan
+#define VIC_PRIO_RTC      4   // Seconds count and wake-up alarm
+#define VIC_PRIO_EINT0    5
+#define VIC_PRIO_EINT1    6
+#define VIC_PRIO_EINT2    7
+#define VIC_PRIO_EINT3    8
+
+// Mask of every source, for VIC_Lock
+#define VIC_ALL           0xFFFFFFFF
+
+/* ================= LATENCY AND DURATION STATISTICS ================= */
+/*
+ * With VIC_STATS 1 (the default in PROF_ENABLE builds) every ISR
+ * brackets its body with VIC_ISR_ENTER and VIC_ISR_EXIT. Times
+ * are Tick_Cycles PCLK cycles (67 ns).
+ * Latency (event to ISR entry) is known only where the hardware
+ * records when the event happened, i.e. timer matches.
+ */
+#ifndef VIC_STATS
+#define VIC_STATS         PROF_ENABLE   // Off in release builds
+#endif
+
+typedef struct
+{
+    u32 count;                // ISR entries
+    u32 durMax;               // Longest ISR body
+    u64 durTotal;             // Sum of ISR bodies
+    u32 latCount;             // Latency samples
+    u32 latMax;               // Longest event-to-entry delay
+    u64 latTotal;             // Sum of latencies
+    u32 entry;                // Clock at the current entry
+} VicStats;
+
+#if VIC_STATS
+
+extern VicStats vicStats[VIC_NUM_SLOTS];
+
+void VIC_Enter(u32 slot);
+void VIC_Exit(u32 slot);
+void VIC_Latency(u32 slot, u32 cycles);
+
+#define VIC_ISR_ENTER(slot)         VIC_Enter(slot)
+#define VIC_ISR_EXIT(slot)          VIC_Exit(slot)
+#define VIC_ISR_LATENCY(slot, cyc)  VIC_Latency(slot, cyc)
+
+#else
+
+#define VIC_ISR_ENTER(slot)         ((void)0)
+#define VIC_ISR_EXIT(slot)          ((void)0)
+#define VIC_ISR_LATENCY(slot, cyc)  ((void)0)
+
+#endif   // VIC_STATS
+
+/* ================= FUNCTION PROTOTYPES ================= */
+
+/*
+ * Installs isr (address of an __irq function) for source src in
+ * slot prio and enables the source
+ * Returns 1 if installed, 0 if the slot belongs to another source
+ */
+u8 VIC_Register(u32 src, u32 prio, u32 isr);
+
+/*
+ * Enables / disables one source without changing its slot
+ */
+void VIC_Enable(u32 src);
+void VIC_Disable(u32 src);
+
+/*
+ * Critical section: masks the sources in srcMask (VIC_ALL for
+ * every source) and returns those that were enabled. Pass the
+ * result to VIC_Unlock. Sections nest, as an inner VIC_Unlock
+ * re-enables only what its own VIC_Lock disabled.
+ */
+u32 VIC_Lock(u32 srcMask);
+void VIC_Unlock(u32 saved);
+
+/*
+ * Clears the latency and duration statistics
+ */
+void VIC_ClearStats(void);
+
+#endif   // End of __VIC_H__
@@ -0,0 +1,25 @@
+#ifndef VIC_DEFINES_H
+#define VIC_DEFINES_H          // Header guard to prevent multiple inclusion
+
+/* ================= VECTORED SLOTS ================= */
+
+// Number of vectored slots (VICVectAddr0-15 / VICVectCntl0-15)
+#define VIC_NUM_SLOTS     16
+
+// Slot enable bit in VICVectCntlX
+#define VIC_SLOT_EN_BIT   5
+
+// Source number field in VICVectCntlX
+#define VIC_SRC_MASK      0x1F
+
+/* ================= EXTERNAL INTERRUPT SOURCES ================= */
+/*
+ * Timer, UART0, ADC and RTC source numbers are defined next to
+ * their drivers (VIC_xxx_CHNL in the *_defines.h files)
+ */
+#define VIC_EINT0_CHNL    14
+#define VIC_EINT1_CHNL    15
+#define VIC_EINT2_CHNL    16
+#define VIC_EINT3_CHNL    17
+
+#endif   // End of VIC_DEFINES_H
@@ -1,7 +1,8 @@
 #include "types.h"          // Custom data types (u32, f32, etc.)
-#include "delay.h"          // Delay functions
 #include <LPC21XX.H>        // LPC21xx microcontroller register definitions
 #include "adc_defines.h"    // ADC-related macros and bit definitions
+#include "defines.h"        // Bit manipulation macros
+#include "vic.h"            // Vectored interrupt registration
 
 /* ================= ADC CHANNEL PIN SELECTION ================= */
 /*
@@ -16,6 +17,50 @@ u32 adcChSel[4] =
     AIN3_PIN_0_30           // ADC Channel 3 ? P0.30
 };
 
+/* ================= SAMPLE RING BUFFER ================= */
+/*
+ * Filled by the ADC ISR (producer), drained by the main
+ * program (consumer). Indices are free-running.
+ */
+#define ADC_RING_MASK (ADC_RING_SIZE - 1)
+
+static volatile u16 adcRing[ADC_RING_SIZE];
+static volatile u32 adcHead = 0;
+static volatile u32 adcTail = 0;
+
+// Samples lost because the ring was full
+volatile u32 adcDropCnt = 0;
+
+// Scan triggers skipped, the previous pass still running
+volatile u32 adcOverrunCnt = 0;
+
+// Total conversions completed by the sampling engine
+volatile u32 adcSampleCnt = 0;
+
+// Channels converted by each burst scan pass
+static u32 adcScanMask = 0;
+
+// Scan passes per second, kept for ADC_Resume
+static u32 adcScanRate;
+
+/* ================= QUEUE ONE SAMPLE ================= */
+/*
+ * Function: ADC_Push
+ * Purpose : Stores a channel-tagged code in the ring (ISR only)
+ */
+static void ADC_Push(u32 chNo, u32 code)
+{
+    if((adcHead - adcTail) >= ADC_RING_SIZE)
+        adcDropCnt++;       // Consumer too slow, drop newest
+    else
+    {
+        adcRing[adcHead & ADC_RING_MASK] =
+            (chNo << ADC_RING_CH_BITS) | code;
+        adcHead++;
+    }
+    adcSampleCnt++;
+}
+
 /* ================= ADC INITIALIZATION ================= */
 /*
  * Function: Init_ADC
@@ -34,33 +79,190 @@ void Init_ADC(u32 chNo)
     ADCR |= (1<<PDN_BIT) | (CLKDIV<<CLKDIV_BITS);
 }
 
-/* ================= ADC READ FUNCTION ================= */
+/* ================= DISCARD STALE RESULTS ================= */
+/*
+ * Function: ADC_Drain
+ * Purpose : Reads (and so clears DONE of) every scanned channel
+ *           Clearing BURST does not stop the conversion already
+ *           running, so one extra result is left after each pass
+ */
+static void ADC_Drain(void)
+{
+    u32 chNo;
+
+    for(chNo = 0; chNo < ADC_NUM_CH; chNo++)
+        if(READBIT(adcScanMask, chNo))
+            (void)ADDR_CH(chNo);
+}
+
+/* ================= BURST SCAN COMPLETE ISR ================= */
 /*
- * Function: Read_ADC
- * Purpose : Reads ADC value from selected channel
- * Args    : chNo     ? ADC channel number
- *           eAR      ? Pointer to store equivalent analog voltage
- *           adcDVal  ? Pointer to store digital ADC value
+ * Function: ADC_ScanISR
+ * Purpose : Runs when the highest enabled channel is converted,
+ *           collects every channel result and ends the pass
  */
-void Read_ADC(u32 chNo, f32 *eAR, u32 *adcDVal)
+void ADC_ScanISR(void) __irq
 {
-    // Clear previous channel selection and start bits
-    ADCR &= 0xFFFFFF00;
+    u32 chNo, dr;
+
+    VIC_ISR_ENTER(VIC_PRIO_ADC);
+
+    // Trailing conversion after the pass ended: not a sample
+    if(!READBIT(ADCR, BURST_BIT))
+    {
+        ADC_Drain();
+        VIC_ISR_EXIT(VIC_PRIO_ADC);
+        VICVectAddr = 0;        // Acknowledge interrupt to VIC
+        return;
+    }
 
-    // Select ADC channel and start conversion
-    ADCR |= (1<<ADC_CONV_START_BIT) | (1<<chNo);
+    ADCR &= ~(1<<BURST_BIT);    // Stop after the current conversion
+
+    for(chNo = 0; chNo < ADC_NUM_CH; chNo++)
+    {
+        if(!READBIT(adcScanMask, chNo))
+            continue;
+
+        dr = ADDR_CH(chNo);     // Reading clears this channel's DONE
+        if(READBIT(dr, DONE_BIT))
+            ADC_Push(chNo, (dr >> DIGITAL_DATA_BITS) & 1023);
+    }
+
+    VIC_ISR_EXIT(VIC_PRIO_ADC);
+    VICVectAddr = 0;            // Acknowledge interrupt to VIC
+}
 
-    delay_us(3);            // Small delay for ADC conversion start
+/* ================= SCAN TRIGGER ISR ================= */
+/*
+ * Function: TIMER0_ISR
+ * Purpose : Starts one burst pass over the enabled channels
+ */
+void TIMER0_ISR(void) __irq
+{
+    VIC_ISR_ENTER(VIC_PRIO_TIMER0);
+
+    // T0TC restarted at the match and counts PCLK cycles
+    VIC_ISR_LATENCY(VIC_PRIO_TIMER0, T0TC);
+
+    T0IR = (1<<MR0I_BIT);       // Clear MR0 interrupt flag
+
+    if(READBIT(ADCR, BURST_BIT))
+        adcOverrunCnt++;        // Previous pass still running
+    else
+    {
+        ADC_Drain();            // Pass starts with no stale result
+        ADCR |= (1<<BURST_BIT);
+    }
+
+    VIC_ISR_EXIT(VIC_PRIO_TIMER0);
+    VICVectAddr = 0;            // Acknowledge interrupt to VIC
+}
 
-    // Wait until conversion is complete (DONE bit = 1)
-    while(((ADDR >> DONE_BIT) & 1) == 0);
+/* ================= START BURST SCAN ENGINE ================= */
+/*
+ * Function: ADC_StartScan
+ * Purpose : Converts every channel in chMask once per period
+ *           using ADC burst mode
+ * Args    : chMask ? bit n set to scan AINn (n = 0..3)
+ *           rateHz ? scan passes per second
+ */
+void ADC_StartScan(u32 chMask, u32 rateHz)
+{
+    u32 last = 0, chNo;
+
+    chMask &= (1<<ADC_NUM_CH) - 1;
+    if(chMask == 0)
+        return;
+
+    if(rateHz < ADC_RATE_MIN) rateHz = ADC_RATE_MIN;
+    if(rateHz > ADC_RATE_MAX) rateHz = ADC_RATE_MAX;
+
+    // Highest enabled channel ends each pass
+    for(chNo = 0; chNo < ADC_NUM_CH; chNo++)
+        if(READBIT(chMask, chNo))
+            last = chNo;
+
+    T0TCR = 0x02;               // Stop and reset Timer0
+
+    adcScanMask = chMask;
+    adcScanRate = rateHz;
+
+    // Timer0 MR0 interrupt starts a pass every period
+    T0PR  = 0;
+    T0MR0 = (PCLK / rateHz) - 1;
+    T0MCR = (1<<MR0I_BIT) | (1<<MR0R_BIT);
+    T0EMR = 0;
+
+    // Software start (START = 000 is required for burst mode)
+    ADCR = (ADCR & ~(0xFF | (1<<BURST_BIT) |
+                     (7<<ADC_CONV_START_BIT) | (1<<ADC_EDGE_BIT))) |
+           chMask;
+
+    // Interrupt only when the last channel completes
+    ADINTEN = (1<<last);
+
+    // Install scan ISR and trigger ISR
+    VIC_Register(VIC_AD0_CHNL, VIC_PRIO_ADC, (u32)(unsigned long)ADC_ScanISR);
+    VIC_Register(VIC_TIMER0_CHNL, VIC_PRIO_TIMER0, (u32)(unsigned long)TIMER0_ISR);
+
+    T0TCR = 0x01;               // Start Timer0
+}
+
+/* ================= STOP SAMPLING ENGINE ================= */
+/*
+ * Function: ADC_StopSampling
+ * Purpose : Stops Timer0, burst mode and the hardware trigger
+ */
+void ADC_StopSampling(void)
+{
+    T0TCR = 0x00;
+    ADCR &= ~((1<<BURST_BIT) | (7<<ADC_CONV_START_BIT));
+    VIC_Disable(VIC_AD0_CHNL);
+    VIC_Disable(VIC_TIMER0_CHNL);
+}
+
+/* ================= LOW POWER ================= */
+/*
+ * Function: ADC_Suspend
+ * Purpose : Stops sampling and powers the converter down (PDN)
+ */
+void ADC_Suspend(void)
+{
+    ADC_StopSampling();
+    ADCR &= ~(1<<PDN_BIT);
+}
+
+/*
+ * Function: ADC_Resume
+ * Purpose : Powers the converter up and restarts the last scan
+ */
+void ADC_Resume(void)
+{
+    ADCR |= (1<<PDN_BIT);
+    if(adcScanMask)
+        ADC_StartScan(adcScanMask, adcScanRate);
+}
+
+/* ================= FETCH ONE SAMPLE ================= */
+/*
+ * Function: ADC_GetSample
+ * Purpose : Takes the oldest sample from the ring
+ * Args    : chNo    ? pointer to store channel number
+ *           adcDVal ? pointer to store digital ADC value
+ * Returns : 1 ? sample returned
+ *           0 ? ring empty
+ */
+u8 ADC_GetSample(u32 *chNo, u32 *adcDVal)
+{
+    u16 s;
 
-    // Stop ADC conversion
-    ADCR &= ~(1<<ADC_CONV_START_BIT);
+    if(adcTail == adcHead)
+        return 0;
 
-    // Extract 10-bit digital ADC value
-    *adcDVal = (ADDR >> DIGITAL_DATA_BITS) & 1023;
+    s = adcRing[adcTail & ADC_RING_MASK];
+    adcTail++;              // Release slot to the ISR
 
-    // Convert digital value to analog voltage (03.3V)
-    *eAR = (*adcDVal) * (3.3 / 1023);
+    *chNo    = s >> ADC_RING_CH_BITS;
+    *adcDVal = s & 1023;
+    return 1;
 }
@@ -0,0 +1,180 @@
+#include "types.h"          // Custom data types (u8, s16, u16, s32)
+#include "alarm.h"          // Alarm engine definitions
+#include "logrec.h"         // Record flag bits
+
+/* ================= CONFIGURATION TABLE ================= */
+/*
+ * Per channel: warning band, hysteresis, rate limit, debounce
+ * The critical threshold itself is sensorCfg[].limit
+ */
+AlarmCfg alarmCfg[ALM_NUM_CH] =
+{
+    { ALM_WARN_BAND, ALM_HYST, ALM_RATE_MAX, ALM_MIN_TICKS },  // CH0
+    { ALM_WARN_BAND, ALM_HYST, ALM_RATE_MAX, ALM_MIN_TICKS },  // CH1
+    { ALM_WARN_BAND, ALM_HYST, ALM_RATE_MAX, ALM_MIN_TICKS },  // CH2
+    { ALM_WARN_BAND, ALM_HYST, ALM_RATE_MAX, ALM_MIN_TICKS }   // CH3
+};
+
+// Evaluation state of every channel
+AlarmState alarmSt[ALM_NUM_CH];
+
+/* ================= RESET ================= */
+/*
+ * Function: Alarm_Init
+ * Purpose : Clears all alarm state
+ */
+void Alarm_Init(void)
+{
+    u32 ch;
+    u8 *p = (u8 *)alarmSt;
+
+    for(ch = 0; ch < sizeof(alarmSt); ch++)
+        p[ch] = 0;
+    for(ch = 0; ch < ALM_NUM_CH; ch++)
+        alarmSt[ch].ref = 0x7FFF;   // No rate reference yet
+}
+
+/* ================= LEVEL WITH HYSTERESIS ================= */
+/*
+ * Function: Alarm_RawLevel
+ * Purpose : Level for this sample; a threshold already crossed
+ *           clears only hyst below it
+ */
+static u8 Alarm_RawLevel(const AlarmState *st, const AlarmCfg *cfg,
+                         s32 t, s32 limit)
+{
+    s32 warn = limit - cfg->warnBand;
+
+    if(t >= ((st->level >= ALM_CRIT) ? limit - cfg->hyst : limit))
+        return ALM_CRIT;
+    if(t >= ((st->level >= ALM_WARN) ? warn - cfg->hyst : warn))
+        return ALM_WARN;
+    return ALM_NONE;
+}
+
+/* ================= RATE OF CHANGE ================= */
+/*
+ * Function: Alarm_Rate
+ * Purpose : Once a second, updates the smoothed dT/dt and
+ *           returns whether it is over the rate limit
+ */
+static u8 Alarm_Rate(AlarmState *st, const AlarmCfg *cfg, s32 t)
+{
+    s32 d;
+
+    if(cfg->rateMax == 0)
+        return 0;
+
+    if(++st->sub >= ALM_EVAL_HZ)
+    {
+        st->sub = 0;
+        if(st->ref != 0x7FFF)
+        {
+            d = (t - st->ref) * 60;                 // Per minute
+            if(d >  30000) d =  30000;              // Fit s16 slope
+            if(d < -30000) d = -30000;
+            st->slope += (d - st->slope) >> ALM_RATE_SHIFT;
+        }
+        st->ref = t;
+    }
+
+    // Once raised, clear only well below the limit
+    d = (st->slope < 0) ? -st->slope : st->slope;
+    if(st->rate)
+        return d > ((cfg->rateMax * ALM_RATE_CLR_Q4) >> 2);
+    return d > cfg->rateMax;
+}
+
+/* ================= EVALUATE ONE CHANNEL ================= */
+/*
+ * Function: Alarm_Eval
+ * Purpose : Runs level, rate and reminder logic for one sample
+ * Method  : A new level or rate state must hold for minTicks
+ *           evaluations in a row; shorter excursions are ignored
+ */
+void Alarm_Eval(u32 chNo, s32 centiC, s32 limit)
+{
+    AlarmState *st = &alarmSt[chNo];
+    const AlarmCfg *cfg = &alarmCfg[chNo];
+    u8 raw, rate;
+
+    /* --------- LEVEL --------- */
+    raw = Alarm_RawLevel(st, cfg, centiC, limit);
+    if(raw == st->level)
+        st->cnt = 0;
+    else
+    {
+        if(raw != st->pending)
+        {
+            st->pending = raw;
+            st->cnt = 0;
+        }
+        if(++st->cnt >= cfg->minTicks)
+        {
+            if(raw > st->level)
+                st->urgent = 1;
+            st->level = raw;
+            st->cnt = 0;
+            st->events |= ALM_EV_LEVEL;
+        }
+    }
+
+    /* --------- RATE --------- */
+    rate = Alarm_Rate(st, cfg, centiC);
+    if(rate == st->rate)
+        st->rateCnt = 0;
+    else if(++st->rateCnt >= cfg->minTicks)
+    {
+        if(rate)
+            st->urgent = 1;
+        st->rate = rate;
+        st->rateCnt = 0;
+        st->events |= ALM_EV_RATE;
+    }
+
+    /* --------- REMINDER --------- */
+    if(st->hold)
+        st->hold--;
+    else if(!st->events && (st->level != ALM_NONE || st->rate))
+        st->events |= ALM_EV_REMIND;
+}
+
+/* ================= EVENTS AND FLAGS ================= */
+/*
+ * Function: Alarm_TakeEvents
+ * Purpose : Hands pending events to the logger
+ * Method  : Escalations pass at once; clears and rate changes
+ *           wait until ALM_REPEAT_S after the last message, so a
+ *           value hovering at a threshold cannot flood the link
+ */
+u8 Alarm_TakeEvents(u32 chNo)
+{
+    AlarmState *st = &alarmSt[chNo];
+    u8 ev = st->events;
+
+    if(!ev || (!st->urgent && st->hold))
+        return 0;
+
+    st->events = 0;
+    st->urgent = 0;
+    st->hold   = ALM_REPEAT_S * ALM_EVAL_HZ;
+    return ev;
+}
+
+/*
+ * Function: Alarm_Flags
+ * Purpose : Maps the alarm state onto log record flags
+ */
+u16 Alarm_Flags(u32 chNo)
+{
+    const AlarmState *st = &alarmSt[chNo];
+    u16 flags = 0;
+
+    if(st->level == ALM_CRIT)
+        flags |= LOGREC_F_ALERT | LOGREC_F_OVERTEMP;
+    else if(st->level == ALM_WARN)
+        flags |= LOGREC_F_WARN;
+    if(st->rate)
+        flags |= LOGREC_F_ALERT | LOGREC_F_RATE;
+    return flags;
+}
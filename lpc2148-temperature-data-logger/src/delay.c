@@ -1,33 +1,207 @@
+#include <LPC214X.H>        // LPC214x microcontroller register definitions
+#include "types.h"          // Custom data types (u8, u32, s32)
+#include "delay.h"          // Delay function prototypes
+#include "delay_defines.h"  // Timer1 tick definitions
+#include "vic.h"            // Vectored interrupt registration
+
+/* ================= PERIODIC CALLBACK ================= */
+
+static TickFn tickFn = 0;           // Called from the Timer1 ISR
+static u32 tickPeriod;              // Callback interval (us)
+
+/* ================= TIMER1 ISR ================= */
+/*
+ * Function: TIMER1_ISR
+ * Purpose : MR0 match ends an idle wait in delay_until
+ *           (the wake-up itself is the only work needed)
+ *           MR1 match runs the periodic callback
+ */
+void TIMER1_ISR(void) __irq
+{
+    u32 ir;
+
+    VIC_ISR_ENTER(VIC_PRIO_TIMER1);
+    ir = T1IR;
+
+    // Match time in cycles is MRx * 15 (prescale counter at 0)
+    if(ir & (1<<T1_MR1_INT))
+        VIC_ISR_LATENCY(VIC_PRIO_TIMER1,
+                        Tick_Cycles() - T1MR1 * (TICK_PR_VAL + 1));
+    else if(ir & (1<<T1_MR0_INT))
+        VIC_ISR_LATENCY(VIC_PRIO_TIMER1,
+                        Tick_Cycles() - T1MR0 * (TICK_PR_VAL + 1));
+
+    if(ir & (1<<T1_MR0_INT))
+    {
+        T1IR  = (1<<T1_MR0_INT);    // Clear MR0 interrupt flag
+        T1MCR &= ~(1<<T1_MR0I_BIT); // One-shot, re-armed per wait
+    }
+
+    if(ir & (1<<T1_MR1_INT))
+    {
+        T1IR  = (1<<T1_MR1_INT);    // Clear MR1 interrupt flag
+        T1MR1 += tickPeriod;        // Next period, no drift
+
+        // Periods lost to a stall (IAP) would leave MR1 behind the
+        // counter until it wraps (71 min); restart from now instead
+        if((s32)(T1MR1 - T1TC) <= 0)
+            T1MR1 = T1TC + tickPeriod;
+        if(tickFn)
+            tickFn();
+    }
+
+    VIC_ISR_EXIT(VIC_PRIO_TIMER1);
+    VICVectAddr = 0;                // Acknowledge interrupt to VIC
+}
+
+/* ================= TICK INITIALIZATION ================= */
+/*
+ * Function: Delay_Init
+ * Purpose : Starts Timer1 as a free-running 1 us counter
+ */
+void Delay_Init(void)
+{
+    T1TCR = (1<<TCR_RST_BIT);       // Stop and reset Timer1
+    T1PR  = TICK_PR_VAL;            // 15 PCLK cycles per tick
+    T1MCR = 0;                      // Free-running, no match action
+    T1IR  = 0xFF;                   // Clear stale interrupt flags
+
+    // Install Timer1 ISR
+    VIC_Register(VIC_TIMER1_CHNL, VIC_PRIO_TIMER1, (u32)(unsigned long)TIMER1_ISR);
+
+    T1TCR = (1<<TCR_EN_BIT);        // Start counting
+}
+
+/* ================= TICK ACCESS ================= */
+/*
+ * Function: Tick_Now
+ * Purpose : Returns the current tick in microseconds
+ */
+u32 Tick_Now(void)
+{
+    if(!(T1TCR & (1<<TCR_EN_BIT)))
+        Delay_Init();               // First use before Delay_Init
+    return T1TC;
+}
+
+/*
+ * Function: Tick_Cycles
+ * Purpose : Returns the tick scaled to PCLK cycles plus the
+ *           prescale counter, for cycle-level timing
+ */
+u32 Tick_Cycles(void)
+{
+    u32 tc, pc;
+
+    do
+    {
+        tc = T1TC;
+        pc = T1PC;
+    } while(tc != T1TC);            // Tick moved between the reads
+
+    return tc * (TICK_PR_VAL + 1) + pc;
+}
+
+/*
+ * Function: Tick_Deadline
+ * Purpose : Returns the tick value us microseconds from now
+ */
+u32 Tick_Deadline(u32 us)
+{
+    return Tick_Now() + us;
+}
+
+/*
+ * Function: Tick_Expired
+ * Purpose : Checks a deadline, valid across counter wrap
+ */
+u8 Tick_Expired(u32 deadline)
+{
+    return (s32)(Tick_Now() - deadline) >= 0;
+}
+
+/* ================= PERIODIC CALLBACK ================= */
+/*
+ * Function: Tick_StartPeriodic
+ * Purpose : Runs fn from the Timer1 ISR every us microseconds
+ *           (one callback; a new call replaces the old one)
+ */
+void Tick_StartPeriodic(TickFn fn, u32 us)
+{
+    Tick_Now();                     // Make sure Timer1 is running
+
+    T1MCR &= ~(1<<T1_MR1I_BIT);
+    tickFn     = fn;
+    tickPeriod = us;
+    T1MR1 = T1TC + us;
+    T1IR  = (1<<T1_MR1_INT);
+    T1MCR |= (1<<T1_MR1I_BIT);
+}
+
+/* ================= WAIT FOR DEADLINE ================= */
+/*
+ * Function: delay_until
+ * Purpose : Waits until the tick reaches deadline
+ * Method  : MR0 is armed DELAY_SPIN_US before the deadline and
+ *           the CPU idles until then; any other interrupt that
+ *           wakes it early just re-enters idle. The remainder is
+ *           spun on the counter, so the wait never ends early.
+ */
+void delay_until(u32 deadline)
+{
+    u32 wake = deadline - DELAY_SPIN_US;
+
+    while((s32)(wake - Tick_Now()) > DELAY_SPIN_US)
+    {
+        T1MR0 = wake;
+        T1MCR |= (1<<T1_MR0I_BIT);
+        PCON  |= (1<<PCON_IDL_BIT); // Sleep until the next interrupt
+    }
+
+    while((s32)(T1TC - deadline) < 0);  // Final short spin
+}
+
 /* ================= MICROSECOND DELAY ================= */
 /*
  * Function: delay_us
- * Purpose : Generates approximate delay in microseconds
- * Method  : Empty loop execution
+ * Purpose : Generates a delay in microseconds
  */
 void delay_us(unsigned int tdiy)
 {
-    tdiy *= 12;            // Scale value for ~1 microsecond delay
-    while(tdiy--);         // Busy wait loop
+    delay_until(Tick_Now() + tdiy);
 }
 
 /* ================= MILLISECOND DELAY ================= */
 /*
  * Function: delay_ms
- * Purpose : Generates approximate delay in milliseconds
+ * Purpose : Generates a delay in milliseconds
  */
 void delay_ms(unsigned int tdiy)
 {
-    tdiy *= 12000;         // Scale value for ~1 millisecond delay
-    while(tdiy--);         // Busy wait loop
+    u32 deadline = Tick_Now();
+
+    // One second steps keep each deadline inside the wrap range
+    while(tdiy > 1000)
+    {
+        deadline += 1000000;
+        delay_until(deadline);
+        tdiy -= 1000;
+    }
+    delay_until(deadline + (tdiy * 1000));
 }
 
 /* ================= SECOND DELAY ================= */
 /*
  * Function: delay_s
- * Purpose : Generates approximate delay in seconds
+ * Purpose : Generates a delay in seconds
  */
 void delay_s(unsigned int tdiy)
 {
-    tdiy *= 12000000;      // Scale value for ~1 second delay
-    while(tdiy--);         // Busy wait loop
+    u32 deadline = Tick_Now();
+
+    while(tdiy--)
+    {
+        deadline += 1000000;
+        delay_until(deadline);
+    }
 }
@@ -0,0 +1,261 @@
+#include "types.h"          // Custom data types (u8, u16, u32)
+#include "uart.h"           // UART receive/transmit functions
+#include "logrec.h"         // CRC16, COBS and frame transmit
+#include "history.h"        // RAM sample history
+#include "download.h"       // Protocol definitions
+#include "tscomp.h"         // Compressed series encoder
+#include "prof.h"           // Profiling table output
+
+/* ================= PROTOCOL STATE ================= */
+
+static u8  rxFrame[DL_RX_MAX];  // Encoded command being received
+static u32 rxLen = 0;           // Bytes in rxFrame
+static u8  rxOver = 0;          // Frame too long, skip to delimiter
+
+static u8  dlActive = 0;        // Download in progress
+static u32 dlAcked;             // First record not yet acknowledged
+static u32 dlSent;              // Next record to send
+static u32 dlEnd;               // End of this download
+static u32 dlIdle;              // Polls since last acknowledgement
+static u8  dlPacked;            // Blocks sent compressed ('Z')
+
+// Block: type + offset + count + records (+ 2 CRC bytes)
+#define DL_BLOCK_MAX (1 + 4 + 1 + (DL_BLOCK_RECS * 8))
+
+// Compressed block: type + offset + count + base + records
+#define DL_ZBLOCK_MAX (1 + 4 + 1 + 4 + (DL_BLOCK_RECS * TSC_REC_MAX))
+
+#if DL_BLOCK_MAX > LOGREC_FRAME_MAX || DL_ZBLOCK_MAX > LOGREC_FRAME_MAX
+#error "DL_BLOCK_RECS too large for LOGREC_FRAME_MAX"
+#endif
+
+/* ================= FIELD PACKING ================= */
+
+static u32 PutU32(u8 *p, u32 v)
+{
+    p[0] = v & 0xFF;
+    p[1] = (v >> 8) & 0xFF;
+    p[2] = (v >> 16) & 0xFF;
+    p[3] = (v >> 24) & 0xFF;
+    return 4;
+}
+
+static u32 GetU32(const u8 *p)
+{
+    return p[0] | (p[1] << 8) | ((u32)p[2] << 16) | ((u32)p[3] << 24);
+}
+
+/* ================= SHORT REPLIES ================= */
+/*
+ * Function: DL_SendOffsets
+ * Purpose : Sends a reply carrying one or two u32 fields
+ */
+static void DL_SendOffsets(u8 type, u32 a, u32 b, u8 nVals)
+{
+    u8  buf[1 + 8 + 2];
+    u32 len = 1;
+
+    buf[0] = type;
+    len += PutU32(&buf[len], a);
+    if(nVals > 1)
+        len += PutU32(&buf[len], b);
+
+    LogRec_SendFrame(buf, len);
+}
+
+/* ================= SEND ONE BLOCK ================= */
+/*
+ * Function: DL_SendBlock
+ * Purpose : Sends up to DL_BLOCK_RECS records from dlSent
+ */
+static void DL_SendBlock(void)
+{
+    u8  buf[DL_BLOCK_MAX + 2];
+    u32 len = 0, n = 0;
+    FlashRec r;
+
+    // Records already overwritten cannot be sent
+    if(dlSent < Hist_First())
+        dlSent = Hist_First();
+
+    buf[len++] = DL_RSP_BLOCK;
+    len += PutU32(&buf[len], dlSent);
+    len++;                                  // Count, filled below
+
+    while((n < DL_BLOCK_RECS) && (dlSent + n < dlEnd) &&
+          Hist_Get(dlSent + n, &r))
+    {
+        len += PutU32(&buf[len], r.epoch);
+        buf[len++] = r.temp & 0xFF;
+        buf[len++] = (r.temp >> 8) & 0xFF;
+        buf[len++] = r.code & 0xFF;
+        buf[len++] = r.code >> 8;
+        n++;
+    }
+    buf[5] = n;
+
+    LogRec_SendFrame(buf, len);
+    dlSent += n;
+}
+
+/*
+ * Function: DL_SendZBlock
+ * Purpose : Sends up to DL_BLOCK_RECS records from dlSent,
+ *           compressed as one key frame
+ */
+static void DL_SendZBlock(void)
+{
+    u8  buf[DL_ZBLOCK_MAX + 2];
+    u32 len = 0, n = 0;
+    TSCState ts;
+    FlashRec r;
+
+    if(dlSent < Hist_First())
+        dlSent = Hist_First();
+
+    buf[len++] = DL_RSP_ZBLOCK;
+    len += PutU32(&buf[len], dlSent);
+    len++;                                  // Count, filled below
+
+    while((n < DL_BLOCK_RECS) && (dlSent + n < dlEnd) &&
+          Hist_Get(dlSent + n, &r))
+    {
+        if(n == 0)
+        {
+            len += PutU32(&buf[len], r.epoch);
+            TSC_Start(&ts, r.epoch);
+        }
+        len += TSC_Encode(&ts, &buf[len], r.epoch, r.temp,
+                          (r.code >> LOGREC_CH_BITS) & 3,
+                          r.code & ~(LOGREC_CODE_MASK | (3 << LOGREC_CH_BITS)));
+        n++;
+    }
+    buf[5] = n;
+
+    LogRec_SendFrame(buf, len);
+    dlSent += n;
+}
+
+/* ================= COMMAND HANDLER ================= */
+/*
+ * Function: DL_Command
+ * Purpose : Checks and executes one decoded command frame
+ */
+static void DL_Command(void)
+{
+    u8  cmd[DL_RX_MAX];
+    u32 n, off;
+
+    n = COBS_Decode(rxFrame, rxLen, cmd);
+    if((n < 3) || (CRC16(cmd, n - 2, 0xFFFF) !=
+                   (cmd[n - 2] | (cmd[n - 1] << 8))))
+        return;                             // Host will retry
+
+    n -= 2;                                 // Drop CRC
+
+    switch(cmd[0])
+    {
+        case DL_CMD_INFO:
+            DL_SendOffsets(DL_RSP_INFO, Hist_First(), Hist_Next(), 2);
+            break;
+
+        case DL_CMD_GET:                    // Start or resume
+        case DL_CMD_GETZ:
+            if(n < 5)
+                break;
+            off = GetU32(&cmd[1]);
+            if(off < Hist_First())
+                off = Hist_First();
+            dlAcked  = off;
+            dlSent   = off;
+            dlEnd    = Hist_Next();
+            dlIdle   = 0;
+            dlPacked = (cmd[0] == DL_CMD_GETZ);
+            dlActive = 1;
+            break;
+
+        case DL_CMD_ACK:                    // Slide the window
+            if(n < 5 || !dlActive)
+                break;
+            off = GetU32(&cmd[1]);
+            if((off > dlAcked) && (off <= dlSent))
+            {
+                dlAcked = off;
+                dlIdle  = 0;
+            }
+            break;
+
+        case DL_CMD_ABORT:
+            dlActive = 0;
+            break;
+
+        case DL_CMD_PROF:                   // Sent by PROF_POLL
+            PROF_DUMP((n > 1) && cmd[1]);
+            break;
+    }
+}
+
+/* ================= PERIODIC SERVICE ================= */
+/*
+ * Function: Download_Poll
+ * Purpose : Receives commands and keeps the window full
+ */
+void Download_Poll(void)
+{
+    u8 ch;
+
+    /* --------- RECEIVE --------- */
+    while(UARTRxGet(&ch))
+    {
+        if(ch == 0)                         // End of frame
+        {
+            if(!rxOver && rxLen)
+                DL_Command();
+            rxLen  = 0;
+            rxOver = 0;
+        }
+        else if(rxLen < DL_RX_MAX)
+            rxFrame[rxLen++] = ch;
+        else
+            rxOver = 1;
+    }
+
+    if(!dlActive)
+        return;
+
+    /* --------- TRANSMIT --------- */
+    // Records overwritten while waiting count as sent
+    if(dlAcked < Hist_First())
+        dlAcked = Hist_First();
+
+    if(dlAcked >= dlEnd)
+    {
+        DL_SendOffsets(DL_RSP_END, dlEnd, 0, 1);
+        dlActive = 0;
+        return;
+    }
+
+    while((dlSent < dlEnd) &&
+          ((dlSent - dlAcked) < (DL_WINDOW * DL_BLOCK_RECS)) &&
+          (UARTTxFree() > DL_ZBLOCK_MAX + 8))
+    {
+        if(dlPacked)
+            DL_SendZBlock();
+        else
+            DL_SendBlock();
+    }
+
+    // No acknowledgement: go back to the last acknowledged record
+    if(++dlIdle > DL_ACK_TIMEOUT)
+    {
+        dlSent = dlAcked;
+        dlIdle = 0;
+    }
+}
+
+/* ================= STATUS ================= */
+
+u8 Download_Active(void)
+{
+    return dlActive;
+}
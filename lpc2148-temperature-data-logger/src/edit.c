@@ -3,67 +3,113 @@
 #include "rtc.h"          // RTC (Real Time Clock) definitions
 #include "keyPd.h"        // Keypad driver
 #include "uart.h"         // UART communication functions
+#include "uart_defines.h" // Baud rate error limit
 #include "types.h"        // Custom data types (u8, u32, f32, etc.)
 #include "delay.h"        // Delay routines
+#include "logrec.h"       // Log output format selection
+#include "lm35.h"         // Per-channel sensor limit table
+#include "stats.h"        // Aggregation mode and window
+#include "edit.h"         // Number entry fields
 
 /* ================= EXTERNAL VARIABLES FROM main.c ================= */
 
 // Flag to indicate edit mode status
 extern volatile u8 edit_flag;
 
-// Current temperature value
-extern volatile f32 temp;
+// Current temperature values (centi-degC), per sensor channel
+extern volatile s32 temp[];
 
 // RTC time and date variables
 extern long int hour, min, sec, date, month, year, day;
 
-// Temperature set limit (modifiable)
-extern u32 TEMP_LIMIT;
-
-/* ================= NUMBER INPUT FUNCTION ================= */
+/* ================= EDIT STATE MACHINE ================= */
+/*
+ * Edit mode never blocks. EditPoll is called from the keypad task
+ * and handles at most the queued key events, so sampling, alerts
+ * and logging keep running while the operator is in a menu.
+ */
+#define ED_IDLE      0   // Not in edit mode
+#define ED_MAIN      1   // Main menu, waiting for 1-6
+#define ED_RTC       2   // RTC sub-menu, waiting for 1-8
+#define ED_NUMBER    3   // Number entry for edField
+#define ED_FORMAT    4   // Log format menu, waiting for 1-3
+#define ED_MESSAGE   5   // Result shown until edMsgEnd
+
+// Time a result message stays on the LCD (us)
+#define ED_MSG_US    500000
+
+static u8  edState = ED_IDLE;
+static u8  edField;          // FLD_xxx being entered
+static u8  edDigits;         // Digit limit for edField
+static u8  edCount;          // Digits entered so far
+static u32 edMax;            // Largest accepted value
+static u8  edBack;           // Menu to return to (ED_MAIN/ED_RTC)
+static u32 edMsgEnd;         // Tick when the message expires
+static u32 edSpCh;           // Channel chosen for set-point edit
+static u32 edBaud;           // Baud rate waiting for an idle line
+
+u32 edVal;                   // Number entered so far
+
+
+/* ================= NUMBER INPUT ================= */
 /*
- * Function: GetKeyNumber
- * Purpose : Reads numeric input from keypad
- * Args    : digits - maximum number of digits allowed
- *           max    - maximum value allowed
- * Returns : Entered number (limited to max)
+ * Function: StartNumber
+ * Purpose : Shows a prompt and starts number entry for a field
+ * Args    : field  ? FLD_xxx value being entered
+ *           digits ? maximum number of digits allowed
+ *           max    ? maximum value allowed
  */
-u32 GetKeyNumber(u8 digits, u32 max)
+void StartNumber(u8 field, u8 digits, u32 max)
 {
-    u32 val = 0;          // Variable to store entered value
-    u8 key, count = 0;   // key = keypad value, count = digit count
+    edField  = field;
+    edDigits = digits;
+    edMax    = max;
+    edVal    = 0;
+    edCount  = 0;
+    edState  = ED_NUMBER;
+}
 
-    while(1)
+/*
+ * Function: NumberKey
+ * Purpose : Handles one key during number entry
+ * Returns : 1 ? ENTER pressed, value in edVal
+ *           0 ? entry still in progress
+ */
+u8 NumberKey(u8 key)
+{
+    if(key == 14 && edCount > 0)     // Backspace
     {
-        while(ColStat());        // Wait until a key is pressed
-        delay_ms(10);            // Debounce delay
-        key = KeyVal();          // Read pressed key
-        while(!ColStat());			// Wait until key is released
-				if(key == 14 && count > 0)
-        {
-            val /= 10;
-            count--;
-            CmdLCD(0x10);   // Cursor left
-            CharLCD(' ');
-            CmdLCD(0x10);
-            continue;
-        }
-        if(key == 15)            // If ENTER/EXIT key pressed
-        {
-            break;               // Exit number entry loop
-        }
+        edVal /= 10;
+        edCount--;
+        CmdLCD(0x10);   // Cursor left
+        CharLCD(' ');
+        CmdLCD(0x10);
+        return 0;
+    }
+    if(key == 15)                    // ENTER/EXIT key
+        return 1;
 
-        if(key <= 9)             // If numeric key pressed
-        {
-            if(count < digits)   // Check digit limit
-            {
-                val = (val * 10) + key;   // Build number
-                CharLCD(key + '0');       // Display digit on LCD
-                count++;
-            }
-        }
+    if(key <= 9 && edCount < edDigits)
+    {
+        edVal = (edVal * 10) + key;  // Build number
+        CharLCD(key + '0');          // Display digit on LCD
+        edCount++;
     }
-    return val;                  // Return entered number
+    return 0;
+}
+
+/* ================= RESULT MESSAGE ================= */
+/*
+ * Function: ShowMessage
+ * Purpose : Shows a result for ED_MSG_US, then returns to the
+ *           menu in edBack
+ */
+static void ShowMessage(u8 *msg)
+{
+    CmdLCD(0x01);
+    StrLCD(msg);
+    edMsgEnd = Tick_Deadline(ED_MSG_US);
+    edState  = ED_MESSAGE;
 }
 
 /* ================= LEAP YEAR CHECK ================= */
@@ -106,186 +152,313 @@ void DisplayMainEditMenu(void)
     CmdLCD(0x01);                // Clear LCD
 
     CmdLCD(0x80);                // First line
-    StrLCD("1)EDIT RTC INFO");   // RTC edit option
+    StrLCD("1)RTC 2)SET 3)EX");  // RTC, set-point and exit options
 
     CmdLCD(0xC0);                // Second line
-    StrLCD("2)E.SET 3)EXIT");    // Set-point edit and exit options
+    StrLCD("4)FMT 5)BAUD 6)S");  // Log format, baud rate, stats
 }
 
 /* ================= RTC EDIT SUB MENU ================= */
 /*
- * Allows editing of RTC parameters like hour, minute, date, etc.
+ * Displays the RTC edit sub-menu
  */
-void EditRTCMenu(void)
+void DisplayRTCEditMenu(void)
 {
-    u8 key,value; 	// Variable to store key press
-		u8 updated = 0;
-
     CmdLCD(0x01);                // Clear LCD
     CmdLCD(0x80);
     StrLCD("1.H 2.M 3.S 4.D");   // Hour, Minute, Second, Date
     CmdLCD(0xC0);
     StrLCD("5.M 6.Y 7.DAY 8.E"); // Month, Year, Day, Exit
+}
 
-    while(1)
+/*
+ * Function: RTCMenuKey
+ * Purpose : Starts editing of the RTC field selected by key
+ */
+static void RTCMenuKey(u8 key)
+{
+    if(key < 1 || key > 8)
+        return;
+
+    CmdLCD(0x01);                // Clear LCD before update
+    switch(key)
     {
-        while(ColStat());        // Wait for key press
-        delay_ms(10);            // Debounce delay
-        key = KeyVal();          // Read key
-        while(!ColStat());       // Wait for key release
-
-        CmdLCD(0x01);            // Clear LCD before update
-				updated = 0;
-        switch(key)
-        {
-            case 1:              // Set Hour
-                StrLCD("SET HOUR:");
-                hour = GetKeyNumber(2, 23);
-                HOUR = hour;
-								updated = 1;
-                break;
+        case 1: StrLCD("SET HOUR:");     StartNumber(FLD_HOUR,  2, 23);   break;
+        case 2: StrLCD("SET MIN:");      StartNumber(FLD_MIN,   2, 59);   break;
+        case 3: StrLCD("SET SEC:");      StartNumber(FLD_SEC,   2, 59);   break;
+        case 4: StrLCD("SET DATE:");     StartNumber(FLD_DATE,  2, 31);   break;
+        case 5: StrLCD("SET MONTH:");    StartNumber(FLD_MONTH, 2, 12);   break;
+        case 6: StrLCD("SET YEAR:");     StartNumber(FLD_YEAR,  4, 2099); break;
+        case 7: StrLCD("SET DAY(1-7):"); StartNumber(FLD_DAY,   1, 7);    break;
+
+        case 8:                  // Exit RTC edit menu
+            DisplayMainEditMenu();
+            edState = ED_MAIN;
+            break;
+    }
+}
 
-            case 2:              // Set Minute
-                StrLCD("SET MIN:");
-                min = GetKeyNumber(2, 59);
-                MIN = min;
-								updated = 1;
-                break;
+/* ================= APPLY ENTERED VALUE ================= */
+/*
+ * Function: ApplyNumber
+ * Purpose : Validates edVal for edField and stores it
+ *           Values above the field maximum are rejected
+ */
+static void ApplyNumber(void)
+{
+    u32 value = edVal;
+    u32 dl, fdr;                 // Unused, only the rate error counts
+    u8  updated = 0;
+
+    if(value > edMax)
+    {
+        ShowMessage("reject change");
+        return;
+    }
+
+    switch(edField)
+    {
+        case FLD_HOUR:           // Set Hour
+            hour = value;
+            HOUR = hour;
+            updated = 1;
+            break;
+
+        case FLD_MIN:            // Set Minute
+            min = value;
+            MIN = min;
+            updated = 1;
+            break;
+
+        case FLD_SEC:            // Set Second
+            sec = value;
+            SEC = sec;
+            updated = 1;
+            break;
+
+        case FLD_DATE:           // Set Date
+            if(value >= 1 && value <= GetMaxDays(month, year))
+            {
+                date = value;
+                DOM  = date;     // Update only if valid
+                updated = 1;
+            }
+            break;
+
+        case FLD_MONTH:          // Set Month
+            if(value >= 1 && date <= GetMaxDays(value, year))
+            {
+                month = value;
+                MONTH = month;   // Safe update
+                updated = 1;
+            }
+            break;
 
-            case 3:              // Set Second
-                StrLCD("SET SEC:");
-                sec = GetKeyNumber(2, 59);
-                SEC = sec;
-								updated = 1;
+        case FLD_YEAR:           // Set Year
+            if(date <= GetMaxDays(month, value))
+            {
+                year = value;
+                YEAR = year;     // Safe update
+                updated = 1;
+            }
+            break;
+
+        case FLD_DAY:            // Set Day of Week
+            if(value >= 1)
+            {
+                day = value - 1; // Map 1-7 to 0-6
+                DOW = day;
+                updated = 1;
+            }
+            break;
+
+        case FLD_SP_CH:          // Channel chosen, ask for limit
+            edSpCh = value;
+            CmdLCD(0x01);
+            StrLCD("SET TEMP LIM:");
+            StartNumber(FLD_SP_LIM, 2, 99);
+            return;
+
+        case FLD_SP_LIM:         // Set temperature limit
+            sensorCfg[edSpCh].limit = value;
+            ShowMessage("LIMIT UPDATED");
+            return;
+
+        case FLD_BAUD:           // Set UART baud rate
+            // Switched by EditPoll once the line is idle, so the
+            // keypad task never waits for the TX ring to drain
+            if(value >= 1 &&
+               UARTCalcBaud(uartBaudTbl[value - 1], &dl, &fdr) <= UART_BAUD_MAX_ERR)
+            {
+                edBaud = uartBaudTbl[value - 1];
+                ShowMessage("BAUD UPDATED");
+            }
+            else
+                ShowMessage("reject change"); // Error above 1%
+            return;
+
+        case FLD_STATS:          // Set summary window
+            if(value == 0)
+                log_stats = STATS_OFF;
+            else if(value >= STATS_WINDOW_MIN)
+            {
+                stats_window = value;
+                log_stats    = STATS_ON;
+                Stats_Reset();   // Next window starts clean
+            }
+            else
                 break;
-            case 4:              // Set Date
-									StrLCD("SET DATE:");
-								  value = GetKeyNumber(2, 31);
-
-								if(value >= 1 && value <= GetMaxDays(month, year))
-								{
-												date = value;
-												DOM  = date;        // ? update only if valid
-												updated = 1;
-								}
-								break;
-
-
-            case 5:              // Set Month
-								StrLCD("SET MONTH:");
-								value = GetKeyNumber(2, 12);
-								if(value >= 1 && value <= 12)
-								{
-									if(date <= GetMaxDays(value, year))
-									{
-										month = value;
-										MONTH = month;     // ? safe update
-										updated = 1;
-									}
-							 }
-								break;
-
-
-            case 6:              // Set Year
-								StrLCD("SET YEAR:");
-								value = GetKeyNumber(4, 2099);
-
-								if(date <= GetMaxDays(month, value))
-								{
-											year = value;
-											YEAR = year;      // ? safe update
-											updated = 1;
-								}
-							  break;
-
-
-            case 7:   // Set Day of Week
-								StrLCD("SET DAY(1-7):");
-								value = GetKeyNumber(1, 7);
-
-								if(value >= 1 && value <= 7)
-								{
-										day = value - 1;   // map 17 to 06
-										DOW = day;
-									  updated = 1;
-                } 
-								break;
-
-
-            case 8:              // Exit RTC edit menu
-                return;
-        }
-				CmdLCD(0x01);
-				if(updated)
-						StrLCD("UPDATED");       // Confirmation message
-				else
-					 StrLCD("reject change");
-				delay_ms(500);
-        CmdLCD(0x01);            // Redisplay RTC edit menu
-        CmdLCD(0x80);
-        StrLCD("1.H 2.M 3.S 4.D");
-        CmdLCD(0xC0);
-        StrLCD("5.M 6.Y 7.DAY 8.E");
+            updated = 1;
+            break;
     }
+
+    ShowMessage(updated ? "UPDATED" : "reject change");
 }
 
-/* ================= SET POINT EDIT ================= */
+/* ================= MAIN MENU ================= */
 /*
- * Allows editing of temperature set-point
+ * Function: MainMenuKey
+ * Purpose : Handles a key in the main edit menu
  */
-void EditSetPoint(void)
+static void MainMenuKey(u8 key)
 {
-    CmdLCD(0x01);                // Clear LCD
-    StrLCD("SET TEMP LIM:");     // Prompt user
+    switch(key)
+    {
+        case 1:              // RTC Edit Mode
+            UARTTxMsg("*** RTC EDIT MODE ***\r\n");
+            DisplayRTCEditMenu();
+            edBack  = ED_RTC;
+            edState = ED_RTC;
+            break;
+
+        case 2:              // Temperature Set-Point Edit
+            UARTTxMsg("*** SET POINT EDIT MODE ***\r\n");
+            CmdLCD(0x01);                // Clear LCD
+            StrLCD("SET CH(0-3):");      // Select sensor channel
+            edBack = ED_MAIN;
+            StartNumber(FLD_SP_CH, 1, 3);
+            break;
+
+        case 3:              // Exit Edit Mode
+            UARTTxMsg("*** EXIT EDIT MODE ***\r\n");
+            CmdLCD(0x01);
+            edState   = ED_IDLE;
+            edit_flag = 0;
+            break;
+
+        case 4:              // Log Output Format
+            UARTTxMsg("*** LOG FORMAT EDIT MODE ***\r\n");
+            CmdLCD(0x01);                // Clear LCD
+            StrLCD("1)TXT 2)BIN 3)PK");  // Prompt user
+            edBack  = ED_MAIN;
+            edState = ED_FORMAT;
+            break;
+
+        case 5:              // UART Baud Rate
+            UARTTxMsg("*** BAUD RATE EDIT MODE ***\r\n");
+            CmdLCD(0x01);                // Clear LCD
+            StrLCD("NOW:");              // Show current rate
+            IntLCD(uartBaud);
+            CmdLCD(0xC0);
+            StrLCD("BAUD(1-6):");        // 1=9600 ... 6=230400
+            edBack = ED_MAIN;
+            StartNumber(FLD_BAUD, 1, UART_BAUD_COUNT);
+            break;
+
+        case 6:              // Aggregated (summary) logging
+            UARTTxMsg("*** STATS EDIT MODE ***\r\n");
+            CmdLCD(0x01);                // Clear LCD
+            StrLCD("NOW:");              // Show current window
+            IntLCD(log_stats ? stats_window : 0);
+            CmdLCD(0xC0);
+            StrLCD("WIN S(0=OFF):");     // 10 ... 3600 seconds
+            edBack = ED_MAIN;
+            StartNumber(FLD_STATS, 4, STATS_WINDOW_MAX);
+            break;
 
-    TEMP_LIMIT = GetKeyNumber(2, 99); // Read temperature limit
+        default:
+            break;
+    }
+}
 
-    CmdLCD(0x01);
-    StrLCD("LIMIT UPDATED");     // Confirmation message
-    delay_ms(500);
+/*
+ * Function: FormatKey
+ * Purpose : Selects text, binary or packed UART log output
+ */
+static void FormatKey(u8 key)
+{
+    if(key >= 1 && key <= 3)
+    {
+        LogRec_Flush();          // Do not mix formats inside a frame
+        log_format = LOG_FMT_TEXT + (key - 1);
+        ShowMessage("FORMAT UPDATED");
+    }
+    else
+        ShowMessage("reject change");
 }
 
 /* ================= EDIT MODE (CALLED FROM main.c) ================= */
 /*
- * Main edit mode handler
- * Controls RTC edit, set-point edit, and exit
+ * Function: EditStart
+ * Purpose : Enters edit mode and shows the main menu
  */
-void EditMode(void)
+void EditStart(void)
 {
-    u8 key;                      // Store key input
+    if(edState != ED_IDLE)
+        return;
 
+    KeyPd_Flush();               // Drop keys pressed before edit
     DisplayMainEditMenu();       // Show main menu
-    UARTTxStr("\r\n*** Time Editing Mode Activated ***\r\n");
+    UARTTxMsg("\r\n*** Time Editing Mode Activated ***\r\n");
+    edState   = ED_MAIN;
+    edit_flag = 1;
+}
+
+/*
+ * Function: EditPoll
+ * Purpose : Advances the edit state machine, never blocks
+ *           Handles every queued key event, the message timer
+ *           and a baud rate change waiting for the line to idle
+ */
+void EditPoll(void)
+{
+    u8 ev, key;
 
-    while(1)
+    // Pending baud rate: queued output leaves at the old rate
+    if(edBaud && UARTTxIdle())
     {
-        while(ColStat());        // Wait for key press
-        delay_ms(10);
-        key = KeyVal();          // Read key
-        while(!ColStat());       // Wait for release
+        UARTSetBaud(edBaud);
+        edBaud = 0;
+    }
 
-        switch(key)
-        {
-            case 1:              // RTC Edit Mode
-                UARTTxStr("*** RTC EDIT MODE ***\r\n");
-                EditRTCMenu();
-                DisplayMainEditMenu();
-                break;
+    if(edState == ED_MESSAGE && Tick_Expired(edMsgEnd))
+    {
+        if(edBack == ED_RTC)
+            DisplayRTCEditMenu();
+        else
+            DisplayMainEditMenu();
+        edState = edBack;
+    }
 
-            case 2:              // Temperature Set-Point Edit
-                UARTTxStr("*** SET POINT EDIT MODE ***\r\n");
-                EditSetPoint();
-                DisplayMainEditMenu();
-                break;
+    while((edState != ED_IDLE) && KeyPd_GetEvent(&ev))
+    {
+        if((ev & KEY_EV_MASK) != KEY_EV_PRESS)
+            continue;
+        key = ev & KEY_VAL_MASK;
 
-            case 3:              // Exit Edit Mode
-                UARTTxStr("*** EXIT EDIT MODE ***\r\n");
-                edit_flag = 0;
-                CmdLCD(0x01);
-                return;
+        switch(edState)
+        {
+            case ED_MAIN:   MainMenuKey(key);  break;
+            case ED_RTC:    RTCMenuKey(key);   break;
+            case ED_FORMAT: FormatKey(key);    break;
 
-            default:
+            case ED_NUMBER:
+                if(NumberKey(key))
+                    ApplyNumber();
                 break;
+
+            default:                         // Message shown,
+                break;                       // key ignored
         }
     }
 }
@@ -0,0 +1,262 @@
+#include <LPC214X.H>        // LPC214x microcontroller register definitions
+#include "types.h"          // Custom data types (u8, u16, u32)
+#include "adc_defines.h"    // CCLK clock definition
+#include "logrec.h"         // CRC16 and record field layout
+#include "flashlog.h"       // Flash log layout and prototypes
+#include "vic.h"            // Critical section
+
+/* ================= IAP ENTRY ================= */
+
+typedef void (*IAP)(u32 *, u32 *);
+
+/* ================= LOG STATE ================= */
+
+// Page buffer, padded to the full 256-byte IAP copy size
+static union
+{
+    FlashPage pg;
+    u32 raw[FLOG_PAGE_SIZE / 4];
+} pageBuf;
+
+static u32 nextPage = 0;        // Page index to program next
+
+u32 flogFirstSeq = 0;           // Oldest valid page sequence
+u32 flogNextSeq  = 0;           // Sequence of the next page
+
+FlashLogStats flogStats;
+
+/* ================= PAGE ADDRESSING ================= */
+
+// Addresses pass through unsigned long, pointer-sized on the target
+// and on the host (where they sit below 4 GB), to and from the u32
+// that IAP takes
+#define PAGE_PTR(p)  ((const FlashPage *)(unsigned long)(FLOG_BASE_ADDR + ((p) * FLOG_PAGE_SIZE)))
+#define PTR_U32(ptr) ((u32)(unsigned long)(ptr))
+
+/* ================= IAP CALL ================= */
+/*
+ * Function: IAP_Call
+ * Purpose : Runs one IAP command with interrupts masked
+ *           (flash, and so the vector table, is unavailable
+ *           while IAP is erasing or programming)
+ * Returns : IAP status code
+ */
+static u32 IAP_Call(u32 cmd, u32 p0, u32 p1, u32 p2, u32 p3)
+{
+    u32 command[5], result[3];
+    u32 save;
+    IAP iap = (IAP)IAP_LOCATION;
+
+    command[0] = cmd;
+    command[1] = p0;
+    command[2] = p1;
+    command[3] = p2;
+    command[4] = p3;
+
+    save = VIC_Lock(VIC_ALL);       // Mask all interrupts
+
+    iap(command, result);
+
+    VIC_Unlock(save);               // Restore interrupts
+    return result[0];
+}
+
+/* ================= PAGE CHECKS ================= */
+/*
+ * Function: PageCRC
+ * Purpose : CRC over seq, count and the used records
+ */
+static u16 PageCRC(const FlashPage *pg)
+{
+    u16 crc;
+
+    crc = CRC16((const u8 *)&pg->seq, 6, 0xFFFF);
+    return CRC16((const u8 *)pg->rec, pg->count * sizeof(FlashRec), crc);
+}
+
+/*
+ * Function: PageValid
+ * Purpose : Checks marker, record count and CRC
+ */
+static u8 PageValid(const FlashPage *pg)
+{
+    return (pg->magic == FLOG_MAGIC) &&
+           (pg->count <= FLOG_RECS_PER_PAGE) &&
+           (pg->crc == PageCRC(pg));
+}
+
+/*
+ * Function: PageBlank
+ * Purpose : Checks that a page is still erased (all 0xFF)
+ */
+static u8 PageBlank(u32 p)
+{
+    const u32 *w = (const u32 *)PAGE_PTR(p);
+    u32 i;
+
+    for(i = 0; i < FLOG_PAGE_SIZE / 4; i++)
+        if(w[i] != 0xFFFFFFFF)
+            return 0;
+    return 1;
+}
+
+/* ================= SCAN ================= */
+/*
+ * Function: FlashLog_Scan
+ * Purpose : Finds the oldest and newest valid pages
+ * Returns : Index of newest valid page, or FLOG_NUM_PAGES if none
+ */
+static u32 FlashLog_Scan(void)
+{
+    const FlashPage *pg;
+    u32 p, newest = FLOG_NUM_PAGES;
+
+    flogFirstSeq = 0xFFFFFFFF;
+
+    for(p = 0; p < FLOG_NUM_PAGES; p++)
+    {
+        pg = PAGE_PTR(p);
+        if(!PageValid(pg))
+            continue;
+
+        if((newest == FLOG_NUM_PAGES) || (pg->seq > PAGE_PTR(newest)->seq))
+            newest = p;
+        if(pg->seq < flogFirstSeq)
+            flogFirstSeq = pg->seq;
+    }
+    return newest;
+}
+
+/* ================= INITIALIZATION / RECOVERY ================= */
+/*
+ * Function: FlashLog_Init
+ * Purpose : Resumes the circular log after a reset or power cut
+ */
+void FlashLog_Init(void)
+{
+    u32 newest;
+
+    newest = FlashLog_Scan();
+
+    if(newest == FLOG_NUM_PAGES)        // Empty log
+    {
+        nextPage     = 0;
+        flogFirstSeq = 0;
+        flogNextSeq  = 0;
+    }
+    else
+    {
+        nextPage    = (newest + 1) % FLOG_NUM_PAGES;
+        flogNextSeq = PAGE_PTR(newest)->seq + 1;
+    }
+
+    pageBuf.pg.count = 0;
+}
+
+/* ================= PROGRAM ONE PAGE ================= */
+/*
+ * Function: FlashLog_Program
+ * Purpose : Writes the page buffer to the next free page,
+ *           erasing a sector when the write pointer enters it
+ */
+static void FlashLog_Program(void)
+{
+    u32 sec, i;
+
+    // Skip any page left half-written by a power cut
+    while(1)
+    {
+        if((nextPage % FLOG_PAGES_PER_SEC) == 0)
+        {
+            sec = FLOG_FIRST_SECTOR + (nextPage / FLOG_PAGES_PER_SEC);
+            if((IAP_Call(IAP_PREPARE, sec, sec, 0, 0) != IAP_CMD_SUCCESS) ||
+               (IAP_Call(IAP_ERASE, sec, sec, CCLK / 1000, 0) != IAP_CMD_SUCCESS))
+                flogStats.errors++;
+            flogStats.erases++;
+
+            // Oldest data may have gone with the erased sector
+            if(FlashLog_Scan() == FLOG_NUM_PAGES)
+                flogFirstSeq = flogNextSeq;
+            break;
+        }
+        if(PageBlank(nextPage))
+            break;
+        nextPage = (nextPage + 1) % FLOG_NUM_PAGES;
+    }
+
+    // Unused tail of the page stays erased
+    for(i = FLOG_HDR_SIZE / 4 + pageBuf.pg.count * sizeof(FlashRec) / 4;
+        i < FLOG_PAGE_SIZE / 4; i++)
+        pageBuf.raw[i] = 0xFFFFFFFF;
+
+    pageBuf.pg.magic = FLOG_MAGIC;
+    pageBuf.pg.seq   = flogNextSeq;
+    pageBuf.pg.crc   = PageCRC(&pageBuf.pg);
+
+    sec = FLOG_FIRST_SECTOR + (nextPage / FLOG_PAGES_PER_SEC);
+    if((IAP_Call(IAP_PREPARE, sec, sec, 0, 0) != IAP_CMD_SUCCESS) ||
+       (IAP_Call(IAP_COPY_RAM, PTR_U32(PAGE_PTR(nextPage)), PTR_U32(pageBuf.raw),
+                 FLOG_PAGE_SIZE, CCLK / 1000) != IAP_CMD_SUCCESS))
+        flogStats.errors++;
+
+    flogStats.pages++;
+    flogNextSeq++;
+    nextPage = (nextPage + 1) % FLOG_NUM_PAGES;
+    pageBuf.pg.count = 0;
+}
+
+/* ================= APPEND RECORD ================= */
+/*
+ * Function: FlashLog_Append
+ * Purpose : Adds one sample to the RAM page buffer; alarm
+ *           records are made reset-proof straight away
+ */
+void FlashLog_Append(u32 epoch, s32 centiC, u32 chNo, u32 code, u16 flags)
+{
+    FlashRec *r = &pageBuf.pg.rec[pageBuf.pg.count];
+
+    r->epoch = epoch;
+    r->temp  = centiC;
+    r->code  = (code & LOGREC_CODE_MASK) |
+               ((chNo & 3) << LOGREC_CH_BITS) | flags;
+
+    flogStats.records++;
+
+    if(++pageBuf.pg.count == FLOG_RECS_PER_PAGE)
+        FlashLog_Program();
+    else if(flags & FLOG_SYNC_FLAGS)
+        FlashLog_Sync();
+}
+
+/* ================= FORCE WRITE ================= */
+/*
+ * Function: FlashLog_Sync
+ * Purpose : Programs a partly filled page buffer
+ */
+void FlashLog_Sync(void)
+{
+    if(pageBuf.pg.count == 0)
+        return;
+
+    flogStats.padRecs += FLOG_RECS_PER_PAGE - pageBuf.pg.count;
+    FlashLog_Program();
+}
+
+/* ================= PAGE LOOKUP ================= */
+/*
+ * Function: FlashLog_FindPage
+ * Purpose : Locates a stored page by sequence number
+ */
+const FlashPage *FlashLog_FindPage(u32 seq)
+{
+    const FlashPage *pg;
+    u32 p;
+
+    for(p = 0; p < FLOG_NUM_PAGES; p++)
+    {
+        pg = PAGE_PTR(p);
+        if((pg->seq == seq) && PageValid(pg))
+            return pg;
+    }
+    return 0;
+}
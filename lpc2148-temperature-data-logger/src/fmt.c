@@ -0,0 +1,199 @@
+#include "types.h"          // Custom data types (u8, u32, s32, f32)
+#include "fmt.h"            // Formatting prototypes
+
+/* ================= TWO-DIGIT TABLE ================= */
+/*
+ * "00" .. "99": one lookup and one divide by 100 produce two
+ * digits, halving the divisions of a digit-by-digit loop
+ */
+static const u8 fmtDig2[200] =
+    "00010203040506070809"
+    "10111213141516171819"
+    "20212223242526272829"
+    "30313233343536373839"
+    "40414243444546474849"
+    "50515253545556575859"
+    "60616263646566676869"
+    "70717273747576777879"
+    "80818283848586878889"
+    "90919293949596979899";
+
+/* ================= UNSIGNED INTEGER ================= */
+/*
+ * Function: Fmt_Digits
+ * Purpose : Renders n right-aligned, ending at end
+ * Returns : Position of the first digit
+ */
+static u8 *Fmt_Digits(u8 *end, u32 n)
+{
+    u32 q, r;
+
+    while(n >= 100)
+    {
+        q = FMT_DIV100(n);
+        r = (n - q * 100) << 1;
+        *--end = fmtDig2[r + 1];
+        *--end = fmtDig2[r];
+        n = q;
+    }
+
+    if(n >= 10)
+    {
+        *--end = fmtDig2[(n << 1) + 1];
+        *--end = fmtDig2[n << 1];
+    }
+    else
+        *--end = n + '0';
+
+    return end;
+}
+
+/*
+ * Function: Fmt_U32
+ * Purpose : Writes n in decimal
+ */
+u8 *Fmt_U32(u8 *p, u32 n)
+{
+    u8 tmp[FMT_U32_MAX];
+    u8 *d = Fmt_Digits(tmp + FMT_U32_MAX, n);
+
+    while(d < tmp + FMT_U32_MAX)
+        *p++ = *d++;
+    return p;
+}
+
+/*
+ * Function: Fmt_S32
+ * Purpose : Writes n in decimal with a leading '-' if negative
+ */
+u8 *Fmt_S32(u8 *p, s32 n)
+{
+    if(n < 0)
+    {
+        *p++ = '-';
+        return Fmt_U32(p, -(u32)n);
+    }
+    return Fmt_U32(p, n);
+}
+
+/*
+ * Function: Fmt_UPad
+ * Purpose : Writes n with leading zeros up to width digits
+ */
+u8 *Fmt_UPad(u8 *p, u32 n, u32 width)
+{
+    u8 tmp[FMT_U32_MAX];
+    u8 *d = Fmt_Digits(tmp + FMT_U32_MAX, n);
+    u32 len = (tmp + FMT_U32_MAX) - d;
+
+    while(width-- > len)
+        *p++ = '0';
+    while(d < tmp + FMT_U32_MAX)
+        *p++ = *d++;
+    return p;
+}
+
+/*
+ * Function: Fmt_U2
+ * Purpose : Writes the two low decimal digits of n
+ */
+u8 *Fmt_U2(u8 *p, u32 n)
+{
+    if(n >= 100)
+        n -= FMT_DIV100(n) * 100;
+    *p++ = fmtDig2[n << 1];
+    *p++ = fmtDig2[(n << 1) + 1];
+    return p;
+}
+
+/* ================= FIXED-POINT AND FLOAT ================= */
+/*
+ * Function: Fmt_Centi
+ * Purpose : Writes a centi-unit value as "I.FF"
+ */
+u8 *Fmt_Centi(u8 *p, s32 v)
+{
+    u32 u, q;
+
+    if(v < 0)
+    {
+        *p++ = '-';
+        u = -(u32)v;
+    }
+    else
+        u = v;
+
+    q = FMT_DIV100(u);
+    p = Fmt_U32(p, q);              // Integer part
+    *p++ = '.';
+    return Fmt_U2(p, u - q * 100);  // Fractional part (2 digits)
+}
+
+/*
+ * Function: Fmt_F32
+ * Purpose : Writes a float, decimals truncated (not rounded)
+ *           the same way UARTTxF32 and FltLCD always did
+ */
+u8 *Fmt_F32(u8 *p, f32 f, u32 nDec)
+{
+    u32 ipart, d;
+
+    if(f < 0)
+    {
+        *p++ = '-';
+        f = -f;
+    }
+
+    ipart = (u32)f;
+    p = Fmt_U32(p, ipart);
+    *p++ = '.';
+
+    f = f - ipart;
+    while(nDec--)
+    {
+        f *= 10;
+        d = (u32)f;
+        *p++ = d + '0';
+        f -= d;
+    }
+    return p;
+}
+
+/* ================= TIME AND DATE ================= */
+/*
+ * Function: Fmt_Time
+ * Purpose : Writes "HH:MM:SS"
+ */
+u8 *Fmt_Time(u8 *p, u32 hour, u32 min, u32 sec)
+{
+    p = Fmt_U2(p, hour);
+    *p++ = ':';
+    p = Fmt_U2(p, min);
+    *p++ = ':';
+    return Fmt_U2(p, sec);
+}
+
+/*
+ * Function: Fmt_Date
+ * Purpose : Writes "DD/MM/YYYY"
+ */
+u8 *Fmt_Date(u8 *p, u32 date, u32 month, u32 year)
+{
+    p = Fmt_U2(p, date);
+    *p++ = '/';
+    p = Fmt_U2(p, month);
+    *p++ = '/';
+    return Fmt_U32(p, year);
+}
+
+/* ================= STRING ================= */
+/*
+ * Function: Fmt_Str
+ * Purpose : Copies a string without its terminator
+ */
+u8 *Fmt_Str(u8 *p, const char *s)
+{
+    while(*s)
+        *p++ = *s++;
+    return p;
+}
@@ -0,0 +1,53 @@
+#include "types.h"          // Custom data types (u8, u16, u32, s32)
+#include "logrec.h"         // Record field layout
+#include "history.h"        // History ring definitions
+
+/* ================= HISTORY RING ================= */
+
+#define HIST_MASK (HIST_SIZE - 1)
+
+static FlashRec hist[HIST_SIZE];
+static u32 histNext = 0;        // Absolute index of next record
+
+/* ================= ADD RECORD ================= */
+/*
+ * Function: Hist_Add
+ * Purpose : Stores a sample, overwriting the oldest when full
+ */
+void Hist_Add(u32 epoch, s32 centiC, u32 chNo, u32 code, u16 flags)
+{
+    FlashRec *r = &hist[histNext & HIST_MASK];
+
+    r->epoch = epoch;
+    r->temp  = centiC;
+    r->code  = (code & LOGREC_CODE_MASK) |
+               ((chNo & 3) << LOGREC_CH_BITS) | flags;
+
+    histNext++;
+}
+
+/* ================= INDEX RANGE ================= */
+
+u32 Hist_First(void)
+{
+    return (histNext > HIST_SIZE) ? (histNext - HIST_SIZE) : 0;
+}
+
+u32 Hist_Next(void)
+{
+    return histNext;
+}
+
+/* ================= READ RECORD ================= */
+/*
+ * Function: Hist_Get
+ * Purpose : Reads a record by absolute index
+ */
+u8 Hist_Get(u32 idx, FlashRec *rec)
+{
+    if((idx < Hist_First()) || (idx >= histNext))
+        return 0;
+
+    *rec = hist[idx & HIST_MASK];
+    return 1;
+}
@@ -1,5 +1,7 @@
 #include <LPC214X.H>        // LPC214x microcontroller register definitions
 #include "KeyPd.h"          // Keypad related definitions (row/column pins)
+#include "types.h"          // Custom data types (u8, u32)
+#include "delay.h"          // Timer1 periodic callback
 
 /* ================= KEYPAD LOOK-UP TABLE ================= */
 /*
@@ -60,7 +62,7 @@ unsigned char ColStat(void)
  */
 unsigned char KeyVal(void)
 {
-    char row_val = 0, col_val = 0;   // Variables to store row & column
+    unsigned int row_val = 0, col_val = 0;   // Variables to store row & column
 
     /* --------- ROW 0 CHECK --------- */
     IOCLR1 = (1<<R0);                           // Activate row 0
@@ -120,3 +122,200 @@ unsigned char KeyVal(void)
     // Return corresponding key value from LUT
     return (LUT[row_val][col_val]);
 }
+
+/* ================= INTERRUPT-DRIVEN SCANNER ================= */
+/*
+ * Timer1 calls KeyPd_ScanTick every KEY_SCAN_US. Each tick reads
+ * the columns of the row driven on the previous tick (so the
+ * lines have a whole tick to settle) and then drives the next
+ * row, giving one sample of every key per 4 ticks.
+ *
+ * Per-key debounce state machine (one sample = 4 ticks):
+ *
+ *   UP ---pressed---> DN_WAIT ---KEY_DEBOUNCE pressed---> DOWN
+ *    ^                   | released                        |
+ *    |<------------------+                                 |
+ *    |<---KEY_DEBOUNCE released--- UP_WAIT <---released---+
+ *                                     | pressed -> DOWN
+ *
+ * DOWN emits KEY_EV_PRESS on entry and KEY_EV_LONG once after
+ * KEY_LONG_SAMPLES; leaving UP_WAIT for UP emits KEY_EV_RELEASE.
+ */
+#define KEY_ROWS_MASK   ((1<<R0) | (1<<R1) | (1<<R2) | (1<<R3))
+#define KEY_QUEUE_MASK  (KEY_QUEUE_SIZE - 1)
+
+u8 keySt[16];                        // Debounce state per key
+static u8 keyCnt[16];                // Samples in current state
+static u8 scanRow = 0;               // Row driven for this tick
+
+static volatile u8  keyQueue[KEY_QUEUE_SIZE];
+static volatile u32 keyHead = 0;     // Written by the ISR
+static volatile u32 keyTail = 0;     // Written by the consumer
+
+// Events lost because the queue was full
+volatile u32 keyDropCnt = 0;
+
+/*
+ * Function: KeyPd_Post
+ * Purpose : Queues one event (ISR only), drops newest if full
+ */
+static void KeyPd_Post(u8 ev)
+{
+    if((keyHead - keyTail) >= KEY_QUEUE_SIZE)
+        keyDropCnt++;
+    else
+    {
+        keyQueue[keyHead & KEY_QUEUE_MASK] = ev;
+        keyHead++;
+    }
+}
+
+/*
+ * Function: KeyPd_Reset
+ * Purpose : All keys up, event queue empty
+ */
+void KeyPd_Reset(void)
+{
+    u8 k;
+
+    for(k = 0; k < 16; k++)
+    {
+        keySt[k]  = KEY_ST_UP;
+        keyCnt[k] = 0;
+    }
+    keyHead = keyTail = 0;
+}
+
+/*
+ * Function: KeyPd_Debounce
+ * Purpose : Advances the state machine of one key
+ */
+void KeyPd_Debounce(u8 key, u8 down)
+{
+    switch(keySt[key])
+    {
+        case KEY_ST_UP:
+            if(down)
+            {
+                keySt[key]  = KEY_ST_DN_WAIT;
+                keyCnt[key] = 1;
+            }
+            break;
+
+        case KEY_ST_DN_WAIT:
+            if(!down)
+                keySt[key] = KEY_ST_UP;         // Bounce or glitch
+            else if(++keyCnt[key] >= KEY_DEBOUNCE)
+            {
+                keySt[key]  = KEY_ST_DOWN;
+                keyCnt[key] = 0;
+                KeyPd_Post(KEY_EV_PRESS | key);
+            }
+            break;
+
+        case KEY_ST_DOWN:
+            if(!down)
+            {
+                keySt[key]  = KEY_ST_UP_WAIT;
+                keyCnt[key] = 1;
+            }
+            else if(keyCnt[key] < KEY_LONG_SAMPLES)
+            {
+                if(++keyCnt[key] == KEY_LONG_SAMPLES)
+                    KeyPd_Post(KEY_EV_LONG | key);
+            }
+            break;
+
+        case KEY_ST_UP_WAIT:
+            if(down)
+            {
+                keySt[key]  = KEY_ST_DOWN;      // Release bounce
+                keyCnt[key] = KEY_LONG_SAMPLES; // No second LONG
+            }
+            else if(++keyCnt[key] >= KEY_DEBOUNCE)
+            {
+                keySt[key] = KEY_ST_UP;
+                KeyPd_Post(KEY_EV_RELEASE | key);
+            }
+            break;
+    }
+}
+
+/*
+ * Function: KeyPd_ScanTick
+ * Purpose : Samples one keypad row (Timer1 ISR context)
+ */
+static void KeyPd_ScanTick(void)
+{
+    u32 cols = (IOPIN1 >> C0) & 0x0F;   // Active low columns
+    u8  c;
+
+    for(c = 0; c < 4; c++)
+        KeyPd_Debounce(LUT[scanRow][c], ((cols >> c) & 1) == 0);
+
+    // Drive the next row low, the others high
+    scanRow = (scanRow + 1) & 3;
+    IOSET1 = KEY_ROWS_MASK;
+    IOCLR1 = (1 << (R0 + scanRow));
+}
+
+/* ================= START SCANNER ================= */
+/*
+ * Function: KeyPd_StartScan
+ * Purpose : Starts background scanning on the Timer1 tick
+ *           ColStat/KeyVal must not be used afterwards
+ */
+void KeyPd_StartScan(void)
+{
+    KeyPd_Reset();
+
+    scanRow = 0;
+    IOSET1 = KEY_ROWS_MASK;
+    IOCLR1 = (1<<R0);
+
+    Tick_StartPeriodic(KeyPd_ScanTick, KEY_SCAN_US);
+}
+
+/* ================= EVENT QUEUE ================= */
+/*
+ * Function: KeyPd_GetEvent
+ * Purpose : Takes the oldest key event
+ * Returns : 1 ? event stored in *ev (KEY_EV_xxx | key)
+ *           0 ? queue empty
+ */
+u8 KeyPd_GetEvent(u8 *ev)
+{
+    if(keyTail == keyHead)
+        return 0;
+
+    *ev = keyQueue[keyTail & KEY_QUEUE_MASK];
+    keyTail++;              // Release slot to the ISR
+    return 1;
+}
+
+/*
+ * Function: KeyPd_Flush
+ * Purpose : Discards all pending key events
+ */
+void KeyPd_Flush(void)
+{
+    keyTail = keyHead;
+}
+
+/*
+ * Function: KeyPd_WaitKey
+ * Purpose : Waits for the next key press, idling the CPU
+ * Returns : Key value (015)
+ */
+u8 KeyPd_WaitKey(void)
+{
+    u8 ev;
+
+    while(1)
+    {
+        while(!KeyPd_GetEvent(&ev))
+            delay_ms(KEY_SCAN_US * 4 / 1000);   // One scan pass
+        if((ev & KEY_EV_MASK) == KEY_EV_PRESS)
+            return ev & KEY_VAL_MASK;
+    }
+}
@@ -3,6 +3,7 @@
 #include "lcd.h"         // LCD function prototypes
 #include "types.h"       // Custom data types (u8, s32, f32, etc.)
 #include "defines.h"     // Bit manipulation macros
+#include "fmt.h"         // Number formatting
 
 /* ================= LCD PIN DEFINITIONS ================= */
 
@@ -14,6 +15,32 @@
 #define RW 6   // Read/Write pin (P0.6)
 #define EN 7   // Enable pin (P0.7)
 
+/* ================= LCD TIMING ================= */
+
+// Longest time to wait for the busy flag before giving up (us)
+#define LCD_BUSY_TIMEOUT 3000
+
+/* ================= SHADOW FRAMEBUFFER ================= */
+/*
+ * CmdLCD/CharLCD only update lcdFb[] and the logical cursor.
+ * LCD_Flush later sends the cells that differ from lcdHw[]
+ * (what the glass shows), moving the cursor only when the
+ * next changed cell is not where the LCD already points.
+ */
+static u8 lcdFb[LCD_ROWS][LCD_COLS];    // Wanted contents
+static u8 lcdHw[LCD_ROWS][LCD_COLS];    // Contents on the LCD
+static u8 lcdAddr  = 0;                 // Logical DDRAM address
+static u8 lcdHwAddr = 0xFF;             // LCD address, 0xFF unknown
+static u8 lcdCgram = 0;                 // CGRAM writes go direct
+static u8 lcdSync  = 0;                 // Flush after every call
+static u8 lcdBfOk  = 0;                 // Busy flag usable
+
+// Bytes written to the LCD bus
+u32 lcdBusWrites = 0;
+
+// Busy flag waits that timed out
+u32 lcdBusyTimeouts = 0;
+
 /* ================= LCD INITIALIZATION ================= */
 /*
  * Function: InitLCD
@@ -21,60 +48,215 @@
  */
 void InitLCD(void)
 {
+    u8 r, c;
+
     // Configure P0.5P0.15 as output pins
     IODIR0 |= ((LCD_DAT << 8) | (1<<RS) | (1<<RW) | (1<<EN));
     // Data lines + control lines set as output
 
+    lcdBfOk = 0;         // Busy flag invalid until function set
     delay_ms(20);        // LCD power-on delay (minimum 15ms)
 
-    CmdLCD(0x30);        // Function set: 8-bit mode
+    DispLCD(0x30);       // Function set: 8-bit mode
     delay_ms(10);        // Delay > 5ms
 
-    CmdLCD(0x30);        // Repeat command for reliability
+    DispLCD(0x30);       // Repeat command for reliability
     delay_ms(1);         // Delay > 160s
 
-    CmdLCD(0x30);        // Repeat function set
+    DispLCD(0x30);       // Repeat function set
+    delay_ms(1);
+
+    DispLCD(0x38);       // 8-bit mode, 2 lines, 5x7 font
     delay_ms(1);
+    lcdBfOk = 1;         // From here on poll the busy flag
 
-    CmdLCD(0x38);        // 8-bit mode, 2 lines, 5x7 font
-    CmdLCD(0x10);        // Display OFF
-    CmdLCD(0x01);        // Clear display
-    CmdLCD(0x06);        // Entry mode: cursor increment
-    CmdLCD(0x0F);        // Display ON, cursor ON, blinking ON
+    DispLCD(0x10);       // Display OFF
+    DispLCD(0x01);       // Clear display
+    DispLCD(0x06);       // Entry mode: cursor increment
+    DispLCD(0x0F);       // Display ON, cursor ON, blinking ON
+
+    for(r = 0; r < LCD_ROWS; r++)
+        for(c = 0; c < LCD_COLS; c++)
+            lcdFb[r][c] = lcdHw[r][c] = ' ';
+    lcdAddr = 0;
+    lcdHwAddr = 0;
 }
 
 /* ================= SEND LCD COMMAND ================= */
 /*
- * Sends a command to LCD
+ * Applies a command to the framebuffer
+ * Cursor moves and clear stay in RAM, CGRAM and mode commands
+ * are sent to the LCD directly
  */
 void CmdLCD(u8 cmd)
 {
-    IOCLR0 = 1<<RS;      // RS = 0 ? command mode
-    DispLCD(cmd);        // Send command to LCD
+    u8 r, c;
+
+    if(cmd & 0x80)                  // Set DDRAM address
+    {
+        lcdAddr  = cmd & 0x7F;
+        lcdCgram = 0;
+    }
+    else if(cmd == 0x01)            // Clear display
+    {
+        for(r = 0; r < LCD_ROWS; r++)
+            for(c = 0; c < LCD_COLS; c++)
+                lcdFb[r][c] = ' ';
+        lcdAddr = 0;
+    }
+    else if((cmd & 0xFE) == 0x02)   // Return home
+        lcdAddr = 0;
+    else if(cmd == 0x10)            // Cursor left
+        lcdAddr--;
+    else if(cmd == 0x14)            // Cursor right
+        lcdAddr++;
+    else
+    {
+        if(cmd & 0x40)              // Set CGRAM address
+        {
+            LCD_Flush();
+            lcdCgram = 1;
+            lcdHwAddr = 0xFF;
+        }
+        IOCLR0 = 1<<RS;             // RS = 0 ? command mode
+        DispLCD(cmd);               // Send command to LCD
+        return;
+    }
+
+    if(lcdSync)
+        LCD_Flush();
 }
 
 /* ================= SEND CHARACTER TO LCD ================= */
 /*
- * Sends a single character to LCD
+ * Stores a single character at the logical cursor
+ * Characters outside the visible 16x2 window are dropped
  */
 void CharLCD(u8 dat)
 {
-    IOSET0 = 1<<RS;      // RS = 1 ? data mode
-    DispLCD(dat);        // Send data to LCD
+    if(lcdCgram)                    // Custom character pattern
+    {
+        IOSET0 = 1<<RS;             // RS = 1 ? data mode
+        DispLCD(dat);
+        return;
+    }
+
+    if(lcdAddr < LCD_COLS)
+        lcdFb[0][lcdAddr] = dat;
+    else if((lcdAddr >= 0x40) && (lcdAddr < 0x40 + LCD_COLS))
+        lcdFb[1][lcdAddr - 0x40] = dat;
+    lcdAddr++;
+
+    if(lcdSync)
+        LCD_Flush();
+}
+
+/* ================= BUSY FLAG ================= */
+/*
+ * Function: LCD_WaitReady
+ * Purpose : Polls the busy flag (D7 on P0.15) over the RW line
+ *           until the LCD accepts the next byte
+ */
+static void LCD_WaitReady(void)
+{
+    u32 deadline = Tick_Deadline(LCD_BUSY_TIMEOUT);
+    u32 rs = IOPIN0 & (1<<RS);      // Keep RS for the next write
+    u8  busy;
+
+    IODIR0 &= ~(LCD_DAT << 8);      // Data lines as inputs
+    IOCLR0 = 1<<RS;                 // RS = 0, RW = 1 ? read status
+    IOSET0 = 1<<RW;
+
+    do
+    {
+        IOSET0 = 1<<EN;
+        delay_us(1);                // Data valid after tDDR
+        busy = READBIT(IOPIN0, 15);
+        IOCLR0 = 1<<EN;
+        if(busy && Tick_Expired(deadline))
+        {
+            lcdBusyTimeouts++;
+            break;
+        }
+    } while(busy);
+
+    IOCLR0 = 1<<RW;                 // Back to write mode
+    IODIR0 |= (LCD_DAT << 8);
+    if(rs)
+        IOSET0 = 1<<RS;
 }
 
 /* ================= LOW LEVEL LCD DATA WRITE ================= */
 /*
  * Writes data/command to LCD with enable pulse
+ * Before the function set the busy flag cannot be read,
+ * so InitLCD paces those writes itself
  */
 void DispLCD(u8 val)
 {
+    if(lcdBfOk)
+        LCD_WaitReady();                 // Wait for previous byte
+
     IOCLR0 = 1<<RW;                      // RW = 0 ? write mode
     WRITEBYTE(IOPIN0, 8, val);           // Write value to P0.8P0.15
     IOSET0 = 1<<EN;                      // EN = 1 (enable LCD)
-    delay_ms(2);                         // Enable pulse width
+    delay_us(1);                         // Enable pulse width
     IOCLR0 = 1<<EN;                      // EN = 0
-    delay_ms(5);                         // Command execution delay
+    lcdBusWrites++;
+}
+
+/* ================= FRAMEBUFFER FLUSH ================= */
+/*
+ * Function: LCD_Flush
+ * Purpose : Sends changed cells, then leaves the LCD cursor
+ *           at the logical cursor (visible in edit mode)
+ */
+void LCD_Flush(void)
+{
+    u8 r, c, addr;
+
+    if(lcdCgram)
+        return;
+
+    for(r = 0; r < LCD_ROWS; r++)
+    {
+        for(c = 0; c < LCD_COLS; c++)
+        {
+            if(lcdFb[r][c] == lcdHw[r][c])
+                continue;
+
+            addr = (r ? 0x40 : 0x00) + c;
+            if(lcdHwAddr != addr)   // Cursor move only when needed
+            {
+                IOCLR0 = 1<<RS;
+                DispLCD(0x80 | addr);
+            }
+            IOSET0 = 1<<RS;
+            DispLCD(lcdFb[r][c]);
+            lcdHw[r][c] = lcdFb[r][c];
+            lcdHwAddr = addr + 1;
+        }
+    }
+
+    if(lcdHwAddr != lcdAddr)
+    {
+        IOCLR0 = 1<<RS;
+        DispLCD(0x80 | lcdAddr);
+        lcdHwAddr = lcdAddr;
+    }
+}
+
+/*
+ * Function: LCD_SetSync
+ * Purpose : 1 ? every CmdLCD/CharLCD is flushed at once, for
+ *               code that writes the LCD and then blocks
+ *           0 ? changes wait for the next LCD_Flush
+ */
+void LCD_SetSync(u8 on)
+{
+    lcdSync = on;
+    if(on)
+        LCD_Flush();
 }
 
 /* ================= DISPLAY STRING ================= */
@@ -93,30 +275,10 @@ void StrLCD(u8 *ptr)
  */
 void IntLCD(s32 num)
 {
-    u8 a[10];                            // Buffer for digits
-    s8 i = 0;
-
-    if(num == 0)                         // If number is zero
-        CharLCD('0');
-    else
-    {
-        if(num < 0)                     // Handle negative numbers
-        {
-            num = -num;
-            CharLCD('-');
-        }
-
-        // Convert integer to ASCII digits
-        while(num > 0)
-        {
-            a[i++] = num % 10 + 48;
-            num = num / 10;
-        }
+    u8 a[1 + FMT_U32_MAX + 1];           // Sign, digits, terminator
 
-        // Display digits in correct order
-        for(--i; i >= 0; i--)
-            CharLCD(a[i]);
-    }
+    *Fmt_S32(a, num) = '\0';
+    StrLCD(a);
 }
 
 /* ================= DISPLAY FLOAT ================= */
@@ -125,25 +287,10 @@ void IntLCD(s32 num)
  */
 void FltLCD(f32 fnum)
 {
-    u32 num, i;
+    u8 a[1 + FMT_U32_MAX + 1 + 6 + 1];
 
-    if(fnum < 0)                         // Handle negative value
-    {
-        CharLCD('-');
-        fnum = -fnum;
-    }
-
-    num = fnum;                          // Integer part
-    IntLCD(num);                         // Display integer part
-    CharLCD('.');                        // Decimal point
-
-    // Display 6 digits after decimal
-    for(i = 0; i < 6; i++)
-    {
-        fnum = (fnum - num) * 10;
-        num = fnum;
-        CharLCD(num + 48);
-    }
+    *Fmt_F32(a, fnum, 6) = '\0';        // 6 digits after decimal
+    StrLCD(a);
 }
 
 /* ================= STORE CUSTOM CHARACTER ================= */
@@ -2,33 +2,210 @@
 #include "types.h"          // Custom data types (u8, u32, f32)
 #include "adc.h"            // ADC read functions
 #include "adc_defines.h"    // ADC channel definitions
+#include "lm35.h"           // Sensor table definitions
+#include "stats.h"          // Window statistics
+
+// Filtered, oversampled code of the most recent reading, per channel
+u32 lm35Code[ADC_NUM_CH];
+
+// Raw ADC code of the most recent sample, per channel
+u32 lm35Raw[ADC_NUM_CH];
+
+/* ================= DECIMATOR / FILTER STATE ================= */
+
+static u32 osAcc[ADC_NUM_CH];                  // Oversampling sum
+static u32 osCnt[ADC_NUM_CH];                  // Samples in osAcc
+
+#if LM35_FILTER != LM35_FILT_NONE
+static u16 fltWin[ADC_NUM_CH][LM35_FILT_LEN];  // Recent decimated codes
+static u8  fltPos[ADC_NUM_CH];                 // Next slot in fltWin
+static u8  fltCnt[ADC_NUM_CH];                 // Valid slots in fltWin
+#endif
+#if LM35_FILTER == LM35_FILT_AVG
+static u32 fltSum[ADC_NUM_CH];                 // Running window sum
+#endif
+
+/* ================= CALIBRATION STATE ================= */
+
+// 1 ? channel gain/offset is not identity and must be applied
+static u8 calOn[ADC_NUM_CH];
+
+/* ================= SENSOR CALIBRATION / LIMIT TABLE ================= */
+/*
+ * One entry per AIN channel:
+ *   enabled, gain (Q16), offset (centi-degC), limit (degC)
+ * Only CH1 is fitted on the standard board.
+ */
+SensorCfg sensorCfg[ADC_NUM_CH] =
+{
+    {0, LM35_GAIN_ONE, 0, 45},      // CH0 ? P0.27
+    {1, LM35_GAIN_ONE, 0, 45},      // CH1 ? P0.28
+    {0, LM35_GAIN_ONE, 0, 45},      // CH2 ? P0.29
+    {0, LM35_GAIN_ONE, 0, 45}       // CH3 ? P0.30
+};
+
+/* ================= ENABLED CHANNEL MASK ================= */
+/*
+ * Function: LM35_ChMask
+ * Purpose : Returns a bit mask of enabled sensor channels
+ */
+u32 LM35_ChMask(void)
+{
+    u32 chNo, mask = 0;
+
+    for(chNo = 0; chNo < ADC_NUM_CH; chNo++)
+        if(sensorCfg[chNo].enabled)
+            mask |= (1<<chNo);
+
+    return mask;
+}
+
+/* ================= CALIBRATION SETUP ================= */
+/*
+ * Function: LM35_InitCal
+ * Purpose : Marks every channel whose gain/offset is not
+ *           identity; Read_LM35_Centi applies it to the single
+ *           interpolated result (one multiply per reading, no
+ *           per-channel RAM table)
+ */
+void LM35_InitCal(void)
+{
+    u32 chNo;
+
+    for(chNo = 0; chNo < ADC_NUM_CH; chNo++)
+        calOn[chNo] = (sensorCfg[chNo].gain != LM35_GAIN_ONE) ||
+                      (sensorCfg[chNo].offset != 0);
+}
+
+/* ================= POST FILTER ================= */
+/*
+ * Function: LM35_Filter
+ * Purpose : Applies the configured moving average or median
+ *           to a decimated code (integer only)
+ * Returns : Filtered code
+ */
+static u32 LM35_Filter(u32 chNo, u32 code)
+{
+#if LM35_FILTER == LM35_FILT_NONE
+    return code;
+#else
+    u8 pos = fltPos[chNo];
+
+#if LM35_FILTER == LM35_FILT_AVG
+    // Replace oldest code in running sum
+    if(fltCnt[chNo] == LM35_FILT_LEN)
+        fltSum[chNo] -= fltWin[chNo][pos];
+    fltSum[chNo] += code;
+#endif
+
+    fltWin[chNo][pos] = code;
+    fltPos[chNo] = (pos + 1) % LM35_FILT_LEN;
+    if(fltCnt[chNo] < LM35_FILT_LEN)
+        fltCnt[chNo]++;
+
+#if LM35_FILTER == LM35_FILT_AVG
+    return fltSum[chNo] / fltCnt[chNo];
+#else
+    {
+        u16 s[LM35_FILT_LEN], v;
+        u8  n = fltCnt[chNo], i, j;
+
+        // Insertion sort of the (short) window
+        for(i = 0; i < n; i++)
+        {
+            v = fltWin[chNo][i];
+            for(j = i; (j > 0) && (s[j - 1] > v); j--)
+                s[j] = s[j - 1];
+            s[j] = v;
+        }
+        return s[n / 2];
+    }
+#endif
+#endif
+}
+
+/* ================= COLLECT NEW SAMPLES ================= */
+/*
+ * Function: LM35_Update
+ * Purpose : Drains samples queued by the sampling engine,
+ *           oversamples and decimates every channel, then
+ *           passes each decimated code through the post filter
+ */
+void LM35_Update(void)
+{
+    u32 chNo, adcDVal;     // Channel and raw ADC digital value
+
+    while(ADC_GetSample(&chNo, &adcDVal))
+    {
+        if(chNo >= ADC_NUM_CH)
+            continue;
+
+        lm35Raw[chNo] = adcDVal;
+        osAcc[chNo] += adcDVal;
+
+        if(++osCnt[chNo] == LM35_OSR)
+        {
+            // Sum of 4^n samples >> n ? n extra bits
+            lm35Code[chNo] = LM35_Filter(chNo,
+                                 osAcc[chNo] >> LM35_EXTRA_BITS);
+            osAcc[chNo] = 0;
+            osCnt[chNo] = 0;
+
+            // Aggregate every filtered reading, not just logged ones
+            if(log_stats)
+                Stats_Add(chNo, Read_LM35_Centi(chNo, 'C'));
+        }
+    }
+}
 
 /* ================= LM35 TEMPERATURE READ FUNCTION ================= */
 /*
- * Function: Read_LM35
- * Purpose : Reads temperature from LM35 sensor
- * Args    : tType
+ * Function: Read_LM35_Centi
+ * Purpose : Reads temperature from an LM35 sensor
+ *           using the latest sample collected by LM35_Update
+ * Method  : Table lookup on the 10-bit part of the oversampled
+ *           code, linear interpolation on the extra bits
+ * Args    : chNo  ? ADC channel number
+ *           tType
  *           'C' ? Celsius
  *           'F' ? Fahrenheit
- * Returns : Temperature value as float
+ * Returns : Calibrated temperature in centi-degrees
  */
-f32 Read_LM35(u8 tType)
+s32 Read_LM35_Centi(u32 chNo, u8 tType)
 {
-    u32 adcDVal;           // Stores raw ADC digital value
-    f32 eAR, temp;         // eAR = equivalent analog voltage
+    const s16 *tbl = lm35LutC;
+    u32 code = lm35Code[chNo];
+    u32 idx  = code >> LM35_EXTRA_BITS;
+    u32 frac = code & ((1 << LM35_EXTRA_BITS) - 1);
+    s32 temp;
+
+    // Uncalibrated channel: Fahrenheit comes straight from its table
+    if((tType == 'F') && !calOn[chNo])
+        tbl = lm35LutF;
 
-    // Read ADC value from channel CH1
-    // eAR  ? analog voltage
-    // adcDVal ? digital ADC value
-    Read_ADC(CH1, &eAR, &adcDVal);
+    temp = tbl[idx];
+    if(frac && (idx < LM35_LUT_SIZE - 1))
+        temp += ((tbl[idx + 1] - temp) * (s32)frac) >> LM35_EXTRA_BITS;
 
-    // LM35 gives 10mV per degree Celsius
-    // Multiply voltage by 100 to get temperature in Celsius
-    temp = eAR * 100;
+    if(calOn[chNo])
+    {
+        temp = (s32)(((s64)temp * sensorCfg[chNo].gain) >> 16) +
+               sensorCfg[chNo].offset;
 
-    // Convert Celsius to Fahrenheit if requested
-    if(tType == 'F')
-        temp = ((temp * (9/5.0)) + 32);
+        // Convert Celsius to Fahrenheit if requested
+        if(tType == 'F')
+            temp = ((temp * 9) / 5) + 3200;
+    }
 
     return temp;           // Return temperature value
 }
+
+/* ================= FLOAT COMPATIBILITY ================= */
+/*
+ * Function: Read_LM35
+ * Purpose : Same reading as Read_LM35_Centi, as float degrees
+ */
+f32 Read_LM35(u32 chNo, u8 tType)
+{
+    return Read_LM35_Centi(chNo, tType) / 100.0f;
+}
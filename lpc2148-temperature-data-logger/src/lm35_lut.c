@@ -0,0 +1,42 @@
+// lm35_lut.c
+#include "types.h"          // Custom data types (s16)
+#include "lm35.h"           // Table declarations
+
+/* ================= TABLE GENERATOR MACROS ================= */
+/*
+ * Each entry is evaluated by the compiler from the same formula
+ * Read_LM35 used in floating point:
+ *   degC = code * (3.3 / 1023) * 100
+ *   degF = degC * 9/5 + 32
+ * in centi-degrees, truncated, saturated to the s16 range
+ * (well above the LM35's 150 degC maximum). tests/test_lm35.c
+ * checks every entry and reading against the formula.
+ */
+#define SAT16(v)  (((v) > 32767) ? 32767 : (v))
+
+#define LUT_C(c)  SAT16(((c) * 33000L) / 1023)
+#define LUT_F(c)  SAT16((((c) * 59400L) / 1023) + 3200)
+
+#define C4(c)     LUT_C(c), LUT_C((c)+1), LUT_C((c)+2), LUT_C((c)+3)
+#define C16(c)    C4(c), C4((c)+4), C4((c)+8), C4((c)+12)
+#define C64(c)    C16(c), C16((c)+16), C16((c)+32), C16((c)+48)
+#define C256(c)   C64(c), C64((c)+64), C64((c)+128), C64((c)+192)
+
+#define F4(c)     LUT_F(c), LUT_F((c)+1), LUT_F((c)+2), LUT_F((c)+3)
+#define F16(c)    F4(c), F4((c)+4), F4((c)+8), F4((c)+12)
+#define F64(c)    F16(c), F16((c)+16), F16((c)+32), F16((c)+48)
+#define F256(c)   F64(c), F64((c)+64), F64((c)+128), F64((c)+192)
+
+/* ================= CODE ? CENTI-DEGREE TABLES ================= */
+
+// Raw 10-bit ADC code ? centi-degrees Celsius
+const s16 lm35LutC[LM35_LUT_SIZE] =
+{
+    C256(0), C256(256), C256(512), C256(768)
+};
+
+// Raw 10-bit ADC code ? centi-degrees Fahrenheit
+const s16 lm35LutF[LM35_LUT_SIZE] =
+{
+    F256(0), F256(256), F256(512), F256(768)
+};
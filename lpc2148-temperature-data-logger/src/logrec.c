@@ -0,0 +1,307 @@
+#include "types.h"          // Custom data types (u8, u16, u32, s32)
+#include "uart.h"           // UART transmit functions
+#include "logrec.h"         // Binary log frame definitions
+#include "tscomp.h"         // Compressed series encoder
+
+// Current log output format
+u8 log_format = LOG_FMT_DEFAULT;
+
+/* ================= PENDING FRAME ================= */
+
+// Header (5) + records + CRC (2)
+#define FRAME_MAX (5 + (LOGREC_BATCH * LOGREC_REC_SIZE) + 2)
+
+#if FRAME_MAX > LOGREC_FRAME_MAX + 2
+#error "LOGREC_BATCH too large for LOGREC_FRAME_MAX"
+#endif
+
+static u8  frame[FRAME_MAX];     // Frame being assembled
+static u32 frameLen = 0;         // Bytes used in frame[]
+static u32 frameBase;            // Epoch of first record
+
+/* ================= PENDING PACKED FRAME ================= */
+
+static u8  pk[LOGREC_PK_SIZE + 2];  // Packed frame being assembled
+static u32 pkLen = 0;            // Bytes used in pk[]
+static u32 pkFirst;              // Epoch of first record
+static u8  pkFrames = 0;         // Frames sent since last key frame
+static TSCState pkState;         // Encoder state across frames
+
+/* ================= CRC-16/CCITT ================= */
+/*
+ * Nibble lookup table for polynomial 0x1021
+ */
+static const u16 crcNib[16] =
+{
+    0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7,
+    0x8108, 0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD, 0xE1CE, 0xF1EF
+};
+
+/*
+ * Function: CRC16
+ * Purpose : Updates a CRC-16/CCITT over len bytes
+ * Args    : crc ? start value (0xFFFF for a new frame)
+ */
+u16 CRC16(const u8 *buf, u32 len, u16 crc)
+{
+    while(len--)
+    {
+        crc ^= (u16)(*buf++) << 8;
+        crc = (crc << 4) ^ crcNib[crc >> 12];
+        crc = (crc << 4) ^ crcNib[crc >> 12];
+    }
+    return crc;
+}
+
+/* ================= COBS ENCODER ================= */
+/*
+ * Function: COBS_Encode
+ * Purpose : Consistent Overhead Byte Stuffing, removes all
+ *           0x00 bytes from the frame body
+ */
+u32 COBS_Encode(const u8 *src, u32 len, u8 *dst)
+{
+    u32 out = 1;            // Next output position
+    u32 codePos = 0;        // Position of current code byte
+    u8  code = 1;           // Distance to next zero
+
+    while(len--)
+    {
+        if(*src == 0)
+        {
+            dst[codePos] = code;
+            codePos = out++;
+            code = 1;
+        }
+        else
+        {
+            dst[out++] = *src;
+            if((++code == 0xFF) && len)     // Full block, more to come
+            {
+                dst[codePos] = code;
+                codePos = out++;
+                code = 1;
+            }
+        }
+        src++;
+    }
+    dst[codePos] = code;
+    return out;
+}
+
+/* ================= COBS DECODER ================= */
+/*
+ * Function: COBS_Decode
+ * Purpose : Reverses COBS_Encode (delimiter already removed)
+ * Returns : Decoded length, 0 if the input is malformed
+ */
+u32 COBS_Decode(const u8 *src, u32 len, u8 *dst)
+{
+    u32 in = 0, out = 0;
+    u8  code, i;
+
+    while(in < len)
+    {
+        code = src[in++];
+        if(code == 0)
+            return 0;               // Zero is never encoded
+
+        for(i = 1; i < code; i++)
+        {
+            if(in >= len)
+                return 0;           // Truncated block
+            dst[out++] = src[in++];
+        }
+
+        if((code < 0xFF) && (in < len))
+            dst[out++] = 0;
+    }
+    return out;
+}
+
+/* ================= SEND ANY FRAME ================= */
+/*
+ * Function: LogRec_SendFrame
+ * Purpose : Appends CRC, COBS encodes and queues a frame
+ * Args    : buf ? frame body, with 2 spare bytes for the CRC
+ *           len ? body length (max LOGREC_FRAME_MAX)
+ */
+void LogRec_SendFrame(u8 *buf, u32 len)
+{
+    // Delimiter + encoded body and CRC + delimiter
+    u8  enc[1 + LOGREC_FRAME_MAX + 2 + ((LOGREC_FRAME_MAX + 2) / 254) + 1 + 1];
+    u32 n;
+    u16 crc;
+
+    crc = CRC16(buf, len, 0xFFFF);
+    buf[len++] = crc & 0xFF;
+    buf[len++] = crc >> 8;
+
+    enc[0] = 0x00;                  // Ends any partial data before it
+    n = 1 + COBS_Encode(buf, len, &enc[1]);
+    enc[n++] = 0x00;                // Frame delimiter
+
+    // All or nothing: a cut frame would also corrupt the next one
+    UARTTxBuf(enc, n);
+}
+
+/* ================= SEND FRAME ================= */
+/*
+ * Function: LogRec_PkFlush
+ * Purpose : Sends the pending packed frame
+ */
+static void LogRec_PkFlush(void)
+{
+    if(pkLen == 0)
+        return;
+
+    LogRec_SendFrame(pk, pkLen);
+    pkLen = 0;
+    if(++pkFrames >= LOGREC_KEY_EVERY)
+        pkFrames = 0;               // Next frame is a key frame
+}
+
+/*
+ * Function: LogRec_Flush
+ * Purpose : Sends the pending record frame
+ */
+void LogRec_Flush(void)
+{
+    LogRec_PkFlush();
+
+    if(frameLen == 0)               // Nothing pending
+        return;
+
+    LogRec_SendFrame(frame, frameLen);
+    frameLen = 0;
+}
+
+/* ================= ADD PACKED RECORD ================= */
+/*
+ * Function: LogRec_PkAdd
+ * Purpose : Compresses one sample into the pending packed frame
+ */
+static void LogRec_PkAdd(u32 epoch, s32 centiC, u32 chNo, u16 flags)
+{
+    u32 ref;
+
+    // Start a new frame if the next record might not fit
+    if(pkLen && ((pkLen + TSC_REC_MAX > LOGREC_PK_SIZE) ||
+                 ((pk[4] & LOGREC_PK_COUNT) == LOGREC_PK_COUNT)))
+        LogRec_PkFlush();
+
+    if(pkLen == 0)
+    {
+        if(pkFrames == 0)
+            TSC_Start(&pkState, epoch);     // Key frame
+        ref = pkState.epoch;
+
+        pkFirst = epoch;
+        pk[0] = ref & 0xFF;
+        pk[1] = (ref >> 8) & 0xFF;
+        pk[2] = (ref >> 16) & 0xFF;
+        pk[3] = (ref >> 24) & 0xFF;
+        pk[4] = LOGREC_PACKED | ((pkFrames == 0) ? LOGREC_KEY : 0);
+        pkLen = 5;
+    }
+
+    pkLen += TSC_Encode(&pkState, &pk[pkLen], epoch, centiC, chNo, flags);
+    pk[4]++;
+
+    if(flags & LOGREC_F_ALERT)
+        LogRec_PkFlush();
+}
+
+/* ================= ADD RECORD ================= */
+/*
+ * Function: LogRec_Add
+ * Purpose : Packs one sample into the pending frame
+ */
+void LogRec_Add(u32 epoch, s32 centiC, u32 chNo, u32 code, u16 flags)
+{
+    u16 field;
+
+    if(log_format == LOG_FMT_PACKED)
+    {
+        LogRec_PkAdd(epoch, centiC, chNo, flags);
+        return;
+    }
+
+    // Start a new frame if dt cannot be represented
+    if(frameLen && (epoch - frameBase > 0xFF))
+        LogRec_Flush();
+
+    if(frameLen == 0)
+    {
+        frameBase = epoch;
+        frame[0] = epoch & 0xFF;
+        frame[1] = (epoch >> 8) & 0xFF;
+        frame[2] = (epoch >> 16) & 0xFF;
+        frame[3] = (epoch >> 24) & 0xFF;
+        frame[4] = 0;               // Record count
+        frameLen = 5;
+    }
+
+    field = (code & LOGREC_CODE_MASK) |
+            ((chNo & 3) << LOGREC_CH_BITS) | flags;
+
+    frame[frameLen++] = (u8)(epoch - frameBase);
+    frame[frameLen++] = centiC & 0xFF;
+    frame[frameLen++] = (centiC >> 8) & 0xFF;
+    frame[frameLen++] = field & 0xFF;
+    frame[frameLen++] = field >> 8;
+    frame[4]++;
+
+    // Alerts are sent at once, otherwise fill the batch
+    if((flags & LOGREC_F_ALERT) || (frame[4] == LOGREC_BATCH))
+        LogRec_Flush();
+}
+
+/* ================= AGE CHECK ================= */
+/*
+ * Function: LogRec_Poll
+ * Purpose : Limits how long a partly filled frame is held back
+ */
+void LogRec_Poll(u32 epoch)
+{
+    if(frameLen && (epoch - frameBase >= LOGREC_MAX_AGE))
+        LogRec_Flush();
+    if(pkLen && (epoch - pkFirst >= LOGREC_MAX_AGE))
+        LogRec_PkFlush();
+}
+
+/* ================= SUMMARY FRAME ================= */
+/*
+ * Function: LogRec_PutU16
+ * Purpose : Stores a little-endian 16-bit field
+ */
+static u8 *LogRec_PutU16(u8 *p, u16 v)
+{
+    *p++ = v & 0xFF;
+    *p++ = v >> 8;
+    return p;
+}
+
+/*
+ * Function: LogRec_SendStats
+ * Purpose : Packs and sends one window summary frame
+ */
+void LogRec_SendStats(u32 chNo, const StatsSummary *s)
+{
+    u8 buf[21 + 2];                 // Body + CRC
+    u8 *p = buf;
+
+    p = LogRec_PutU16(p, s->start & 0xFFFF);
+    p = LogRec_PutU16(p, s->start >> 16);
+    *p++ = LOGREC_STATS | (chNo & 3);
+    p = LogRec_PutU16(p, s->n & 0xFFFF);
+    p = LogRec_PutU16(p, s->n >> 16);
+    p = LogRec_PutU16(p, s->mean);
+    p = LogRec_PutU16(p, s->sd);
+    p = LogRec_PutU16(p, s->min);
+    p = LogRec_PutU16(p, s->minOff);
+    p = LogRec_PutU16(p, s->max);
+    p = LogRec_PutU16(p, s->maxOff);
+
+    LogRec_SendFrame(buf, p - buf);
+}
@@ -9,6 +9,15 @@
 #include "lm35.h"         // LM35 temperature sensor functions
 #include "keyPd.h"        // Keypad functions
 #include "edit.h"         // Edit mode functions
+#include "logrec.h"       // Binary log frame format
+#include "flashlog.h"     // Persistent on-chip flash log
+#include "history.h"      // RAM sample history
+#include "download.h"     // History download over UART
+#include "sched.h"        // Cooperative task scheduler
+#include "power.h"        // Power-down between samples
+#include "alarm.h"        // Multi-level alarm engine
+#include "stats.h"        // Per-window aggregation
+#include "prof.h"         // Hot-path profiling (PROF_ENABLE)
 
 /* ================= MACRO DEFINITIONS ================= */
 
@@ -18,33 +27,294 @@
 // Edit switch connected to P0.4
 #define EDIT_SW (1<<4)
 
+/* ================= TASK PERIODS (microseconds) ================= */
+
+#define SAMPLE_PERIOD   100000    // Filter ADC samples, update temp[]
+#define ALERT_PERIOD    100000    // Alarm engine, drive LED (ALM_EVAL_HZ)
+#define DISPLAY_PERIOD  250000    // Redraw time, date and temperature
+#define LOG_PERIOD      200000    // UART/flash logging, download
+#define KEYPAD_PERIOD   50000     // Poll EDIT switch, step edit menus
+#define LCD_PERIOD      50000     // Send changed LCD cells
+#define POWER_PERIOD    250000    // Sleep between samples (power mode)
+
 /* ================= GLOBAL VARIABLES ================= */
 
 // RTC time and date variables
 long int hour, min, sec, date, month, year, day;
 
-// Current temperature value
-volatile f32 temp;
+// Current temperature in centi-degrees C, per sensor channel
+volatile s32 temp[ADC_NUM_CH];
 
 // Flag to indicate edit mode
 volatile u8 edit_flag = 0;
 
-// Stores last minute value for UART logging
-static u8 last_min = 60;
+// Minute rollovers already logged (compared with rtcMinCnt),
+// starts unequal so the first run logs at once
+static u32 last_min_cnt = 0xFFFFFFFF;
+
+// Seconds already shown (compared with rtcSecCnt)
+static u32 last_sec_cnt;
+
+// Channel currently shown on the LCD
+static u32 disp_ch = CH1;
+
+// Highest alarm level of any channel, set by the alert task
+static u8 alert = ALM_NONE;
+
+/* ================= SAMPLE TASK ================= */
+/*
+ * Function: SampleTask
+ * Purpose : Filters new ADC samples and updates temp[]
+ */
+static void SampleTask(void)
+{
+    u32 ch;
+
+    PROF_BEGIN(PROF_LM35);
+
+    // Collect samples converted since the last run
+    LM35_Update();
+
+    // Read temperature of every fitted sensor in Celsius
+    for(ch = 0; ch < ADC_NUM_CH; ch++)
+        if(sensorCfg[ch].enabled)
+            temp[ch] = Read_LM35_Centi(ch, 'C');
+
+    PROF_END(PROF_LM35);
+}
+
+/* ================= ALERT TASK ================= */
+/*
+ * Function: AlertTask
+ * Purpose : Runs the alarm engine on every fitted channel and
+ *           drives the LED: steady for critical or rate alarms,
+ *           blinking for a warning
+ */
+static void AlertTask(void)
+{
+    u32 ch;
+    u8  rate = 0;
+
+    PROF_BEGIN(PROF_ALARM);
+    alert = ALM_NONE;
+    for(ch = 0; ch < ADC_NUM_CH; ch++)
+    {
+        if(!sensorCfg[ch].enabled)
+            continue;
+        Alarm_Eval(ch, temp[ch], (s32)sensorCfg[ch].limit * 100);
+        if(alarmSt[ch].level > alert)
+            alert = alarmSt[ch].level;
+        rate |= alarmSt[ch].rate;
+    }
+    PROF_END(PROF_ALARM);
+
+    /* --------- TEMPERATURE CONTROL --------- */
+    if(alert == ALM_CRIT || rate)
+        IOCLR0 = LED_PIN;             // LED on
+    else if(alert == ALM_WARN)
+    {
+        if(IOPIN0 & LED_PIN)          // Toggle LED
+            IOCLR0 = LED_PIN;
+        else
+            IOSET0 = LED_PIN;
+    }
+    else
+        IOSET0 = LED_PIN;             // LED off
+}
+
+/* ================= DISPLAY TASK ================= */
+/*
+ * Function: DisplayTask
+ * Purpose : Shows time, date, day and one sensor on the LCD
+ */
+static void DisplayTask(void)
+{
+    RTCTime t;
+    u32 ch;
+
+    if(edit_flag)
+        return;
+
+    // Read current time, date and day of week from RTC
+    RTC_ReadTime(&t);
+    hour = t.hour;  min   = t.min;   sec  = t.sec;
+    date = t.dom;   month = t.month; year = t.year;
+    day  = t.dow;
+
+    PROF_BEGIN(PROF_DISP_TIME);
+    DisplayRTCTime(hour, min, sec);
+    PROF_END(PROF_DISP_TIME);
+
+    PROF_BEGIN(PROF_DISP_DATE);
+    DisplayRTCDate(date, month, year);
+    PROF_END(PROF_DISP_DATE);
+
+    PROF_BEGIN(PROF_DISP_DAY);
+    DisplayRTCDay(day);
+    PROF_END(PROF_DISP_DAY);
+
+    // Show the next fitted sensor once per second
+    if(rtcSecCnt != last_sec_cnt)
+    {
+        last_sec_cnt = rtcSecCnt;
+        for(ch = 0; ch < ADC_NUM_CH; ch++)
+        {
+            disp_ch = (disp_ch + 1) % ADC_NUM_CH;
+            if(sensorCfg[disp_ch].enabled)
+                break;
+        }
+    }
+
+    // Display temperature on LCD
+    PROF_BEGIN(PROF_DISP_TEMP);
+    DisplayTemp(disp_ch);
+    PROF_END(PROF_DISP_TEMP);
+}
+
+/* ================= LOG TASK ================= */
+/*
+ * Function: LogTask
+ * Purpose : Logs every minute and on alarm events (rate
+ *           limited by the alarm engine); in aggregation mode
+ *           the UART gets one summary per window instead of the
+ *           minute lines. Also services history download requests
+ */
+static void LogTask(void)
+{
+    RTCTime t;
+    StatsSummary sum;
+    u32 ch, epoch, minCnt;
+    u8  newMin;            // Minute rolled over since last run
+    u8  winEnd;            // Aggregation window complete
+    u8  event;             // Alarm engine asks for a record
+    u16 flags;             // Record flags for this channel
+
+    // One snapshot, so every record of this run has the same time
+    minCnt = rtcMinCnt;
+    RTC_ReadTime(&t);
+    newMin = (minCnt != last_min_cnt);
+    last_min_cnt = minCnt;
+
+    /* --------- UART AND FLASH LOGGING --------- */
+    epoch = RTC_Epoch(&t);
+    winEnd = log_stats && Stats_WindowDone(epoch);
+
+    for(ch = 0; ch < ADC_NUM_CH; ch++)
+    {
+        if(!sensorCfg[ch].enabled)
+            continue;
+
+        // Aggregation mode: one summary replaces the raw samples
+        if(winEnd && Stats_Take(ch, &sum))
+            UARTTX_Stats(ch, &sum);
+
+        event = Alarm_TakeEvents(ch);
+        flags = Alarm_Flags(ch);
+
+        // UART line every minute (replaced by the summary in
+        // aggregation mode), or when the alarm engine asks
+        if(event || (newMin && !log_stats))
+        {
+            PROF_BEGIN(PROF_UART_DATA);
+            UARTTX_Data(ch, flags, t.hour, t.min, t.sec,
+                        t.dom, t.month, t.year);
+            PROF_END(PROF_UART_DATA);
+        }
+
+        // Flash and history keep one record per minute in both modes
+        if(event || newMin)
+        {
+            PROF_BEGIN(PROF_FLASH);
+            FlashLog_Append(epoch, temp[ch], ch, lm35Raw[ch], flags);
+            PROF_END(PROF_FLASH);
+            Hist_Add(epoch, temp[ch], ch, lm35Raw[ch], flags);
+        }
+    }
+
+    if(winEnd)
+        Stats_Begin(epoch);
 
-// Temperature limit for LED control
-u32 TEMP_LIMIT = 45;
+    // Do not hold a partly filled binary frame too long
+    if(log_format != LOG_FMT_TEXT)
+        LogRec_Poll(epoch);
+
+    /* --------- HISTORY DOWNLOAD --------- */
+    Download_Poll();
+
+    // Profiling table requested with the 'P' command
+    PROF_POLL();
+}
+
+/* ================= KEYPAD TASK ================= */
+/*
+ * Function: KeypadTask
+ * Purpose : Enters edit mode while the EDIT switch is held
+ *           for two consecutive runs (debounce) and runs the
+ *           non-blocking edit menus
+ */
+static void KeypadTask(void)
+{
+    static u8 held = 0;
+
+    if((IOPIN0 & EDIT_SW) == 0)   // If edit switch is pressed
+    {
+        if(held)
+            EditStart();          // Enter edit mode
+        held = 1;
+    }
+    else
+        held = 0;
+
+    /* --------- EDIT MODE --------- */
+    EditPoll();                   // Handle queued key events
+}
+
+/* ================= LCD TASK ================= */
+/*
+ * Function: LcdTask
+ * Purpose : Sends the framebuffer cells changed by other tasks
+ */
+static void LcdTask(void)
+{
+    PROF_BEGIN(PROF_LCD_FLUSH);
+    LCD_Flush();
+    PROF_END(PROF_LCD_FLUSH);
+}
+
+/* ================= POWER TASK ================= */
+/*
+ * Function: PowerTask
+ * Purpose : Powers down between samples when power mode is on
+ */
+static void PowerTask(void)
+{
+    Power_Poll();
+}
 
 /* ================= MAIN FUNCTION ================= */
 int main()
 {
-    /* --------- INITIALIZATION SECTION --------- */
+    u32 ch;                // Sensor channel loop index
 
+    /* --------- INITIALIZATION SECTION --------- */
+    Delay_Init();          // Start Timer1 microsecond tick
     RTC_Init();            // Initialize RTC
     InitLCD();             // Initialize LCD
-    Init_ADC(CH1);         // Initialize ADC on channel 1
+    // Initialize ADC pins of every fitted sensor
+    for(ch = 0; ch < ADC_NUM_CH; ch++)
+        if(sensorCfg[ch].enabled)
+            Init_ADC(ch);
+
+    // Fold sensor calibration into the conversion tables
+    LM35_InitCal();
+    Alarm_Init();          // All channels start without alarm
+
+    // Timer0-paced burst scan of all fitted sensors
+    ADC_StartScan(LM35_ChMask(), ADC_SAMPLE_RATE);
     InitUART();            // Initialize UART communication
+    FlashLog_Init();       // Resume flash log after reset/power cut
     KeyPdInit();           // Initialize keypad
+    KeyPd_StartScan();     // Debounced key events from Timer1
 
     // Configure LED as output
     IODIR0 |= LED_PIN;
@@ -61,68 +331,15 @@ int main()
     // Set day of week
     SetRTCDay(5);
 
-    /* ================= SUPER LOOP ================= */
-    while(1)
-    {
-        /* --------- CHECK EDIT SWITCH --------- */
-        if((IOPIN0 & EDIT_SW) == 0)   // If edit switch is pressed
-        {
-            delay_ms(50);             // Debounce delay
-            edit_flag = 1;            // Enter edit mode
-        }
-
-        /* --------- NORMAL MODE --------- */
-        if(edit_flag == 0)
-        {
-            // Read current time from RTC
-            GetRTCTimeInfo(&hour, &min, &sec);
-
-            // Read current date from RTC
-            GetRTCDateInfo(&date, &month, &year);
-
-            // Read day of week
-            GetRTCDay(&day);
-
-            // Display time on LCD
-            DisplayRTCTime(hour, min, sec);
-
-            // Display date on LCD
-            DisplayRTCDate(date, month, year);
-
-            // Display day on LCD
-            DisplayRTCDay(day);
-
-            // Read temperature from LM35 sensor in Celsius
-            temp = Read_LM35('C');
-
-            // Display temperature on LCD
-            DisplayTemp();
-
-            /* --------- TEMPERATURE CONTROL --------- */
-            if(temp > TEMP_LIMIT)     // If temperature exceeds limit
-                IOCLR0 = LED_PIN;     // Turn OFF LED
-            else
-                IOSET0 = LED_PIN;     // Turn ON LED
-
-            /* --------- UART LOGGING --------- */
-            // Send data once every minute
-            if(min != last_min)
-            {
-                last_min = min;
-                UARTTX_Data(hour, min, sec, date, month, year);
-            }
-            // Send UART data if temperature exceeds limit
-            else if(temp > TEMP_LIMIT)
-            {
-                UARTTX_Data(hour, min, sec, date, month, year);
-            }
-        }
-        /* --------- EDIT MODE --------- */
-        else
-        {
-            EditMode();   // Call edit mode function from edit.c
-        }
+    /* ================= TASK TABLE ================= */
+    // Priority order; offsets spread the first releases
+    Sched_Add(SampleTask,  SAMPLE_PERIOD,  0, 0);
+    Sched_Add(AlertTask,   ALERT_PERIOD,   0, 1000);
+    Sched_Add(KeypadTask,  KEYPAD_PERIOD,  0, 2000);
+    Sched_Add(LogTask,     LOG_PERIOD,     0, 3000);
+    Sched_Add(DisplayTask, DISPLAY_PERIOD, 0, 4000);
+    Sched_Add(LcdTask,     LCD_PERIOD,     0, 5000);
+    Sched_Add(PowerTask,   POWER_PERIOD,   0, 6000);
 
-        delay_ms(200);    // Small delay for stability
-    }
+    Sched_Run();           // Never returns
 }
@@ -0,0 +1,165 @@
+#include <LPC214X.H>          // LPC214x microcontroller register definitions
+#include "types.h"            // Custom data types (u8, u32)
+#include "power.h"            // Power mode definitions
+#include "power_defines.h"    // PCON, PLL and schedule constants
+#include "rtc_defines.h"      // RTC clock source bit
+#include "rtc.h"              // Time snapshot and tick counters
+#include "delay.h"            // Microsecond tick
+#include "adc.h"              // Sampling engine stop/start
+#include "uart.h"             // Transmit idle check
+#include "download.h"         // Download in progress
+
+// Flag to indicate edit mode status (main.c)
+extern volatile u8 edit_flag;
+
+// Current power mode
+u8 power_mode = POWER_MODE_DEFAULT;
+
+// Wake-up and charge counters
+PowerStats pwrStats;
+
+static u32 wakeTick;          // Timer1 tick at the last wake-up
+static u32 wakeSecCnt;        // rtcSecCnt at the last wake-up
+
+/* ================= WAKE SCHEDULE ================= */
+/*
+ * Function: Power_NextWake
+ * Purpose : Next wake-up time for a sampling period
+ * Args    : now    ? current epoch second
+ *           period ? sample interval (s), samples fall on
+ *                    multiples of period since 01/01/1970
+ *           lead   ? seconds to wake before the sample
+ */
+u32 Power_NextWake(u32 now, u32 period, u32 lead)
+{
+    u32 next = ((now + lead) / period + 1) * period;
+
+    return next - lead;
+}
+
+/* ================= PLL RESTART ================= */
+/*
+ * Function: PLL_Restart
+ * Purpose : Re-locks and connects the PLL after power-down
+ */
+static void PLL_Restart(void)
+{
+    PLL0CON  = PLLCON_PLLE;             // Enable, not connected
+    PLL0CFG  = PLL_CFG_VAL;
+    PLL0FEED = 0xAA;
+    PLL0FEED = 0x55;
+
+    while(!(PLL0STAT & PLLSTAT_PLOCK)); // Wait for lock
+
+    PLL0CON  = PLLCON_PLLE | PLLCON_PLLC;
+    PLL0FEED = 0xAA;
+    PLL0FEED = 0x55;
+}
+
+/* ================= POWER DOWN ================= */
+/*
+ * Function: Power_Sleep
+ * Purpose : Powers down until the RTC alarm at epoch wake
+ * Returns : 1 ? slept and woke up
+ *           0 ? wake time too close, nothing done
+ */
+static u8 Power_Sleep(u32 wake)
+{
+    RTCTime t;
+    u32 now, awake, ciir;
+
+    /* --------- PROGRAM RTC ALARM --------- */
+    RTC_FromEpoch(wake, &t);
+    AMR    = 0xFF;
+    ALSEC  = t.sec;
+    ALMIN  = t.min;
+    ALHOUR = t.hour;
+    ALDOM  = t.dom;
+    ALMON  = t.month;
+    ALYEAR = t.year;
+    ILR    = ILR_RTCALF;
+    AMR    = AMR_WAKE;
+
+    // A passed alarm would never fire, so check again after arming
+    RTC_ReadTime(&t);
+    now = RTC_Epoch(&t);
+    if((s32)(wake - now) < 2)
+    {
+        AMR = 0xFF;
+        return 0;
+    }
+
+    /* --------- ACCOUNT AWAKE TIME --------- */
+    awake = Tick_Now() - wakeTick;
+    pwrStats.lastAwakeUs = awake;
+    if(awake > pwrStats.maxAwakeUs)
+        pwrStats.maxAwakeUs = awake;
+    if(awake > POWER_WAKE_BUDGET_US)
+        pwrStats.overBudget++;
+    pwrStats.chargeRunUC += (awake / 1000) * POWER_I_RUN_MA;
+
+    /* --------- PERIPHERALS OFF --------- */
+    ADC_Suspend();
+    PCONP &= ~((1<<PCONP_AD0_BIT) | (1<<PCONP_UART0_BIT));
+
+    ciir = CIIR;
+    CIIR = 0;                           // Only the alarm may wake
+    INTWAKE |= (1<<INTWAKE_RTC_BIT);
+
+    PCON = (1<<PCON_PD_BIT);            // Sleep until the alarm
+
+    /* --------- WAKE-UP --------- */
+    PLL_Restart();
+    CIIR = ciir;
+
+    PCONP |= (1<<PCONP_AD0_BIT) | (1<<PCONP_UART0_BIT);
+    ADC_Resume();
+
+    RTC_ReadTime(&t);
+    pwrStats.sleepS     += RTC_Epoch(&t) - now;
+    pwrStats.chargePdUC += (RTC_Epoch(&t) - now) * POWER_I_PD_UA;
+    pwrStats.wakes++;
+    return 1;
+}
+
+/* ================= POWER TASK ================= */
+/*
+ * Function: Power_Poll
+ * Purpose : Sleeps once the scheduled sample has been taken
+ *           Stays awake while editing, downloading or sending
+ */
+void Power_Poll(void)
+{
+    RTCTime t;
+    u32 now;
+
+    if(power_mode != POWER_MODE_SLEEP)
+    {
+        wakeTick   = Tick_Now();
+        wakeSecCnt = rtcSecCnt;
+        return;
+    }
+
+    if(edit_flag || Download_Active() || !UARTTxIdle())
+        return;
+
+    // Allow the lead time and the sample itself to pass
+    if((rtcSecCnt - wakeSecCnt) < (POWER_LEAD_S + POWER_HOLD_S))
+        return;
+
+    if(!(CCR & RTC_CLKSRC))             // RTC would stop with PCLK
+    {
+        pwrStats.refused++;
+        power_mode = POWER_MODE_OFF;
+        return;
+    }
+
+    RTC_ReadTime(&t);
+    now = RTC_Epoch(&t);
+    if(Power_Sleep(Power_NextWake(now + POWER_MIN_SLEEP_S,
+                                  POWER_PERIOD_S, POWER_LEAD_S)))
+    {
+        wakeTick   = Tick_Now();
+        wakeSecCnt = rtcSecCnt;
+    }
+}
@@ -0,0 +1,182 @@
+#include "types.h"          // Custom data types (u8, u32, u64)
+#include "prof.h"           // Region table and macros
+
+#if PROF_ENABLE
+
+#ifdef PROF_HOST
+#include <time.h>           // clock_gettime
+#define PROF_CLK_PER_US 1000
+#else
+#include "delay.h"          // Tick_Cycles
+#include "delay_defines.h"  // TICK_PCLK
+#define PROF_CLK_PER_US (TICK_PCLK / 1000000)
+#endif
+#include "uart.h"           // UART transmit functions
+#include "vic.h"            // Interrupt statistics
+
+// Dump lines: one per region, then one per interrupt slot
+#if VIC_STATS
+#define PROF_DUMP_END   (PROF_NUM + VIC_NUM_SLOTS)
+#else
+#define PROF_DUMP_END   PROF_NUM
+#endif
+
+ProfRegion profTbl[PROF_NUM];
+
+// Region names, in PROF_xxx order
+static const char *const profName[PROF_NUM] =
+{
+    "LM35", "ALARM", "DTIME", "DDATE", "DDAY",
+    "DTEMP", "UARTTX", "FLASH", "LCDFL"
+};
+
+static u8 dumpNext = PROF_DUMP_END; // Next line to send
+static u8 dumpClear;                // Reset after sending
+
+/* ================= CLOCK ================= */
+/*
+ * Function: Prof_Clock
+ * Purpose : Reads the free-running profiling clock
+ */
+u32 Prof_Clock(void)
+{
+#ifdef PROF_HOST
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (u32)ts.tv_sec * 1000000000u + (u32)ts.tv_nsec;
+#else
+    return Tick_Cycles();
+#endif
+}
+
+/* ================= CLOSE ENTRY ================= */
+/*
+ * Function: Prof_End
+ * Purpose : Adds the time since PROF_BEGIN(id) to region id
+ */
+void Prof_End(u32 id)
+{
+    ProfRegion *r = &profTbl[id];
+    u32 dt = Prof_Clock() - r->start;
+
+    if(r->count == 0 || dt < r->min)
+        r->min = dt;
+    if(dt > r->max)
+        r->max = dt;
+    r->total += dt;
+    r->count++;
+}
+
+/* ================= TABLE OUTPUT ================= */
+/*
+ * Function: Prof_Dump
+ * Purpose : Starts sending the table
+ */
+void Prof_Dump(u8 clear)
+{
+    dumpNext  = 0;
+    dumpClear = clear;
+}
+
+// Clock counts to whole microseconds, rounded
+static u32 Prof_Us(u64 t)
+{
+    return (u32)((t + PROF_CLK_PER_US / 2) / PROF_CLK_PER_US);
+}
+
+/*
+ * Function: Prof_Line
+ * Purpose : Sends one region line, all times in microseconds:
+ *           "[PROF] NAME n: x min: x max: x avg: x tot: x us"
+ */
+static void Prof_Line(u32 id)
+{
+    ProfRegion *r = &profTbl[id];
+
+    UARTTxStr("[PROF] ");
+    UARTTxStr((s8 *)profName[id]);
+    UARTTxStr(" n: ");
+    UARTTxU32(r->count);
+    UARTTxStr(" min: ");
+    UARTTxU32(r->count ? Prof_Us(r->min) : 0);
+    UARTTxStr(" max: ");
+    UARTTxU32(Prof_Us(r->max));
+    UARTTxStr(" avg: ");
+    UARTTxU32(r->count ? Prof_Us(r->total / r->count) : 0);
+    UARTTxStr(" tot: ");
+    UARTTxU32(Prof_Us(r->total));
+    UARTTxStr(" us\r\n");
+}
+
+#if VIC_STATS
+/*
+ * Function: Prof_VicLine
+ * Purpose : Sends the interrupt statistics of one used slot:
+ *           "[VIC] SLOTn n: x dur max: x avg: x lat max: x avg: x"
+ */
+static void Prof_VicLine(u32 slot)
+{
+    VicStats v;
+    u32 save;
+
+    save = VIC_Lock(VIC_ALL);       // Consistent copy
+    v = vicStats[slot];
+    VIC_Unlock(save);
+
+    if(v.count == 0)
+        return;
+
+    UARTTxStr("[VIC] SLOT");
+    UARTTxU32(slot);
+    UARTTxStr(" n: ");
+    UARTTxU32(v.count);
+    UARTTxStr(" dur max: ");
+    UARTTxU32(v.durMax);
+    UARTTxStr(" avg: ");
+    UARTTxU32((u32)(v.durTotal / v.count));
+    UARTTxStr(" lat max: ");
+    UARTTxU32(v.latMax);
+    UARTTxStr(" avg: ");
+    UARTTxU32(v.latCount ? (u32)(v.latTotal / v.latCount) : 0);
+    UARTTxStr("\r\n");
+}
+#endif
+
+/*
+ * Function: Prof_Poll
+ * Purpose : Sends one line per region (then per interrupt
+ *           slot), as room in the TX ring allows, so a dump
+ *           never blocks the caller. The dump is text, so it
+ *           is held while the link carries COBS frames
+ */
+void Prof_Poll(void)
+{
+    u32 i;
+
+    if(!UARTTextMode())
+        return;
+
+    while((dumpNext < PROF_DUMP_END) && (UARTTxFree() > PROF_LINE_MAX))
+    {
+        if(dumpNext < PROF_NUM)
+            Prof_Line(dumpNext);
+#if VIC_STATS
+        else
+            Prof_VicLine(dumpNext - PROF_NUM);
+#endif
+
+        if(++dumpNext == PROF_DUMP_END && dumpClear)
+        {
+            for(i = 0; i < PROF_NUM; i++)
+            {
+                profTbl[i].count = 0;
+                profTbl[i].max   = 0;
+                profTbl[i].total = 0;
+            }
+            VIC_ClearStats();
+        }
+    }
+}
+
+#endif   // PROF_ENABLE
@@ -1,11 +1,15 @@
 #include <LPC214X.H>        // LPC214x microcontroller register definitions
 #include "rtc_defines.h"    // RTC register macros and constants
+#include "rtc.h"            // RTC function prototypes
 #include "types.h"          // Custom data types (u8, s32, u32, f32)
 #include "lcd.h"            // LCD display functions
 #include "lm35.h"           // LM35 temperature sensor functions
+#include "edit.h"           // IsLeapYear / GetMaxDays calendar helpers
+#include "fmt.h"            // Number formatting
+#include "vic.h"            // Vectored interrupt registration
 
-// External temperature variable read from LM35
-extern volatile f32 temp;
+// External temperature values (centi-degC) read from LM35 sensors
+extern volatile s32 temp[];
 
 /* ================= DAY NAME LOOKUP TABLE ================= */
 /*
@@ -14,6 +18,39 @@ extern volatile f32 temp;
  */
 u8 week[][4] = {"SUN","MON","TUE","WED","THU","FRI","SAT"};
 
+/* ================= TICK EVENT COUNTERS ================= */
+
+// Seconds and minute rollovers seen by the RTC ISR
+volatile u32 rtcSecCnt = 0;
+volatile u32 rtcMinCnt = 0;
+
+/* ================= RTC ISR ================= */
+/*
+ * Function: RTC_ISR
+ * Purpose : Counter increment interrupt, once per second
+ */
+void RTC_ISR(void) __irq
+{
+    VIC_ISR_ENTER(VIC_PRIO_RTC);
+
+    if(ILR & ILR_RTCCIF)
+    {
+        ILR = ILR_RTCCIF;           // Clear increment flag
+        rtcSecCnt++;
+        if(CT_SEC(CTIME0) == 0)     // Seconds wrapped to 0
+            rtcMinCnt++;
+    }
+
+    if(ILR & ILR_RTCALF)            // Wake-up alarm (power.c)
+    {
+        ILR = ILR_RTCALF;           // Clear alarm flag
+        AMR = 0xFF;                 // One-shot, disable comparison
+    }
+
+    VIC_ISR_EXIT(VIC_PRIO_RTC);
+    VICVectAddr = 0;                // Acknowledge interrupt to VIC
+}
+
 /* ================= RTC INITIALIZATION ================= */
 /*
  * Initializes RTC with prescaler values and enables it
@@ -23,7 +60,89 @@ void RTC_Init(void)
     CCR = RTC_RESET;        // Reset RTC
     PREINT  = PREINT_VAL;   // Set integer prescaler value
     PREFRAC = PREFRAC_VAL;  // Set fractional prescaler value
+
+    AMR  = 0xFF;            // Alarm registers not compared
+    CIIR = CIIR_IMSEC;      // Interrupt on every second
+    ILR  = ILR_RTCCIF | ILR_RTCALF;
+
+    // Install RTC ISR
+    VIC_Register(VIC_RTC_CHNL, VIC_PRIO_RTC, (u32)(unsigned long)RTC_ISR);
+
+#ifdef RTC_USE_XTAL
+    CCR = RTC_ENABLE | RTC_CLKSRC;  // Enable RTC on 32.768 kHz crystal
+#else
     CCR = RTC_ENABLE;       // Enable RTC
+#endif
+}
+
+/* ================= ATOMIC TIME READ ================= */
+/*
+ * Function: RTC_ReadTime
+ * Purpose : Reads a consistent time/date snapshot
+ * Method  : CTIME0 holds the whole time of day and CTIME1 the
+ *           whole date. If CTIME0 changed while CTIME1 was read,
+ *           the date may belong to the next second (midnight),
+ *           so both are read again.
+ */
+void RTC_ReadTime(RTCTime *t)
+{
+    u32 c0, c1;
+
+    do
+    {
+        c0 = CTIME0;
+        c1 = CTIME1;
+    } while(c0 != CTIME0);
+
+    t->sec   = CT_SEC(c0);
+    t->min   = CT_MIN(c0);
+    t->hour  = CT_HOUR(c0);
+    t->dow   = CT_DOW(c0);
+    t->dom   = CT_DOM(c1);
+    t->month = CT_MONTH(c1);
+    t->year  = CT_YEAR(c1);
+}
+
+/*
+ * Function: RTC_FromEpoch
+ * Purpose : Converts seconds since 01/01/1970 to calendar form
+ *           (inverse of RTCToEpoch, same 1970 to 2105 range)
+ */
+void RTC_FromEpoch(u32 epoch, RTCTime *t)
+{
+    u32 days = epoch / 86400;
+    u32 secs = epoch % 86400;
+    u32 y = 1970, m = 1, n;
+
+    t->hour = secs / 3600;
+    t->min  = (secs / 60) % 60;
+    t->sec  = secs % 60;
+    t->dow  = (days + 4) % 7;           // 01/01/1970 was a Thursday
+
+    while(days >= (n = IsLeapYear(y) ? 366 : 365))
+    {
+        days -= n;
+        y++;
+    }
+    while(days >= (n = GetMaxDays(m, y)))
+    {
+        days -= n;
+        m++;
+    }
+
+    t->year  = y;
+    t->month = m;
+    t->dom   = days + 1;
+}
+
+/*
+ * Function: RTC_Epoch
+ * Purpose : Seconds since 01/01/1970 of a snapshot
+ */
+u32 RTC_Epoch(const RTCTime *t)
+{
+    return RTCToEpoch(t->dom, t->month, t->year,
+                      t->hour, t->min, t->sec);
 }
 
 /* ================= READ RTC TIME ================= */
@@ -43,18 +162,12 @@ void GetRTCTimeInfo(s32 *hour, s32 *minute, s32 *second)
  */
 void DisplayRTCTime(u32 hour, u32 minute, u32 second)
 {
-    CmdLCD(0x80);           // Move cursor to first line, first position
-
-    CharLCD(hour/10 + 48);  // Display hour tens digit
-    CharLCD(hour%10 + 48);  // Display hour units digit
-    CharLCD(':');
+    u8 row[8 + 1];          // "HH:MM:SS"
 
-    CharLCD(minute/10 + 48);// Display minute tens digit
-    CharLCD(minute%10 + 48);// Display minute units digit
-    CharLCD(':');
+    CmdLCD(0x80);           // Move cursor to first line, first position
 
-    CharLCD(second/10 + 48);// Display second tens digit
-    CharLCD(second%10 + 48);// Display second units digit
+    *Fmt_Time(row, hour, minute, second) = '\0';
+    StrLCD(row);
 }
 
 /* ================= READ RTC DATE ================= */
@@ -74,17 +187,12 @@ void GetRTCDateInfo(s32 *date, s32 *month, s32 *year)
  */
 void DisplayRTCDate(u32 date, u32 month, u32 year)
 {
-    CmdLCD(0xC0);           // Move cursor to second line
-
-    CharLCD(date/10 + 48);  // Date tens digit
-    CharLCD(date%10 + 48);  // Date units digit
-    CharLCD('/');
+    u8 row[6 + FMT_U32_MAX + 1];    // "DD/MM/" + year
 
-    CharLCD(month/10 + 48); // Month tens digit
-    CharLCD(month%10 + 48); // Month units digit
-    CharLCD('/');
+    CmdLCD(0xC0);           // Move cursor to second line
 
-    IntLCD(year);           // Display full year
+    *Fmt_Date(row, date, month, year) = '\0';
+    StrLCD(row);
 }
 
 /* ================= SET RTC TIME ================= */
@@ -137,16 +245,48 @@ void SetRTCDay(u32 day)
     DOW = day;              // Set day-of-week register
 }
 
+/* ================= CALENDAR TO EPOCH ================= */
+/*
+ * Converts a calendar date and time to seconds since
+ * 00:00:00 01/01/1970 (valid for years 1970 to 2105)
+ */
+u32 RTCToEpoch(u32 date, u32 month, u32 year,
+               u32 hour, u32 minute, u32 second)
+{
+    u32 days = 0, y, m;
+
+    for(y = 1970; y < year; y++)        // Whole years
+        days += IsLeapYear(y) ? 366 : 365;
+
+    for(m = 1; m < month; m++)          // Whole months
+        days += GetMaxDays(m, year);
+
+    days += date - 1;                   // Whole days
+
+    return (days * 86400) + (hour * 3600) + (minute * 60) + second;
+}
+
 /* ================= DISPLAY TEMPERATURE ================= */
 /*
- * Displays temperature value on LCD
+ * Displays temperature value of one sensor channel on LCD
+ * Label is "T:" with a single sensor, else the channel digit
  */
-void DisplayTemp(void)
+void DisplayTemp(u32 chNo)
 {
+    u8 row[2 + 1 + FMT_U32_MAX + 2 + 1];
+    u8 *p = row;
+
     CmdLCD(0x89);           // Set cursor position for temperature
-    StrLCD("T:");           // Display label
 
-    IntLCD((int)temp);      // Display integer part of temperature
-    CharLCD(223);           // Degree symbol
-    CharLCD('C');           // Celsius unit
+    if((LM35_ChMask() & ~(1<<chNo)) == 0)
+        *p++ = 'T';         // Only one sensor fitted
+    else
+        *p++ = chNo + '0';
+    *p++ = ':';
+
+    p = Fmt_S32(p, temp[chNo] / 100);   // Integer part of temperature
+    *p++ = 223;             // Degree symbol
+    *p++ = 'C';             // Celsius unit
+    *p = '\0';
+    StrLCD(row);
 }
@@ -0,0 +1,126 @@
+#include "types.h"          // Custom data types (u8, u32, s32)
+#include "delay.h"          // Microsecond tick and delay_until
+#include "sched.h"          // Scheduler definitions
+
+// Task table, in priority order
+SchedTask schedTask[SCHED_MAX_TASKS];
+
+// Number of entries used in schedTask[]
+u32 schedTaskCnt = 0;
+
+/* ================= ADD TASK ================= */
+/*
+ * Function: Sched_Add
+ * Purpose : Appends a periodic task to the table
+ * Args    : fn       ? task body
+ *           period   ? release interval in microseconds
+ *           deadline ? release-to-finish limit (0 = period)
+ *           offset   ? delay before the first release, used to
+ *                      spread tasks with equal periods
+ */
+u32 Sched_Add(TaskFn fn, u32 period, u32 deadline, u32 offset)
+{
+    SchedTask *t;
+
+    if(schedTaskCnt >= SCHED_MAX_TASKS)
+        return SCHED_MAX_TASKS;
+
+    t = &schedTask[schedTaskCnt];
+    t->fn       = fn;
+    t->period   = period;
+    t->deadline = deadline ? deadline : period;
+    t->release  = Tick_Now() + offset;
+    t->runs = t->misses = t->skips = 0;
+    t->lastUs = t->maxUs = 0;
+
+    return schedTaskCnt++;
+}
+
+/* ================= RUN ONE TASK ================= */
+/*
+ * Function: Sched_RunOnce
+ * Purpose : Runs the first released task in the table
+ * Method  : Execution time and deadline are measured on the
+ *           Timer1 tick. If a task is still behind by a whole
+ *           period after running, the missed releases are
+ *           dropped instead of run back to back.
+ */
+u8 Sched_RunOnce(void)
+{
+    SchedTask *t;
+    u32 i, start, end;
+
+    for(i = 0; i < schedTaskCnt; i++)
+    {
+        t = &schedTask[i];
+        if(!Tick_Expired(t->release))
+            continue;
+
+        start = Tick_Now();
+        t->fn();
+        end = Tick_Now();
+
+        t->runs++;
+        t->lastUs = end - start;
+        if(t->lastUs > t->maxUs)
+            t->maxUs = t->lastUs;
+        if((end - t->release) > t->deadline)
+            t->misses++;
+
+        t->release += t->period;
+        if((s32)(end - t->release) >= (s32)t->period)
+        {
+            t->skips++;
+            t->release = end + t->period;   // Re-phase from now
+        }
+        return 1;
+    }
+    return 0;
+}
+
+/* ================= NEXT RELEASE ================= */
+/*
+ * Function: Sched_NextRelease
+ * Purpose : Finds the earliest pending release tick
+ */
+u32 Sched_NextRelease(void)
+{
+    u32 i, next, now = Tick_Now();
+
+    next = now + 1000000;           // Nothing due within 1 s
+    for(i = 0; i < schedTaskCnt; i++)
+        if((s32)(schedTask[i].release - next) < 0)
+            next = schedTask[i].release;
+    return next;
+}
+
+/* ================= SCHEDULER LOOP ================= */
+/*
+ * Function: Sched_Run
+ * Purpose : Dispatches tasks forever, CPU idles when none is due
+ */
+void Sched_Run(void)
+{
+    while(1)
+    {
+        if(!Sched_RunOnce())
+            delay_until(Sched_NextRelease());
+    }
+}
+
+/* ================= CLEAR STATISTICS ================= */
+/*
+ * Function: Sched_ClearStats
+ * Purpose : Resets run, miss and timing counters
+ */
+void Sched_ClearStats(void)
+{
+    u32 i;
+
+    for(i = 0; i < schedTaskCnt; i++)
+    {
+        schedTask[i].runs = schedTask[i].misses = 0;
+        schedTask[i].skips = 0;
+        schedTask[i].lastUs = schedTask[i].maxUs = 0;
+    }
+}
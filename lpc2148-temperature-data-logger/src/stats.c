@@ -0,0 +1,163 @@
+#include "types.h"          // Custom data types (u16, s32, u32, u64)
+#include "stats.h"          // Aggregation definitions
+#include "rtc.h"            // Seconds counter for min/max offsets
+
+// Aggregation on/off and window length (seconds)
+u8  log_stats    = STATS_DEFAULT;
+u32 stats_window = STATS_WINDOW_S;
+
+static StatsAcc acc[STATS_NUM_CH];  // Per-channel accumulators
+static u32 winStart;                // Epoch of window start
+static u32 winSec;                  // rtcSecCnt at window start
+static u8  winValid = 0;            // A window has been started
+
+/* ================= RESET ONE CHANNEL ================= */
+/*
+ * Function: Stats_Clear
+ * Purpose : Empties the accumulator of one channel
+ */
+static void Stats_Clear(StatsAcc *a)
+{
+    a->n    = 0;
+    a->mean = 0;
+    a->rem  = 0;
+    a->m2   = 0;
+    a->min  = 0x7FFF;
+    a->max  = -0x8000;
+}
+
+/* ================= ADD ONE SAMPLE ================= */
+/*
+ * Function: Stats_Add
+ * Purpose : Welford update of mean and M2, plus extremes
+ * Method  : delta  = x - mean_old
+ *           mean  += delta / n  (remainder carried to next step)
+ *           M2    += delta * (x - mean_new)
+ *           The two deltas have the same sign, so M2 never
+ *           decreases and cannot go negative through rounding
+ */
+void Stats_Add(u32 chNo, s32 centiC)
+{
+    StatsAcc *a;
+    s32 x, d1, d2, q;
+    u16 off;
+
+    if(chNo >= STATS_NUM_CH)
+        return;
+    a = &acc[chNo];
+
+    x  = centiC << STATS_Q;
+    a->n++;
+    d1 = x - a->mean;
+    q  = (d1 + a->rem) / (s32)a->n;
+    a->rem   = (d1 + a->rem) - q * (s32)a->n;
+    a->mean += q;
+    d2 = x - a->mean;
+    if((d1 ^ d2) >= 0)                  // Same sign (or zero)
+        a->m2 += (u64)((s64)d1 * d2);
+
+    off = (u16)(rtcSecCnt - winSec);
+    if(centiC < a->min)
+    {
+        a->min = centiC;
+        a->minOff = off;
+    }
+    if(centiC > a->max)
+    {
+        a->max = centiC;
+        a->maxOff = off;
+    }
+}
+
+/* ================= WINDOW CONTROL ================= */
+/*
+ * Function: Stats_Begin
+ * Purpose : Starts a window at epoch for all channels
+ */
+void Stats_Begin(u32 epoch)
+{
+    u32 ch;
+
+    for(ch = 0; ch < STATS_NUM_CH; ch++)
+        Stats_Clear(&acc[ch]);
+    winStart = epoch - (epoch % stats_window);  // Align to window
+    winSec   = rtcSecCnt - (epoch % stats_window);
+    winValid = 1;
+}
+
+/*
+ * Function: Stats_Reset
+ * Purpose : Drops the current window so the next one is
+ *           started (and aligned) by Stats_WindowDone
+ */
+void Stats_Reset(void)
+{
+    winValid = 0;
+}
+
+/*
+ * Function: Stats_WindowDone
+ * Purpose : Checks whether the current window has ended
+ */
+u8 Stats_WindowDone(u32 epoch)
+{
+    if(!winValid)
+    {
+        Stats_Begin(epoch);
+        return 0;
+    }
+    return (epoch - winStart) >= stats_window;
+}
+
+/*
+ * Function: Stats_Take
+ * Purpose : Converts an accumulator to a summary record
+ */
+u8 Stats_Take(u32 chNo, StatsSummary *s)
+{
+    StatsAcc *a = &acc[chNo];
+    u32 sd = 0;
+
+    if(a->n == 0)
+        return 0;
+
+    // Sample variance (Q16) -> standard deviation (Q8) -> centi
+    if(a->n > 1)
+        sd = ISqrt64(a->m2 / (a->n - 1));
+
+    s->start  = winStart;
+    s->n      = a->n;
+    s->mean   = (a->mean + (1 << (STATS_Q - 1))) >> STATS_Q;
+    s->sd     = (sd + (1 << (STATS_Q - 1))) >> STATS_Q;
+    s->min    = a->min;
+    s->max    = a->max;
+    s->minOff = a->minOff;
+    s->maxOff = a->maxOff;
+    return 1;
+}
+
+/* ================= INTEGER SQUARE ROOT ================= */
+/*
+ * Function: ISqrt64
+ * Purpose : floor(sqrt(v)), bit by bit (no division)
+ */
+u32 ISqrt64(u64 v)
+{
+    u64 res = 0, bit = (u64)1 << 62;
+
+    while(bit > v)
+        bit >>= 2;
+
+    while(bit)
+    {
+        if(v >= res + bit)
+        {
+            v  -= res + bit;
+            res = (res >> 1) + bit;
+        }
+        else
+            res >>= 1;
+        bit >>= 2;
+    }
+    return (u32)res;
+}
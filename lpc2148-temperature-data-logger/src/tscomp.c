@@ -0,0 +1,143 @@
+#include "types.h"          // Custom data types (u8, u16, u32, s16, s32)
+#include "logrec.h"         // Record field layout
+#include "tscomp.h"         // Compressed series format
+
+/* ================= ZIG-ZAG VARINT ================= */
+/*
+ * Function: TSC_PutVar
+ * Purpose : Writes a signed value as a zig-zag varint
+ * Returns : Bytes written (1..5)
+ */
+static u32 TSC_PutVar(u8 *p, s32 v)
+{
+    u32 z = ((u32)v << 1) ^ (u32)(v >> 31);
+    u32 n = 0;
+
+    while(z >= 0x80)
+    {
+        p[n++] = (z & 0x7F) | 0x80;
+        z >>= 7;
+    }
+    p[n++] = z;
+    return n;
+}
+
+/*
+ * Function: TSC_GetVar
+ * Purpose : Reads a zig-zag varint
+ * Returns : Bytes consumed, 0 if truncated or over 5 bytes
+ */
+static u32 TSC_GetVar(const u8 *p, u32 len, s32 *v)
+{
+    u32 z = 0, n = 0, shift = 0;
+    u8  b;
+
+    do
+    {
+        if((n >= len) || (n >= 5))
+            return 0;
+        b = p[n++];
+        z |= (u32)(b & 0x7F) << shift;
+        shift += 7;
+    } while(b & 0x80);
+
+    *v = (s32)(z >> 1) ^ -(s32)(z & 1);
+    return n;
+}
+
+/* ================= KEYFRAME ================= */
+/*
+ * Function: TSC_Start
+ * Purpose : Resets the stream state to a block start
+ */
+void TSC_Start(TSCState *s, u32 base)
+{
+    u32 i;
+
+    s->epoch = base;
+    s->delta = 0;
+    for(i = 0; i < TSC_NUM_CH; i++)
+        s->temp[i] = 0;
+}
+
+/* ================= ENCODER ================= */
+/*
+ * Function: TSC_Encode
+ * Purpose : Appends one record to a compressed block
+ */
+u32 TSC_Encode(TSCState *s, u8 *dst, u32 epoch, s32 centiC,
+               u32 chNo, u16 flags)
+{
+    s32 delta, dtemp;
+    u32 n = 1;
+    u8  tag;
+
+    chNo &= TSC_NUM_CH - 1;
+    tag = chNo | ((flags >> TSC_FLAG_SHIFT) & 0xF0);
+
+    // Time: nothing for a repeat, else change of the interval
+    if(epoch == s->epoch)
+        tag |= TSC_T_SAME;
+    else
+    {
+        delta = (s32)(epoch - s->epoch);
+        n += TSC_PutVar(&dst[n], delta - s->delta);
+        s->delta = delta;
+        s->epoch = epoch;
+    }
+
+    // Temperature: change since the last record of this channel
+    dtemp = centiC - s->temp[chNo];
+    if(dtemp == 0)
+        tag |= TSC_T_ZERO;
+    else
+    {
+        n += TSC_PutVar(&dst[n], dtemp);
+        s->temp[chNo] = centiC;
+    }
+
+    dst[0] = tag;
+    return n;
+}
+
+/* ================= DECODER ================= */
+/*
+ * Function: TSC_Decode
+ * Purpose : Reverses TSC_Encode for one record
+ */
+u32 TSC_Decode(TSCState *s, const u8 *src, u32 len, FlashRec *rec)
+{
+    u32 n = 1, k, chNo;
+    s32 v;
+    u8  tag;
+
+    if(len == 0)
+        return 0;
+    tag  = src[0];
+    chNo = tag & (TSC_NUM_CH - 1);
+
+    if(!(tag & TSC_T_SAME))
+    {
+        k = TSC_GetVar(&src[n], len - n, &v);
+        if(k == 0)
+            return 0;
+        n += k;
+        s->delta += v;
+        s->epoch += s->delta;
+    }
+
+    if(!(tag & TSC_T_ZERO))
+    {
+        k = TSC_GetVar(&src[n], len - n, &v);
+        if(k == 0)
+            return 0;
+        n += k;
+        s->temp[chNo] += v;
+    }
+
+    rec->epoch = s->epoch;
+    rec->temp  = s->temp[chNo];
+    rec->code  = (chNo << LOGREC_CH_BITS) |
+                 ((u16)(tag & 0xF0) << TSC_FLAG_SHIFT);
+    return n;
+}
@@ -2,18 +2,221 @@
 #include "UART.h"         // UART function prototypes
 #include "types.h"        // Custom data types (u32, f32, s8, etc.)
 #include "pinconnect.h"   // Pin function configuration function
+#include "uart_defines.h" // UART register bits and ring configuration
+#include "adc_defines.h"  // PCLK clock definition
+#include "logrec.h"       // Binary log frame format
+#include "lm35.h"         // Sensor table and raw ADC codes
+#include "rtc.h"          // Calendar to epoch conversion
+#include "download.h"     // Download in progress check
+#include "stats.h"        // Window summary records
+#include "fmt.h"          // Number and record formatting
+#include "vic.h"          // Vectored interrupt registration
 
-// External temperature value
-extern volatile f32 temp;
+// External temperature values (centi-degC), per sensor channel
+extern volatile s32 temp[];
 
-// External temperature limit
-extern u32 TEMP_LIMIT;
+/* ================= SUPPORTED BAUD RATES ================= */
+/*
+ * Rates offered in the edit menu, selected by index 1-6
+ * 460800 is left out: above PCLK / 48 the fractional divider
+ * cannot be used (DL >= 3), and DL = 2 is 1.7% fast
+ */
+const u32 uartBaudTbl[UART_BAUD_COUNT] =
+{
+    9600, 19200, 38400, 57600, 115200, 230400
+};
+
+// Baud rate currently programmed into UART0
+u32 uartBaud = 0;
+
+/* ================= TRANSMIT RING BUFFER ================= */
+/*
+ * Single-producer / single-consumer ring:
+ * txHead is advanced only by the main program (producer),
+ * txTail is advanced only by the UART0 ISR (consumer).
+ * Both are free-running and masked on access.
+ */
+#define UART_TX_MASK (UART_TX_BUF_SIZE - 1)
+
+static volatile u8  txBuf[UART_TX_BUF_SIZE];
+static volatile u32 txHead = 0;
+static volatile u32 txTail = 0;
+
+// Number of bytes discarded because the ring was full
+volatile u32 uartTxDropCnt = 0;
+
+// Highest ring occupancy seen since start-up
+u32 uartTxHighWater = 0;
+
+/* ================= RECEIVE RING BUFFER ================= */
+/*
+ * rxHead is advanced only by the UART0 ISR (producer),
+ * rxTail only by the main program (consumer)
+ */
+#define UART_RX_MASK (UART_RX_BUF_SIZE - 1)
+
+static volatile u8  rxBuf[UART_RX_BUF_SIZE];
+static volatile u32 rxHead = 0;
+static volatile u32 rxTail = 0;
+
+// Received bytes lost because the ring was full
+volatile u32 uartRxDropCnt = 0;
+
+/* ================= FILL TX FIFO ================= */
+/*
+ * Function: UARTTxFill
+ * Purpose : Moves up to UART_TX_CHUNK bytes from the ring
+ *           into the UART0 transmit FIFO
+ * Note    : Called from the ISR, or from the producer with
+ *           the THRE interrupt masked
+ */
+static void UARTTxFill(void)
+{
+    u32 n = UART_TX_CHUNK;
+
+    while(n-- && (txTail != txHead))
+    {
+        U0THR = txBuf[txTail & UART_TX_MASK];
+        txTail++;
+    }
+}
+
+/* ================= UART0 INTERRUPT SERVICE ROUTINE ================= */
+/*
+ * Function: UART0_ISR
+ * Purpose : Refills the TX FIFO each time it runs empty
+ *           and moves received bytes into the RX ring
+ */
+void UART0_ISR(void) __irq
+{
+    u32 iir;
+
+    VIC_ISR_ENTER(VIC_PRIO_UART0);
+
+    // Reading U0IIR also clears a pending THRE interrupt
+    while(!((iir = U0IIR) & IIR_NONE))
+    {
+        switch(iir & IIR_ID_MASK)
+        {
+            case IIR_THRE:
+                UARTTxFill();
+                break;
+
+            case IIR_RDA:
+            case IIR_CTI:
+                while(U0LSR & (1<<RDR_BIT))
+                {
+                    if((rxHead - rxTail) >= UART_RX_BUF_SIZE)
+                    {
+                        (void)U0RBR;        // Discard, ring full
+                        uartRxDropCnt++;
+                    }
+                    else
+                    {
+                        rxBuf[rxHead & UART_RX_MASK] = U0RBR;
+                        rxHead++;
+                    }
+                }
+                break;
+
+            default:                        // Line status: clear it
+                (void)U0LSR;
+                break;
+        }
+    }
+
+    VIC_ISR_EXIT(VIC_PRIO_UART0);
+    VICVectAddr = 0;            // Acknowledge interrupt to VIC
+}
+
+/* ================= BAUD RATE CALCULATION ================= */
+/*
+ * Function: UARTCalcBaud
+ * Purpose : Finds the divisor latch and fractional divider
+ *           giving the closest rate to baud from PCLK
+ * Args    : baud ? required baud rate
+ *           dl   ? pointer to store divisor latch (DLM:DLL)
+ *           fdr  ? pointer to store U0FDR value
+ * Returns : Rate error in units of 0.01%
+ */
+u32 UARTCalcBaud(u32 baud, u32 *dl, u32 *fdr)
+{
+    u32 mul, div, d, act, diff;
+    u32 bestErr = 0xFFFFFFFF;
+
+    *dl  = 0;
+    *fdr = (1<<MULVAL_BITS);            // Divider bypassed
+
+    for(mul = 1; mul <= 15; mul++)
+    {
+        for(div = 0; div < mul; div++)
+        {
+            // Rounded DL = PCLK * mul / (16 * baud * (mul + div))
+            d = ((2 * PCLK * mul) / (16 * baud * (mul + div)) + 1) / 2;
+
+            // DL must be at least 3 when the divider is used
+            if((d == 0) || (d > 0xFFFF) || (div && (d < 3)))
+                continue;
+
+            act  = (PCLK * mul) / (16 * d * (mul + div));
+            diff = (act > baud) ? (act - baud) : (baud - act);
+            diff = (diff * 1000) / (baud / 10);
+
+            if(diff < bestErr)
+            {
+                bestErr = diff;
+                *dl  = d;
+                *fdr = (mul<<MULVAL_BITS) | (div<<DIVADDVAL_BITS);
+            }
+        }
+    }
+    return bestErr;
+}
+
+/* ================= BAUD RATE SELECTION ================= */
+/*
+ * Function: UARTSetBaud
+ * Purpose : Reprograms UART0 to a new baud rate
+ * Returns : 1 ? rate set
+ *           0 ? rate error above UART_BAUD_MAX_ERR, unchanged
+ */
+u8 UARTSetBaud(u32 baud)
+{
+    u32 dl, fdr, save;
+
+    if(UARTCalcBaud(baud, &dl, &fdr) > UART_BAUD_MAX_ERR)
+        return 0;
+
+    // Let queued characters leave at the old rate
+    if(uartBaud)
+        UARTTxFlush();
+
+    // While DLAB is set U0RBR reads DLL, so a receive interrupt
+    // in this window would spin on RDR in UART0_ISR for ever
+    save = VIC_Lock(1<<VIC_UART0_CHNL);
+
+    // Enable access to Divisor Latch Registers
+    U0LCR = (1<<DLAB_BIT) | UART_8N1;
+
+    U0DLL = dl & 0xFF;
+    U0DLM = dl >> 8;
+    U0FDR = fdr;
+
+    // 8-bit data, 1 stop bit, no parity
+    U0LCR = UART_8N1;
+
+    VIC_Unlock(save);
+
+    uartBaud = baud;
+    return 1;
+}
 
 /* ================= UART INITIALIZATION ================= */
 /*
  * Function: InitUART
  * Purpose : Initializes UART0 for serial communication
- *           with 9600 baud rate (assuming PCLK)
+ *           at UART_BAUD_DEFAULT with interrupt-driven
+ *           transmission
  */
 void InitUART()
 {
@@ -21,29 +224,118 @@ void InitUART()
     CfgPinFunc(0, 0, 1);
     CfgPinFunc(0, 1, 1);
 
-    // Enable access to Divisor Latch Registers
-    U0LCR = 0x83;
+    // Set baud rate divisors, 8-bit data, 1 stop bit, no parity
+    UARTSetBaud(UART_BAUD_DEFAULT);
 
-    // Set baud rate divisor (9600 baud)
-    U0DLL = 97;
-    U0DLM = 0;
+    // Enable and reset the 16-byte FIFOs
+    U0FCR = FIFO_EN_RESET;
 
-    // 8-bit data, 1 stop bit, no parity
-    U0LCR = 0x03;
+    // Install UART0 ISR
+    VIC_Register(VIC_UART0_CHNL, VIC_PRIO_UART0, (u32)(unsigned long)UART0_ISR);
+
+    // Enable THRE and receive interrupts
+    U0IER = (1<<THRE_IE_BIT) | (1<<RBR_IE_BIT);
+}
+
+/* ================= RECEIVE SINGLE CHARACTER ================= */
+/*
+ * Function: UARTRxGet
+ * Purpose : Takes one received byte without blocking
+ * Returns : 1 ? byte stored in *ch
+ *           0 ? nothing received
+ */
+u8 UARTRxGet(u8 *ch)
+{
+    if(rxTail == rxHead)
+        return 0;
+
+    *ch = rxBuf[rxTail & UART_RX_MASK];
+    rxTail++;                   // Release slot to the ISR
+    return 1;
+}
+
+/* ================= QUEUE SINGLE CHARACTER ================= */
+/*
+ * Function: UARTTxEnq
+ * Purpose : Queues a character for transmission without blocking
+ * Returns : 1 ? queued (possibly after dropping the oldest byte)
+ *           0 ? dropped (UART_TX_DROP_NEW policy, ring full)
+ */
+u8 UARTTxEnq(u8 ch)
+{
+    u32 used = txHead - txTail;
+
+    if(used >= UART_TX_BUF_SIZE)
+    {
+        uartTxDropCnt++;
+#if UART_TX_POLICY == UART_TX_OVERWRITE
+        // Consumer index must not move under the ISR
+        U0IER &= ~(1<<THRE_IE_BIT);
+        txTail++;
+        U0IER |= (1<<THRE_IE_BIT);
+        used--;
+#else
+        return 0;
+#endif
+    }
+
+    txBuf[txHead & UART_TX_MASK] = ch;
+    txHead++;                   // Publish byte to the ISR
+
+    if(++used > uartTxHighWater)
+        uartTxHighWater = used;
+
+    // Transmitter idle: no THRE interrupt will come, prime the FIFO
+    if(U0LSR & (1<<THRE_BIT))
+    {
+        U0IER &= ~(1<<THRE_IE_BIT);
+        if(U0LSR & (1<<THRE_BIT))
+            UARTTxFill();
+        U0IER |= (1<<THRE_IE_BIT);
+    }
+    return 1;
+}
+
+/* ================= TRANSMIT RING SPACE ================= */
+/*
+ * Function: UARTTxFree
+ * Purpose : Returns the number of bytes that can be queued
+ *           without dropping
+ */
+u32 UARTTxFree(void)
+{
+    return UART_TX_BUF_SIZE - (txHead - txTail);
 }
 
 /* ================= TRANSMIT SINGLE CHARACTER ================= */
 /*
  * Function: UARTTxChar
  * Purpose : Transmits a single character via UART
+ *           (queued to the transmit ring, does not block)
  */
 void UARTTxChar(s8 ch)
 {
-    // Wait until Transmit Holding Register is empty
-    while(!(U0LSR & (1<<5)));   // THRE bit
+    UARTTxEnq((u8)ch);
+}
 
-    // Load character into transmit register
-    U0THR = ch;
+/* ================= WAIT FOR TRANSMIT COMPLETE ================= */
+/*
+ * Function: UARTTxFlush
+ * Purpose : Blocks until the ring and the UART shifter are empty
+ */
+void UARTTxFlush(void)
+{
+    while(txTail != txHead);            // Ring drained by ISR
+    while(!(U0LSR & (1<<TEMT_BIT)));    // Shifter empty
+}
+
+/*
+ * Function: UARTTxIdle
+ * Purpose : Returns 1 when nothing is queued or being sent
+ */
+u8 UARTTxIdle(void)
+{
+    return (txTail == txHead) && (U0LSR & (1<<TEMT_BIT));
 }
 
 /* ================= TRANSMIT STRING ================= */
@@ -57,32 +349,85 @@ void UARTTxStr(s8 *ptr)
         UARTTxChar(*ptr++);
 }
 
-/* ================= TRANSMIT UNSIGNED INTEGER ================= */
+/* ================= TRANSMIT BUFFER ================= */
 /*
- * Function: UARTTxU32
- * Purpose : Transmits unsigned 32-bit integer via UART
+ * Function: UARTTxBuf
+ * Purpose : Queues a complete line or record in one call
+ * Returns : 1 ? queued
+ *           0 ? dropped whole (UART_TX_DROP_NEW policy, not
+ *               enough room), so a line is never cut short
  */
-void UARTTxU32(u32 num)
+u8 UARTTxBuf(const u8 *buf, u32 len)
 {
-    char buf[10];              // Buffer to store digits
-    int i = 0;
+#if UART_TX_POLICY == UART_TX_OVERWRITE
+    while(len--)
+        UARTTxEnq(*buf++);
+    return 1;
+#else
+    u32 used;
 
-    if(num == 0)               // Handle zero explicitly
+    if(len > UARTTxFree())
     {
-        UARTTxChar('0');
-        return;
+        uartTxDropCnt += len;
+        return 0;
     }
 
-    // Convert number to ASCII digits (reverse order)
-    while(num)
+    while(len--)
     {
-        buf[i++] = num % 10 + '0';
-        num /= 10;
+        txBuf[txHead & UART_TX_MASK] = *buf++;
+        txHead++;               // Publish byte to the ISR
     }
 
-    // Transmit digits in correct order
-    while(i--)
-        UARTTxChar(buf[i]);
+    used = txHead - txTail;
+    if(used > uartTxHighWater)
+        uartTxHighWater = used;
+
+    // Transmitter idle: no THRE interrupt will come, prime the FIFO
+    if(U0LSR & (1<<THRE_BIT))
+    {
+        U0IER &= ~(1<<THRE_IE_BIT);
+        if(U0LSR & (1<<THRE_BIT))
+            UARTTxFill();
+        U0IER |= (1<<THRE_IE_BIT);
+    }
+    return 1;
+#endif
+}
+
+/* ================= OPERATOR MESSAGES ================= */
+/*
+ * Function: UARTTextMode
+ * Purpose : Returns 1 while the link carries text, 0 while it
+ *           carries COBS frames (binary or packed log format,
+ *           or a history download)
+ */
+u8 UARTTextMode(void)
+{
+    return (log_format == LOG_FMT_TEXT) && !Download_Active();
+}
+
+/*
+ * Function: UARTTxMsg
+ * Purpose : Transmits an operator message in text mode only;
+ *           text between frames would be glued onto the next
+ *           frame and make it fail its CRC
+ */
+void UARTTxMsg(s8 *ptr)
+{
+    if(UARTTextMode())
+        UARTTxStr(ptr);
+}
+
+/* ================= TRANSMIT UNSIGNED INTEGER ================= */
+/*
+ * Function: UARTTxU32
+ * Purpose : Transmits unsigned 32-bit integer via UART
+ */
+void UARTTxU32(u32 num)
+{
+    u8 buf[FMT_U32_MAX];
+
+    UARTTxBuf(buf, Fmt_U32(buf, num) - buf);
 }
 
 /* ================= TRANSMIT FLOAT ================= */
@@ -92,75 +437,136 @@ void UARTTxU32(u32 num)
  */
 void UARTTxF32(f32 fnum)
 {
-    u32 ipart;
-    u8 i;
+    u8 buf[1 + FMT_U32_MAX + 1 + 2];
 
-    // Handle negative number
-    if(fnum < 0)
-    {
-        UARTTxChar('-');
-        fnum = -fnum;
-    }
+    UARTTxBuf(buf, Fmt_F32(buf, fnum, 2) - buf);
+}
 
-    // Extract integer part
-    ipart = (u32)fnum;
-    UARTTxU32(ipart);
-    UARTTxChar('.');
+/* ================= TRANSMIT FIXED-POINT VALUE ================= */
+/*
+ * Function: UARTTxCenti
+ * Purpose : Transmits a centi-unit value as a number with
+ *           2 decimal places (3250 ? "32.50")
+ */
+void UARTTxCenti(s32 val)
+{
+    u8 buf[1 + FMT_U32_MAX + 1 + 2];
 
-    // Extract and transmit fractional part (2 digits)
-    fnum = fnum - ipart;
-    for(i = 0; i < 2; i++)
-    {
-        fnum *= 10;
-        UARTTxChar((u8)fnum + '0');
-        fnum -= (u8)fnum;
-    }
+    UARTTxBuf(buf, Fmt_Centi(buf, val) - buf);
+}
+
+/* ================= FORMAT TIMESTAMP ================= */
+/*
+ * Function: FmtStamp
+ * Purpose : Writes "HH:MM:SS DD/MM/YYYY"
+ */
+static u8 *FmtStamp(u8 *p, u32 hour, u32 min, u32 sec,
+                    u32 date, u32 month, u32 year)
+{
+    p = Fmt_Time(p, hour, min, sec);
+    *p++ = ' ';
+    return Fmt_Date(p, date, month, year);
 }
 
 /* ================= TRANSMIT FULL SYSTEM DATA ================= */
 /*
  * Function: UARTTX_Data
- * Purpose : Transmits temperature, time, and date information
- *           with alert/status indication
+ * Purpose : Transmits temperature of one sensor channel, time,
+ *           and date information with alert/status indication
+ *           The line is built in a buffer and queued at once
+ * Args    : flags ? LOGREC_F_xxx alarm state (Alarm_Flags)
  */
-void UARTTX_Data(u32 hour, u32 min, u32 sec,
+void UARTTX_Data(u32 chNo, u16 flags, u32 hour, u32 min, u32 sec,
                  u32 date, u32 month, u32 year)
 {
-    // Display ALERT or INFO based on temperature limit
-    if(temp > TEMP_LIMIT)
-        UARTTxStr("[ALERT] ");
+    u8 line[FMT_LINE_MAX];
+    u8 *p = line;
+
+    // The link belongs to the history download until it ends
+    if(Download_Active())
+        return;
+
+    // Binary mode: pack the sample into a COBS frame instead
+    if(log_format != LOG_FMT_TEXT)
+    {
+        LogRec_Add(RTCToEpoch(date, month, year, hour, min, sec),
+                   temp[chNo], chNo, lm35Raw[chNo], flags);
+        return;
+    }
+
+    // Display ALERT, WARN or INFO based on alarm state
+    if(flags & LOGREC_F_ALERT)
+        p = Fmt_Str(p, "[ALERT] ");
+    else if(flags & LOGREC_F_WARN)
+        p = Fmt_Str(p, "[WARN] ");
     else
-        UARTTxStr("[INFO] ");
-
-    // Transmit temperature
-    UARTTxStr("Temp: ");
-    UARTTxF32(temp);
-    UARTTxStr(" C | ");
-
-    // Transmit time in HH:MM:SS format
-    UARTTxChar(hour/10 + '0');
-    UARTTxChar(hour%10 + '0');
-    UARTTxChar(':');
-    UARTTxChar(min/10 + '0');
-    UARTTxChar(min%10 + '0');
-    UARTTxChar(':');
-    UARTTxChar(sec/10 + '0');
-    UARTTxChar(sec%10 + '0');
-    UARTTxStr(" ");
-
-    // Transmit date in DD/MM/YYYY format
-    UARTTxChar(date/10 + '0');
-    UARTTxChar(date%10 + '0');
-    UARTTxChar('/');
-    UARTTxChar(month/10 + '0');
-    UARTTxChar(month%10 + '0');
-    UARTTxChar('/');
-    UARTTxU32(year);
-
-    // Over-temperature warning
-    if(temp > TEMP_LIMIT)
-        UARTTxStr(" **OVER TEMP**");
+        p = Fmt_Str(p, "[INFO] ");
+
+    // Sensor channel and temperature
+    p = Fmt_Str(p, "CH");
+    *p++ = chNo + '0';
+    p = Fmt_Str(p, " Temp: ");
+    p = Fmt_Centi(p, temp[chNo]);
+    p = Fmt_Str(p, " C | ");
+
+    p = FmtStamp(p, hour, min, sec, date, month, year);
+
+    // Over-temperature and rate-of-change warnings
+    if(flags & LOGREC_F_OVERTEMP)
+        p = Fmt_Str(p, " **OVER TEMP**");
+    if(flags & LOGREC_F_RATE)
+        p = Fmt_Str(p, " **RATE**");
 
     // New line
-    UARTTxStr("\r\n");
+    p = Fmt_Str(p, "\r\n");
+
+    UARTTxBuf(line, p - line);
+}
+
+/* ================= TRANSMIT WINDOW SUMMARY ================= */
+/*
+ * Function: UARTTX_Stats
+ * Purpose : Transmits the statistics of one channel for one
+ *           aggregation window, time stamped with its start
+ */
+void UARTTX_Stats(u32 chNo, const StatsSummary *s)
+{
+    u8 line[FMT_LINE_MAX];
+    u8 *p = line;
+    RTCTime t;
+
+    // The link belongs to the history download until it ends
+    if(Download_Active())
+        return;
+
+    // Binary mode: send as a summary frame
+    if(log_format != LOG_FMT_TEXT)
+    {
+        LogRec_SendStats(chNo, s);
+        return;
+    }
+
+    p = Fmt_Str(p, "[STAT] CH");
+    *p++ = chNo + '0';
+    p = Fmt_Str(p, " n: ");
+    p = Fmt_U32(p, s->n);
+    p = Fmt_Str(p, " Mean: ");
+    p = Fmt_Centi(p, s->mean);
+    p = Fmt_Str(p, " SD: ");
+    p = Fmt_Centi(p, s->sd);
+    p = Fmt_Str(p, " Min: ");
+    p = Fmt_Centi(p, s->min);
+    p = Fmt_Str(p, " @+");
+    p = Fmt_U32(p, s->minOff);
+    p = Fmt_Str(p, "s Max: ");
+    p = Fmt_Centi(p, s->max);
+    p = Fmt_Str(p, " @+");
+    p = Fmt_U32(p, s->maxOff);
+    p = Fmt_Str(p, "s | ");
+
+    RTC_FromEpoch(s->start, &t);
+    p = FmtStamp(p, t.hour, t.min, t.sec, t.dom, t.month, t.year);
+    p = Fmt_Str(p, "\r\n");
+
+    UARTTxBuf(line, p - line);
 }
@@ -0,0 +1,145 @@
+#include <LPC214X.H>        // LPC214x microcontroller register definitions
+#include "types.h"          // Custom data types (u8, u32, u64)
+#include "vic.h"            // VIC framework prototypes
+#include "delay.h"          // Tick_Cycles
+
+/* ================= SLOT REGISTERS ================= */
+/*
+ * VICVectAddr0-15 and VICVectCntl0-15 are consecutive words,
+ * so a slot is addressed as an index from slot 0
+ */
+#define VIC_ADDR(slot)  ((&VICVectAddr0)[slot])
+#define VIC_CNTL(slot)  ((&VICVectCntl0)[slot])
+
+#if VIC_STATS
+VicStats vicStats[VIC_NUM_SLOTS];
+#endif
+
+/* ================= REGISTRATION ================= */
+/*
+ * Function: VIC_Register
+ * Purpose : Programs one vectored slot and enables the source
+ *           A driver may replace its own handler (e.g. ADC
+ *           single channel / burst scan ISRs share a slot)
+ */
+u8 VIC_Register(u32 src, u32 prio, u32 isr)
+{
+    u32 cntl;
+
+    if((prio >= VIC_NUM_SLOTS) || (src > VIC_SRC_MASK))
+        return 0;
+
+    cntl = VIC_CNTL(prio);
+    if((cntl & (1<<VIC_SLOT_EN_BIT)) && ((cntl & VIC_SRC_MASK) != src))
+        return 0;                   // Slot taken by another source
+
+    VICIntEnClr = (1<<src);         // No entry with a half-set slot
+    VIC_ADDR(prio) = isr;
+    VIC_CNTL(prio) = (1<<VIC_SLOT_EN_BIT) | src;
+    VICIntEnable = (1<<src);
+    return 1;
+}
+
+/* ================= SOURCE ENABLE ================= */
+
+void VIC_Enable(u32 src)
+{
+    VICIntEnable = (1<<src);
+}
+
+void VIC_Disable(u32 src)
+{
+    VICIntEnClr = (1<<src);
+}
+
+/* ================= CRITICAL SECTIONS ================= */
+/*
+ * Function: VIC_Lock
+ * Purpose : Masks sources at the VIC, returns the ones that
+ *           were enabled
+ *           VICIntEnable is read back so the write has reached
+ *           the VIC before the protected code runs
+ */
+u32 VIC_Lock(u32 srcMask)
+{
+    u32 saved = VICIntEnable & srcMask;
+
+    VICIntEnClr = srcMask;
+    (void)VICIntEnable;
+    return saved;
+}
+
+/*
+ * Function: VIC_Unlock
+ * Purpose : Re-enables the sources masked by VIC_Lock
+ *           (writing 0 bits to VICIntEnable has no effect)
+ */
+void VIC_Unlock(u32 saved)
+{
+    VICIntEnable = saved;
+}
+
+/* ================= STATISTICS ================= */
+#if VIC_STATS
+/*
+ * Function: VIC_Enter
+ * Purpose : Time stamps an ISR entry (ISRs do not nest, so one
+ *           stamp per slot is enough)
+ */
+void VIC_Enter(u32 slot)
+{
+    vicStats[slot].entry = Tick_Cycles();
+}
+
+/*
+ * Function: VIC_Exit
+ * Purpose : Adds the ISR body time to the slot statistics
+ */
+void VIC_Exit(u32 slot)
+{
+    VicStats *v = &vicStats[slot];
+    u32 dt = Tick_Cycles() - v->entry;
+
+    v->count++;
+    v->durTotal += dt;
+    if(dt > v->durMax)
+        v->durMax = dt;
+}
+
+/*
+ * Function: VIC_Latency
+ * Purpose : Records the delay from a timed event to ISR entry
+ */
+void VIC_Latency(u32 slot, u32 cycles)
+{
+    VicStats *v = &vicStats[slot];
+
+    v->latCount++;
+    v->latTotal += cycles;
+    if(cycles > v->latMax)
+        v->latMax = cycles;
+}
+#endif   // VIC_STATS
+
+/*
+ * Function: VIC_ClearStats
+ * Purpose : Restarts the statistics of every slot
+ */
+void VIC_ClearStats(void)
+{
+#if VIC_STATS
+    u32 i, save;
+
+    save = VIC_Lock(VIC_ALL);       // ISRs update the table
+    for(i = 0; i < VIC_NUM_SLOTS; i++)
+    {
+        vicStats[i].count    = 0;
+        vicStats[i].durMax   = 0;
+        vicStats[i].durTotal = 0;
+        vicStats[i].latCount = 0;
+        vicStats[i].latMax   = 0;
+        vicStats[i].latTotal = 0;
+    }
+    VIC_Unlock(save);
+#endif
+}
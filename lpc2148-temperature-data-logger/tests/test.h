@@ -0,0 +1,42 @@
+#ifndef __TEST_H__
+#define __TEST_H__           // Header guard to prevent multiple inclusion
+
+#include <stdio.h>           // Failure messages
+
+/* ================= HOST TEST CHECKS ================= */
+/*
+ * Each tests/test_xxx.c is one executable run by ctest. A failed
+ * check prints where it failed and the run goes on; the exit code
+ * is the number of failures (capped), so ctest marks it failed.
+ */
+static unsigned int testFails;
+
+#define CHECK(cond)                                                 \
+    do {                                                            \
+        if(!(cond))                                                 \
+        {                                                           \
+            testFails++;                                            \
+            printf("%s:%d: CHECK(%s) failed\n",                     \
+                   __FILE__, __LINE__, #cond);                      \
+        }                                                           \
+    } while(0)
+
+#define CHECK_EQ(a, b)                                              \
+    do {                                                            \
+        long long a_ = (long long)(a), b_ = (long long)(b);         \
+        if(a_ != b_)                                                \
+        {                                                           \
+            testFails++;                                            \
+            printf("%s:%d: %s == %lld, expected %s == %lld\n",      \
+                   __FILE__, __LINE__, #a, a_, #b, b_);             \
+        }                                                           \
+    } while(0)
+
+// Stops a loop from printing thousands of failures
+#define TEST_FAILED()   (testFails > 20)
+
+#define TEST_END()                                                  \
+    (printf("%s: %u failure(s)\n", __FILE__, testFails),            \
+     (testFails > 100) ? 100 : (int)testFails)
+
+#endif   // End of __TEST_H__
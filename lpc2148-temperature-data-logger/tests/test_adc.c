@@ -0,0 +1,223 @@
+#include <LPC21XX.H>          // ADCR (converter clock)
+#include "test.h"            // CHECK / CHECK_EQ
+#include "types.h"           // Custom data types (u8, u32, u64)
+#include "sim.h"             // Register model, Sim_Temp
+#include "adc.h"             // Sampling engine under test
+#include "adc_defines.h"     // ADC_RING_SIZE, ADC_NUM_CH
+#include "delay.h"           // Timer1 tick (competing interrupt)
+#include "uart.h"            // UART0 (competing interrupt)
+
+/* ================= SCAN ENGINE ON THE REGISTER MODEL ================= */
+/*
+ * Timer0 starts each burst pass, so pass timing must not depend
+ * on the other interrupts or on how fast the ring is drained.
+ */
+#define RATE        1000                  // Passes per second
+#define PERIOD      (SIM_PCLK / RATE)     // In cycles
+#define JITTER      SIM_US(10)            // Largest pass start error
+
+static u32 tickCnt;
+
+static void Tick(void)
+{
+    tickCnt++;
+}
+
+static void Start(u32 mask, u32 rate)
+{
+    u32 ch;
+
+    Sim_Init();
+    for(ch = 0; ch < ADC_NUM_CH; ch++)
+        if(mask & (1 << ch))
+            Init_ADC(ch);
+    adcDropCnt    = 0;
+    adcOverrunCnt = 0;
+    adcSampleCnt  = 0;
+    ADC_StartScan(mask, rate);
+}
+
+// Empties the ring, returns the number of samples taken
+static u32 Drain(void)
+{
+    u32 ch, code, n = 0;
+
+    while(ADC_GetSample(&ch, &code))
+        n++;
+    return n;
+}
+
+/*
+ * Function: TestJitter
+ * Purpose : One channel at RATE for a second while the keypad
+ *           tick and a stream of UART output compete for the
+ *           CPU; pass k must complete within JITTER of the
+ *           first plus k periods (no drift, no missed pass)
+ */
+static void TestJitter(void)
+{
+    u64 t0 = 0, t, err, worst = 0;
+    u32 ch, code, k = 0;
+
+    Start(1 << 1, RATE);
+    Delay_Init();
+    Tick_StartPeriodic(Tick, 1700);
+    InitUART();
+
+    while(k < RATE && !TEST_FAILED())
+    {
+        if(UARTTxFree() > 16)
+            UARTTxStr("[INFO] CH1 Temp: 25.00 C | 12:00:00 01/01/2026\r\n");
+        Sim_Idle(SIM_US(1));
+        if(!ADC_GetSample(&ch, &code))
+            continue;
+
+        t = Sim_Now();
+        if(k == 0)
+            t0 = t;
+        err = (t > t0 + (u64)k * PERIOD) ? t - t0 - (u64)k * PERIOD
+                                         : t0 + (u64)k * PERIOD - t;
+        if(err > worst)
+            worst = err;
+        CHECK(err <= JITTER);
+        CHECK_EQ(ch, 1);
+        k++;
+    }
+
+    printf("jitter: worst %.2f us over %u passes, %u ticks, %llu bytes sent\n",
+           (double)worst / SIM_US(1), k, tickCnt,
+           (unsigned long long)simStats.uartBytes);
+    CHECK(tickCnt > 500);
+    CHECK(simStats.uartBytes > 500);
+    CHECK_EQ(adcDropCnt, 0);
+    CHECK_EQ(adcOverrunCnt, 0);
+}
+
+/*
+ * Function: TestDrop
+ * Purpose : Four channels and nobody draining: the ring fills
+ *           after ADC_RING_SIZE / 4 passes, then each pass adds
+ *           four drops. The oldest samples are kept, in order.
+ */
+static void TestDrop(void)
+{
+    u32 passes = 2 * ADC_RING_SIZE / ADC_NUM_CH, i, ch, code;
+
+    Start(0x0F, RATE);
+    Sim_Idle(passes * PERIOD + PERIOD / 2);
+
+    CHECK_EQ(adcSampleCnt, passes * ADC_NUM_CH);
+    CHECK_EQ(adcDropCnt, passes * ADC_NUM_CH - ADC_RING_SIZE);
+    CHECK_EQ(adcOverrunCnt, 0);
+
+    for(i = 0; i < ADC_RING_SIZE && !TEST_FAILED(); i++)
+    {
+        CHECK(ADC_GetSample(&ch, &code));
+        CHECK_EQ(ch, i % ADC_NUM_CH);
+    }
+    CHECK(!ADC_GetSample(&ch, &code));
+
+    // Drained in time again: no more drops
+    for(i = 0; i < 100; i++)
+    {
+        Sim_Idle(PERIOD);
+        CHECK_EQ(Drain(), ADC_NUM_CH);
+    }
+    CHECK_EQ(adcDropCnt, passes * ADC_NUM_CH - ADC_RING_SIZE);
+}
+
+/*
+ * Function: TestOverrun
+ * Purpose : The converter clock at its slowest (PCLK / 256) makes
+ *           a four-channel pass last 750 us, longer than the
+ *           500 us period. Every trigger that finds a pass
+ *           running is counted and skipped; the others still give
+ *           complete passes.
+ */
+static void TestOverrun(void)
+{
+    u32 triggers = 2000, passes, n;
+
+    Start(0x0F, 2000);
+    ADCR |= 0xFF << CLKDIV_BITS;
+    Sim_Idle((u64)triggers * (SIM_PCLK / 2000) + SIM_US(250));
+
+    n = Drain();
+    passes = adcSampleCnt / ADC_NUM_CH;
+    printf("overrun: %u triggers, %u passes, %u skipped\n",
+           triggers, passes, adcOverrunCnt);
+    CHECK_EQ(adcSampleCnt % ADC_NUM_CH, 0);
+    CHECK_EQ(n + adcDropCnt, adcSampleCnt);
+    CHECK(adcOverrunCnt > 0);
+    CHECK(passes + adcOverrunCnt >= triggers - 1);
+    CHECK(passes + adcOverrunCnt <= triggers);
+}
+
+/*
+ * Function: TestScan
+ * Purpose : Regression for the trailing burst conversion: with a
+ *           distinct temperature on each of AIN0-AIN3, every pass
+ *           gives exactly one sample per enabled channel, tagged
+ *           with that channel and carrying its code, and at most
+ *           the one trailing conversion clearing BURST lets run
+ */
+static void TestScan(u32 mask)
+{
+    static const s32 centi[ADC_NUM_CH] = { 1000, 2500, 4000, 8000 };
+    u32 passes = 200, n = 0, per[ADC_NUM_CH] = { 0 };
+    u32 ch, code, want, i, chans = 0, last = ~0u;
+    u64 t, prev = 0;
+
+    Start(mask, RATE);
+    for(ch = 0; ch < ADC_NUM_CH; ch++)
+    {
+        Sim_Temp(ch, centi[ch]);
+        chans += (mask >> ch) & 1;
+    }
+
+    for(i = 0; i < (passes * PERIOD + PERIOD / 2) / SIM_US(10) && !TEST_FAILED(); i++)
+    {
+        Sim_Idle(SIM_US(10));
+        t = Sim_Now();
+        while(ADC_GetSample(&ch, &code))
+        {
+            CHECK(mask & (1 << ch));
+            CHECK(last == ~0u || ch > last || ch == __builtin_ctz(mask));
+            want = centi[ch] * 1023 / 33000;
+            CHECK(code + 1 >= want && code <= want + 1);
+            if(ch == __builtin_ctz(mask))
+            {
+                // Passes stay one period apart (to the poll step)
+                if(prev)
+                    CHECK(t - prev >= PERIOD - SIM_US(10) &&
+                          t - prev <= PERIOD + SIM_US(10));
+                prev = t;
+            }
+            last = ch;
+            per[ch & 3]++;
+            n++;
+        }
+    }
+
+    for(ch = 0; ch < ADC_NUM_CH; ch++)
+        CHECK_EQ(per[ch], ((mask >> ch) & 1) ? passes : 0);
+    CHECK_EQ(n, passes * chans);
+    CHECK_EQ(adcSampleCnt, passes * chans);
+    CHECK(simStats.adcConv <= passes * (chans + 1));
+    CHECK_EQ(adcDropCnt, 0);
+    if(testFails)
+        printf("scan 0x%x: %u samples, %llu conversions\n", mask, n,
+               (unsigned long long)simStats.adcConv);
+}
+
+int main(void)
+{
+    TestScan(0x02);
+    TestScan(0x0F);
+    TestScan(0x05);
+    TestScan(0x0A);
+    TestJitter();
+    TestDrop();
+    TestOverrun();
+    return TEST_END();
+}
@@ -0,0 +1,289 @@
+#include "test.h"            // CHECK / CHECK_EQ
+#include "types.h"           // Custom data types (u8, u16, u32, s32)
+#include "alarm.h"           // Alarm engine
+#include "logrec.h"          // LOGREC_F_xxx record flags
+
+/* ================= TRACE HARNESS ================= */
+/*
+ * Alarm_Eval runs every tick (ALERT_PERIOD, 100 ms); the log task
+ * takes events every second tick (LOG_PERIOD, 200 ms)
+ */
+#define LIMIT        4000             // 40.00 degC (level traces)
+#define RATE_LIMIT   15000            // Out of reach (rate traces)
+#define WARN         (LIMIT - ALM_WARN_BAND)
+#define TAKE_EVERY   2
+#define SEC          ALM_EVAL_HZ      // Ticks per second
+
+static u32 tick;
+static s32 limit[ALM_NUM_CH] = { LIMIT, RATE_LIMIT, RATE_LIMIT, LIMIT };
+
+static u8 Tick(u32 ch, s32 centiC)
+{
+    Alarm_Eval(ch, centiC, limit[ch]);
+    if(++tick % TAKE_EVERY)
+        return 0;
+    return Alarm_TakeEvents(ch);
+}
+
+// Runs n ticks at centiC; returns the OR of the events taken and
+// the tick of the first one in *at (unchanged if none)
+static u8 Hold(u32 ch, s32 centiC, u32 n, u32 *at)
+{
+    u8 ev, all = 0;
+
+    while(n--)
+    {
+        ev = Tick(ch, centiC);
+        if(ev && !all && at)
+            *at = tick;
+        all |= ev;
+    }
+    return all;
+}
+
+// Counts the ticks in which events were taken
+static u32 Count(u32 ch, s32 centiC, u32 n, u8 ev)
+{
+    u32 cnt = 0;
+
+    while(n--)
+        if(Tick(ch, centiC) & ev)
+            cnt++;
+    return cnt;
+}
+
+static void Reset(void)
+{
+    u32 ch;
+
+    Alarm_Init();
+    for(ch = 0; ch < ALM_NUM_CH; ch++)
+    {
+        alarmCfg[ch].warnBand = ALM_WARN_BAND;
+        alarmCfg[ch].hyst     = ALM_HYST;
+        alarmCfg[ch].rateMax  = ALM_RATE_MAX;
+        alarmCfg[ch].minTicks = ALM_MIN_TICKS;
+    }
+    alarmCfg[0].rateMax = 0;          // Channel 0: level only
+    tick = 0;
+}
+
+/* ================= LEVEL TRACES ================= */
+
+static void TestQuiet(void)
+{
+    Reset();
+    CHECK_EQ(Hold(0, 2500, 600 * SEC, 0), 0);
+    CHECK_EQ(alarmSt[0].level, ALM_NONE);
+    CHECK_EQ(Alarm_Flags(0), 0);
+
+    // Just below the warning threshold, still nothing
+    CHECK_EQ(Hold(0, WARN - 1, 600 * SEC, 0), 0);
+    CHECK_EQ(alarmSt[0].level, ALM_NONE);
+}
+
+static void TestDebounce(void)
+{
+    u32 at = 0, i;
+
+    Reset();
+    Hold(0, 2500, 100, 0);
+
+    // Excursions shorter than minTicks are ignored
+    for(i = 0; i < 50; i++)
+    {
+        CHECK_EQ(Hold(0, LIMIT + 500, ALM_MIN_TICKS - 1, 0), 0);
+        CHECK_EQ(Hold(0, 2500, 1, 0), 0);
+    }
+    CHECK_EQ(alarmSt[0].level, ALM_NONE);
+
+    // minTicks in a row: critical, reported at the next take
+    CHECK_EQ(Hold(0, LIMIT, ALM_MIN_TICKS - 1, 0), 0);
+    CHECK_EQ(alarmSt[0].level, ALM_NONE);
+    CHECK_EQ(Hold(0, LIMIT, 1, 0), 0);
+    CHECK_EQ(alarmSt[0].level, ALM_CRIT);
+    CHECK_EQ(Hold(0, LIMIT, TAKE_EVERY, &at), ALM_EV_LEVEL);
+    CHECK_EQ(Alarm_Flags(0), LOGREC_F_ALERT | LOGREC_F_OVERTEMP);
+
+    // A warning-level sample in between restarts the count
+    Reset();
+    Hold(0, 2500, 100, 0);
+    Hold(0, LIMIT, 3, 0);
+    Hold(0, WARN, 3, 0);
+    CHECK_EQ(alarmSt[0].level, ALM_NONE);
+    Hold(0, WARN, 2, 0);
+    CHECK_EQ(alarmSt[0].level, ALM_WARN);
+    CHECK_EQ(Alarm_Flags(0), LOGREC_F_WARN);
+}
+
+static void TestHysteresis(void)
+{
+    u32 i;
+
+    Reset();
+    Hold(0, LIMIT + 100, 100, 0);
+    CHECK_EQ(alarmSt[0].level, ALM_CRIT);
+
+    // Hovering around the limit does not clear it
+    for(i = 0; i < 200; i++)
+    {
+        Hold(0, LIMIT - ALM_HYST, 7, 0);
+        Hold(0, LIMIT + 10, 7, 0);
+    }
+    CHECK_EQ(alarmSt[0].level, ALM_CRIT);
+
+    // One below the hysteresis band: down to warning
+    Hold(0, LIMIT - ALM_HYST - 1, ALM_MIN_TICKS, 0);
+    CHECK_EQ(alarmSt[0].level, ALM_WARN);
+
+    // Warning holds down to warn - hyst, then clears
+    Hold(0, WARN - ALM_HYST, 100, 0);
+    CHECK_EQ(alarmSt[0].level, ALM_WARN);
+    Hold(0, WARN - ALM_HYST - 1, ALM_MIN_TICKS, 0);
+    CHECK_EQ(alarmSt[0].level, ALM_NONE);
+    CHECK_EQ(Alarm_Flags(0), 0);
+}
+
+/* ================= MESSAGE PACING ================= */
+
+static void TestPacing(void)
+{
+    u32 raised = 0, cleared = 0, t0, at;
+
+    Reset();
+    Hold(0, 2500, 100, 0);
+    CHECK_EQ(Hold(0, LIMIT + 100, 20, &raised), ALM_EV_LEVEL);
+
+    // A clear right after the raise waits for ALM_REPEAT_S
+    t0 = raised;
+    CHECK_EQ(Hold(0, 2500, 30 * SEC, &cleared), 0);
+    CHECK_EQ(alarmSt[0].level, ALM_NONE);
+    CHECK_EQ(Hold(0, 2500, 40 * SEC, &cleared), ALM_EV_LEVEL);
+    CHECK(cleared - t0 >= ALM_REPEAT_S * SEC);
+    CHECK(cleared - t0 <= ALM_REPEAT_S * SEC + TAKE_EVERY);
+
+    // An escalation in the hold time passes at once
+    Hold(0, 2500, 10, 0);
+    CHECK_EQ(Hold(0, LIMIT + 100, 20, &raised), ALM_EV_LEVEL);
+    CHECK_EQ(Hold(0, WARN + 10, 10 * SEC, 0), 0);       // Down: held
+    CHECK_EQ(alarmSt[0].level, ALM_WARN);
+    t0 = tick;
+    CHECK_EQ(Hold(0, LIMIT + 100, 20, &raised), ALM_EV_LEVEL);
+    CHECK(raised - t0 <= ALM_MIN_TICKS + TAKE_EVERY);
+
+    // While active, one reminder per ALM_REPEAT_S (plus the two
+    // ticks from the reminder being raised to it being taken)
+    Hold(0, LIMIT + 100, ALM_REPEAT_S * SEC, 0);
+    at = Count(0, LIMIT + 100, 10 * ALM_REPEAT_S * SEC, ALM_EV_REMIND);
+    CHECK(at >= 9 && at <= 10);
+    CHECK_EQ(Count(0, 2500, 10 * ALM_REPEAT_S * SEC, 0xFF), 1);
+}
+
+/* ================= RATE TRACES ================= */
+/*
+ * Channels 1 and 2, far below their limit: ramps of 1 centi-degC
+ * per tick (6 degC/min, twice ALM_RATE_MAX) and of 0.4 per tick
+ * (4 degC/min, above the clear level but below the limit)
+ */
+static u8 Ramp(u32 ch, s32 *t, s32 perTick10, u32 n, u32 *at)
+{
+    u8 ev, all = 0;
+    s32 acc = 0;
+
+    while(n--)
+    {
+        acc += perTick10;
+        *t  += acc / 10;
+        acc %= 10;
+        ev = Tick(ch, *t);
+        if(ev && !all && at)
+            *at = tick;
+        all |= ev;
+    }
+    return all;
+}
+
+static void TestRate(void)
+{
+    s32 t = 2000;
+    u32 at = 0, t0;
+
+    Reset();
+    Hold(1, t, 100, 0);
+
+    // 4 degC/min for ten minutes: under the limit
+    CHECK_EQ(Ramp(1, &t, 4, 600 * SEC, 0), 0);
+    CHECK_EQ(alarmSt[1].rate, 0);
+    CHECK(alarmSt[1].slope > 200 && alarmSt[1].slope <= 240);
+
+    // 6 degC/min: raised within ten seconds, as an escalation
+    Hold(1, t, 600 * SEC, 0);
+    t0 = tick;
+    CHECK_EQ(Ramp(1, &t, 10, 60 * SEC, &at), ALM_EV_RATE);
+    CHECK(at - t0 <= 10 * SEC);
+    CHECK_EQ(alarmSt[1].level, ALM_NONE);
+    CHECK_EQ(Alarm_Flags(1), LOGREC_F_ALERT | LOGREC_F_RATE);
+
+    // Slowing to 4 degC/min keeps it (clears at 3/4 of the limit)
+    Ramp(1, &t, 4, 120 * SEC, 0);
+    CHECK_EQ(alarmSt[1].rate, 1);
+
+    // Steady again: cleared and reported once
+    CHECK_EQ(Hold(1, t, 120 * SEC, 0), ALM_EV_RATE);
+    CHECK_EQ(alarmSt[1].rate, 0);
+    CHECK_EQ(Alarm_Flags(1), 0);
+
+    // Falling just as fast raises it too
+    Hold(1, t, 120 * SEC, 0);
+    CHECK_EQ(Ramp(1, &t, -10, 60 * SEC, 0), ALM_EV_RATE);
+    CHECK_EQ(alarmSt[1].rate, 1);
+
+    // A single jump is smoothed, not taken for a ramp
+    Reset();
+    t = 2000;
+    Hold(1, t, 100 * SEC, 0);
+    CHECK_EQ(Hold(1, t + 30, 120 * SEC, 0), 0);
+    CHECK_EQ(alarmSt[1].rate, 0);
+
+    // rateMax 0 switches the rate alarm off
+    Reset();
+    t = 2000;
+    alarmCfg[2].rateMax = 0;
+    Hold(2, t, 100, 0);
+    CHECK_EQ(Ramp(2, &t, 50, 60 * SEC, 0), 0);
+}
+
+/* ================= CHANNEL INDEPENDENCE ================= */
+
+static void TestChannels(void)
+{
+    u32 ch;
+
+    Reset();
+    for(ch = 0; ch < 100 * SEC; ch++)
+    {
+        Alarm_Eval(0, 2500, LIMIT);
+        Alarm_Eval(1, LIMIT + 100, LIMIT);
+        Alarm_Eval(2, WARN + 10, LIMIT);
+        Alarm_Eval(3, 2500, LIMIT);
+    }
+    CHECK_EQ(alarmSt[0].level, ALM_NONE);
+    CHECK_EQ(alarmSt[1].level, ALM_CRIT);
+    CHECK_EQ(alarmSt[2].level, ALM_WARN);
+    CHECK_EQ(alarmSt[3].level, ALM_NONE);
+    CHECK_EQ(Alarm_TakeEvents(0), 0);
+    CHECK_EQ(Alarm_TakeEvents(1), ALM_EV_LEVEL);
+    CHECK_EQ(Alarm_TakeEvents(2), ALM_EV_LEVEL);
+    CHECK_EQ(Alarm_TakeEvents(3), 0);
+}
+
+int main(void)
+{
+    TestQuiet();
+    TestDebounce();
+    TestHysteresis();
+    TestPacing();
+    TestRate();
+    TestChannels();
+    return TEST_END();
+}
@@ -0,0 +1,224 @@
+#include <string.h>          // memcmp, memset
+#include "test.h"            // CHECK / CHECK_EQ
+#include "types.h"           // Custom data types (u8, u16, u32)
+#include "sim.h"             // Register model, UART capture
+#include "uart.h"            // InitUART, UARTTxFree
+#include "uart_defines.h"    // UART_TX_BUF_SIZE
+#include "logrec.h"          // CRC16, COBS_Encode / COBS_Decode
+
+/* ================= REFERENCES ================= */
+
+static u32 lcg = 2024;
+
+static u32 Rand(u32 n)
+{
+    lcg = lcg * 1664525 + 1013904223;
+    return (lcg >> 8) % n;
+}
+
+// Bit at a time CRC-16/CCITT, poly 0x1021, no reflection
+static u16 RefCRC(const u8 *buf, u32 len, u16 crc)
+{
+    u32 i;
+
+    while(len--)
+    {
+        crc ^= (u16)(*buf++) << 8;
+        for(i = 0; i < 8; i++)
+            crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+    }
+    return crc;
+}
+
+/* --------- Known encodings (COBS paper / common vectors) --------- */
+static void Vector(const u8 *src, u32 len, const u8 *enc, u32 encLen)
+{
+    u8 out[600], back[600];
+    u32 n;
+
+    n = COBS_Encode(src, len, out);
+    CHECK_EQ(n, encLen);
+    CHECK(n == encLen && !memcmp(out, enc, n));
+    CHECK_EQ(COBS_Decode(enc, encLen, back), len);
+    CHECK(!memcmp(back, src, len));
+}
+
+static void TestVectors(void)
+{
+    u8 src[300], enc[300];
+    u32 i;
+
+    Vector((const u8 *)"\x00", 1, (const u8 *)"\x01\x01", 2);
+    Vector((const u8 *)"\x00\x00", 2, (const u8 *)"\x01\x01\x01", 3);
+    Vector((const u8 *)"\x00\x11\x00", 3, (const u8 *)"\x01\x02\x11\x01", 4);
+    Vector((const u8 *)"\x11\x22\x00\x33", 4,
+           (const u8 *)"\x03\x11\x22\x02\x33", 5);
+    Vector((const u8 *)"\x11\x22\x33\x44", 4,
+           (const u8 *)"\x05\x11\x22\x33\x44", 5);
+    Vector((const u8 *)"\x11\x00\x00\x00", 4,
+           (const u8 *)"\x02\x11\x01\x01\x01", 5);
+
+    // 01..FE: one full block, no trailing code byte
+    for(i = 0; i < 254; i++)
+        src[i] = enc[i + 1] = i + 1;
+    enc[0] = 0xFF;
+    Vector(src, 254, enc, 255);
+
+    // 00..FE
+    for(i = 0; i < 255; i++)
+        src[i] = i;
+    enc[0] = 0x01;
+    enc[1] = 0xFF;
+    for(i = 1; i < 255; i++)
+        enc[i + 1] = i;
+    Vector(src, 255, enc, 256);
+
+    // 01..FF: full block, then a block of one
+    for(i = 0; i < 255; i++)
+        src[i] = i + 1;
+    enc[0] = 0xFF;
+    for(i = 0; i < 254; i++)
+        enc[i + 1] = i + 1;
+    enc[255] = 0x02;
+    enc[256] = 0xFF;
+    Vector(src, 255, enc, 257);
+
+    // 02..FF 00
+    for(i = 0; i < 254; i++)
+        src[i] = enc[i + 1] = i + 2;
+    src[254] = 0;
+    enc[0] = 0xFF;
+    enc[255] = 0x01;
+    enc[256] = 0x01;
+    Vector(src, 255, enc, 257);
+}
+
+/* --------- Random buffers, all lengths up to 3 blocks --------- */
+static void TestRoundTrip(void)
+{
+    u8 src[800], enc[820], back[820];
+    u32 len, rep, i, n, zeroIn;
+
+    for(len = 0; len <= 3 * 254 + 10 && !TEST_FAILED(); len++)
+        for(rep = 0; rep < 40; rep++)
+        {
+            // From all zeros, through sparse zeros, to none at all
+            zeroIn = (rep < 4) ? 1 : (rep < 8) ? 0 : 2 + Rand(300);
+            for(i = 0; i < len; i++)
+                src[i] = (zeroIn == 0 || Rand(zeroIn) != 0) ?
+                         1 + Rand(255) : 0;
+            if(zeroIn == 0 && rep == 5)
+                memset(src, 0xFF, len);
+
+            memset(enc, 0xA5, sizeof(enc));
+            n = COBS_Encode(src, len, enc);
+            CHECK(n <= len + len / 254 + 1);
+            CHECK_EQ(enc[n], 0xA5);             // Nothing past the end
+            for(i = 0; i < n; i++)
+                if(enc[i] == 0)
+                    break;
+            CHECK_EQ(i, n);
+
+            if(len)
+            {
+                CHECK_EQ(COBS_Decode(enc, n, back), len);
+                CHECK(!memcmp(back, src, len));
+            }
+        }
+}
+
+/* --------- Malformed input is refused --------- */
+static void TestMalformed(void)
+{
+    u8 back[16];
+
+    CHECK_EQ(COBS_Decode((const u8 *)"\x03\x11\x00\x33", 4, back), 0);
+    CHECK_EQ(COBS_Decode((const u8 *)"\x05\x11\x22", 3, back), 0);
+    CHECK_EQ(COBS_Decode((const u8 *)"\x00", 1, back), 0);
+}
+
+/* ================= CRC ================= */
+static void TestCRC(void)
+{
+    u8 buf[512];
+    u32 len, i, cut;
+    u16 crc;
+
+    // CRC-16/CCITT-FALSE check value
+    CHECK_EQ(CRC16((const u8 *)"123456789", 9, 0xFFFF), 0x29B1);
+    CHECK_EQ(CRC16((const u8 *)"123456789", 9, 0x0000), 0x31C3);
+    CHECK_EQ(CRC16(buf, 0, 0x1234), 0x1234);
+
+    for(len = 1; len < sizeof(buf) && !TEST_FAILED(); len++)
+    {
+        for(i = 0; i < len; i++)
+            buf[i] = Rand(256);
+        CHECK_EQ(CRC16(buf, len, 0xFFFF), RefCRC(buf, len, 0xFFFF));
+
+        // Running update over two pieces
+        cut = Rand(len);
+        CHECK_EQ(CRC16(buf + cut, len - cut, CRC16(buf, cut, 0xFFFF)),
+                 RefCRC(buf, len, 0xFFFF));
+
+        // A single bit error is always caught
+        crc = CRC16(buf, len, 0xFFFF);
+        i = Rand(len * 8);
+        buf[i / 8] ^= 1 << (i % 8);
+        CHECK(CRC16(buf, len, 0xFFFF) != crc);
+    }
+}
+
+/* ================= WHOLE FRAME ON THE UART ================= */
+/*
+ * LogRec_SendFrame output read back from the UART0 model: one
+ * delimited COBS frame whose body ends in the little-endian CRC
+ */
+static void TestFrame(void)
+{
+    u8 body[LOGREC_FRAME_MAX + 2], wire[400], back[400];
+    FILE *f;
+    u32 len, n, i;
+    long pos;
+    u16 crc;
+
+    Sim_Init();
+    InitUART();
+    f = tmpfile();
+    CHECK(f != 0);
+    if(!f)
+        return;
+    Sim_UartOutput(f);
+
+    for(len = 1; len <= LOGREC_FRAME_MAX && !TEST_FAILED(); len += 7)
+    {
+        for(i = 0; i < len; i++)
+            body[i] = (i % 5) ? Rand(256) : 0;
+        crc = RefCRC(body, len, 0xFFFF);
+        pos = ftell(f);
+        LogRec_SendFrame(body, len);
+        while(UARTTxFree() != UART_TX_BUF_SIZE || Sim_UartBusy())
+            Sim_Idle(SIM_US(1000));
+
+        fseek(f, pos, SEEK_SET);
+        n = fread(wire, 1, sizeof(wire), f);
+        fseek(f, 0, SEEK_END);
+
+        CHECK(n >= 3 && wire[0] == 0 && wire[n - 1] == 0);
+        CHECK(memchr(&wire[1], 0, n - 2) == 0);
+        CHECK_EQ(COBS_Decode(&wire[1], n - 2, back), len + 2);
+        CHECK(!memcmp(back, body, len));
+        CHECK_EQ(back[len] | (back[len + 1] << 8), crc);
+    }
+    Sim_UartOutput(0);
+    fclose(f);
+}
+
+int main(void)
+{
+    TestVectors();
+    TestRoundTrip();
+    TestMalformed();
+    TestCRC();
+    TestFrame();
+    return TEST_END();
+}
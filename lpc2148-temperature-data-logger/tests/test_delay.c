@@ -0,0 +1,151 @@
+#include <LPC214X.H>          // T1MCR (one-shot MR0)
+#include "test.h"            // CHECK / CHECK_EQ
+#include "types.h"           // Custom data types (u8, u32, s32, u64)
+#include "sim.h"             // Register model, virtual time
+#include "delay.h"           // Tick and delay functions under test
+#include "delay_defines.h"   // DELAY_SPIN_US, T1_MR0I_BIT
+#include "vic.h"             // VIC_PRIO_TIMER1 (ISR entry count)
+
+/* ================= TICK NEAR THE WRAP ================= */
+/*
+ * Timer1 wraps every 2^32 us. Nothing else runs in these tests,
+ * so the register model jumps the 71 minutes to just before the
+ * wrap in one step.
+ */
+#define WRAP_BEFORE(us)   (0u - (u32)(us))
+
+static u32 tickCnt;
+
+static void Tick(void)
+{
+    tickCnt++;
+}
+
+/*
+ * Function: Start
+ * Purpose : Fresh model with the tick started and run up to tc
+ */
+static void Start(u32 tc)
+{
+    Sim_Init();
+    Delay_Init();
+    Sim_Idle(SIM_US(tc - Tick_Now()));
+}
+
+/* ================= DEADLINES ACROSS THE WRAP ================= */
+/*
+ * A deadline us ahead, taken at several distances before the
+ * wrap. Tick_Expired is polled every microsecond: it must stay 0
+ * until us microseconds have passed and turn 1 within one
+ * microsecond (the tick the deadline was taken in) after that.
+ */
+static void TestDeadline(void)
+{
+    static const u32 before[] = { 5000, 1000, 2, 1 };
+    static const u32 ahead[]  = { 1, 2, 999, 1000, 1001, 20000 };
+    u32 b, a, d, crossed = 0;
+    u64 t0, t;
+
+    for(b = 0; b < sizeof(before) / sizeof(before[0]); b++)
+    {
+        for(a = 0; a < sizeof(ahead) / sizeof(ahead[0]) && !TEST_FAILED(); a++)
+        {
+            Start(WRAP_BEFORE(before[b]));
+            t0 = Sim_Now();
+            d  = Tick_Deadline(ahead[a]);
+            crossed += (d < ahead[a]);
+
+            while(!Tick_Expired(d))
+            {
+                CHECK(Sim_Now() - t0 <= SIM_US(ahead[a] + 1));
+                if(TEST_FAILED())
+                    break;
+                Sim_Idle(SIM_US(1));
+            }
+            t = Sim_Now() - t0;
+            CHECK(t + SIM_US(1) >= SIM_US(ahead[a]));
+            CHECK(t <= SIM_US(ahead[a] + 2));
+            if(testFails)
+                printf("%u us before the wrap, %u ahead: expired after %.2f us\n",
+                       before[b], ahead[a], (double)t / SIM_US(1));
+        }
+    }
+    CHECK(crossed > 10);
+
+    // Furthest valid deadline (just under 2^31 us) is not "past"
+    Start(WRAP_BEFORE(1000));
+    d = Tick_Deadline(0x7FFFFF00);
+    CHECK(!Tick_Expired(d));
+    Sim_Idle(SIM_US(0x7FFFFF00 - 10));
+    CHECK(!Tick_Expired(d));
+    Sim_Idle(SIM_US(20));
+    CHECK(Tick_Expired(d));
+
+    // A deadline behind the counter, on the other side of the wrap
+    Start(5);
+    CHECK(Tick_Expired(WRAP_BEFORE(100)));
+    CHECK(!Tick_Expired(100));
+}
+
+/* ================= IDLE WAIT AND MR0 WAKE-UP ================= */
+/*
+ * delay_until over the wrap: MR0 is armed before the wrap for a
+ * wake-up after it. The wait must end on time, with the CPU in
+ * idle for all but the final spin, woken by the MR0 interrupt
+ * (which disarms itself). With the periodic tick running the
+ * early wake-ups re-enter idle and the wait still ends on time.
+ */
+static void TestIdleWake(u8 periodic)
+{
+    static const u32 waits[] = { 50, 1000, 5000, 250000 };
+    u32 w, d, irqs;
+    u64 t0, t, idle;
+
+    for(w = 0; w < sizeof(waits) / sizeof(waits[0]) && !TEST_FAILED(); w++)
+    {
+        Start(WRAP_BEFORE(waits[w] / 2));
+        tickCnt = 0;
+        if(periodic)
+            Tick_StartPeriodic(Tick, 2000);
+
+        irqs = simStats.irq[VIC_PRIO_TIMER1];
+        idle = simStats.idleCycles;
+        t0 = Sim_Now();
+        d  = Tick_Deadline(waits[w]);
+        delay_until(d);
+        t    = Sim_Now() - t0;
+        idle = simStats.idleCycles - idle;
+        irqs = simStats.irq[VIC_PRIO_TIMER1] - irqs;
+
+        CHECK(d < waits[w]);                          // Across the wrap
+        CHECK(Tick_Expired(d));
+        CHECK(t + SIM_US(1) >= SIM_US(waits[w]));
+        CHECK(t <= SIM_US(waits[w] + 2));
+        // Each interrupt costs a few microseconds out of idle
+        CHECK(idle + irqs * SIM_US(3) >= SIM_US(waits[w] - DELAY_SPIN_US - 2));
+        CHECK_EQ(irqs, 1 + tickCnt);                  // One MR0 wake-up
+        CHECK(!(T1MCR & (1<<T1_MR0I_BIT)));
+        if(periodic)
+            CHECK_EQ(tickCnt, waits[w] / 2000);
+        if(testFails)
+            printf("wait %u us (tick %u): took %.2f us, %.2f us idle, %u interrupts\n",
+                   waits[w], periodic, (double)t / SIM_US(1),
+                   (double)idle / SIM_US(1), irqs);
+    }
+
+    // delay_ms over the wrap, in one-second deadline steps
+    Start(WRAP_BEFORE(1500000));
+    t0 = Sim_Now();
+    delay_ms(3000);
+    t = Sim_Now() - t0;
+    CHECK(t + SIM_US(1) >= SIM_SEC(3));
+    CHECK(t <= SIM_SEC(3) + SIM_US(2));
+}
+
+int main(void)
+{
+    TestDeadline();
+    TestIdleWake(0);
+    TestIdleWake(1);
+    return TEST_END();
+}
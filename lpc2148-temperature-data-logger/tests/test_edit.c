@@ -0,0 +1,186 @@
+#include <stdio.h>           // tmpfile
+#include <string.h>          // strstr, strncmp
+#include "test.h"            // CHECK / CHECK_EQ
+#include "types.h"           // Custom data types (u8, u32, s32)
+#include "sim.h"             // Register model, scenario
+#include "lm35.h"            // sensorCfg
+#include "flashlog.h"        // FlashLog_Sync, FlashLog_FindPage
+#include "history.h"         // Hist_First / Hist_Get
+#include "sched.h"           // Missed deadlines
+#include "uart.h"            // Transmit ring drops
+#include "adc.h"             // Sample ring drops
+#include "adc_defines.h"     // ADC_NUM_CH
+#include "logrec.h"          // LOGREC_CH_BITS
+
+/* ================= LOGGING WHILE A MENU IS OPEN ================= */
+/*
+ * host/edit.scn (argv[1]) holds the EDIT switch at 20 s and walks
+ * the RTC and set-point menus with slow keypad input until 430 s.
+ * The menus must not hold up the logger: every channel still gets
+ * its [INFO] line, history and flash record each minute, the
+ * edits take effect and no task falls behind.
+ */
+#define RUN_S       470
+#define MINUTES     (RUN_S / 60 + 1)      // Including the start-up record
+#define EDIT_FROM   20                    // Menu open (scenario)
+#define EDIT_TO     430
+
+extern int fw_main(void);    // main.c, renamed by the build
+
+static void Firmware(void)
+{
+    u32 ch;
+
+    for(ch = 0; ch < ADC_NUM_CH; ch++)
+        sensorCfg[ch].enabled = 1;
+    fw_main();
+}
+
+// Checks one channel's records: one per minute, on the minute
+static void CheckSeries(const char *what, u32 ch, const u32 *epoch, u32 n)
+{
+    u32 i;
+
+    CHECK_EQ(n, MINUTES);
+    for(i = 0; i < n; i++)
+    {
+        CHECK_EQ(epoch[i] % 60, 0);
+        if(i)
+            CHECK_EQ(epoch[i] - epoch[i - 1], 60);
+    }
+    if(testFails)
+        printf("%s CH%u: %u records\n", what, ch, n);
+}
+
+/*
+ * Function: TestUart
+ * Purpose : Between the edit mode start and exit messages each
+ *           channel has one [INFO] line per minute, on the minute
+ */
+static void TestUart(FILE *f)
+{
+    char line[256];
+    u32 info[ADC_NUM_CH] = { 0 }, last[ADC_NUM_CH] = { 0 };
+    u32 ch, m, s;
+    u8  inEdit = 0, entered = 0, left = 0, rtc = 0, sp = 0;
+
+    rewind(f);
+    while(fgets(line, sizeof(line), f))
+    {
+        if(strstr(line, "Time Editing Mode Activated"))
+            inEdit = entered = 1;
+        if(strstr(line, "EXIT EDIT MODE"))
+        {
+            inEdit = 0;
+            left   = 1;
+        }
+        rtc |= (strstr(line, "RTC EDIT MODE") != 0);
+        sp  |= (strstr(line, "SET POINT EDIT MODE") != 0);
+
+        if(!inEdit || strncmp(line, "[INFO] CH", 9))
+            continue;
+        ch = line[9] - '0';
+        CHECK(ch < ADC_NUM_CH);
+        if(ch >= ADC_NUM_CH || sscanf(strchr(line, '|'), "| 23:%u:%u", &m, &s) != 2)
+        {
+            CHECK(0);
+            continue;
+        }
+        CHECK_EQ(s, 0);
+        if(info[ch])
+            CHECK_EQ(m, last[ch] + 1);
+        last[ch] = m;
+        info[ch]++;
+    }
+
+    CHECK(entered && left && rtc && sp);
+    for(ch = 0; ch < ADC_NUM_CH; ch++)
+    {
+        CHECK_EQ(info[ch], EDIT_TO / 60 - EDIT_FROM / 60);
+        if(testFails)
+            printf("uart CH%u: %u lines in edit mode\n", ch, info[ch]);
+    }
+}
+
+static void TestHistory(void)
+{
+    FlashRec r;
+    u32 epoch[ADC_NUM_CH][64], n[ADC_NUM_CH] = { 0 };
+    u32 i, ch;
+
+    for(i = Hist_First(); i != Hist_Next(); i++)
+    {
+        CHECK(Hist_Get(i, &r));
+        ch = (r.code >> LOGREC_CH_BITS) & 3;
+        if(n[ch] < 64)
+            epoch[ch][n[ch]++] = r.epoch;
+    }
+    for(ch = 0; ch < ADC_NUM_CH; ch++)
+        CheckSeries("history", ch, epoch[ch], n[ch]);
+}
+
+static void TestFlash(void)
+{
+    const FlashPage *pg;
+    u32 epoch[ADC_NUM_CH][64], n[ADC_NUM_CH] = { 0 };
+    u32 seq, i, ch;
+
+    FlashLog_Sync();                  // Program the partly filled page
+    CHECK_EQ(flogStats.errors, 0);
+    for(seq = flogFirstSeq; seq != flogNextSeq; seq++)
+    {
+        pg = FlashLog_FindPage(seq);
+        CHECK(pg != 0);
+        if(!pg)
+            continue;
+        for(i = 0; i < pg->count; i++)
+        {
+            ch = (pg->rec[i].code >> LOGREC_CH_BITS) & 3;
+            if(n[ch] < 64)
+                epoch[ch][n[ch]++] = pg->rec[i].epoch;
+        }
+    }
+    for(ch = 0; ch < ADC_NUM_CH; ch++)
+        CheckSeries("flash", ch, epoch[ch], n[ch]);
+}
+
+/*
+ * No task overran or was skipped, nothing was dropped. The only
+ * exception is a sector erase, which stalls the CPU for 400 ms:
+ * it may cost each task one late and one skipped period.
+ */
+static void TestTiming(void)
+{
+    u32 i;
+
+    for(i = 0; i < schedTaskCnt; i++)
+    {
+        CHECK(schedTask[i].misses <= flogStats.erases);
+        CHECK(schedTask[i].skips <= flogStats.erases);
+    }
+    CHECK_EQ(adcDropCnt, 0);
+    CHECK_EQ(uartTxDropCnt, 0);
+}
+
+int main(int argc, char **argv)
+{
+    FILE *f = tmpfile();
+
+    CHECK(f != 0 && argc > 1);
+    if(!f || argc < 2)
+        return TEST_END();
+
+    Sim_Init();
+    CHECK(Sim_LoadScenario(argv[1]));
+    Sim_UartOutput(f);
+    Sim_Run(Firmware, RUN_S);
+    Sim_UartOutput(0);
+
+    CHECK_EQ(sensorCfg[1].limit, 99);     // The set-point edit took
+    TestUart(f);
+    TestTiming();
+    TestHistory();
+    TestFlash();
+    fclose(f);
+    return TEST_END();
+}
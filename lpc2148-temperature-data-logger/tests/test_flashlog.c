@@ -0,0 +1,257 @@
+#include <string.h>          // memset
+#include "test.h"            // CHECK / CHECK_EQ
+#include "types.h"           // Custom data types (u8, u32, s16)
+#include "sim.h"             // Register model, Sim_FlashCut
+#include "flashlog.h"        // Flash log under test
+#include "logrec.h"          // LOGREC_F_ALERT, LOGREC_CH_BITS
+
+/* ================= FLASH LOG RECOVERY ================= */
+/*
+ * The log is written by a stand-in for the logging task (Writer)
+ * under Sim_Run, so Sim_FlashCut can end it inside an IAP command
+ * as a power cut would. Record n has epoch n, so what survived a
+ * cut and where the log resumes can be checked exactly.
+ *
+ * Without syncs, page p (counted from a blank log) is programmed
+ * by IAP erase/copy command p + p/16 + 2; pages with p % 16 == 0
+ * are preceded by the erase of their sector, command p + p/16 + 1.
+ */
+#define RECS       FLOG_RECS_PER_PAGE
+#define PAGES      FLOG_NUM_PAGES
+#define SEC_PAGES  FLOG_PAGES_PER_SEC
+
+#define COPY_CMD(p)   ((p) + (p) / SEC_PAGES + 2)
+#define ERASE_CMD(p)  ((p) + (p) / SEC_PAGES + 1)
+
+static u32 recNext;          // Epoch of the next record
+static u32 recEnd;           // Writer stops before this one
+static u32 syncEvery;        // Every n-th record is an alarm (0 = none)
+
+static u16 RecFlags(u32 n)
+{
+    return (syncEvery && (n % syncEvery == syncEvery - 1)) ? LOGREC_F_ALERT : 0;
+}
+
+static u16 RecCode(u32 n)
+{
+    return (n & LOGREC_CODE_MASK) | ((n & 3) << LOGREC_CH_BITS) | RecFlags(n);
+}
+
+static void Writer(void)
+{
+    u32 n;
+
+    while(recNext != recEnd)
+    {
+        n = recNext++;
+        FlashLog_Append(n, (s16)(n * 7), n & 3, n, RecFlags(n));
+    }
+}
+
+// Appends records up to end, unless a pending cut stops it first
+static void Write(u32 end)
+{
+    recEnd = end;
+    Sim_Run(Writer, 1e6);
+}
+
+// Reset: the model restarts, flash keeps its contents
+static void PowerUp(void)
+{
+    Sim_Init();
+    memset(&flogStats, 0, sizeof(flogStats));
+    FlashLog_Init();
+}
+
+static void BlankFlash(void)
+{
+    memset(simFlash, 0xFF, SIM_FLASH_SIZE);
+    recNext   = 0;
+    syncEvery = 0;
+    PowerUp();
+}
+
+static u32 PageIndex(const FlashPage *pg)
+{
+    return ((u32)(unsigned long)pg - FLOG_BASE_ADDR) / FLOG_PAGE_SIZE;
+}
+
+/*
+ * Function: CheckLog
+ * Purpose : Every page from flogFirstSeq to flogNextSeq - 1 is
+ *           there and together they hold records first..end - 1
+ */
+static void CheckLog(u32 first, u32 end)
+{
+    const FlashPage *pg;
+    u32 seq, i, n = first;
+
+    for(seq = flogFirstSeq; seq != flogNextSeq && !TEST_FAILED(); seq++)
+    {
+        pg = FlashLog_FindPage(seq);
+        CHECK(pg != 0);
+        if(!pg)
+            continue;
+        for(i = 0; i < pg->count; i++, n++)
+        {
+            CHECK_EQ(pg->rec[i].epoch, n);
+            CHECK_EQ(pg->rec[i].temp, (s16)(n * 7));
+            CHECK_EQ(pg->rec[i].code, RecCode(n));
+        }
+    }
+    CHECK_EQ(n, end);
+}
+
+/* ================= POWER CUT WHILE PROGRAMMING ================= */
+/*
+ * The copy of page p stops after keep bytes (less than the 252
+ * the 30 records and header fill). The page is torn, or still
+ * blank if keep is 0, its records are lost and everything before
+ * it must be intact. The log resumes with the same sequence
+ * number in the next page; in the same page if it was left blank
+ * or starts a sector, which is then erased again.
+ */
+static void TestCutCopy(u32 p, u32 keep)
+{
+    const FlashPage *pg;
+    u32 first = (p >= PAGES) ? (p / SEC_PAGES) * SEC_PAGES - (PAGES - SEC_PAGES) : 0;
+
+    BlankFlash();
+    Sim_FlashCut(COPY_CMD(p), keep);
+    Write(~0u);
+    CHECK_EQ(recNext, (p + 1) * RECS);           // Cut in page p
+
+    PowerUp();
+    CHECK_EQ(flogNextSeq, p);
+    CHECK_EQ(flogFirstSeq, first);
+    CHECK(FlashLog_FindPage(p) == 0);
+    CheckLog(first * RECS, p * RECS);
+
+    // The same records again: they land in the next free page
+    recNext = p * RECS;
+    Write((p + 1) * RECS);
+    CHECK_EQ(flogStats.errors, 0);
+    pg = FlashLog_FindPage(p);
+    CHECK(pg != 0);
+    if(pg)
+        CHECK_EQ(PageIndex(pg), (p + ((keep && p % SEC_PAGES) ? 1 : 0)) % PAGES);
+    CHECK_EQ(flogNextSeq, p + 1);
+    CheckLog(flogFirstSeq * RECS, (p + 1) * RECS);
+
+    if(testFails)
+        printf("copy cut: page %u, %u bytes programmed\n", p, keep);
+}
+
+/* ================= POWER CUT WHILE ERASING ================= */
+/*
+ * The erase of the sector that page p (a sector start, after the
+ * log has wrapped) enters stops after keep bytes. Pages of the
+ * old data still whole in that sector stay valid and keep the
+ * oldest sequence number down; the next page erases the sector
+ * again and writes page p at its start.
+ */
+static void TestCutErase(u32 p, u32 keep)
+{
+    const FlashPage *pg;
+    u32 sec = (p % PAGES) / SEC_PAGES;
+    u32 gone = (keep + FLOG_PAGE_SIZE - 1) / FLOG_PAGE_SIZE;
+    u64 erases;
+
+    if(gone > SEC_PAGES)
+        gone = SEC_PAGES;
+
+    BlankFlash();
+    Sim_FlashCut(ERASE_CMD(p), keep);
+    Write(~0u);
+    CHECK_EQ(recNext, (p + 1) * RECS);
+    erases = simStats.flashErases[sec];
+
+    PowerUp();
+    CHECK_EQ(flogNextSeq, p);
+    CHECK_EQ(flogFirstSeq, p - PAGES + gone);
+    CheckLog(flogFirstSeq * RECS, p * RECS);
+
+    recNext = p * RECS;
+    Write((p + 1) * RECS);
+    CHECK_EQ(flogStats.errors, 0);
+    CHECK_EQ(simStats.flashErases[sec], 1);      // Erased again
+    pg = FlashLog_FindPage(p);
+    CHECK(pg != 0);
+    if(pg)
+        CHECK_EQ(PageIndex(pg), p % PAGES);
+    CHECK_EQ(flogFirstSeq, p - (PAGES - SEC_PAGES));
+    CheckLog(flogFirstSeq * RECS, (p + 1) * RECS);
+
+    if(testFails)
+        printf("erase cut: page %u, %u bytes erased (%llu erases)\n",
+               p, keep, (unsigned long long)erases);
+}
+
+/* ================= WEAR OVER A LONG RUN ================= */
+/*
+ * 2000 pages, a sync (alarm record) every 13 records so pages
+ * are of mixed fill, and a reset every few hundred records (the
+ * records still in the page buffer are lost). Each session
+ * resumes where the last one stopped, so the sectors see the
+ * same number of erase cycles (within one).
+ */
+static void TestWear(void)
+{
+    u64 erases[SIM_FLASH_SECS] = { 0 }, total = 0, lo = ~0ull, hi = 0;
+    u32 pages = 0, seg = 0, s;
+
+    BlankFlash();
+    syncEvery = 13;
+
+    while(pages < 2000 && !TEST_FAILED())
+    {
+        PowerUp();
+        Write(recNext + 200 + (seg++ * 137) % 700);
+        CHECK_EQ(flogStats.errors, 0);
+        pages += flogStats.pages;
+        for(s = 0; s < SIM_FLASH_SECS; s++)
+            erases[s] += simStats.flashErases[s];
+    }
+
+    printf("wear: %u pages in %u sessions, erases per sector:", pages, seg);
+    for(s = 0; s < SIM_FLASH_SECS; s++)
+    {
+        printf(" %llu", (unsigned long long)erases[s]);
+        total += erases[s];
+        if(erases[s] < lo)
+            lo = erases[s];
+        if(erases[s] > hi)
+            hi = erases[s];
+    }
+    printf("\n");
+
+    CHECK(hi - lo <= 1);
+    CHECK(total >= pages / SEC_PAGES);
+    CHECK(total <= pages / SEC_PAGES + 1);
+
+    // Three whole sectors and the one being filled are valid
+    PowerUp();
+    CHECK_EQ(flogNextSeq, pages);
+    CHECK_EQ(flogFirstSeq, ((pages - 1) / SEC_PAGES) * SEC_PAGES - (PAGES - SEC_PAGES));
+}
+
+int main(void)
+{
+    static const u32 keeps[] = { 0, 1, 12, 100, 251 };
+    static const u32 pages[] = { 0, 1, 15, 16, 40, 63, 64, 85, 127, 200 };
+    static const u32 eraseKeeps[] = { 0, 1, 256, 1000, 2048, 4095, 4096 };
+    static const u32 erasePages[] = { 64, 80, 96, 112, 128, 176 };
+    u32 i, j;
+
+    for(i = 0; i < sizeof(pages) / sizeof(pages[0]); i++)
+        for(j = 0; j < sizeof(keeps) / sizeof(keeps[0]); j++)
+            TestCutCopy(pages[i], keeps[j]);
+
+    for(i = 0; i < sizeof(erasePages) / sizeof(erasePages[0]); i++)
+        for(j = 0; j < sizeof(eraseKeeps) / sizeof(eraseKeeps[0]); j++)
+            TestCutErase(erasePages[i], eraseKeeps[j]);
+
+    TestWear();
+
+    return TEST_END();
+}
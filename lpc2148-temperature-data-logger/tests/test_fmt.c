@@ -0,0 +1,301 @@
+/*
+ * Fmt_* against the output of the routines it replaced.
+ *
+ * "Old output" is the text the drivers sent before fmt.c existed.
+ * The Old_* functions below reproduce it: each is a copy of the
+ * original digit loop (UARTTxU32 and UARTTxF32 in uart.c, IntLCD
+ * and FltLCD in lcd.c, DisplayRTCTime and DisplayRTCDate in rtc.c,
+ * whose fields UARTTX_Data also sent), with every UARTTxChar /
+ * CharLCD call turned into a store to a buffer. The new routines
+ * must give the same characters wherever the old loops were well
+ * defined; the routines with no old counterpart (Fmt_Centi,
+ * Fmt_UPad, Fmt_U2) are checked against snprintf.
+ */
+#include <stdio.h>           // snprintf reference
+#include <string.h>          // memcmp
+#include "test.h"            // CHECK / CHECK_EQ
+#include "types.h"           // Custom data types (u8, u32, s32, f32)
+#include "fmt.h"             // Formatting routines under test
+
+/* ================= OUTPUT OF THE OLD ROUTINES ================= */
+
+// UARTTxU32
+static u32 Old_U32(u8 *out, u32 num)
+{
+    char buf[10];
+    int i = 0;
+    u32 n = 0;
+
+    if(num == 0)
+    {
+        out[0] = '0';
+        return 1;
+    }
+    while(num)
+    {
+        buf[i++] = num % 10 + '0';
+        num /= 10;
+    }
+    while(i--)
+        out[n++] = buf[i];
+    return n;
+}
+
+// IntLCD (INT_MIN overflowed in -num and is not compared)
+static u32 Old_S32(u8 *out, s32 num)
+{
+    u8 a[10];
+    s8 i = 0;
+    u32 n = 0;
+
+    if(num == 0)
+        out[n++] = '0';
+    else
+    {
+        if(num < 0)
+        {
+            num = -num;
+            out[n++] = '-';
+        }
+        while(num > 0)
+        {
+            a[i++] = num % 10 + 48;
+            num = num / 10;
+        }
+        for(--i; i >= 0; i--)
+            out[n++] = a[i];
+    }
+    return n;
+}
+
+// UARTTxF32 (2 decimals)
+static u32 Old_F32Uart(u8 *out, f32 fnum)
+{
+    u32 ipart, n = 0;
+    u8 i;
+
+    if(fnum < 0)
+    {
+        out[n++] = '-';
+        fnum = -fnum;
+    }
+    ipart = (u32)fnum;
+    n += Old_U32(&out[n], ipart);
+    out[n++] = '.';
+    fnum = fnum - ipart;
+    for(i = 0; i < 2; i++)
+    {
+        fnum *= 10;
+        out[n++] = (u8)fnum + '0';
+        fnum -= (u8)fnum;
+    }
+    return n;
+}
+
+// FltLCD (6 decimals; integer part through IntLCD, so < 2^31)
+static u32 Old_F32Lcd(u8 *out, f32 fnum)
+{
+    u32 num, i, n = 0;
+
+    if(fnum < 0)
+    {
+        out[n++] = '-';
+        fnum = -fnum;
+    }
+    num = fnum;
+    n += Old_S32(&out[n], num);
+    out[n++] = '.';
+    for(i = 0; i < 6; i++)
+    {
+        fnum = (fnum - num) * 10;
+        num = fnum;
+        out[n++] = num + 48;
+    }
+    return n;
+}
+
+// DisplayRTCTime / the time part of UARTTX_Data
+static u32 Old_Time(u8 *out, u32 hour, u32 minute, u32 second)
+{
+    out[0] = hour / 10 + 48;    out[1] = hour % 10 + 48;    out[2] = ':';
+    out[3] = minute / 10 + 48;  out[4] = minute % 10 + 48;  out[5] = ':';
+    out[6] = second / 10 + 48;  out[7] = second % 10 + 48;
+    return 8;
+}
+
+// DisplayRTCDate / the date part of UARTTX_Data
+static u32 Old_Date(u8 *out, u32 date, u32 month, u32 year)
+{
+    out[0] = date / 10 + 48;    out[1] = date % 10 + 48;    out[2] = '/';
+    out[3] = month / 10 + 48;   out[4] = month % 10 + 48;   out[5] = '/';
+    return 6 + Old_S32(&out[6], year);
+}
+
+/* ================= COMPARISON ================= */
+
+static u32 lcg = 1;
+
+static u32 Rand(void)
+{
+    lcg = lcg * 1664525 + 1013904223;
+    return lcg;
+}
+
+static void Same(const u8 *newBuf, const u8 *newEnd, const u8 *oldBuf,
+                 u32 oldLen, const char *what, double arg)
+{
+    if((u32)(newEnd - newBuf) != oldLen || memcmp(newBuf, oldBuf, oldLen))
+    {
+        testFails++;
+        printf("%s(%.9g): \"%.*s\", old \"%.*s\"\n", what, arg,
+               (int)(newEnd - newBuf), newBuf, (int)oldLen, oldBuf);
+    }
+}
+
+static void U32(u32 n)
+{
+    u8 a[32], b[32];
+
+    Same(a, Fmt_U32(a, n), b, Old_U32(b, n), "Fmt_U32", n);
+}
+
+static void S32(s32 n)
+{
+    u8 a[32], b[32];
+
+    Same(a, Fmt_S32(a, n), b, Old_S32(b, n), "Fmt_S32", n);
+}
+
+static void F32(f32 f)
+{
+    u8 a[48], b[48];
+
+    if(f > -4294967040.0f && f < 4294967040.0f)
+        Same(a, Fmt_F32(a, f, 2), b, Old_F32Uart(b, f), "Fmt_F32/2", f);
+    if(f > -2147483520.0f && f < 2147483520.0f)
+        Same(a, Fmt_F32(a, f, 6), b, Old_F32Lcd(b, f), "Fmt_F32/6", f);
+}
+
+/* --------- Reciprocal divisions, every u32 --------- */
+static void TestDiv(void)
+{
+    u32 n = 0, bad = 0;
+
+    do
+    {
+        if(FMT_DIV10(n) != n / 10 || FMT_DIV100(n) != n / 100)
+            bad++;
+    } while(++n != 0);
+    CHECK_EQ(bad, 0);
+}
+
+/* --------- Integers --------- */
+static void TestInt(void)
+{
+    u32 i, p;
+
+    for(i = 0; i < (1u << 24) && !TEST_FAILED(); i++)
+    {
+        U32(i);
+        S32((s32)i);
+        S32(-(s32)i);
+    }
+
+    // Around every power of ten and the type limits
+    for(p = 10; p <= 1000000000; p *= 10)
+        for(i = p - 1000; i < p + 1000; i++)
+            U32(i), S32((s32)i), S32(-(s32)i);
+    for(i = 0; i < 1000; i++)
+    {
+        U32(0xFFFFFFFF - i);
+        S32(0x7FFFFFFF - i);
+        S32(-0x7FFFFFFF + i);
+    }
+
+    for(i = 0; i < 4000000 && !TEST_FAILED(); i++)
+    {
+        p = Rand();
+        U32(p);
+        if(p != 0x80000000)
+            S32((s32)p);
+    }
+}
+
+/* --------- Floats --------- */
+static void TestFloat(void)
+{
+    s32 c;
+    u32 i, bits;
+    f32 f;
+
+    // Every temperature in centi-degrees the logger can show
+    for(c = -100000; c <= 100000 && !TEST_FAILED(); c++)
+        F32(c / 100.0f);
+
+    // A spread of all finite bit patterns
+    for(i = 0; i < 4000000 && !TEST_FAILED(); i++)
+    {
+        bits = Rand();
+        memcpy(&f, &bits, sizeof(f));
+        if(f == f)
+            F32(f);
+    }
+}
+
+/* --------- Fixed point, padding, time and date --------- */
+static void TestFields(void)
+{
+    char ref[32];
+    u8 a[32], b[32];
+    u32 h, m, s, d, y, n, w, i;
+    s32 v;
+
+    for(h = 0; h < 24; h++)
+        for(m = 0; m < 60; m++)
+            for(s = 0; s < 60; s++)
+                Same(a, Fmt_Time(a, h, m, s), b, Old_Time(b, h, m, s),
+                     "Fmt_Time", h * 10000 + m * 100 + s);
+
+    for(y = 0; y < 10000 && !TEST_FAILED(); y++)
+        for(m = 1; m <= 12; m++)
+            for(d = 1; d <= 31; d++)
+                Same(a, Fmt_Date(a, d, m, y), b, Old_Date(b, d, m, y),
+                     "Fmt_Date", y * 10000 + m * 100 + d);
+
+    // Centi values as UARTTxCenti prints them: "[-]I.FF"
+    for(i = 0; i < 2000000 && !TEST_FAILED(); i++)
+    {
+        v = (i < 1000000) ? (s32)i - 500000 : (s32)Rand();
+        n = snprintf(ref, sizeof(ref), "%s%u.%02u", (v < 0) ? "-" : "",
+                     (unsigned)((v < 0 ? -(u32)v : (u32)v) / 100),
+                     (unsigned)((v < 0 ? -(u32)v : (u32)v) % 100));
+        Same(a, Fmt_Centi(a, v), (u8 *)ref, n, "Fmt_Centi", v);
+    }
+
+    for(w = 0; w <= 12; w++)
+        for(i = 0; i < 20000; i++)
+        {
+            n = (i < 10000) ? i : Rand() >> (i % 32);
+            Same(a, Fmt_UPad(a, n, w), (u8 *)ref,
+                 snprintf(ref, sizeof(ref), "%0*u", (int)w, (unsigned)n),
+                 "Fmt_UPad", n);
+        }
+
+    for(i = 0; i < 1000; i++)
+    {
+        Same(a, Fmt_U2(a, i), (u8 *)ref,
+             snprintf(ref, sizeof(ref), "%02u", i % 100), "Fmt_U2", i);
+    }
+
+    CHECK_EQ(Fmt_Str(a, "CH1 ") - a, 4);
+    CHECK(!memcmp(a, "CH1 ", 4));
+}
+
+int main(void)
+{
+    TestDiv();
+    TestInt();
+    TestFloat();
+    TestFields();
+    return TEST_END();
+}
@@ -0,0 +1,238 @@
+#include <string.h>          // strlen
+#include "test.h"            // CHECK / CHECK_EQ
+#include "types.h"           // Custom data types (u8, u32)
+#include "sim.h"             // Register model, Sim_Key
+#include "delay.h"           // Delay_Init (Timer1 tick)
+#include "keyPd.h"           // Scanner and debounce under test
+
+/* ================= DEBOUNCE STATE MACHINE ================= */
+/*
+ * KeyPd_Debounce is fed one sample per character ('1' down,
+ * '0' up, anything else ignored); the events it queued are
+ * compared with the expected ones
+ */
+static void Reset(void)
+{
+    KeyPd_Reset();
+    keyDropCnt = 0;
+}
+
+static void Feed(u8 key, const char *samples)
+{
+    for(; *samples; samples++)
+        if(*samples == '0' || *samples == '1')
+            KeyPd_Debounce(key, *samples == '1');
+}
+
+static void FeedN(u8 key, u8 down, u32 n)
+{
+    while(n--)
+        KeyPd_Debounce(key, down);
+}
+
+// Takes every queued event; returns how many and the last one
+static u32 Events(u8 *last)
+{
+    u32 n = 0;
+    u8 ev;
+
+    *last = 0;
+    while(KeyPd_GetEvent(&ev))
+    {
+        *last = ev;
+        n++;
+    }
+    return n;
+}
+
+static void TestDebounce(void)
+{
+    u8 ev;
+
+    // Clean press and release: accepted on the KEY_DEBOUNCE-th sample
+    Reset();
+    Feed(5, "11");
+    CHECK_EQ(Events(&ev), 0);
+    Feed(5, "1");
+    CHECK_EQ(Events(&ev), 1);
+    CHECK_EQ(ev, KEY_EV_PRESS | 5);
+    Feed(5, "111 00");
+    CHECK_EQ(Events(&ev), 0);
+    Feed(5, "0");
+    CHECK_EQ(Events(&ev), 1);
+    CHECK_EQ(ev, KEY_EV_RELEASE | 5);
+    CHECK_EQ(keySt[5], KEY_ST_UP);
+
+    // Contact bounce on press: one press once it settles
+    Reset();
+    Feed(7, "1010 1101 110 111");
+    CHECK_EQ(Events(&ev), 1);
+    CHECK_EQ(ev, KEY_EV_PRESS | 7);
+
+    // Glitches shorter than KEY_DEBOUNCE never get through
+    Reset();
+    Feed(7, "1 0 11 0 1 0 11 0 0000");
+    CHECK_EQ(Events(&ev), 0);
+
+    // Bounce on release: still one press, one release
+    Reset();
+    Feed(9, "111 1111 0 1 00 1 0 1 000");
+    CHECK_EQ(Events(&ev), 2);
+    CHECK_EQ(ev, KEY_EV_RELEASE | 9);
+
+    // A dropout shorter than KEY_DEBOUNCE does not split a press
+    Reset();
+    Feed(9, "111 11 00 1111 00 111");
+    CHECK_EQ(Events(&ev), 1);
+    CHECK_EQ(keySt[9], KEY_ST_DOWN);
+}
+
+static void TestLong(void)
+{
+    u8 ev;
+
+    // LONG once, KEY_LONG_SAMPLES after the press
+    Reset();
+    Feed(3, "111");
+    CHECK_EQ(Events(&ev), 1);
+    FeedN(3, 1, KEY_LONG_SAMPLES - 1);
+    CHECK_EQ(Events(&ev), 0);
+    FeedN(3, 1, 1);
+    CHECK_EQ(Events(&ev), 1);
+    CHECK_EQ(ev, KEY_EV_LONG | 3);
+    FeedN(3, 1, 10 * KEY_LONG_SAMPLES);
+    CHECK_EQ(Events(&ev), 0);
+
+    // A release bounce after it does not repeat it
+    Feed(3, "0 1");
+    FeedN(3, 1, 2 * KEY_LONG_SAMPLES);
+    CHECK_EQ(Events(&ev), 0);
+    Feed(3, "000");
+    CHECK_EQ(Events(&ev), 1);
+    CHECK_EQ(ev, KEY_EV_RELEASE | 3);
+
+    // Released just before: no LONG
+    Reset();
+    FeedN(3, 1, KEY_DEBOUNCE + KEY_LONG_SAMPLES - 1);
+    FeedN(3, 0, KEY_DEBOUNCE);
+    CHECK_EQ(Events(&ev), 2);
+    CHECK_EQ(ev, KEY_EV_RELEASE | 3);
+}
+
+static void TestQueue(void)
+{
+    u8 ev, k;
+
+    // Keys are independent
+    Reset();
+    Feed(0, "11");
+    Feed(15, "111");
+    Feed(0, "0");
+    CHECK_EQ(Events(&ev), 1);
+    CHECK_EQ(ev, KEY_EV_PRESS | 15);
+
+    // A full queue drops the newest events and counts them
+    Reset();
+    for(k = 0; k < 12; k++)
+        Feed(k, "111 000");
+    CHECK_EQ(keyDropCnt, 24 - KEY_QUEUE_SIZE);
+    CHECK(KeyPd_GetEvent(&ev));
+    CHECK_EQ(ev, KEY_EV_PRESS | 0);
+    CHECK_EQ(Events(&ev), KEY_QUEUE_SIZE - 1);
+    CHECK_EQ(ev, KEY_EV_RELEASE | 7);
+
+    Feed(1, "111");
+    KeyPd_Flush();
+    CHECK_EQ(Events(&ev), 0);
+}
+
+/* ================= SCANNER ON THE REGISTER MODEL ================= */
+/*
+ * Every key pressed through the port model must come back as
+ * its own LUT value, within the debounce time
+ */
+#define SAMPLE_US   (KEY_SCAN_US * 4)     // One sample of every key
+
+static void TestScan(void)
+{
+    u8 ev;
+    u32 k;
+
+    Sim_Init();
+    Delay_Init();
+    KeyPdInit();
+    KeyPd_StartScan();
+    keyDropCnt = 0;
+    Sim_Idle(SIM_US(50000));
+    CHECK_EQ(Events(&ev), 0);
+
+    for(k = 0; k < 16; k++)
+    {
+        Sim_Key(k, 1);
+        Sim_Idle(SIM_US((KEY_DEBOUNCE - 1) * SAMPLE_US - KEY_SCAN_US));
+        CHECK_EQ(Events(&ev), 0);
+        Sim_Idle(SIM_US(2 * SAMPLE_US));
+        CHECK_EQ(Events(&ev), 1);
+        CHECK_EQ(ev, KEY_EV_PRESS | k);
+
+        Sim_Key(k, 0);
+        Sim_Idle(SIM_US((KEY_DEBOUNCE + 1) * SAMPLE_US));
+        CHECK_EQ(Events(&ev), 1);
+        CHECK_EQ(ev, KEY_EV_RELEASE | k);
+    }
+
+    // Held for a second and a half: press, long press, release
+    Sim_Key(6, 1);
+    Sim_Idle(SIM_US(1500000));
+    CHECK(KeyPd_GetEvent(&ev));
+    CHECK_EQ(ev, KEY_EV_PRESS | 6);
+    CHECK(KeyPd_GetEvent(&ev));
+    CHECK_EQ(ev, KEY_EV_LONG | 6);
+    Sim_Key(6, 0);
+    Sim_Idle(SIM_US(50000));
+    CHECK_EQ(Events(&ev), 1);
+    CHECK_EQ(ev, KEY_EV_RELEASE | 6);
+    CHECK_EQ(keyDropCnt, 0);
+}
+
+/*
+ * A sector erase stalls the CPU for 400 ms, far past the next
+ * scan tick; scanning must carry on afterwards
+ */
+static void TestStall(void)
+{
+    unsigned int cmd[5], res[5];
+    u8 ev;
+
+    Sim_Init();
+    Delay_Init();
+    KeyPdInit();
+    KeyPd_StartScan();
+    Sim_Idle(SIM_US(50000));
+
+    cmd[0] = 50;                          // Prepare
+    cmd[1] = cmd[2] = SIM_FLASH_FIRST;
+    Sim_IAP(cmd, res);
+    CHECK_EQ(res[0], 0);
+    cmd[0] = 52;                          // Erase
+    cmd[3] = 60000;
+    Sim_IAP(cmd, res);
+    CHECK_EQ(res[0], 0);
+    Sim_Idle(SIM_US(50000));
+
+    Sim_Key(9, 1);
+    Sim_Idle(SIM_US((KEY_DEBOUNCE + 1) * SAMPLE_US));
+    CHECK_EQ(Events(&ev), 1);
+    CHECK_EQ(ev, KEY_EV_PRESS | 9);
+    Sim_Key(9, 0);
+}
+
+int main(void)
+{
+    TestDebounce();
+    TestLong();
+    TestQueue();
+    TestScan();
+    TestStall();
+    return TEST_END();
+}
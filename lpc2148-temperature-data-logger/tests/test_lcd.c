@@ -0,0 +1,187 @@
+#include <string.h>          // memcmp, memcpy
+#include "test.h"            // CHECK / CHECK_EQ
+#include "types.h"           // Custom data types (u8, u32, u64)
+#include "sim.h"             // Register model, HD44780 contents
+#include "delay.h"           // Timer1 tick
+#include "lcd.h"             // Driver under test
+
+#define BUSY_TIMEOUT  3000            // LCD_BUSY_TIMEOUT in lcd.c (us)
+
+/*
+ * Function: Start
+ * Purpose : Fresh model and LCD, deferred updates
+ */
+static void Start(void)
+{
+    Sim_Init();
+    Delay_Init();
+    InitLCD();
+    LCD_SetSync(0);
+}
+
+// Glass matches the two expected rows
+static u8 Glass(const char *row0, const char *row1)
+{
+    char buf[LCD_COLS + 1];
+    u8 ok;
+
+    Sim_LcdRow(0, buf);
+    ok = !memcmp(buf, row0, LCD_COLS);
+    Sim_LcdRow(1, buf);
+    ok &= !memcmp(buf, row1, LCD_COLS);
+    return ok;
+}
+
+/*
+ * Function: Flushed
+ * Purpose : LCD_Flush, returning the bytes it put on the bus;
+ *           the model must have latched the same number
+ */
+static u32 Flushed(void)
+{
+    u32 n;
+    u64 m;
+
+    Sim_Idle(0);                      // Let earlier writes latch
+    n = lcdBusWrites;
+    m = simStats.lcdWrites;
+    LCD_Flush();
+    Sim_Idle(0);
+    CHECK_EQ(simStats.lcdWrites - m, lcdBusWrites - n);
+    return lcdBusWrites - n;
+}
+
+/* ================= ONLY CHANGED CELLS ================= */
+/*
+ * The main loop clears and redraws the whole screen; only the
+ * cells that really changed may reach the bus, each run of
+ * adjacent changes needing one cursor move, plus one move back
+ * to the logical cursor at the end.
+ */
+static void TestFlush(void)
+{
+    Start();
+    CHECK_EQ(Flushed(), 0);                            // Nothing drawn yet
+
+    CmdLCD(0x80);
+    StrLCD((u8 *)"CH1 25.00 C");
+    CmdLCD(0xC0);
+    StrLCD((u8 *)"12:00:00");
+    CHECK_EQ(Flushed(), 11 + 1 + 8);                   // 2nd row needs a move
+    CHECK(Glass("CH1 25.00 C     ", "12:00:00        "));
+
+    // Same screen again after a clear: nothing to send
+    CmdLCD(0x01);
+    CmdLCD(0x80);
+    StrLCD((u8 *)"CH1 25.00 C");
+    CmdLCD(0xC0);
+    StrLCD((u8 *)"12:00:00");
+    CHECK_EQ(Flushed(), 0);
+
+    // One digit: move, digit, move back
+    CmdLCD(0x80 | 7);
+    CharLCD('1');
+    CmdLCD(0xC8);
+    CHECK_EQ(Flushed(), 3);
+    CHECK(Glass("CH1 25.10 C     ", "12:00:00        "));
+
+    // Rewritten fields with one changed cell each; the cursor ends
+    // where the logical one is, so no move back
+    CmdLCD(0x80 | 4);
+    StrLCD((u8 *)"26.10");
+    CmdLCD(0xC0 | 6);
+    StrLCD((u8 *)"01");
+    CHECK_EQ(Flushed(), 1 + 1 + 1 + 1);                // Move, "6", move, "1"
+    CHECK(Glass("CH1 26.10 C     ", "12:00:01        "));
+
+    // Cursor moves only: one write to place the cursor
+    CmdLCD(0x80);
+    CHECK_EQ(Flushed(), 1);
+    CHECK_EQ(Flushed(), 0);
+    CHECK_EQ(simStats.lcdBusy, 0);                     // Busy flag obeyed
+    CHECK_EQ(lcdBusyTimeouts, 0);
+}
+
+/* ================= CUSTOM CHARACTERS ================= */
+/*
+ * A CGRAM address command flushes what is pending, then the
+ * pattern bytes go straight to the LCD (the framebuffer only
+ * holds DDRAM). The address counter is shared, so after CGRAM
+ * the driver must not trust its DDRAM address (lcdHwAddr
+ * unknown): the next cell written needs a cursor move.
+ */
+static void TestCgram(void)
+{
+    static const u8 font[8] = { 0x00, 0x00, 0x04, 0x0C, 0x1C, 0x1C, 0x1C, 0x00 };
+    u8  cg[64];
+    u32 n;
+
+    Start();
+    CmdLCD(0x80);
+    StrLCD((u8 *)"AB");
+
+    n = lcdBusWrites;
+    CmdLCD(0x40);                                      // CGRAM address 0
+    CHECK_EQ(lcdBusWrites - n, 2 + 1);                 // "AB" flushed first
+    CHECK(Glass("AB              ", "                "));
+
+    n = lcdBusWrites;
+    StoreCustCharFont();
+    CHECK_EQ(lcdBusWrites - n, 8);
+    CHECK_EQ(Flushed(), 0);                            // Nothing while in CGRAM
+    Sim_LcdCgram(cg);
+    CHECK(!memcmp(cg, font, sizeof(font)));
+
+    // Back to DDRAM right after "AB": the cursor is set again
+    CmdLCD(0x82);
+    CharLCD(0);
+    CHECK_EQ(Flushed(), 1 + 1);
+    CHECK(Glass("AB\0             ", "                "));
+    Sim_LcdCgram(cg);
+    CHECK(!memcmp(cg, font, sizeof(font)));
+}
+
+/* ================= BUSY FLAG TIMEOUT ================= */
+/*
+ * An LCD that never clears its busy flag costs BUSY_TIMEOUT per
+ * byte, counted in lcdBusyTimeouts, and the driver carries on
+ * with the write; once it answers again writes are fast and the
+ * count stops.
+ */
+static void TestBusy(void)
+{
+    u64 t0, t;
+
+    Start();
+    Sim_LcdHang(1);
+    CmdLCD(0x80);
+    StrLCD((u8 *)"XY");
+
+    t0 = Sim_Now();
+    CHECK_EQ(Flushed(), 2);                            // Cursor already at 0
+    t = Sim_Now() - t0;
+    CHECK_EQ(lcdBusyTimeouts, 2);
+    CHECK(t >= 2 * SIM_US(BUSY_TIMEOUT));
+    CHECK(t <= 2 * SIM_US(BUSY_TIMEOUT + 10));
+
+    Sim_LcdHang(0);
+    CmdLCD(0x80);
+    StrLCD((u8 *)"ZW");
+    t0 = Sim_Now();
+    CHECK_EQ(Flushed(), 1 + 2);
+    t = Sim_Now() - t0;
+    CHECK_EQ(lcdBusyTimeouts, 2);
+    CHECK(t <= 3 * SIM_US(50));                        // 37 us per byte
+    CHECK(Glass("ZW              ", "                "));
+    if(testFails)
+        printf("busy: %u timeouts, last flush %.1f us\n",
+               lcdBusyTimeouts, (double)t / SIM_US(1));
+}
+
+int main(void)
+{
+    TestFlush();
+    TestCgram();
+    TestBusy();
+    return TEST_END();
+}
@@ -0,0 +1,216 @@
+#include <string.h>          // memcmp
+#include "test.h"            // CHECK / CHECK_EQ
+#include "types.h"           // Custom data types (u32, s32, f32, f64)
+#include "lm35.h"            // Tables, sensorCfg, Read_LM35_Centi
+#include "fmt.h"             // Fmt_Centi, Fmt_F32
+
+/* ================= CONVERSION AGAINST THE FLOAT FORMULA ================= */
+/*
+ * The reference is the formula Read_LM35 used before the tables,
+ * in double:
+ *   degC = code * (3.3 / 1023) * 100
+ *   degF = degC * 9/5 + 32
+ * A table entry is that value in centi-degrees, truncated, so it
+ * may be up to 1 centi-degree low and never high; entries above
+ * 327.67 degrees are clipped to 32767. Interpolated
+ * and calibrated readings add their own truncations; the bounds
+ * below are the worst cases those can reach, in centi-degrees.
+ */
+#define TOL_LUT      1       // Table entry: one truncation
+#define TOL_INTERP   2       // Entry plus the interpolation step
+#define TOL_CAL      3       // ... plus the Q16 gain product
+#define TOL_CAL_F    6       // ... plus the integer 9/5 scaling
+
+#define CAL_CH       2
+#define CAL_GAIN     ((s32)(1.05 * LM35_GAIN_ONE))   // +5 %
+#define CAL_OFFSET   (-150)                          // -1.50 degC
+
+static f64 RefC(f64 code)
+{
+    return code * (3.3 / 1023) * 100;
+}
+
+static f64 RefF(f64 degC)
+{
+    return degC * (9 / 5.0) + 32;
+}
+
+// Reference as an uncalibrated (table) reading can hold it
+static f64 Sat(f64 ref)
+{
+    return (ref * 100 > 32767) ? 327.67 : ref;
+}
+
+/*
+ * Function: Within
+ * Purpose : Checks got (centi-degrees) is at most tol below the
+ *           reference and less than one centi-degree above it
+ * Returns : Error in centi-degrees (reference - got)
+ */
+static f64 Within(const char *what, u32 code, s32 got, f64 ref, f64 tol)
+{
+    f64 err = ref * 100 - got;
+
+    if(err > tol + 1e-6 || err < -1 + 1e-6)
+    {
+        CHECK(0);
+        printf("%s code %u: %d, reference %.4f\n", what, code, got, ref * 100);
+    }
+    return err;
+}
+
+/* ================= TABLES ================= */
+
+static void TestLut(void)
+{
+    u32 c;
+    f64 e, maxC = 0, maxF = 0;
+
+    for(c = 0; c < LM35_LUT_SIZE && !TEST_FAILED(); c++)
+    {
+        e = Within("lm35LutC", c, lm35LutC[c], Sat(RefC(c)), TOL_LUT);
+        if(e > maxC)
+            maxC = e;
+        e = Within("lm35LutF", c, lm35LutF[c], Sat(RefF(RefC(c))), TOL_LUT);
+        if(e > maxF)
+            maxF = e;
+    }
+    printf("tables: max error %.3f C, %.3f F (centi)\n", maxC, maxF);
+}
+
+/* ================= READING PATH ================= */
+/*
+ * Every oversampled code (the 10-bit codes and the interpolated
+ * steps between them) through Read_LM35_Centi, on an identity
+ * channel and on one with gain and offset. Where the table
+ * segment reaches the s16 clip (degC from code 1016, degF from
+ * code 510, both far above the LM35's 150 degC, code 465) the
+ * reading can only be checked to be monotonic.
+ */
+static void TestRead(void)
+{
+    s32 got[4], last[4] = { 0 };
+    u32 code, idx, k;
+    u8  clipC, clipF;
+    f64 raw, degC, e, maxId = 0, maxCal = 0;
+
+    sensorCfg[1].gain   = LM35_GAIN_ONE;
+    sensorCfg[1].offset = 0;
+    sensorCfg[CAL_CH].gain   = CAL_GAIN;
+    sensorCfg[CAL_CH].offset = CAL_OFFSET;
+    LM35_InitCal();
+
+    for(code = 0; code <= LM35_CODE_MAX && !TEST_FAILED(); code++)
+    {
+        raw = (f64)code / (1 << LM35_EXTRA_BITS);
+        idx = code >> LM35_EXTRA_BITS;
+        k   = (idx < LM35_LUT_SIZE - 1) ? idx + 1 : idx;
+        clipC = (lm35LutC[k] == 32767);
+        clipF = (lm35LutF[k] == 32767);
+
+        lm35Code[1] = code;
+        lm35Code[CAL_CH] = code;
+        got[0] = Read_LM35_Centi(1, 'C');
+        got[1] = Read_LM35_Centi(1, 'F');
+        got[2] = Read_LM35_Centi(CAL_CH, 'C');
+        got[3] = Read_LM35_Centi(CAL_CH, 'F');
+
+        for(k = 0; k < 4; k++)
+        {
+            CHECK(!code || got[k] >= last[k]);
+            last[k] = got[k];
+        }
+        CHECK(Read_LM35(1, 'C') == got[0] / 100.0f);
+
+        if(!clipC)
+        {
+            e = Within("C", code, got[0], RefC(raw), TOL_INTERP);
+            if(e > maxId)
+                maxId = e;
+
+            degC = RefC(raw) * CAL_GAIN / LM35_GAIN_ONE + CAL_OFFSET / 100.0;
+            e = Within("cal C", code, got[2], degC, TOL_CAL);
+            if(e > maxCal)
+                maxCal = e;
+            Within("cal F", code, got[3], RefF(degC), TOL_CAL_F);
+        }
+        if(!clipF)
+            Within("F", code, got[1], RefF(RefC(raw)), TOL_INTERP);
+        else
+            CHECK(got[1] <= 32767);
+    }
+    printf("readings: max error %.3f C identity, %.3f C calibrated (centi)\n",
+           maxId, maxCal);
+}
+
+/* ================= RENDERED OUTPUT ================= */
+/*
+ * Every 10-bit code on an identity channel, as the UART and LCD
+ * print it: the old float reading (Read_LM35 and Read_ADC of the
+ * baseline, in f32) through Fmt_F32 with 2 decimals, which
+ * test_fmt checks against the old UARTTxF32 loop, against
+ * Read_LM35_Centi through Fmt_Centi. The text must be the same.
+ * The exceptions are where the true value is a whole number of
+ * centi-degrees: there the float could land just below it and
+ * print one centi-degree low, while the table is exact. Codes
+ * whose table entry is clipped (above 327.67) are skipped.
+ */
+static void TestRender(void)
+{
+    u8  a[16], b[16], c[16];
+    u32 code, na, nb, nc, k, exact, same = 0, floatLow = 0;
+    s32 centi;
+    f32 eAR, temp;
+    u8  tType;
+
+    sensorCfg[1].gain   = LM35_GAIN_ONE;
+    sensorCfg[1].offset = 0;
+    LM35_InitCal();
+
+    for(code = 0; code < LM35_LUT_SIZE && !TEST_FAILED(); code++)
+    {
+        for(k = 0; k < 2; k++)
+        {
+            tType = k ? 'F' : 'C';
+            if((k ? lm35LutF : lm35LutC)[code] == 32767)
+                continue;
+
+            eAR  = code * (3.3 / 1023);
+            temp = eAR * 100;
+            if(tType == 'F')
+                temp = ((temp * (9/5.0)) + 32);
+            na = Fmt_F32(a, temp, 2) - a;
+
+            lm35Code[1] = code << LM35_EXTRA_BITS;
+            centi = Read_LM35_Centi(1, tType);
+            nb = Fmt_Centi(b, centi) - b;
+            if(na == nb && !memcmp(a, b, na))
+            {
+                same++;
+                continue;
+            }
+
+            // centi-degrees = code * 33000 / 1023 (C), * 59400 / 1023 + 3200 (F)
+            exact = !((code * (k ? 59400 : 33000)) % 1023);
+            nc = Fmt_Centi(c, centi - 1) - c;
+            if(exact && na == nc && !memcmp(a, c, na))
+                floatLow++;
+            else
+            {
+                CHECK(0);
+                printf("%c code %u: float %.*s, centi %.*s\n",
+                       tType, code, (int)na, a, (int)nb, b);
+            }
+        }
+    }
+    printf("rendered: %u readings the same, float one centi-degree low on %u\n",
+           same, floatLow);
+}
+
+int main(void)
+{
+    TestLut();
+    TestRead();
+    TestRender();
+    return TEST_END();
+}
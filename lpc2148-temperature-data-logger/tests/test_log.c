@@ -0,0 +1,130 @@
+#include <stdio.h>           // tmpfile
+#include <string.h>          // strstr, strncmp
+#include "test.h"            // CHECK / CHECK_EQ
+#include "types.h"           // Custom data types (u8, u32, s32)
+#include "sim.h"             // Register model
+#include "lm35.h"            // sensorCfg
+#include "stats.h"           // log_stats
+#include "flashlog.h"        // FlashLog_Sync, FlashLog_FindPage
+#include "history.h"         // Hist_First / Hist_Get
+#include "adc_defines.h"     // ADC_NUM_CH
+#include "logrec.h"          // LOGREC_CH_BITS
+
+/* ================= LOGGING IN AGGREGATION MODE ================= */
+/*
+ * Five and a half virtual minutes of the firmware with all four
+ * sensors fitted and aggregation on: the UART gets one [STAT]
+ * summary per window and channel instead of the minute lines,
+ * while flash and the RAM history still get one record per
+ * minute and channel.
+ */
+#define RUN_S       330
+#define MINUTES     (RUN_S / 60 + 1)      // Including the start-up record
+
+extern int fw_main(void);    // main.c, renamed by the build
+
+static void Firmware(void)
+{
+    u32 ch;
+
+    log_stats = STATS_ON;
+    for(ch = 0; ch < ADC_NUM_CH; ch++)
+        sensorCfg[ch].enabled = 1;
+    fw_main();
+}
+
+// Checks one channel's records: one per minute, on the minute
+static void CheckSeries(const char *what, u32 ch, const u32 *epoch, u32 n)
+{
+    u32 i;
+
+    CHECK_EQ(n, MINUTES);
+    for(i = 0; i < n; i++)
+    {
+        CHECK_EQ(epoch[i] % 60, 0);
+        if(i)
+            CHECK_EQ(epoch[i] - epoch[i - 1], 60);
+    }
+    if(testFails)
+        printf("%s CH%u: %u records\n", what, ch, n);
+}
+
+static void TestHistory(void)
+{
+    FlashRec r;
+    u32 epoch[ADC_NUM_CH][64], n[ADC_NUM_CH] = { 0 };
+    u32 i, ch;
+
+    for(i = Hist_First(); i != Hist_Next(); i++)
+    {
+        CHECK(Hist_Get(i, &r));
+        ch = (r.code >> LOGREC_CH_BITS) & 3;
+        if(n[ch] < 64)
+            epoch[ch][n[ch]++] = r.epoch;
+    }
+    for(ch = 0; ch < ADC_NUM_CH; ch++)
+        CheckSeries("history", ch, epoch[ch], n[ch]);
+}
+
+static void TestFlash(void)
+{
+    const FlashPage *pg;
+    u32 epoch[ADC_NUM_CH][64], n[ADC_NUM_CH] = { 0 };
+    u32 seq, i, ch;
+
+    FlashLog_Sync();                  // Program the partly filled page
+    CHECK_EQ(flogStats.errors, 0);
+    for(seq = flogFirstSeq; seq != flogNextSeq; seq++)
+    {
+        pg = FlashLog_FindPage(seq);
+        CHECK(pg != 0);
+        if(!pg)
+            continue;
+        for(i = 0; i < pg->count; i++)
+        {
+            ch = (pg->rec[i].code >> LOGREC_CH_BITS) & 3;
+            if(n[ch] < 64)
+                epoch[ch][n[ch]++] = pg->rec[i].epoch;
+        }
+    }
+    for(ch = 0; ch < ADC_NUM_CH; ch++)
+        CheckSeries("flash", ch, epoch[ch], n[ch]);
+}
+
+static void TestUart(FILE *f)
+{
+    char line[256];
+    u32 stat[ADC_NUM_CH] = { 0 }, info = 0, ch;
+
+    rewind(f);
+    while(fgets(line, sizeof(line), f))
+    {
+        if(!strncmp(line, "[STAT] CH", 9) && line[9] >= '0' && line[9] <= '3')
+            stat[line[9] - '0']++;
+        if(strstr(line, "[INFO]"))
+            info++;
+    }
+    CHECK_EQ(info, 0);
+    for(ch = 0; ch < ADC_NUM_CH; ch++)
+        CHECK(stat[ch] >= RUN_S / STATS_WINDOW_S - 1);
+}
+
+int main(void)
+{
+    FILE *f = tmpfile();
+
+    CHECK(f != 0);
+    if(!f)
+        return TEST_END();
+
+    Sim_Init();
+    Sim_UartOutput(f);
+    Sim_Run(Firmware, RUN_S);
+    Sim_UartOutput(0);
+
+    TestUart(f);
+    TestHistory();
+    TestFlash();
+    fclose(f);
+    return TEST_END();
+}
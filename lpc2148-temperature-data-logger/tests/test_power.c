@@ -0,0 +1,90 @@
+#include "test.h"            // CHECK / CHECK_EQ
+#include "types.h"           // Custom data types (u32)
+#include "sim.h"             // Register model
+#include "power.h"           // Power_NextWake, power_mode, pwrStats
+#include "power_defines.h"   // POWER_PERIOD_S, POWER_LEAD_S
+
+/* ================= WAKE SCHEDULE ================= */
+
+static u32 lcg = 77;
+
+static u32 Rand(void)
+{
+    lcg = lcg * 1664525 + 1013904223;
+    return lcg;
+}
+
+// First second after now that lies lead seconds before a multiple of period
+static u32 RefNextWake(u32 now, u32 period, u32 lead)
+{
+    u32 w = now + 1;
+
+    while((w + lead) % period)
+        w++;
+    return w;
+}
+
+static void TestNextWake(void)
+{
+    u32 now, period, lead, w, i;
+
+    // Every small case against the brute force answer
+    for(period = 1; period <= 90 && !TEST_FAILED(); period++)
+        for(lead = 0; lead <= period + 5; lead++)
+            for(now = 0; now < 3 * period + 7; now++)
+                CHECK_EQ(Power_NextWake(now, period, lead),
+                         RefNextWake(now, period, lead));
+
+    // Real epochs (2000 - 2099) and the periods the logger uses
+    for(i = 0; i < 1000000 && !TEST_FAILED(); i++)
+    {
+        now    = 946684800 + Rand() % 3155760000u;
+        period = 1 + Rand() % 86400;
+        lead   = Rand() % 60;
+        w = Power_NextWake(now, period, lead);
+        CHECK(w > now);
+        CHECK(w - now <= period);
+        CHECK_EQ((w + lead) % period, 0);
+    }
+
+    // The firmware settings: wake at :58 for the sample at :00
+    CHECK_EQ(Power_NextWake(1700000000 + 3, POWER_PERIOD_S, POWER_LEAD_S),
+             1700000040 - POWER_LEAD_S);
+    CHECK_EQ(Power_NextWake(1700000038, POWER_PERIOD_S, POWER_LEAD_S),
+             1700000098);
+    CHECK_EQ(Power_NextWake(1700000037, POWER_PERIOD_S, POWER_LEAD_S),
+             1700000038);
+}
+
+/* ================= SLEEPING FIRMWARE ================= */
+/*
+ * Ten virtual minutes of the battery build (fw_sleep): it must
+ * power down once per period and spend most of the time there
+ */
+extern int fw_main(void);    // main.c, renamed by the build
+
+static void Firmware(void)
+{
+    fw_main();
+}
+
+static void TestSleep(void)
+{
+    CHECK_EQ(power_mode, POWER_MODE_SLEEP);
+    Sim_Init();
+    Sim_Run(Firmware, 600);
+
+    printf("wakes %u, refused %u, power-down %.1f %%\n", pwrStats.wakes,
+           pwrStats.refused, 100.0 * simStats.pdCycles / Sim_Now());
+    CHECK_EQ(pwrStats.refused, 0);
+    CHECK(pwrStats.wakes >= 600 / POWER_PERIOD_S - 2);
+    CHECK(pwrStats.wakes <= 600 / POWER_PERIOD_S + 1);
+    CHECK(simStats.pdCycles > Sim_Now() / 2);
+}
+
+int main(void)
+{
+    TestNextWake();
+    TestSleep();
+    return TEST_END();
+}
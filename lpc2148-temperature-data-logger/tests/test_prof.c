@@ -0,0 +1,162 @@
+#define PROF_ENABLE 1        // Linked with fw_prof (PROF_HOST)
+
+#include <string.h>          // strstr, strncmp
+#include <time.h>            // clock_gettime
+#include "test.h"            // CHECK / CHECK_EQ
+#include "types.h"           // Custom data types (u8, u32, u64)
+#include "sim.h"             // Register model, UART0 output tap
+#include "uart.h"            // InitUART
+#include "prof.h"            // Profiling under test
+
+/* ================= HOST CLOCK ================= */
+
+static u64 NowNs(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (u64)ts.tv_sec * 1000000000u + ts.tv_nsec;
+}
+
+// Busy for at least us microseconds of real time
+static void Spin(u32 us)
+{
+    u64 end = NowNs() + (u64)us * 1000;
+
+    while(NowNs() < end)
+        ;
+}
+
+/* ================= UART CAPTURE ================= */
+
+static char out[4096];
+static u32  outLen;
+
+static void Tap(u8 byte)
+{
+    if(outLen < sizeof(out) - 1)
+        out[outLen++] = byte;
+    out[outLen] = 0;
+}
+
+/*
+ * Function: Dump
+ * Purpose : PROF_DUMP and PROF_POLL until the table is out,
+ *           which leaves it in out[]
+ */
+static void Dump(u8 clear)
+{
+    u32 i;
+
+    outLen = 0;
+    out[0] = 0;
+    PROF_DUMP(clear);
+    for(i = 0; i < 100; i++)
+    {
+        PROF_POLL();
+        Sim_Idle(SIM_US(1000));
+    }
+    while(!UARTTxIdle())
+        Sim_Idle(SIM_US(1000));
+}
+
+/* ================= REGION TIMING ================= */
+/*
+ * With PROF_HOST the regions are timed in nanoseconds of the host
+ * clock: three entries of 1, 2 and 3 ms of real time give at
+ * least those times. The dumped line reports every figure in
+ * microseconds, so the average times the count is the total.
+ * The clear dump resets the table once it is sent.
+ */
+static void TestRegion(void)
+{
+    static const u32 spin[3] = { 1000, 3000, 2000 };
+    ProfRegion r;
+    u32 i, n, mn, mx, avg, tot;
+    char *line;
+
+    Sim_Init();
+    InitUART();
+    CHECK(UARTSetBaud(115200));
+    Sim_UartTap(Tap);
+
+    for(i = 0; i < 3; i++)
+    {
+        PROF_BEGIN(PROF_DISP_TEMP);
+        Spin(spin[i]);
+        PROF_END(PROF_DISP_TEMP);
+    }
+    r = profTbl[PROF_DISP_TEMP];
+    CHECK_EQ(r.count, 3);
+    CHECK(r.min >= 1000000 && r.min < 3000000);
+    CHECK(r.max >= 3000000);
+    CHECK(r.total >= 6000000);
+    CHECK(r.total >= (u64)r.min + r.max);
+    CHECK(r.total < 1000000000);
+    CHECK_EQ(profTbl[PROF_LM35].count, 0);
+
+    Dump(1);
+    line = strstr(out, "[PROF] DTEMP ");
+    CHECK(line != NULL);
+    if(line == NULL)
+        return;
+    CHECK_EQ(sscanf(line, "[PROF] DTEMP n: %u min: %u max: %u avg: %u tot: %u us",
+                    &n, &mn, &mx, &avg, &tot), 5);
+    CHECK_EQ(n, 3);
+    CHECK_EQ(mn, (r.min + 500) / 1000);
+    CHECK_EQ(mx, (r.max + 500) / 1000);
+    CHECK_EQ(tot, (r.total + 500) / 1000);
+    CHECK(mn <= avg && avg <= mx);
+    CHECK(avg * n <= tot + n && tot <= avg * n + n);
+    CHECK(strstr(out, "[PROF] LM35 n: 0 min: 0 max: 0 avg: 0 tot: 0 us\r\n") != NULL);
+    if(testFails)
+        printf("%s", out);
+
+    // Cleared once sent
+    CHECK_EQ(profTbl[PROF_DISP_TEMP].count, 0);
+    CHECK_EQ(profTbl[PROF_DISP_TEMP].total, 0);
+    CHECK_EQ(profTbl[PROF_DISP_TEMP].max, 0);
+}
+
+/* ================= TABLE OUTPUT ================= */
+/*
+ * One line per region in PROF_xxx order, none repeated; a dump
+ * without clear keeps the statistics.
+ */
+static void TestTable(void)
+{
+    static const char *const name[PROF_NUM] =
+    {
+        "LM35", "ALARM", "DTIME", "DDATE", "DDAY",
+        "DTEMP", "UARTTX", "FLASH", "LCDFL"
+    };
+    char *p, *q;
+    u32 i, lines = 0;
+
+    PROF_BEGIN(PROF_FLASH);
+    PROF_END(PROF_FLASH);
+    Dump(0);
+
+    for(p = out; (p = strstr(p, "[PROF] ")) != NULL; p++)
+        lines++;
+    CHECK_EQ(lines, PROF_NUM);
+
+    for(i = 0, p = out; i < PROF_NUM; i++)
+    {
+        q = strstr(p, "[PROF] ");
+        CHECK(q != NULL);
+        if(q == NULL)
+            break;
+        CHECK(!strncmp(q + 7, name[i], strlen(name[i])));
+        p = q + 1;
+    }
+    CHECK(strstr(out, "[PROF] FLASH n: 1 ") != NULL);
+    CHECK_EQ(profTbl[PROF_FLASH].count, 1);
+}
+
+int main(void)
+{
+    TestRegion();
+    TestTable();
+    return TEST_END();
+}
@@ -0,0 +1,211 @@
+#include <LPC214X.H>          // CTIME0 / CTIME1
+#include "test.h"            // CHECK / CHECK_EQ
+#include "types.h"           // Custom data types (u8, u32, u64)
+#include "sim.h"             // Register model, virtual time
+#include "rtc.h"             // RTC_ReadTime, epoch conversion
+#include "rtc_defines.h"     // CT_xxx field access
+#include "edit.h"            // IsLeapYear / GetMaxDays
+
+/* ================= ROLLOVER EDGES ================= */
+/*
+ * The RTC counts leap years as year % 4 == 0, which only holds
+ * from 1901 to 2099, so every edge stays inside that range.
+ */
+typedef struct
+{
+    const char *what;
+    u8  dom, month;
+    u16 year;
+    u8  hour, min, sec;
+} RtcEdge;
+
+static const RtcEdge edges[] =
+{
+    { "second",          15,  6, 2026, 12, 34, 56 },
+    { "minute",          15,  6, 2026, 12, 34, 59 },
+    { "hour",            15,  6, 2026, 12, 59, 59 },
+    { "midnight",        15,  6, 2026, 23, 59, 59 },
+    { "31 Jan",          31,  1, 2026, 23, 59, 59 },
+    { "30 Apr",          30,  4, 2026, 23, 59, 59 },
+    { "31 Aug",          31,  8, 2026, 23, 59, 59 },
+    { "30 Nov",          30, 11, 2026, 23, 59, 59 },
+    { "28 Feb 2023",     28,  2, 2023, 23, 59, 59 },
+    { "28 Feb 2024",     28,  2, 2024, 23, 59, 59 },
+    { "29 Feb 2024",     29,  2, 2024, 23, 59, 59 },
+    { "28 Feb 2000",     28,  2, 2000, 23, 59, 59 },
+    { "year",            31, 12, 2025, 23, 59, 59 },
+    { "year 2099",       31, 12, 2099, 23, 59, 59 },
+};
+
+#define NUM_EDGES   (sizeof(edges) / sizeof(edges[0]))
+
+/*
+ * Function: Setup
+ * Purpose : Starts the RTC one second before the edge, with
+ *           or without the increment interrupt
+ * Returns : Epoch of the start time
+ */
+static u32 Setup(const RtcEdge *e, u8 isr)
+{
+    RTCTime t;
+    u32 epoch = RTCToEpoch(e->dom, e->month, e->year, e->hour, e->min, e->sec);
+
+    RTC_FromEpoch(epoch, &t);
+    Sim_Init();
+    RTC_Init();
+    SetRTCTimeInfo(e->hour, e->min, e->sec);
+    SetRTCDateInfo(e->dom, e->month, e->year);
+    SetRTCDay(t.dow);
+    if(!isr)
+        CIIR = 0;
+    return epoch;
+}
+
+// Every field of a snapshot matches the calendar at epoch
+static u8 SameTime(const RTCTime *t, u32 epoch)
+{
+    RTCTime r;
+
+    RTC_FromEpoch(epoch, &r);
+    return t->sec == r.sec && t->min == r.min && t->hour == r.hour &&
+           t->dow == r.dow && t->dom == r.dom && t->month == r.month &&
+           t->year == r.year;
+}
+
+/* ================= ATOMIC CTIME0 / CTIME1 READ ================= */
+/*
+ * The increment is moved across the reads one access at a time,
+ * from before the first CTIME0 read to after the last. Every
+ * snapshot must be the time before the edge or the time after
+ * it, never a mix. Two plain reads (CTIME0, then CTIME1) are
+ * taken the same way as a control: across a date change they
+ * must come out torn for some placement, or the sweep missed
+ * the window. The increment interrupt is off, so the accesses
+ * counted are the reads alone (six when RTC_ReadTime retried).
+ */
+#define SWEEP   (8 * SIM_ACCESS_CYCLES)
+
+static void TestReadAtomic(const RtcEdge *e)
+{
+    RTCTime t;
+    u64 tick, acc;
+    u32 e0, c0, c1, d, n;
+    u8  before = 0, after = 0, retried = 0, torn = 0;
+
+    // Find the increment: the register model is deterministic.
+    e0 = Setup(e, 0);
+    c0 = CTIME0;
+    for(n = 0; n < SIM_PCLK; n++)
+    {
+        tick = Sim_Now();
+        if(CTIME0 != c0)
+            break;
+    }
+    CHECK(n < SIM_PCLK);
+
+    for(d = 0; d < SWEEP; d++)
+    {
+        Setup(e, 0);
+        Sim_Idle(tick - SWEEP / 2 + d - Sim_Now());
+        acc = simStats.accesses;
+        RTC_ReadTime(&t);
+        retried |= (simStats.accesses - acc) > 3;
+
+        if(SameTime(&t, e0))
+            before = 1;
+        else if(SameTime(&t, e0 + 1))
+            after = 1;
+        else
+        {
+            CHECK(0);
+            printf("%s: %02u:%02u:%02u %02u/%02u/%04u read %u cycles before the tick\n",
+                   e->what, t.hour, t.min, t.sec, t.dom, t.month, t.year,
+                   SWEEP / 2 - d);
+        }
+
+        Setup(e, 0);
+        Sim_Idle(tick - SWEEP / 2 + d - Sim_Now());
+        c0 = CTIME0;
+        c1 = CTIME1;
+        torn |= (CT_SEC(c0) == e->sec) && (CT_DOM(c1) != e->dom);
+    }
+
+    CHECK(before && after);
+    CHECK(retried);
+    CHECK(torn == (e->hour == 23 && e->min == 59));
+    if(testFails)
+        printf("%s: before %u after %u retried %u torn %u\n",
+               e->what, before, after, retried, torn);
+}
+
+/* ================= EPOCH CONVERSION ================= */
+/*
+ * Every day from 1970 to 2105: consecutive days are 86400 s
+ * apart, RTC_FromEpoch gives the same date back and Feb 29
+ * exists in leap years only
+ */
+static void TestEpoch(void)
+{
+    RTCTime t;
+    u32 y, m, d, epoch, last = 0, days = 0;
+
+    for(y = 1970; y <= 2105 && !TEST_FAILED(); y++)
+    {
+        CHECK_EQ(GetMaxDays(2, y), (y % 4 || (y % 100 == 0 && y % 400)) ? 28 : 29);
+        for(m = 1; m <= 12; m++)
+        {
+            for(d = 1; d <= GetMaxDays(m, y); d++, days++)
+            {
+                epoch = RTCToEpoch(d, m, y, 23, 59, 59);
+                if(days)
+                    CHECK_EQ(epoch - last, 86400);
+                last = epoch;
+
+                RTC_FromEpoch(epoch, &t);
+                CHECK(t.dom == d && t.month == m && t.year == y);
+                CHECK(t.hour == 23 && t.min == 59 && t.sec == 59);
+                CHECK_EQ(t.dow, (days + 4) % 7);      // 01/01/1970 was a Thursday
+            }
+        }
+    }
+
+    RTC_FromEpoch(RTCToEpoch(29, 2, 2024, 0, 0, 0), &t);
+    CHECK_EQ(t.dow, 4);                               // Thursday
+    RTC_FromEpoch(RTCToEpoch(1, 1, 2100, 0, 0, 0), &t);
+    CHECK_EQ(t.dow, 5);                               // Friday
+}
+
+/* ================= ISR TICK COUNTERS ================= */
+/*
+ * 125 s from 23:59:50 on New Year's Eve: one rtcSecCnt step per
+ * second, rtcMinCnt steps at 00:00:00 and 00:01:00
+ */
+static void TestTickCounts(void)
+{
+    static const RtcEdge e = { "counters", 31, 12, 2025, 23, 59, 50 };
+    RTCTime t;
+    u32 e0;
+
+    e0 = Setup(&e, 1);
+    rtcSecCnt = 0;
+    rtcMinCnt = 0;
+    Sim_Idle(SIM_SEC(125));
+
+    CHECK_EQ(rtcSecCnt, 125);
+    CHECK_EQ(rtcMinCnt, 2);
+    RTC_ReadTime(&t);
+    CHECK(SameTime(&t, e0 + 125));
+    CHECK_EQ(t.dom, 1);
+    CHECK_EQ(t.year, 2026);
+}
+
+int main(void)
+{
+    u32 i;
+
+    for(i = 0; i < NUM_EDGES; i++)
+        TestReadAtomic(&edges[i]);
+    TestEpoch();
+    TestTickCounts();
+    return TEST_END();
+}
@@ -0,0 +1,241 @@
+#include <string.h>          // memset
+#include "test.h"            // CHECK / CHECK_EQ
+#include "types.h"           // Custom data types (u8, u32, s32, u64)
+#include "sim.h"             // Register model, virtual time
+#include "delay.h"           // Tick, delay_until
+#include "sched.h"           // Scheduler under test
+
+/* ================= TASKS ON THE VIRTUAL CLOCK ================= */
+/*
+ * The scheduler runs on the Timer1 tick of the register model.
+ * A task "executes" by letting virtual time pass for its work
+ * time, and records when it started.
+ */
+#define MAX_STARTS   1200
+
+typedef struct
+{
+    u32 work;                 // Execution time (us)
+    u32 longRun;              // Run number that takes longWork instead
+    u32 longWork;
+    u32 n;                    // Runs so far
+    u64 start[MAX_STARTS];    // Virtual time of each start
+    u64 end[MAX_STARTS];      // ... and of each finish
+} TaskLog;
+
+static TaskLog logs[3];
+
+static void Work(TaskLog *l)
+{
+    u32 us = (l->longWork && l->n == l->longRun) ? l->longWork : l->work;
+
+    if(l->n < MAX_STARTS)
+        l->start[l->n] = Sim_Now();
+    Sim_Idle(SIM_US(us));
+    if(l->n < MAX_STARTS)
+        l->end[l->n] = Sim_Now();
+    l->n++;
+}
+
+static void Task0(void) { Work(&logs[0]); }
+static void Task1(void) { Work(&logs[1]); }
+static void Task2(void) { Work(&logs[2]); }
+
+static const TaskFn taskFn[3] = { Task0, Task1, Task2 };
+
+/*
+ * Function: Start
+ * Purpose : Fresh model, empty task table and task logs
+ */
+static void Start(void)
+{
+    Sim_Init();
+    Delay_Init();
+    schedTaskCnt = 0;
+    memset(logs, 0, sizeof(logs));
+}
+
+/*
+ * Function: RunFor
+ * Purpose : The Sched_Run loop, for us microseconds of virtual time
+ */
+static void RunFor(u32 us)
+{
+    u64 end = Sim_Now() + SIM_US(us);
+
+    while(Sim_Now() < end)
+    {
+        if(!Sched_RunOnce())
+            delay_until(Sched_NextRelease());
+    }
+}
+
+/* ================= PERIOD ACCURACY ================= */
+/*
+ * Three tasks for one second. Run k of a task starts k periods
+ * after its first release, late by no more than the work of the
+ * other tasks (a higher priority task runs first, a lower one
+ * already running is not preempted), and never early: the
+ * releases do not drift however late each run starts.
+ */
+static void TestPeriod(void)
+{
+    static const u32 period[3] = { 1000, 2500, 10000 };
+    static const u32 work[3]   = { 50, 100, 300 };
+    static const u32 offset[3] = { 0, 0, 0 };     // All collide at 0, 10 ms, ...
+    u64 t0, due, late, worst[3] = { 0 };
+    u32 i, k, slack;
+
+    Start();
+    t0 = Sim_Now();
+    for(i = 0; i < 3; i++)
+    {
+        logs[i].work = work[i];
+        CHECK_EQ(Sched_Add(taskFn[i], period[i], 0, offset[i]), i);
+    }
+    RunFor(1000000);
+
+    for(i = 0; i < 3; i++)
+    {
+        slack = work[0] + work[1] + work[2] - work[i] + 5;
+        CHECK(logs[i].n >= 1000000 / period[i]);
+        CHECK(logs[i].n <= 1000000 / period[i] + 1);
+        CHECK_EQ(schedTask[i].runs, logs[i].n);
+        CHECK_EQ(schedTask[i].misses, 0);
+        CHECK_EQ(schedTask[i].skips, 0);
+        CHECK(schedTask[i].maxUs >= work[i] && schedTask[i].maxUs <= work[i] + 1);
+        CHECK(schedTask[i].lastUs >= work[i] && schedTask[i].lastUs <= work[i] + 1);
+
+        for(k = 0; k < logs[i].n && !TEST_FAILED(); k++)
+        {
+            due = t0 + SIM_US(offset[i] + (u64)k * period[i]);
+            CHECK(logs[i].start[k] + SIM_US(1) >= due);
+            late = (logs[i].start[k] > due) ? logs[i].start[k] - due : 0;
+            CHECK(late <= SIM_US(slack));
+            if(late > worst[i])
+                worst[i] = late;
+        }
+    }
+    printf("period: worst start delay %.1f / %.1f / %.1f us\n",
+           (double)worst[0] / SIM_US(1), (double)worst[1] / SIM_US(1),
+           (double)worst[2] / SIM_US(1));
+}
+
+/* ================= OVERRUN ================= */
+/*
+ * Run 10 of the first task takes 3500 us instead of 100 us, over
+ * three of its 1000 us periods. That run misses its deadline and
+ * the releases it overran are dropped, not run back to back: the
+ * next run starts a full period after it ends. The second task
+ * (2000 us period, 500 us deadline) is blocked by it for less
+ * than two periods, so it is behind by less than a whole period:
+ * its late release and the next one both run (two misses) and
+ * no release is dropped. A third task whose work is longer than
+ * its deadline misses on every run but never skips.
+ */
+static void TestOverrun(void)
+{
+    TaskLog *a = &logs[0], *b = &logs[1], *c = &logs[2];
+    u32 k;
+
+    Start();
+    a->work = 100;
+    a->longRun  = 10;
+    a->longWork = 3500;
+    b->work = 20;
+    c->work = 300;
+    Sched_Add(Task0, 1000, 0, 0);
+    Sched_Add(Task1, 2000, 500, 100);
+    Sched_Add(Task2, 5000, 200, 600);
+    RunFor(100000);
+
+    CHECK_EQ(schedTask[0].misses, 1);
+    CHECK_EQ(schedTask[0].skips, 1);
+    CHECK(schedTask[0].maxUs >= 3500 && schedTask[0].maxUs <= 3501);
+    CHECK(a->start[11] >= a->end[10] + SIM_US(1000) - SIM_US(1));
+    CHECK(a->start[11] <= a->end[10] + SIM_US(1000) + SIM_US(400));
+
+    // On the new phase from then on, no catching up
+    for(k = 12; k < a->n && !TEST_FAILED(); k++)
+        CHECK(a->start[k] - a->start[k - 1] >= SIM_US(1000) - SIM_US(400));
+
+    CHECK_EQ(schedTask[1].misses, 2);
+    CHECK_EQ(schedTask[1].skips, 0);
+    CHECK_EQ(b->n, 100000 / 2000);                // Released at 100 + 2000k
+
+    CHECK_EQ(schedTask[2].misses, schedTask[2].runs);
+    CHECK_EQ(schedTask[2].skips, 0);
+    if(testFails)
+        printf("overrun: misses %u/%u/%u skips %u/%u/%u\n",
+               schedTask[0].misses, schedTask[1].misses, schedTask[2].misses,
+               schedTask[0].skips, schedTask[1].skips, schedTask[2].skips);
+}
+
+/* ================= STATISTICS RESET ================= */
+/*
+ * Sched_ClearStats zeroes every counter but leaves the tasks and
+ * their release phase alone: counting restarts from zero and the
+ * runs stay on the period grid of the runs before the reset.
+ */
+static void TestClearStats(void)
+{
+    u64 due;
+    u32 i, n;
+
+    Start();
+    logs[0].work = 100;
+    logs[0].longRun  = 3;
+    logs[0].longWork = 2500;
+    Sched_Add(Task0, 1000, 0, 0);
+    RunFor(20000);
+    CHECK(schedTask[0].runs > 0);
+    CHECK(schedTask[0].misses && schedTask[0].skips && schedTask[0].maxUs);
+
+    Sched_ClearStats();
+    CHECK_EQ(schedTask[0].runs, 0);
+    CHECK_EQ(schedTask[0].misses, 0);
+    CHECK_EQ(schedTask[0].skips, 0);
+    CHECK_EQ(schedTask[0].lastUs, 0);
+    CHECK_EQ(schedTask[0].maxUs, 0);
+    CHECK(schedTask[0].fn == Task0);
+    CHECK_EQ(schedTask[0].period, 1000);
+    CHECK_EQ(schedTaskCnt, 1);
+
+    n = logs[0].n;
+    RunFor(10000);
+    CHECK_EQ(schedTask[0].runs, logs[0].n - n);
+    CHECK(schedTask[0].runs >= 9 && schedTask[0].runs <= 10);
+    CHECK_EQ(schedTask[0].misses, 0);
+    CHECK_EQ(schedTask[0].skips, 0);
+    CHECK(schedTask[0].maxUs >= 100 && schedTask[0].maxUs <= 101);
+
+    // Same phase as the last run before the reset
+    for(i = n; i < logs[0].n; i++)
+    {
+        due = logs[0].start[n - 1] + SIM_US((u64)(i - n + 1) * 1000);
+        CHECK(logs[0].start[i] + SIM_US(1) >= due);
+        CHECK(logs[0].start[i] <= due + SIM_US(1));
+    }
+}
+
+/* ================= TABLE FULL ================= */
+
+static void TestFull(void)
+{
+    u32 i;
+
+    Start();
+    for(i = 0; i < SCHED_MAX_TASKS; i++)
+        CHECK_EQ(Sched_Add(Task0, 1000, 0, 0), i);
+    CHECK_EQ(Sched_Add(Task1, 1000, 0, 0), SCHED_MAX_TASKS);
+    CHECK_EQ(schedTaskCnt, SCHED_MAX_TASKS);
+}
+
+int main(void)
+{
+    TestPeriod();
+    TestOverrun();
+    TestClearStats();
+    TestFull();
+    return TEST_END();
+}
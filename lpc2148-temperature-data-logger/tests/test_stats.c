@@ -0,0 +1,195 @@
+#include <math.h>            // sqrt, fabs
+#include "test.h"            // CHECK / CHECK_EQ
+#include "types.h"           // Custom data types (u32, s32, u64, f64)
+#include "stats.h"           // Stats_Add / Stats_Take, ISqrt64
+#include "rtc.h"             // rtcSecCnt (min/max offsets)
+
+/* ================= WELFORD AGAINST A DOUBLE REFERENCE ================= */
+
+#define MAX_SAMPLES  3600000          // One hour at 1 kHz
+
+static s32 sample[MAX_SAMPLES];
+static u32 lcg = 31337;
+
+static u32 Rand(u32 n)
+{
+    lcg = lcg * 1664525 + 1013904223;
+    return (lcg >> 8) % n;
+}
+
+/* ~N(0, 1) from twelve uniforms */
+static f64 Gauss(void)
+{
+    f64 s = 0;
+    u32 i;
+
+    for(i = 0; i < 12; i++)
+        s += Rand(1 << 20) / (f64)(1 << 20);
+    return s - 6;
+}
+
+/*
+ * Feeds n samples to channel ch, one per rate-th of a second,
+ * and compares the summary with a two-pass double computation
+ */
+static void Window(const char *what, u32 ch, u32 n, u32 rate)
+{
+    StatsSummary s;
+    f64 mean = 0, m2 = 0, sd;
+    s32 mn = 0x7FFF, mx = -0x8000;
+    u32 i, minAt = 0, maxAt = 0, fails = testFails;
+
+    rtcSecCnt = 5000;
+    Stats_Begin(1700000040);            // On a window boundary
+    for(i = 0; i < n; i++)
+    {
+        rtcSecCnt = 5000 + i / rate;
+        Stats_Add(ch, sample[i]);
+        mean += sample[i];
+        if(sample[i] < mn)
+            mn = sample[i], minAt = i / rate;
+        if(sample[i] > mx)
+            mx = sample[i], maxAt = i / rate;
+    }
+    mean /= n;
+    for(i = 0; i < n; i++)
+        m2 += (sample[i] - mean) * (sample[i] - mean);
+    sd = (n > 1) ? sqrt(m2 / (n - 1)) : 0;
+
+    CHECK_EQ(Stats_Take(ch, &s), 1);
+    CHECK_EQ(s.n, n);
+    CHECK_EQ(s.start, 1700000040);
+    CHECK(fabs(s.mean - mean) <= 0.5 + 1.0 / 256);
+    CHECK(fabs(s.sd - sd) <= 0.5 + 1.0 / 256 + sd * 1e-4);
+    CHECK_EQ(s.min, mn);
+    CHECK_EQ(s.max, mx);
+    CHECK_EQ(s.minOff, minAt);
+    CHECK_EQ(s.maxOff, maxAt);
+    if(testFails != fails)
+        printf("%s: n %u mean %d (%.4f) sd %u (%.4f)\n",
+               what, n, s.mean, mean, s.sd, sd);
+}
+
+static void TestWelford(void)
+{
+    u32 i, k;
+    f64 t;
+
+    // Constant: no spread at all, at the sensor limits too
+    for(k = 0; k < 3; k++)
+    {
+        for(i = 0; i < 9600; i++)
+            sample[i] = (k == 0) ? 2537 : (k == 1) ? -5500 : 15000;
+        Window("constant", k, 9600, 160);
+    }
+
+    // Single sample and a pair
+    sample[0] = -123;
+    Window("one", 0, 1, 160);
+    sample[1] = 124;
+    Window("two", 1, 2, 160);
+
+    // Noise on a large offset: small variance, no cancellation
+    for(i = 0; i < 576000; i++)
+        sample[i] = 12000 + (s32)(Gauss() * 3);
+    Window("offset", 2, 576000, 160);
+
+    // Slow ramp with noise, as a room warming up
+    for(i = 0; i < 576000; i++)
+        sample[i] = 1800 + (s32)(i / 160.0 * 0.5 + Gauss() * 20);
+    Window("ramp", 3, 576000, 160);
+
+    // Step halfway through the window
+    for(i = 0; i < 9600; i++)
+        sample[i] = (i < 4800) ? 2000 : 3000;
+    Window("step", 0, 9600, 160);
+
+    // Full-scale square wave
+    for(i = 0; i < 9600; i++)
+        sample[i] = (i & 1) ? 15000 : -5500;
+    Window("square", 1, 9600, 160);
+
+    // Uniform over the whole sensor range
+    for(i = 0; i < 100000; i++)
+        sample[i] = -5500 + (s32)Rand(20501);
+    Window("uniform", 2, 100000, 160);
+
+    // An hour at 1 kHz of a slow sine with noise
+    for(i = 0; i < MAX_SAMPLES; i++)
+    {
+        t = i / 1000.0;
+        sample[i] = 2500 + (s32)(300 * sin(t / 600) + Gauss() * 15);
+    }
+    Window("hour", 3, MAX_SAMPLES, 1000);
+
+    // Random lengths and spreads
+    for(k = 0; k < 200 && !TEST_FAILED(); k++)
+    {
+        u32 n = 1 + Rand(20000);
+        s32 base = -5000 + (s32)Rand(19000), spread = 1 + Rand(500);
+
+        for(i = 0; i < n; i++)
+            sample[i] = base + (s32)Rand(spread);
+        Window("random", k % STATS_NUM_CH, n, 1 + Rand(200));
+    }
+}
+
+/* ================= WINDOW CONTROL ================= */
+static void TestWindow(void)
+{
+    StatsSummary s;
+
+    stats_window = 60;
+    Stats_Reset();
+    rtcSecCnt = 100;
+    CHECK_EQ(Stats_WindowDone(1700000017), 0);   // Starts the window
+    CHECK_EQ(Stats_Take(0, &s), 0);              // Nothing added yet
+
+    rtcSecCnt = 110;                             // Epoch ...027
+    Stats_Add(0, 2000);
+    Stats_Add(STATS_NUM_CH, 9999);               // Ignored
+    CHECK_EQ(Stats_Take(0, &s), 1);
+    CHECK_EQ(s.start, 1699999980);
+    CHECK_EQ(s.minOff, 47);
+    CHECK_EQ(s.sd, 0);
+
+    CHECK_EQ(Stats_WindowDone(1700000039), 0);
+    CHECK_EQ(Stats_WindowDone(1700000040), 1);
+    Stats_Begin(1700000040);
+    CHECK_EQ(Stats_Take(0, &s), 0);
+    CHECK_EQ(Stats_WindowDone(1700000099), 0);
+    CHECK_EQ(Stats_WindowDone(1700000100), 1);
+}
+
+/* ================= SQUARE ROOT ================= */
+static void TestISqrt(void)
+{
+    u64 r, v;
+    u32 i;
+
+    CHECK_EQ(ISqrt64(0), 0);
+    CHECK_EQ(ISqrt64(~(u64)0), 0xFFFFFFFF);
+    for(r = 1; r < 0x100000000ull; r = r * 3 + 1)
+    {
+        CHECK_EQ(ISqrt64(r * r), r);
+        CHECK_EQ(ISqrt64(r * r - 1), r - 1);
+        if(r < 0xFFFFFFFF)
+            CHECK_EQ(ISqrt64(r * r + 2 * r), r);
+    }
+    for(i = 0; i < 1000000 && !TEST_FAILED(); i++)
+    {
+        v = ((u64)Rand(1 << 24) << 40) ^ ((u64)Rand(1 << 24) << 16) ^
+            Rand(1 << 16);
+        v >>= Rand(64);
+        r = ISqrt64(v);
+        CHECK(r * r <= v && (r == 0xFFFFFFFF || (r + 1) * (r + 1) > v));
+    }
+}
+
+int main(void)
+{
+    TestWelford();
+    TestWindow();
+    TestISqrt();
+    return TEST_END();
+}
@@ -0,0 +1,205 @@
+#include <string.h>          // memset
+#include "test.h"            // CHECK / CHECK_EQ
+#include "types.h"           // Custom data types (u8, u16, u32, s32)
+#include "logrec.h"          // LOGREC_F_xxx, LOGREC_CH_BITS
+#include "tscomp.h"          // Compressed series encoder / decoder
+
+/* ================= TSC ROUND TRIP ================= */
+
+#define SERIES_LEN   20000
+#define BLOCK_RECS   64                // Records between keyframes
+
+typedef struct
+{
+    u32 epoch;
+    s32 temp;
+    u32 ch;
+    u16 flags;
+} Sample;
+
+static Sample series[SERIES_LEN];
+static u8 stream[SERIES_LEN * TSC_REC_MAX];
+static u32 blockAt[SERIES_LEN / BLOCK_RECS + 1];   // Byte offset per block
+
+static u32 lcg = 12345;
+
+static u32 Rand(u32 n)
+{
+    lcg = lcg * 1664525 + 1013904223;
+    return (lcg >> 8) % n;
+}
+
+/*
+ * Function: MakeSeries
+ * Purpose : Logger-like series: four channels drifting slowly,
+ *           several channels per time stamp, one-minute steps
+ *           with gaps, occasional alarm flags
+ */
+static void MakeSeries(void)
+{
+    static const u16 flagSet[4] =
+    {
+        0, LOGREC_F_WARN, LOGREC_F_ALERT | LOGREC_F_OVERTEMP, LOGREC_F_RATE
+    };
+    s32 t[4] = { 2500, 2210, -1500, 8000 };
+    u32 epoch = 1767394800, i, ch = 0;
+
+    for(i = 0; i < SERIES_LEN; i++)
+    {
+        ch = (ch + 1) & 3;
+        if(ch == 0)
+            epoch += (Rand(20) == 0) ? 60 + Rand(3600) : 60;
+        if(Rand(3))
+            t[ch] += (s32)Rand(7) - 3;
+        series[i].epoch = epoch;
+        series[i].temp  = t[ch];
+        series[i].ch    = ch;
+        series[i].flags = (Rand(50) == 0) ? flagSet[Rand(4)] : 0;
+    }
+}
+
+/*
+ * Function: Encode
+ * Purpose : Encodes series into stream with a keyframe every
+ *           BLOCK_RECS records; returns the stream length
+ */
+static u32 Encode(u32 count)
+{
+    TSCState s;
+    u32 i, n, len = 0;
+
+    for(i = 0; i < count; i++)
+    {
+        if(i % BLOCK_RECS == 0)
+        {
+            blockAt[i / BLOCK_RECS] = len;
+            TSC_Start(&s, series[i].epoch);
+        }
+        n = TSC_Encode(&s, &stream[len], series[i].epoch, series[i].temp,
+                       series[i].ch, series[i].flags);
+        CHECK(n >= 1 && n <= TSC_REC_MAX);
+        len += n;
+    }
+    return len;
+}
+
+static void CheckRec(const FlashRec *r, const Sample *x)
+{
+    CHECK_EQ(r->epoch, x->epoch);
+    CHECK_EQ(r->temp, x->temp);
+    CHECK_EQ((r->code >> LOGREC_CH_BITS) & 3, x->ch);
+    CHECK_EQ(r->code & 0xF000, x->flags);
+    CHECK_EQ(r->code & LOGREC_CODE_MASK, 0);
+}
+
+/* --------- Whole series, block by block --------- */
+static void TestSeries(void)
+{
+    TSCState s;
+    FlashRec r;
+    u32 len, pos = 0, i, n;
+
+    MakeSeries();
+    len = Encode(SERIES_LEN);
+
+    for(i = 0; i < SERIES_LEN && !TEST_FAILED(); i++)
+    {
+        if(i % BLOCK_RECS == 0)
+        {
+            CHECK_EQ(pos, blockAt[i / BLOCK_RECS]);
+            TSC_Start(&s, series[i].epoch);
+        }
+        n = TSC_Decode(&s, &stream[pos], len - pos, &r);
+        CHECK(n != 0);
+        CheckRec(&r, &series[i]);
+        pos += n;
+    }
+    CHECK_EQ(pos, len);
+
+    // Slow series: well under the 8 bytes of a FlashRec
+    printf("series: %u records, %.2f bytes/record\n",
+           SERIES_LEN, (double)len / SERIES_LEN);
+    CHECK(len < SERIES_LEN * 2);
+}
+
+/* --------- A lost block does not affect the next one --------- */
+static void TestResync(void)
+{
+    TSCState s;
+    FlashRec r;
+    u32 len, pos, i;
+
+    len = Encode(3 * BLOCK_RECS);
+    memset(&stream[blockAt[1]], 0xA5, blockAt[2] - blockAt[1]);
+
+    pos = blockAt[2];
+    TSC_Start(&s, series[2 * BLOCK_RECS].epoch);
+    for(i = 2 * BLOCK_RECS; i < 3 * BLOCK_RECS; i++)
+    {
+        pos += TSC_Decode(&s, &stream[pos], len - pos, &r);
+        CheckRec(&r, &series[i]);
+    }
+    CHECK_EQ(pos, len);
+}
+
+/* --------- Extremes of every field --------- */
+static void TestExtremes(void)
+{
+    static const u32 epochs[] =
+    {
+        0, 1, 0x7FFFFFFF, 0x80000000, 0xFFFFFFFF, 0, 0xFFFFFFFF, 1
+    };
+    static const s32 temps[] = { -32768, 32767, 0, -1, 1, 32767, -32768, 0 };
+    TSCState enc, dec;
+    FlashRec r;
+    Sample x;
+    u8 buf[TSC_REC_MAX];
+    u32 i, n;
+
+    TSC_Start(&enc, 0);
+    TSC_Start(&dec, 0);
+    for(i = 0; i < sizeof(epochs) / sizeof(epochs[0]); i++)
+    {
+        x.epoch = epochs[i];
+        x.temp  = temps[i];
+        x.ch    = i & 3;
+        x.flags = (u16)((i * 0x1000) & 0xF000);
+        n = TSC_Encode(&enc, buf, x.epoch, x.temp, x.ch, x.flags);
+        CHECK(n <= TSC_REC_MAX);
+        CHECK_EQ(TSC_Decode(&dec, buf, n, &r), n);
+        CheckRec(&r, &x);
+    }
+}
+
+/* --------- Truncated and malformed input --------- */
+static void TestTruncated(void)
+{
+    TSCState enc, dec;
+    FlashRec r;
+    u8 buf[TSC_REC_MAX];
+    u32 n, k;
+
+    TSC_Start(&enc, 100);
+    n = TSC_Encode(&enc, buf, 100 + 5000000, -20000, 2, LOGREC_F_RATE);
+    CHECK_EQ(n, TSC_REC_MAX - 1);
+    for(k = 0; k < n; k++)
+    {
+        TSC_Start(&dec, 100);
+        CHECK_EQ(TSC_Decode(&dec, buf, k, &r), 0);
+    }
+
+    // Varint longer than 5 bytes
+    memset(buf, 0xFF, sizeof(buf));
+    buf[0] = 0;
+    TSC_Start(&dec, 0);
+    CHECK_EQ(TSC_Decode(&dec, buf, sizeof(buf), &r), 0);
+}
+
+int main(void)
+{
+    TestSeries();
+    TestResync();
+    TestExtremes();
+    TestTruncated();
+    return TEST_END();
+}
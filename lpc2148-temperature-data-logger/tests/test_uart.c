@@ -0,0 +1,286 @@
+#include "test.h"            // CHECK / CHECK_EQ
+#include "types.h"           // Custom data types (u8, u32, u64)
+#include "sim.h"             // Register model, UART0 output tap
+#include "uart.h"            // Driver under test
+#include <LPC214X.H>          // U0DLL / U0DLM / U0FDR
+#include "uart_defines.h"    // Ring size and policy, divider fields
+#include "adc_defines.h"     // PCLK
+
+/* ================= OUTPUT CHECK ================= */
+/*
+ * Byte n of the stream is Seq(n), which does not repeat with the
+ * ring size, so the tap sees a lost, repeated, reordered or
+ * overwritten byte at once
+ */
+static u32 txNext;           // Next byte number to queue
+static u32 rxNext;           // Next byte number expected
+static u32 rxBad;            // Bytes not as expected
+
+static u8 Seq(u32 n)
+{
+    return (u8)(n + n / 251);
+}
+
+static void Tap(u8 byte)
+{
+    if(byte != Seq(rxNext))
+    {
+        if(!rxBad)
+            printf("byte %u: 0x%02x, expected 0x%02x\n", rxNext, byte, Seq(rxNext));
+        rxBad++;
+    }
+    rxNext++;
+}
+
+/*
+ * Function: Start
+ * Purpose : Fresh model and UART0 at baud, output checked
+ */
+static void Start(u32 baud)
+{
+    Sim_Init();
+    InitUART();
+    CHECK(UARTSetBaud(baud));
+    Sim_UartTap(Tap);
+    txNext = rxNext = rxBad = 0;
+    uartTxDropCnt   = 0;
+    uartTxHighWater = 0;
+}
+
+// Lets the ISR send everything queued
+static void Drain(void)
+{
+    while(!UARTTxIdle())
+        Sim_Idle(SIM_US(1000));
+}
+
+/* ================= RING FULL ================= */
+/*
+ * Queued faster than 9600 baud can send, the ring fills: one
+ * FIFO load leaves at once, then UART_TX_BUF_SIZE bytes fit and
+ * the next are refused (UART_TX_DROP_NEW) and counted. What was
+ * accepted goes out complete and in order; a line that does not
+ * fit is refused whole.
+ */
+static void TestFull(void)
+{
+    u8  line[40];
+    u32 i, taken = 0, drops;
+
+    Start(9600);
+    for(i = 0; i < UART_TX_BUF_SIZE + 64; i++)
+    {
+        if(UARTTxEnq(Seq(txNext)))
+        {
+            txNext++;
+            taken++;
+        }
+    }
+    drops = UART_TX_BUF_SIZE + 64 - taken;
+
+    CHECK(taken >= UART_TX_BUF_SIZE);
+    CHECK(taken <= UART_TX_BUF_SIZE + UART_TX_CHUNK);
+    CHECK_EQ(uartTxDropCnt, drops);
+    CHECK_EQ(UARTTxFree(), 0);
+    CHECK_EQ(uartTxHighWater, UART_TX_BUF_SIZE);
+
+    // Room for part of a line only: nothing of it is queued
+    Sim_Idle(SIM_US(1042 * 5 + 500));         // Five characters out
+    CHECK(UARTTxFree() >= 5 && UARTTxFree() < sizeof(line));
+    for(i = 0; i < sizeof(line); i++)
+        line[i] = Seq(txNext + i);
+    CHECK(!UARTTxBuf(line, sizeof(line)));
+    CHECK_EQ(uartTxDropCnt, drops + sizeof(line));
+
+    Drain();
+    CHECK_EQ(rxNext, taken);
+    CHECK_EQ(rxBad, 0);
+    CHECK_EQ(UARTTxFree(), UART_TX_BUF_SIZE);
+
+    // Fits again once drained
+    CHECK(UARTTxBuf(line, sizeof(line)));
+    txNext += sizeof(line);
+    Drain();
+    CHECK_EQ(rxNext, txNext);
+    CHECK_EQ(rxBad, 0);
+}
+
+/* ================= INDEX WRAP ================= */
+/*
+ * A long stream at 115200 baud, queued single bytes and lines
+ * of every length whenever there is room, takes the free-running
+ * indices round the ring many times: no byte may be lost, sent
+ * twice or reordered.
+ */
+static void TestWrap(void)
+{
+    u8  line[64];
+    u32 i, len, total = 20 * UART_TX_BUF_SIZE;
+
+    Start(115200);
+    while(txNext < total && !TEST_FAILED())
+    {
+        len = 1 + txNext % sizeof(line);
+        if(UARTTxFree() < len)
+        {
+            Sim_Idle(SIM_US(100));
+            continue;
+        }
+        if(len & 1)
+        {
+            for(i = 0; i < len; i++)
+                CHECK(UARTTxEnq(Seq(txNext++)));
+        }
+        else
+        {
+            for(i = 0; i < len; i++)
+                line[i] = Seq(txNext + i);
+            CHECK(UARTTxBuf(line, len));
+            txNext += len;
+        }
+    }
+    Drain();
+
+    CHECK_EQ(rxNext, txNext);
+    CHECK_EQ(rxBad, 0);
+    CHECK_EQ(uartTxDropCnt, 0);
+    CHECK(uartTxHighWater > UART_TX_BUF_SIZE - sizeof(line));
+    CHECK_EQ(simStats.uartLost, 0);
+    if(testFails)
+        printf("wrap: %u queued, %u sent, %u out of order\n", txNext, rxNext, rxBad);
+}
+
+/* ================= BAUD RATE DIVIDERS ================= */
+/*
+ * rate = PCLK / (16 * DL * (1 + DIVADDVAL / MULVAL))
+ * with 1 <= MULVAL <= 15, DIVADDVAL < MULVAL and DL >= 3 when
+ * DIVADDVAL is not 0 (LPC214x user manual).
+ */
+static f64 Rate(u32 dl, u32 fdr)
+{
+    u32 mul = (fdr >> MULVAL_BITS) & 15;
+    u32 div = (fdr >> DIVADDVAL_BITS) & 15;
+
+    return (f64)PCLK * mul / (16.0 * dl * (mul + div));
+}
+
+// Rate error in units of 0.01 %
+static f64 ErrOf(f64 rate, u32 baud)
+{
+    f64 e = (rate - baud) / baud * 10000;
+
+    return (e < 0) ? -e : e;
+}
+
+/*
+ * Function: BestErr
+ * Purpose : Smallest error any valid divider setting reaches
+ */
+static f64 BestErr(u32 baud)
+{
+    u32 mul, div, dl, k;
+    f64 e, best = 1e9;
+
+    for(mul = 1; mul <= 15; mul++)
+        for(div = 0; div < mul; div++)
+        {
+            dl = (u32)((f64)PCLK * mul / (16.0 * baud * (mul + div)));
+            for(k = 0; k < 2; k++, dl++)
+            {
+                if(dl == 0 || dl > 0xFFFF || (div && dl < 3))
+                    continue;
+                e = ErrOf(Rate(dl, (mul<<MULVAL_BITS) | (div<<DIVADDVAL_BITS)), baud);
+                if(e < best)
+                    best = e;
+            }
+        }
+    return best;
+}
+
+static u64 tapFirst, tapLast;
+static u32 tapCnt;
+
+static void TimeTap(u8 byte)
+{
+    if(!tapCnt++)
+        tapFirst = Sim_Now();
+    tapLast = Sim_Now();
+}
+
+/*
+ * Every rate of the edit menu at PCLK = 15 MHz: UARTCalcBaud
+ * picks a valid setting within 0.01 % of the best one, under
+ * UART_BAUD_MAX_ERR, and reports its error. UARTSetBaud programs
+ * exactly that setting, and characters leave the model at the
+ * rate it gives. A rate no setting reaches within the bound
+ * (460800: DL = 2 without the fractional divider is 1.7% fast)
+ * is refused and the dividers are left alone.
+ */
+static void TestBaud(void)
+{
+    u32 b, baud, dl, fdr, err, mul, div, n = 50;
+    f64 rate, e, t;
+
+    CHECK_EQ(PCLK, 15000000);
+    for(b = 0; b < UART_BAUD_COUNT && !TEST_FAILED(); b++)
+    {
+        baud = uartBaudTbl[b];
+        err  = UARTCalcBaud(baud, &dl, &fdr);
+        mul  = (fdr >> MULVAL_BITS) & 15;
+        div  = (fdr >> DIVADDVAL_BITS) & 15;
+
+        CHECK(mul >= 1 && div < mul);
+        CHECK(dl >= 1 && dl <= 0xFFFF);
+        CHECK(!div || dl >= 3);
+        rate = Rate(dl, fdr);
+        e    = ErrOf(rate, baud);
+        CHECK(e <= UART_BAUD_MAX_ERR);
+        CHECK(e <= BestErr(baud) + 1);
+        CHECK(err <= e + 1 && err + 1 >= e);
+
+        Start(baud);
+        U0LCR |= (1<<DLAB_BIT);
+        CHECK_EQ(U0DLL, dl & 0xFF);
+        CHECK_EQ(U0DLM, dl >> 8);
+        U0LCR &= ~(1<<DLAB_BIT);
+        CHECK_EQ(U0FDR, fdr);
+        CHECK_EQ(uartBaud, baud);
+
+        // n characters of 10 bits back to back, timed at the tap;
+        // the model rounds a character down to whole PCLK cycles
+        Sim_UartTap(TimeTap);
+        tapCnt = 0;
+        for(txNext = 0; txNext < n; txNext++)
+            UARTTxEnq(Seq(txNext));
+        Drain();
+        CHECK_EQ(tapCnt, n);
+        t = (f64)(tapLast - tapFirst) / (n - 1) - 10.0 * SIM_PCLK / rate;
+        CHECK(t > -1 && t <= 0);
+
+        printf("%6u baud: DL %4u MULVAL %2u DIVADDVAL %2u, %9.2f baud, error %.2f %%\n",
+               baud, dl, mul, div, rate, e / 100);
+    }
+
+    // Out of reach: refused, dividers unchanged
+    Start(9600);
+    U0LCR |= (1<<DLAB_BIT);
+    dl = U0DLL | (U0DLM << 8);
+    U0LCR &= ~(1<<DLAB_BIT);
+    fdr = U0FDR;
+    CHECK(UARTCalcBaud(460800, &mul, &div) > UART_BAUD_MAX_ERR);
+    CHECK(!UARTSetBaud(460800));
+    CHECK(!UARTSetBaud(2000000));
+    CHECK_EQ(uartBaud, 9600);
+    U0LCR |= (1<<DLAB_BIT);
+    CHECK_EQ(U0DLL | (U0DLM << 8), dl);
+    U0LCR &= ~(1<<DLAB_BIT);
+    CHECK_EQ(U0FDR, fdr);
+}
+
+int main(void)
+{
+    TestFull();
+    TestWrap();
+    TestBaud();
+    return TEST_END();
+}
@@ -0,0 +1,205 @@
+#include <LPC214X.H>          // VIC and Timer1 registers
+#include "test.h"            // CHECK / CHECK_EQ
+#include "types.h"           // Custom data types (u8, u32, u64)
+#include "sim.h"             // Register model, interrupt dispatch
+
+#define VIC_STATS 1          // Linked with fw_stats
+#include "vic.h"             // Framework under test
+#include "delay.h"           // Timer1 tick as an interrupt source
+#include "delay_defines.h"   // VIC_TIMER1_CHNL, T1 match bits
+
+/* ================= HANDLERS ================= */
+
+static u32 hitA, hitB, tickCnt;
+
+// Handler address as VICVectAddr holds it
+#define ISR(fn)  ((u32)(unsigned long)(fn))
+
+static void IsrA(void)
+{
+    hitA++;
+    T1IR = (1<<T1_MR0_INT);
+    VICVectAddr = 0;
+}
+
+static void IsrB(void)
+{
+    hitB++;
+    T1IR = (1<<T1_MR0_INT);
+    VICVectAddr = 0;
+}
+
+static void Tick(void)
+{
+    tickCnt++;
+}
+
+#define SLOT(n)  ((&VICVectCntl0)[n])
+#define ADDR(n)  ((&VICVectAddr0)[n])
+
+// Timer1 running, MR0 interrupt 100 us from now
+static void FireMr0(void)
+{
+    T1TCR = (1<<TCR_EN_BIT);
+    T1MR0 = T1TC + 100;
+    T1MCR = (1<<T1_MR0I_BIT);
+}
+
+/* ================= SLOT ALLOCATION ================= */
+/*
+ * A source gets the slot of its priority and is enabled. The
+ * same source may replace its own handler; another source
+ * asking for a taken slot is refused and leaves the slot alone.
+ * Once all 16 slots are taken no new source can register.
+ */
+static void TestRegister(void)
+{
+    u32 slot, src;
+
+    Sim_Init();
+    T1PR = 0;
+
+    CHECK(VIC_Register(VIC_TIMER1_CHNL, 3, ISR(IsrA)));
+    CHECK_EQ(SLOT(3), (1<<VIC_SLOT_EN_BIT) | VIC_TIMER1_CHNL);
+    CHECK_EQ(ADDR(3), ISR(IsrA));
+    CHECK(VICIntEnable & (1<<VIC_TIMER1_CHNL));
+    FireMr0();
+    Sim_Idle(SIM_US(200));
+    CHECK_EQ(hitA, 1);
+
+    // Own slot: new handler, still enabled
+    CHECK(VIC_Register(VIC_TIMER1_CHNL, 3, ISR(IsrB)));
+    CHECK_EQ(ADDR(3), ISR(IsrB));
+    FireMr0();
+    Sim_Idle(SIM_US(200));
+    CHECK_EQ(hitA, 1);
+    CHECK_EQ(hitB, 1);
+
+    // Another source in the slot, bad slot, bad source
+    CHECK(!VIC_Register(VIC_EINT0_CHNL, 3, ISR(IsrA)));
+    CHECK(!VIC_Register(VIC_EINT0_CHNL, VIC_NUM_SLOTS, ISR(IsrA)));
+    CHECK(!VIC_Register(VIC_SRC_MASK + 1, 4, ISR(IsrA)));
+    CHECK_EQ(SLOT(3), (1<<VIC_SLOT_EN_BIT) | VIC_TIMER1_CHNL);
+    CHECK_EQ(ADDR(3), ISR(IsrB));
+    CHECK(!(VICIntEnable & (1<<VIC_EINT0_CHNL)));
+    CHECK(!(SLOT(4) & (1<<VIC_SLOT_EN_BIT)));
+
+    // Fill every other slot with a source of its own (none fire)
+    for(slot = 0, src = 16; slot < VIC_NUM_SLOTS; slot++)
+        if(slot != 3)
+            CHECK(VIC_Register(src++, slot, ISR(IsrA)));
+    for(slot = 0; slot < VIC_NUM_SLOTS; slot++)
+        CHECK(!VIC_Register(VIC_EINT0_CHNL, slot, ISR(IsrA)));
+    CHECK(!(VICIntEnable & (1<<VIC_EINT0_CHNL)));
+    CHECK_EQ(ADDR(3), ISR(IsrB));
+    CHECK_EQ(hitA, 1);
+}
+
+/* ================= NESTED CRITICAL SECTIONS ================= */
+/*
+ * An inner VIC_Unlock re-enables only what its own VIC_Lock
+ * masked, so the outer section stays closed until its own
+ * VIC_Unlock. A source that was off before stays off. A tick
+ * that falls due inside the section runs right after it.
+ */
+static void TestLock(void)
+{
+    u32 on, outer, inner;
+
+    Sim_Init();
+    Delay_Init();
+    VIC_Enable(VIC_EINT1_CHNL);
+    VIC_Disable(VIC_EINT2_CHNL);
+    on = VICIntEnable;
+    CHECK(on & (1<<VIC_TIMER1_CHNL));
+
+    tickCnt = 0;
+    Tick_StartPeriodic(Tick, 1000);
+
+    outer = VIC_Lock(VIC_ALL);
+    CHECK_EQ(outer, on);
+    CHECK_EQ(VICIntEnable, 0);
+
+    inner = VIC_Lock(1<<VIC_TIMER1_CHNL);
+    CHECK_EQ(inner, 0);                       // Already masked
+    Sim_Idle(SIM_US(1500));                   // Tick due at 1000 us
+    VIC_Unlock(inner);
+    CHECK_EQ(VICIntEnable, 0);
+    Sim_Idle(SIM_US(10));
+    CHECK_EQ(tickCnt, 0);
+
+    VIC_Unlock(outer);
+    CHECK_EQ(VICIntEnable, on);
+    CHECK(!(VICIntEnable & (1<<VIC_EINT2_CHNL)));
+    Sim_Idle(0);
+    CHECK_EQ(tickCnt, 1);                     // Held, then taken
+
+    // Inner section over part of the sources, outer over the rest
+    outer = VIC_Lock(1<<VIC_EINT1_CHNL);
+    inner = VIC_Lock(VIC_ALL);
+    CHECK_EQ(inner, on & ~(1<<VIC_EINT1_CHNL));
+    VIC_Unlock(inner);
+    CHECK_EQ(VICIntEnable, on & ~(1<<VIC_EINT1_CHNL));
+    VIC_Unlock(outer);
+    CHECK_EQ(VICIntEnable, on);
+}
+
+/* ================= LATENCY AND DURATION ================= */
+/*
+ * The Timer1 tick records one latency sample per match: the
+ * interrupt entry cost when the CPU is free, and the whole
+ * masked time when a critical section holds it off. Every entry
+ * counts its body time; VIC_ClearStats zeroes it all.
+ */
+static void TestStats(void)
+{
+    VicStats *v = &vicStats[VIC_PRIO_TIMER1];
+    u32 due, held, save;
+
+    Sim_Init();
+    Delay_Init();
+    VIC_ClearStats();
+    tickCnt = 0;
+    Tick_StartPeriodic(Tick, 1000);
+
+    Sim_Idle(SIM_US(100000) + SIM_US(500));
+    CHECK_EQ(v->count, 100);
+    CHECK_EQ(v->latCount, 100);
+    CHECK(v->latMax >= SIM_IRQ_CYCLES);
+    CHECK(v->latMax <= SIM_IRQ_CYCLES + 16 * SIM_ACCESS_CYCLES);
+    CHECK(v->latTotal >= (u64)v->latCount * SIM_IRQ_CYCLES);
+    CHECK(v->latTotal <= (u64)v->latCount * v->latMax);
+    CHECK(v->durMax > 0);
+    CHECK(v->durTotal <= (u64)v->count * v->durMax);
+    CHECK(v->durTotal >= v->count);
+    if(testFails)
+        printf("tick: %u entries, latency max %u cycles, body max %u cycles\n",
+               v->count, v->latMax, v->durMax);
+
+    // A critical section across the next match: the latency is
+    // the time from the match to the unlock
+    Sim_Idle(SIM_US(400));
+    due  = T1MR1;
+    save = VIC_Lock(VIC_ALL);
+    Sim_Idle(SIM_US(400));
+    held = Tick_Now() - due;
+    VIC_Unlock(save);
+    Sim_Idle(0);
+    CHECK_EQ(v->count, 101);
+    CHECK(held > 250 && held < 350);
+    CHECK(v->latMax >= SIM_US(held));
+    CHECK(v->latMax <= SIM_US(held + 2));
+
+    VIC_ClearStats();
+    CHECK(!v->count && !v->latCount && !v->latMax && !v->latTotal);
+    CHECK(!v->durMax && !v->durTotal);
+    CHECK_EQ(tickCnt, 101);
+}
+
+int main(void)
+{
+    TestRegister();
+    TestLock();
+    TestStats();
+    return TEST_END();
+}